@@ -0,0 +1,134 @@
+/**
+ * @file bench_http1.cpp
+ * @author DrkWithT
+ * @brief Microbenchmarks of request parsing and reply serialization over the in-memory transport.
+ * @date 2024-09-04
+ */
+
+#include <algorithm>
+#include <array>
+#include <string>
+#include <string_view>
+#include <utility>
+#include "netio/transport.hpp"
+#include "http1/reader.hpp"
+#include "http1/statics.hpp"
+#include "http1/writer.hpp"
+#include "corpus.hpp"
+#include "harness.hpp"
+
+using namespace ToyServer::Http1;
+using namespace ToyServer::Bench;
+using ToyServer::NetIO::MemoryTransport;
+
+/// @brief Requests per stream, enough that refilling the transport between rounds is noise.
+static constexpr std::size_t stream_request_count = 256;
+
+/**
+ * @brief A reader served a request stream from memory, restarting the stream once it is used up.
+ */
+class RequestFeed
+{
+private:
+    MemoryTransport pipe;
+    BasicHttpReader<MemoryTransport> reader;
+    RequestStream stream;
+    std::size_t next_idx;
+
+public:
+    explicit RequestFeed(RequestStream stream_)
+    : pipe {}, reader {}, stream {std::move(stream_)}, next_idx {stream.sizes.size()} {}
+
+    /// @return Octets of the request `nextView()` or `nextRequest()` will return next.
+    std::size_t prepare()
+    {
+        if (next_idx == stream.sizes.size())
+        {
+            pipe.reset();
+            pipe.pushInput(stream.octets);
+            reader.resetState(&pipe);
+            next_idx = 0;
+        }
+
+        return stream.sizes[next_idx++];
+    }
+
+    [[nodiscard]] BasicHttpReader<MemoryTransport>& getReader() noexcept { return reader; }
+};
+
+/// @brief Reads a request view and all of its body, like a handler that uses every octet.
+static std::size_t readWholeView(RequestFeed& feed)
+{
+    std::size_t request_size = feed.prepare();
+    RequestView req = feed.getReader().nextView();
+
+    while (!req.body_reader->readSome().empty()) {}
+
+    return request_size;
+}
+
+static FixedBuffer makeBody(std::string_view text)
+{
+    FixedBuffer body {text.length()};
+    std::copy(text.begin(), text.end(), body.getBasePtr());
+
+    return body;
+}
+
+int main(int argc, char* argv[])
+{
+    BenchReport report {"http1", argc, argv};
+
+    {
+        std::array<std::string, 1> json_post {makeJsonPost()};
+        std::array<std::string, 1> chunked_post {makeChunkedPost()};
+
+        RequestFeed browser_feed {makeRequestStream(browser_heads, stream_request_count)};
+        RequestFeed client_feed {makeRequestStream(client_heads, stream_request_count)};
+        RequestFeed json_feed {makeRequestStream(json_post, stream_request_count)};
+        RequestFeed chunked_feed {makeRequestStream(chunked_post, stream_request_count)};
+        RequestFeed owned_feed {makeRequestStream(browser_heads, stream_request_count)};
+
+        report.run("HttpReader::nextView browser GET", [&browser_feed] { return readWholeView(browser_feed); });
+        report.run("HttpReader::nextView client GET", [&client_feed] { return readWholeView(client_feed); });
+        report.run("HttpReader::nextView JSON POST", [&json_feed] { return readWholeView(json_feed); });
+        report.run("HttpReader::nextView chunked POST", [&chunked_feed] { return readWholeView(chunked_feed); });
+
+        report.run("HttpReader::nextRequest browser GET", [&owned_feed] {
+            std::size_t request_size = owned_feed.prepare();
+            Request req = owned_feed.getReader().nextRequest();
+
+            return request_size + (req.headers.size() & 1);
+        });
+    }
+
+    {
+        MemoryTransport pipe {};
+        BasicHttpWriter<MemoryTransport> writer {&pipe};
+
+        Response text_reply {Schema::http_1_1, Status::stat_ok, "", {}, makeBody("{\"status\":\"ok\",\"items\":[1,2,3]}")};
+        text_reply.headers["Content-Type"] = "application/json";
+        text_reply.headers["Cache-Control"] = "no-store";
+        text_reply.headers["X-Request-Id"] = "4f1c9a2b";
+
+        Response missing_reply = StaticFiles::makeStatusReply(Schema::http_1_1, Status::stat_not_found);
+
+        auto sendReplies = [&pipe, &writer](const Response& reply, int reply_count) {
+            for (int reply_idx = 0; reply_idx < reply_count; reply_idx++)
+                writer.queueReply(reply, true);
+
+            writer.flush();
+
+            std::size_t sent_count = pipe.getOutput().length();
+            pipe.clearOutput();
+
+            return sent_count;
+        };
+
+        report.run("HttpWriter JSON 200", [&sendReplies, &text_reply] { return sendReplies(text_reply, 1); });
+        report.run("HttpWriter canned 404", [&sendReplies, &missing_reply] { return sendReplies(missing_reply, 1); });
+        report.run("HttpWriter JSON 200 x16 pipelined", [&sendReplies, &text_reply] { return sendReplies(text_reply, 16); });
+    }
+
+    return report.finish();
+}
@@ -0,0 +1,55 @@
+/**
+ * @file bench_metrics.cpp
+ * @author DrkWithT
+ * @brief Microbenchmarks of metric recording and scraping.
+ * @date 2024-09-06
+ */
+
+#include <chrono>
+#include <string>
+#include "metrics/metrics.hpp"
+#include "harness.hpp"
+
+using namespace ToyServer;
+using namespace ToyServer::Metrics;
+using namespace ToyServer::Bench;
+
+int main(int argc, char* argv[])
+{
+    BenchReport report {"metrics", argc, argv};
+    std::chrono::nanoseconds fake_time {1};
+
+    // recording sits on the request path, so these should stay at a few ns
+    report.run("ThreadMetrics::add", [] {
+        threadMetrics().add(Counter::c_bytes_in, 64);
+
+        return std::size_t {0};
+    });
+
+    report.run("ThreadMetrics::countRequest", [] {
+        threadMetrics().countRequest(Http1::Method::h1_get, Http1::Status::stat_ok);
+
+        return std::size_t {0};
+    });
+
+    // spreads the samples over every bucket so the branch on the exponent is not always predicted
+    report.run("ThreadMetrics::observe", [&fake_time] {
+        fake_time = std::chrono::nanoseconds {(fake_time.count() * 5 + 3) & 0x3ffffffffLL};
+        threadMetrics().observe(Timer::t_handler, fake_time);
+
+        return std::size_t {0};
+    });
+
+    report.run("collectMetrics", [] {
+        return collectMetrics().block_count;
+    });
+
+    report.run("writePrometheus", [] {
+        std::string text {};
+        writePrometheus(collectMetrics(), text);
+
+        return text.length();
+    });
+
+    return report.finish();
+}
@@ -0,0 +1,71 @@
+/**
+ * @file bench_netio.cpp
+ * @author DrkWithT
+ * @brief Microbenchmarks of pooled buffers and the read-ahead ring.
+ * @date 2024-09-04
+ */
+
+#include <string>
+#include <utility>
+#include "netio/buffers.hpp"
+#include "netio/transport.hpp"
+#include "corpus.hpp"
+#include "harness.hpp"
+
+using namespace ToyServer::NetIO;
+using namespace ToyServer::Bench;
+
+int main(int argc, char* argv[])
+{
+    BenchReport report {"netio", argc, argv};
+
+    // sizes of a small reply body and of a static file read into memory
+    for (std::size_t buffer_size : {std::size_t {512}, std::size_t {16384}})
+    {
+        std::string size_tag = std::to_string(buffer_size);
+        FixedBuffer source {buffer_size};
+        FixedBuffer moved {buffer_size};
+        std::string content(buffer_size - 1, 'x'); // loadChars keeps room for a NUL
+
+        report.run("FixedBuffer ctor " + size_tag, [buffer_size] {
+            FixedBuffer buffer {buffer_size};
+            buffer[0] = 'a';
+
+            return buffer.getCapacity();
+        });
+
+        report.run("FixedBuffer copy " + size_tag, [&source] {
+            FixedBuffer copy {source};
+
+            return copy.getCapacity();
+        });
+
+        report.run("FixedBuffer move " + size_tag, [&moved] {
+            FixedBuffer target {std::move(moved)};
+            moved = std::move(target);
+
+            return moved.getCapacity();
+        });
+
+        report.run("FixedBuffer::loadChars " + size_tag, [&source, &content] {
+            return (source.loadChars(content)) ? content.length() : 0;
+        });
+    }
+
+    {
+        MemoryTransport pipe {};
+
+        // consumed heads walk around the ring, so now and then one wraps and gets rotated by linearizing
+        report.run("MemoryTransport fill+peek browser head", [&pipe] {
+            pipe.pushInput(browser_heads[0]);
+            [[maybe_unused]] auto fill_status = pipe.fillReadAhead();
+
+            std::size_t buffered = pipe.peekReadAhead().length();
+            pipe.consumeReadAhead(buffered);
+
+            return buffered;
+        });
+    }
+
+    return report.finish();
+}
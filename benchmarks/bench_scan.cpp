@@ -0,0 +1,92 @@
+/**
+ * @file bench_scan.cpp
+ * @author DrkWithT
+ * @brief Microbenchmark of the header scanning kernels over browser-like requests.
+ * @date 2024-08-20
+ */
+
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <string_view>
+#include "http1/scanner.hpp"
+#include "corpus.hpp"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+using namespace ToyServer::Http1;
+using ToyServer::Bench::browser_heads;
+
+static constexpr int bench_rounds = 200000;
+
+static std::uint64_t readTicks() noexcept
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return static_cast<std::uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count());
+#endif
+}
+
+/// @brief Splits a head into lines and fields the way `HttpReader` does, returning a checksum so the work is not optimized out.
+static std::size_t scanHead(const ScanKernels& kernels, std::string_view head) noexcept
+{
+    std::size_t checksum = 0;
+
+    while (!head.empty())
+    {
+        std::size_t line_end = kernels.find_any(head.data(), head.length(), scan_line_end);
+        std::size_t colon_pos = kernels.find_any(head.data(), line_end, scan_colon);
+
+        if (colon_pos < line_end)
+            checksum += colon_pos + kernels.is_token(head.data(), colon_pos);
+
+        std::size_t skip = line_end + 1;
+
+        if (skip < head.length() && head[line_end] == '\r' && head[skip] == '\n')
+            skip++;
+
+        head.remove_prefix(std::min(skip, head.length()));
+    }
+
+    return checksum;
+}
+
+int main()
+{
+    std::size_t head_bytes = 0;
+
+    for (auto head : browser_heads)
+        head_bytes += head.length();
+
+    std::cout << "detected level: " << getScanKernels(detectScanLevel()).name << '\n';
+
+    for (ScanLevel level : {ScanLevel::scan_scalar, ScanLevel::scan_sse2, ScanLevel::scan_avx2})
+    {
+        const ScanKernels& kernels = getScanKernels(level);
+
+        if (level != ScanLevel::scan_scalar && &kernels == &getScanKernels(ScanLevel::scan_scalar))
+            continue;
+
+        volatile std::size_t sink = 0;
+        auto wall_start = std::chrono::steady_clock::now();
+        std::uint64_t tick_start = readTicks();
+
+        for (int round = 0; round < bench_rounds; round++)
+        {
+            for (auto head : browser_heads)
+                sink = sink + scanHead(kernels, head);
+        }
+
+        std::uint64_t ticks = readTicks() - tick_start;
+        auto wall_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - wall_start).count();
+        double total_bytes = static_cast<double>(head_bytes) * bench_rounds;
+
+        std::cout << kernels.name
+            << ": " << total_bytes / static_cast<double>(ticks) << " bytes/tick, "
+            << total_bytes / static_cast<double>(wall_ns) << " bytes/ns, "
+            << static_cast<double>(wall_ns) / (bench_rounds * std::size(browser_heads)) << " ns/head\n";
+    }
+}
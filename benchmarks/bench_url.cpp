@@ -0,0 +1,69 @@
+/**
+ * @file bench_url.cpp
+ * @author DrkWithT
+ * @brief Microbenchmark of the token based URL parser against the single pass URL view.
+ * @date 2024-09-01
+ */
+
+#include <memory_resource>
+#include <string_view>
+#include "uri/parse.hpp"
+#include "uri/view.hpp"
+#include "corpus.hpp"
+#include "harness.hpp"
+
+using namespace ToyServer::Uri;
+using namespace ToyServer::Bench;
+
+/// @brief Runs `parse_fn` on the next sample target each call, so one op is one URL.
+template <typename ParseFn>
+static auto cycleTargets(ParseFn parse_fn)
+{
+    return [parse_fn, target_idx = std::size_t {0}]() mutable {
+        std::string_view target = sample_targets[target_idx];
+        target_idx = (target_idx + 1) % std::size(sample_targets);
+
+        return parse_fn(target);
+    };
+}
+
+int main(int argc, char* argv[])
+{
+    BenchReport report {"uri", argc, argv};
+    UrlParser parser {};
+
+    // both sides touch the path and every parameter, so neither skips work the other does, and each returns the octets it looked at
+    report.run("UrlParser::parseAll", cycleTargets([&parser](std::string_view target) {
+        parser.reset(target);
+        Url url = parser.parseAll();
+        std::size_t checksum = url.path.length();
+
+        if (url.tag == UrlItemTag::ur_params)
+        {
+            for (const auto& [key, value] : std::get<url_params_t>(url.content))
+                checksum += key.length() + value.length();
+        }
+
+        return target.length() + (checksum & 1);
+    }));
+
+    report.run("parseUrlView", cycleTargets([](std::string_view target) {
+        std::optional<UrlView> url = parseUrlView(target);
+        std::size_t checksum = url->path.length();
+
+        for (const auto& [key, value] : url->getParams())
+            checksum += key.length() + value.length();
+
+        return target.length() + (checksum & 1);
+    }));
+
+    std::pmr::unsynchronized_pool_resource url_pool {};
+
+    report.run("parseUrlView+toOwnedUrl pooled", cycleTargets([&url_pool](std::string_view target) {
+        Url url = toOwnedUrl(*parseUrlView(target), &url_pool);
+
+        return target.length() + (url.path.length() & 1);
+    }));
+
+    return report.finish();
+}
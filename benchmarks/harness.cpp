@@ -0,0 +1,167 @@
+/**
+ * @file harness.cpp
+ * @author DrkWithT
+ * @brief Implements the microbenchmark runner, its reports and the allocation counter.
+ * @date 2024-09-04
+ */
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <new>
+#include <utility>
+#include "harness.hpp"
+
+static std::atomic<std::size_t> alloc_counter {0};
+
+/* counting replacements of the global allocation functions, array forms forward to these */
+
+void* operator new(std::size_t size)
+{
+    alloc_counter.fetch_add(1, std::memory_order_relaxed);
+
+    if (void* block = std::malloc((size > 0) ? size : 1); block)
+        return block;
+
+    throw std::bad_alloc {};
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment)
+{
+    alloc_counter.fetch_add(1, std::memory_order_relaxed);
+
+    // aligned_alloc wants the size to be a multiple of the alignment
+    std::size_t align = static_cast<std::size_t>(alignment);
+
+    if (void* block = std::aligned_alloc(align, (size + align - 1) / align * align + ((size == 0) ? align : 0)); block)
+        return block;
+
+    throw std::bad_alloc {};
+}
+
+void operator delete(void* block) noexcept
+{
+    std::free(block);
+}
+
+void operator delete(void* block, [[maybe_unused]] std::size_t size) noexcept
+{
+    std::free(block);
+}
+
+void operator delete(void* block, [[maybe_unused]] std::align_val_t alignment) noexcept
+{
+    std::free(block);
+}
+
+void operator delete(void* block, [[maybe_unused]] std::size_t size, [[maybe_unused]] std::align_val_t alignment) noexcept
+{
+    std::free(block);
+}
+
+namespace ToyServer::Bench
+{
+    /// @brief Writes `text` as a JSON string literal. Benchmark names are plain ASCII, so only quotes and backslashes need escapes.
+    static void putJsonString(std::ostream& out, std::string_view text)
+    {
+        out << '"';
+
+        for (char c : text)
+        {
+            if (c == '"' || c == '\\')
+                out << '\\';
+
+            out << c;
+        }
+
+        out << '"';
+    }
+
+    std::size_t getAllocCount() noexcept
+    {
+        return alloc_counter.load(std::memory_order_relaxed);
+    }
+
+    /* BenchReport private impl. */
+
+    void BenchReport::record(BenchResult result)
+    {
+        if (!json_output)
+        {
+            std::printf("%-44s %12.1f ns/op %10.2f allocs/op %10.1f MB/s\n", result.name.c_str(), result.ns_per_op, result.allocs_per_op, result.bytes_per_sec / 1e6);
+            std::fflush(stdout);
+        }
+
+        results.push_back(std::move(result));
+    }
+
+    /* BenchReport public impl. */
+
+    BenchReport::BenchReport(std::string_view suite_, int argc, char* argv[])
+    : results {}, suite {suite_}, filter {}, json_path {}, json_output {false}
+    {
+        for (int arg_idx = 1; arg_idx < argc; arg_idx++)
+        {
+            std::string_view arg {argv[arg_idx]};
+
+            if (arg == "--json")
+            {
+                json_output = true;
+            }
+            else if (arg.starts_with("--json="))
+            {
+                json_output = true;
+                json_path = arg.substr(7);
+            }
+            else if (arg.starts_with("--filter="))
+            {
+                filter = arg.substr(9);
+            }
+            else
+            {
+                std::cerr << "usage: " << argv[0] << " [--json | --json=<file>] [--filter=<text>]\n";
+                std::exit(2);
+            }
+        }
+    }
+
+    int BenchReport::finish() const
+    {
+        if (!json_output)
+            return 0;
+
+        std::ofstream json_file;
+
+        if (!json_path.empty())
+        {
+            json_file.open(json_path);
+
+            if (!json_file)
+            {
+                std::cerr << "Failed to open " << json_path << '\n';
+                return 1;
+            }
+        }
+
+        std::ostream& out = (json_path.empty()) ? std::cout : json_file;
+
+        out << "{\n  \"suite\": ";
+        putJsonString(out, suite);
+        out << ",\n  \"results\": [";
+
+        for (std::size_t result_idx = 0; result_idx < results.size(); result_idx++)
+        {
+            const auto& [name, op_count, ns_per_op, allocs_per_op, bytes_per_sec] = results[result_idx];
+
+            out << ((result_idx > 0) ? ",\n" : "\n") << "    {\"name\": ";
+            putJsonString(out, name);
+            out << ", \"ops\": " << op_count << ", \"ns_per_op\": " << ns_per_op << ", \"allocs_per_op\": " << allocs_per_op << ", \"bytes_per_sec\": " << bytes_per_sec << '}';
+        }
+
+        out << "\n  ]\n}\n";
+
+        return (out) ? 0 : 1;
+    }
+}
@@ -0,0 +1,96 @@
+#ifndef HARNESS_HPP
+#define HARNESS_HPP
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace ToyServer::Bench
+{
+    /**
+     * @brief Averages of one measured batch.
+     */
+    struct BenchResult
+    {
+        std::string name;
+        std::size_t op_count;
+        double ns_per_op;
+        double allocs_per_op;
+        double bytes_per_sec;
+    };
+
+    /// @return Calls to the global `operator new` so far, counted by the harness' replacement of it.
+    [[nodiscard]] std::size_t getAllocCount() noexcept;
+
+    /**
+     * @brief Runs microbenchmarks and reports them as text lines or, with `--json` / `--json=<file>`, as one JSON document to diff between releases. `--filter=<text>` runs only benchmarks whose name contains the text.
+     */
+    class BenchReport
+    {
+    private:
+        static constexpr std::int64_t min_batch_ns = 200'000'000;
+        static constexpr std::size_t max_op_count = std::size_t {1} << 32;
+        static constexpr int warmup_op_count = 1000;
+
+        std::vector<BenchResult> results;
+        std::string suite;
+        std::string filter;
+        std::string json_path;
+        bool json_output;
+
+        void record(BenchResult result);
+
+    public:
+        BenchReport(std::string_view suite_, int argc, char* argv[]);
+
+        BenchReport(const BenchReport& other) = delete;
+        BenchReport& operator=(const BenchReport& other) = delete;
+
+        /// @brief Times batches of `op_fn` calls, doubling the batch until one lasts long enough to trust.
+        /// @param op_fn Does one operation and returns the octets it processed, which also keeps its work from being optimized out.
+        template <typename OpFn>
+        void run(std::string_view name, OpFn op_fn)
+        {
+            if (!filter.empty() && name.find(filter) == std::string_view::npos)
+                return;
+
+            volatile std::size_t sink = 0;
+
+            // pools, arenas and string capacities settle before anything is counted
+            for (int op_idx = 0; op_idx < warmup_op_count; op_idx++)
+                sink = sink + op_fn();
+
+            for (std::size_t op_count = 1;; op_count *= 2)
+            {
+                std::size_t byte_count = 0;
+                std::size_t allocs_before = getAllocCount();
+                auto wall_start = std::chrono::steady_clock::now();
+
+                for (std::size_t op_idx = 0; op_idx < op_count; op_idx++)
+                    byte_count += op_fn();
+
+                auto wall_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - wall_start).count();
+                std::size_t alloc_count = getAllocCount() - allocs_before;
+
+                sink = sink + byte_count;
+
+                if (wall_ns < min_batch_ns && op_count < max_op_count)
+                    continue;
+
+                double ops = static_cast<double>(op_count);
+
+                record({std::string {name}, op_count, static_cast<double>(wall_ns) / ops, static_cast<double>(alloc_count) / ops,
+                    static_cast<double>(byte_count) * 1e9 / static_cast<double>(wall_ns)});
+                return;
+            }
+        }
+
+        /// @brief Writes the JSON document when asked for.
+        /// @return Exit code for `main`.
+        [[nodiscard]] int finish() const;
+    };
+}
+
+#endif
@@ -0,0 +1,147 @@
+#ifndef BODIES_HPP
+#define BODIES_HPP
+
+#include <optional>
+#include <string_view>
+#include "netio/sockets.hpp"
+#include "netio/transport.hpp"
+
+namespace ToyServer::Http1
+{
+    /// @brief Throws the std::runtime_error matching a failed read-ahead fill.
+    [[noreturn]] void failFill(NetIO::IOStatus status);
+
+    /// @brief Reads more request octets, throwing std::runtime_error on timeouts and hang ups.
+    template <NetIO::Transport T>
+    void fillOrThrow(T& transport)
+    {
+        if (NetIO::IOStatus status = transport.fillReadAhead(); status != NetIO::IOStatus::io_ok)
+            failFill(status);
+    }
+
+    /**
+     * @brief Read-ahead of whichever transport a reader runs on, so `BodyReader` stays one type for every `RequestView`. Only called once per body slice or refill.
+     */
+    struct ReadAheadSource
+    {
+        void* transport;
+        NetIO::IOStatus (*fill)(void* transport);
+        std::string_view (*peek)(void* transport) noexcept;
+        void (*consume)(void* transport, std::size_t count) noexcept;
+
+        template <NetIO::Transport T>
+        [[nodiscard]] static ReadAheadSource of(T& transport) noexcept
+        {
+            return {
+                &transport,
+                [](void* target) { return static_cast<T*>(target)->fillReadAhead(); },
+                [](void* target) noexcept { return static_cast<T*>(target)->peekReadAhead(); },
+                [](void* target, std::size_t count) noexcept { static_cast<T*>(target)->consumeReadAhead(count); }
+            };
+        }
+    };
+
+    /**
+     * @brief One decoding step: `consumed` input octets cover framing plus the returned `data` slice, which points into the input.
+     */
+    struct DecodeStep
+    {
+        std::size_t consumed;
+        std::string_view data;
+    };
+
+    /**
+     * @brief Incremental decoder for `Transfer-Encoding: chunked`. Input may be split anywhere, and no octet is buffered: chunk data comes back as slices of the caller's input.
+     * @note Chunk extensions and trailer fields are skipped. Throws std::runtime_error on malformed framing.
+     */
+    class ChunkedDecoder
+    {
+    private:
+        static constexpr std::size_t max_line_size = 8192; // bound for a chunk extension or one trailer field
+
+        enum class State
+        {
+            st_size,
+            st_extension,
+            st_size_lf,
+            st_data,
+            st_data_end,
+            st_data_lf,
+            st_trailer_start,
+            st_trailer,
+            st_final_lf,
+            st_done,
+            last = st_done
+        };
+
+        std::size_t chunk_left;  // octets of the current chunk still to come, or its size while the size line is read
+        std::size_t line_size;   // octets of the extension or trailer field being skipped
+        std::size_t digit_count;
+        State state;
+
+        void endSizeLine();
+
+    public:
+        ChunkedDecoder() noexcept;
+
+        void reset() noexcept;
+
+        /// @brief Decodes framing up to the first data slice or the end of `input`.
+        /// @note Only returns with empty `data` once all of `input` is consumed or the terminating chunk is reached.
+        [[nodiscard]] DecodeStep decode(std::string_view input);
+
+        [[nodiscard]] bool isDone() const noexcept { return state == State::st_done; }
+    };
+
+    /**
+     * @brief Pull side of a request body, handed out through `RequestView::body_reader`. Bodies that fit the receive buffer come back as one slice, larger or chunked ones as a run of slices read straight from it, so memory stays bounded whatever the upload size.
+     * @note Each slice is valid until the next call. Throws std::runtime_error on I/O failures, bad framing, and bodies over the reader's size limit.
+     */
+    class BodyReader
+    {
+    private:
+        enum class Framing
+        {
+            framing_buffered, // whole body already in the view
+            framing_length,   // `Content-Length` body past the receive buffer
+            framing_chunked,
+            last = framing_chunked
+        };
+
+        ChunkedDecoder decoder;
+        std::string_view buffered_body;
+        ReadAheadSource source;
+        std::size_t length_left;   // `Content-Length` octets still on the wire
+        std::size_t read_count;    // body octets handed out
+        std::size_t max_body_size;
+        std::size_t slice_consume; // octets of the last slice, released on the next call
+        Framing framing;
+        bool finished;             // no body octets are left on the connection
+
+        void releaseSlice() noexcept;
+
+    public:
+        BodyReader() noexcept;
+
+        BodyReader(const BodyReader& other) = delete;
+        BodyReader& operator=(const BodyReader& other) = delete;
+
+        /// @brief Used by `HttpReader` for a body already buffered with its head.
+        void resetBuffered(std::string_view body) noexcept;
+
+        /// @brief Used by `HttpReader` for a body still arriving, framed by `content_len` or else chunked.
+        void resetStreamed(ReadAheadSource source_, std::optional<std::size_t> content_len, std::size_t max_body_size_) noexcept;
+
+        /// @return The next body slice, or empty at the end.
+        [[nodiscard]] std::string_view readSome();
+
+        /// @brief Reads and drops whatever the handler left of the body, so the next request can be parsed.
+        void skipRest();
+
+        [[nodiscard]] bool isFinished() const noexcept { return finished; }
+
+        [[nodiscard]] std::size_t getReadCount() const noexcept { return read_count; }
+    };
+}
+
+#endif
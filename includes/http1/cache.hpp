@@ -0,0 +1,110 @@
+#ifndef CACHE_HPP
+#define CACHE_HPP
+
+#include <cstdint>
+#include <array>
+#include <atomic>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include "netio/files.hpp"
+#include "netio/queues.hpp"
+#include "http1/messages.hpp"
+#include "http1/statics.hpp"
+
+namespace ToyServer::Http1
+{
+    /**
+     * @brief Sizing options for `StaticCache`.
+     */
+    struct CacheLimits
+    {
+        std::size_t memory_budget;  // octets across all cached replies
+        std::size_t max_entry_size; // larger files bypass the cache and go out by `sendfile`
+    };
+
+    /**
+     * @brief Snapshot of the cache counters.
+     */
+    struct CacheStats
+    {
+        std::uint64_t hits;
+        std::uint64_t misses;
+        std::uint64_t evictions;
+        std::size_t entry_count;
+        std::size_t used_bytes;
+    };
+
+    /**
+     * @brief Size bounded LRU cache of small static files, each kept as one fully serialized reply. A hit costs no stat, open or formatting: the writer sends the shared bytes in place with one gathering write.
+     * @note Safe to share between worker threads. Entries are split over independently locked shards, and a hit holds its shard's lock only long enough to bump the LRU order and copy a `shared_ptr`. Cached files are not revalidated, so call `clear()` after deploying new assets.
+     */
+    class StaticCache
+    {
+    private:
+        static constexpr std::size_t shard_count = 16;
+        static constexpr std::size_t entry_overhead = 128; // rough map and list node cost per entry
+
+        /// @brief Prebuilt reply plus what a 304 for it needs, so a revalidation hit skips the stat too.
+        struct CachedReply : PrebuiltReply
+        {
+            std::string etag;
+            bool varies; // the reply has a `Vary: Accept-Encoding` line
+        };
+
+        struct CacheEntry
+        {
+            std::shared_ptr<const CachedReply> reply;
+            std::list<std::string>::iterator lru_pos;
+            std::size_t charge;
+        };
+
+        struct alignas(NetIO::cache_line_size) Shard
+        {
+            mutable std::mutex lock;
+            std::unordered_map<std::string, CacheEntry> entries;
+            std::list<std::string> lru; // most recently used first
+            std::size_t used_bytes = 0;
+            std::atomic<std::uint64_t> hits = 0;
+            std::atomic<std::uint64_t> misses = 0;
+            std::atomic<std::uint64_t> evictions = 0;
+        };
+
+        std::array<Shard, shard_count> shards;
+        const StaticFiles& files;
+        CacheLimits limits;
+
+        [[nodiscard]] Shard& pickShard(const std::string& key) noexcept;
+
+        [[nodiscard]] std::shared_ptr<const CachedReply> lookup(Shard& shard, const std::string& key);
+
+        /// @return The entry now cached under `key`, which is an earlier racing insert's reply if there was one.
+        std::shared_ptr<const CachedReply> insert(Shard& shard, const std::string& key, std::shared_ptr<const CachedReply> reply);
+
+        [[nodiscard]] static std::shared_ptr<const CachedReply> buildReply(const NetIO::FileHandle& file, const NetIO::FileStats& stats, std::string_view relative, Coding coding);
+
+        /// @return The cached reply, or a 304 when `if_none_match` names its `ETag`.
+        [[nodiscard]] static Response makeCachedReply(Method method, Schema schema, std::shared_ptr<const CachedReply> reply, std::string_view if_none_match);
+
+    public:
+        /// @note `files_` must outlive the cache.
+        StaticCache(const StaticFiles& files_, CacheLimits limits_);
+
+        StaticCache(const StaticCache& other) = delete;
+        StaticCache& operator=(const StaticCache& other) = delete;
+
+        /// @brief Same contract as `StaticFiles::serve`, answering from memory when possible.
+        [[nodiscard]] Response serve(Method method, Schema schema, std::string_view url_path, std::string_view accept_encoding = {}, std::string_view if_none_match = {});
+
+        [[nodiscard]] Response serve(const RequestView& req);
+
+        [[nodiscard]] CacheStats getStats() const;
+
+        void clear();
+    };
+}
+
+#endif
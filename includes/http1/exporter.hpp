@@ -0,0 +1,28 @@
+#ifndef EXPORTER_HPP
+#define EXPORTER_HPP
+
+#include <string>
+#include <string_view>
+#include "http1/helpers.hpp"
+#include "http1/messages.hpp"
+#include "http1/session.hpp"
+
+namespace ToyServer::Http1
+{
+    /// @brief Scrape path served unless the server is configured with another.
+    constexpr std::string_view default_metrics_path = "/metrics";
+
+    /**
+     * @brief Builds a reply holding a fresh snapshot of every thread's metrics in the Prometheus text format.
+     * @note A HEAD reply keeps the GET reply's `Content-Length` but carries no body.
+     */
+    [[nodiscard]] Response makeMetricsReply(Method method, Schema schema);
+
+    /**
+     * @brief Wraps `inner` so GET and HEAD requests for `path` get a metrics scrape, ignoring any query, while all other requests go through to `inner`.
+     * @note Scrapes only sum per-thread blocks, so serving one never blocks the threads recording.
+     */
+    [[nodiscard]] RequestHandler withMetricsEndpoint(std::string path, RequestHandler inner);
+}
+
+#endif
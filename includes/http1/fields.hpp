@@ -0,0 +1,231 @@
+#ifndef FIELDS_HPP
+#define FIELDS_HPP
+
+#include <cstdint>
+#include <array>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace ToyServer::Http1
+{
+    /**
+     * @brief IDs of the header fields the server knows by name, in the order of `field_names`.
+     */
+    enum class FieldId : std::uint8_t
+    {
+        f_accept,
+        f_accept_encoding,
+        f_authorization,
+        f_cache_control,
+        f_connection,
+        f_content_encoding,
+        f_content_length,
+        f_content_type,
+        f_cookie,
+        f_date,
+        f_etag,
+        f_expect,
+        f_host,
+        f_if_modified_since,
+        f_if_none_match,
+        f_last_modified,
+        f_location,
+        f_range,
+        f_server,
+        f_transfer_encoding,
+        f_upgrade,
+        f_user_agent,
+        f_vary,
+        f_unknown,
+        last = f_unknown
+    };
+
+    constexpr std::size_t known_field_count = static_cast<std::size_t>(FieldId::f_unknown);
+
+    constexpr std::array<std::string_view, known_field_count> field_names {
+        "Accept",
+        "Accept-Encoding",
+        "Authorization",
+        "Cache-Control",
+        "Connection",
+        "Content-Encoding",
+        "Content-Length",
+        "Content-Type",
+        "Cookie",
+        "Date",
+        "ETag",
+        "Expect",
+        "Host",
+        "If-Modified-Since",
+        "If-None-Match",
+        "Last-Modified",
+        "Location",
+        "Range",
+        "Server",
+        "Transfer-Encoding",
+        "Upgrade",
+        "User-Agent",
+        "Vary"
+    };
+
+    constexpr char foldCase(char c) noexcept
+    {
+        return (c >= 'A' && c <= 'Z') ? static_cast<char>(c - 'A' + 'a') : c;
+    }
+
+    /// @brief ASCII case-insensitive equality for header names and tokens.
+    constexpr bool equalsNoCase(std::string_view lhs, std::string_view rhs) noexcept
+    {
+        if (lhs.length() != rhs.length())
+            return false;
+
+        for (std::size_t pos = 0; pos < lhs.length(); pos++)
+        {
+            if (foldCase(lhs[pos]) != foldCase(rhs[pos]))
+                return false;
+        }
+
+        return true;
+    }
+
+    /// @brief Transparent ASCII case-insensitive ordering, so maps keyed by header name find any spelling of it.
+    struct LessNoCase
+    {
+        using is_transparent = void;
+
+        constexpr bool operator()(std::string_view lhs, std::string_view rhs) const noexcept
+        {
+            std::size_t common_len = (lhs.length() < rhs.length()) ? lhs.length() : rhs.length();
+
+            for (std::size_t pos = 0; pos < common_len; pos++)
+            {
+                if (char lhs_c = foldCase(lhs[pos]), rhs_c = foldCase(rhs[pos]); lhs_c != rhs_c)
+                    return static_cast<unsigned char>(lhs_c) < static_cast<unsigned char>(rhs_c);
+            }
+
+            return lhs.length() < rhs.length();
+        }
+    };
+
+    /// @brief Case-insensitive FNV-1a style hash, seeded so the known names land in distinct table slots.
+    constexpr std::uint32_t hashFieldName(std::string_view name, std::uint32_t seed) noexcept
+    {
+        std::uint32_t hash = 2166136261U ^ seed;
+
+        for (char c : name)
+            hash = (hash ^ static_cast<std::uint8_t>(foldCase(c))) * 16777619U;
+
+        return hash ^ (hash >> 15);
+    }
+
+    constexpr std::size_t field_table_size = 64;
+
+    /// @brief Searches for the first seed that gives every known name its own slot.
+    consteval std::uint32_t findFieldSeed()
+    {
+        for (std::uint32_t seed = 0; ; seed++)
+        {
+            std::array<bool, field_table_size> taken {};
+            bool collided = false;
+
+            for (std::string_view name : field_names)
+            {
+                std::size_t slot = hashFieldName(name, seed) % field_table_size;
+
+                if (taken[slot])
+                {
+                    collided = true;
+                    break;
+                }
+
+                taken[slot] = true;
+            }
+
+            if (!collided)
+                return seed;
+        }
+    }
+
+    constexpr std::uint32_t field_hash_seed = findFieldSeed();
+
+    consteval std::array<FieldId, field_table_size> buildFieldTable()
+    {
+        std::array<FieldId, field_table_size> table {};
+        table.fill(FieldId::f_unknown);
+
+        for (std::size_t name_idx = 0; name_idx < known_field_count; name_idx++)
+            table[hashFieldName(field_names[name_idx], field_hash_seed) % field_table_size] = static_cast<FieldId>(name_idx);
+
+        return table;
+    }
+
+    constexpr std::array<FieldId, field_table_size> field_table = buildFieldTable();
+
+    /// @brief Perfect hash lookup of a header name: one hash, one slot, one case-insensitive compare.
+    constexpr FieldId lookupField(std::string_view name) noexcept
+    {
+        FieldId candidate = field_table[hashFieldName(name, field_hash_seed) % field_table_size];
+
+        if (candidate == FieldId::f_unknown)
+            return candidate;
+
+        return (equalsNoCase(name, field_names[static_cast<std::size_t>(candidate)])) ? candidate : FieldId::f_unknown;
+    }
+
+    static_assert(lookupField("content-length") == FieldId::f_content_length && lookupField("HOST") == FieldId::f_host && lookupField("X-Custom") == FieldId::f_unknown);
+
+    /// @brief Position of a field plus one, so that zero means absent.
+    using FieldPos = std::uint16_t;
+
+    /// @brief Most fields a `FieldIndex` can point into.
+    constexpr std::size_t max_indexed_fields = 0xffff;
+
+    /// @brief Positions of the first field of each known name within a request's headers, plus one (zero means absent).
+    using FieldIndex = std::array<FieldPos, known_field_count>;
+
+    /**
+     * @brief Header field of an outgoing reply.
+     */
+    struct HeaderField
+    {
+        std::string name;
+        std::string value;
+        FieldId id;
+    };
+
+    /**
+     * @brief Flat store of reply headers, kept in insertion order. Known fields are found through a per-ID position table, others by a case-insensitive scan.
+     */
+    class HeaderFields
+    {
+    private:
+        std::vector<HeaderField> fields;
+        FieldIndex known_pos;
+
+        [[nodiscard]] std::size_t findUnknown(std::string_view name) const noexcept;
+
+    public:
+        HeaderFields() noexcept;
+
+        /// @note `id` must not be `FieldId::f_unknown`, here and below.
+        [[nodiscard]] bool contains(FieldId id) const noexcept { return known_pos[static_cast<std::size_t>(id)] != 0; }
+
+        [[nodiscard]] bool contains(std::string_view name) const noexcept;
+
+        /// @return The field's value, added empty first if missing.
+        std::string& operator[](FieldId id);
+
+        std::string& operator[](std::string_view name);
+
+        [[nodiscard]] std::size_t size() const noexcept { return fields.size(); }
+
+        [[nodiscard]] bool empty() const noexcept { return fields.empty(); }
+
+        [[nodiscard]] auto begin() const noexcept { return fields.begin(); }
+
+        [[nodiscard]] auto end() const noexcept { return fields.end(); }
+    };
+}
+
+#endif
@@ -1,37 +1,136 @@
 #ifndef MESSAGES_HPP
 #define MESSAGES_HPP
 
+#include <functional>
+#include <memory>
+#include <memory_resource>
+#include <optional>
 #include <string>
 #include <string_view>
+#include <span>
 #include <map>
 #include "netio/buffers.hpp"
+#include "netio/files.hpp"
+#include "http1/fields.hpp"
 #include "http1/helpers.hpp"
 #include "uri/url.hpp"
+#include "uri/view.hpp"
 
 namespace ToyServer::Http1
 {
+    /**
+     * @brief Header fields of an owning request, allocated from the same memory resource as the rest of it. Lookups by `std::string_view` allocate nothing and ignore ASCII case.
+     */
+    using header_map_t = std::pmr::map<std::pmr::string, std::pmr::string, LessNoCase>;
+
     /**
      * @brief Aggregate representing a simple, non-chunked request.
+     * @note Strings and maps live in the memory resource given to `toOwnedRequest`, usually the reader's per-request arena.
      */
     struct Request
     {
         Schema schema;
         Method method;
         Uri::Url route;
-        std::map<std::string, std::string> headers;
+        header_map_t headers;
         NetIO::FixedBuffer body;
     };
 
     /**
-     * @brief Aggregate representing a simple, non-chunked response.
+     * @brief Non-owning header field, both parts trimmed of the colon and surrounding spaces.
+     */
+    struct HeaderView
+    {
+        std::string_view name;
+        std::string_view value;
+        FieldId id = FieldId::f_unknown;
+    };
+
+    class BodyReader;
+
+    /**
+     * @brief Zero-copy request: every view points into the connection's receive buffer.
+     * @note Only valid until the reader fetches the next request. Use `toOwnedRequest` to keep anything longer. `body` is only filled when the whole body fit the receive buffer, while `body_reader` serves every body.
+     */
+    struct RequestView
+    {
+        Schema schema;
+        Method method;
+        std::string_view method_txt;
+        std::string_view target;
+        std::span<const HeaderView> headers;
+        const FieldIndex* field_index {}; // positions of known fields within `headers`
+        std::string_view body;
+        BodyReader* body_reader {};
+
+        /// @brief Constant time lookup of a known field (first match).
+        [[nodiscard]] std::optional<std::string_view> findHeader(FieldId id) const noexcept;
+
+        /// @brief Case-insensitive header lookup (first match), which goes through the field index for known names.
+        [[nodiscard]] std::optional<std::string_view> findHeader(std::string_view name) const noexcept;
+    };
+
+    /**
+     * @brief Checks whether the client allows reusing the connection: HTTP/1.1 unless it sent `Connection: close`, HTTP/1.0 only with `Connection: keep-alive`.
+     */
+    [[nodiscard]] bool wantsKeepAlive(const RequestView& view) noexcept;
+
+    /**
+     * @brief Copies a request view into an owning `Request`, parsing its target URL. Every string and map node comes from `resource`.
+     * @note Throws std::runtime_error when the target is not a valid absolute path. Of repeated header names only the first is kept, matching `RequestView::findHeader`.
+     */
+    [[nodiscard]] Request toOwnedRequest(const RequestView& view, std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+
+    /**
+     * @brief File region sent as a reply body straight from the page cache.
+     */
+    struct FileBody
+    {
+        NetIO::FileHandle file;
+        std::size_t offset;
+        std::size_t length;
+    };
+
+    /**
+     * @brief Fully serialized reply shared between requests, see `StaticCache`. Only the status, `Date` and `Connection` lines are left out, so one copy serves either HTTP version, keep-alive and closing replies alike, and never goes stale.
+     */
+    struct PrebuiltReply
+    {
+        std::string bytes;    // header lines, then the blank line's CRLF and the body
+        std::size_t head_end; // offset of that CRLF
+    };
+
+    /**
+     * @brief Reference to a shared prebuilt reply from one response.
+     */
+    struct PrebuiltRef
+    {
+        std::shared_ptr<const PrebuiltReply> reply;
+        bool head_only; // HEAD: send everything but the body
+    };
+
+    class ChunkSink;
+
+    /**
+     * @brief Body generator of a streamed reply, called once while the reply is being sent. Every piece it writes to the sink goes out as chunked transfer coding.
+     * @note Throwing from it drops the connection, since the reply is already partly sent.
+     */
+    using BodyProducer = std::function<void(ChunkSink& sink)>;
+
+    /**
+     * @brief Aggregate representing a response, sized up front unless it is streamed.
+     * @note When `file_body` is set it replaces `body` as the payload. When `body_stream` is set, the payload comes from it instead and the reply uses `Transfer-Encoding: chunked`. When `prebuilt` is set it replaces the whole reply except the status line (from `schema` and `status`) and the `Date` and `Connection` lines.
      */
     struct Response
     {
         Schema schema;
         Status status;
         std::string_view status_txt;
-        std::map<std::string, std::string> headers;
+        HeaderFields headers;
         NetIO::FixedBuffer body;
+        std::optional<FileBody> file_body {};
+        std::optional<PrebuiltRef> prebuilt {};
+        BodyProducer body_stream {};
     };
 }
 
@@ -0,0 +1,117 @@
+#ifndef PARSER_HPP
+#define PARSER_HPP
+
+#include <array>
+#include <cstddef>
+#include <span>
+#include <string_view>
+#include "http1/fields.hpp"
+#include "http1/messages.hpp"
+
+namespace ToyServer::Http1
+{
+    constexpr bool matchSpacing(char s)
+    {
+        return s == ' ' || s == '\t';
+    }
+
+    /**
+     * @brief Outcome of one `RequestParser::feed()` call.
+     */
+    enum class ParseStatus
+    {
+        parse_need_more, // the request is not whole yet, feed again once more octets arrived
+        parse_complete,  // the view is ready
+        parse_error,     // the request is malformed or over a limit, see `getError()`
+        last = parse_error
+    };
+
+    /**
+     * @brief Resumable HTTP/1.x request parser that is driven by whoever owns the octets, so it works with any I/O model.
+     * @note Each `feed()` gets every octet buffered since the request began, which may have moved in memory since the last call. Only the octets past the previous call get looked at, and a `Content-Length` body is just waited for without scanning. A chunked body is left to the caller right after the head.
+     */
+    class RequestParser
+    {
+    private:
+        static constexpr std::size_t max_header_count = 64;
+        static_assert(max_header_count <= max_indexed_fields);
+        static constexpr std::size_t default_max_head_size = 16 << 10;
+        static constexpr std::size_t default_max_body_size = 8 << 20;
+
+        enum class ParseStep
+        {
+            step_blank_lines, // stray CRLFs before the request line
+            step_top_line,
+            step_header_lines,
+            step_body,
+            step_done,
+            step_failed,
+            last = step_failed
+        };
+
+        std::array<HeaderView, max_header_count> header_slots; // backing store for the view's headers
+        FieldIndex field_index;                                 // known field positions within `header_slots`
+        RequestView view;
+        std::string_view error_msg;
+        const char* base;        // start of the octets given to the last call, which the views point into
+        std::size_t line_start;  // offset of the line being parsed
+        std::size_t scan_offset; // octets already searched for a line end
+        std::size_t head_length; // offset past the blank line ending the head, once found
+        std::size_t content_length;
+        std::size_t max_head_size;
+        std::size_t max_body_size;
+        ParseStep step;
+        bool chunked;
+
+        [[nodiscard]] ParseStatus fail(std::string_view msg) noexcept;
+
+        [[nodiscard]] bool parseTop(std::string_view line) noexcept;
+        [[nodiscard]] bool parseHeader(std::string_view line) noexcept;
+
+        /// @brief Checks the framing fields once the head is whole.
+        [[nodiscard]] ParseStatus finishHead() noexcept;
+
+    public:
+        explicit RequestParser() noexcept;
+
+        RequestParser(const RequestParser& other) = delete;
+        RequestParser& operator=(const RequestParser& other) = delete;
+
+        /// @brief Forgets the current request so the next `feed()` starts a new one.
+        void reset() noexcept;
+
+        /// @brief Largest head accepted, blank line included.
+        void setHeadLimit(std::size_t max_head_size_) noexcept { max_head_size = max_head_size_; }
+
+        /// @brief Largest body accepted, whether sized or chunked.
+        void setBodyLimit(std::size_t max_body_size_) noexcept { max_body_size = max_body_size_; }
+
+        /// @brief Parses whatever arrived since the last call. After completion or an error, further calls only re-point the view at `buffered` and repeat the status.
+        [[nodiscard]] ParseStatus feed(std::span<const char> buffered) noexcept;
+
+        /// @brief Tells whether the head is parsed, which is enough to decide how the body gets read.
+        [[nodiscard]] bool isHeadDone() const noexcept { return step == ParseStep::step_body || step == ParseStep::step_done; }
+
+        [[nodiscard]] bool isChunked() const noexcept { return chunked; }
+
+        /// @return Octets from the start of the fed data through the blank line ending the head, stray leading CRLFs included.
+        [[nodiscard]] std::size_t getHeadLength() const noexcept { return head_length; }
+
+        /// @return Size of a sized body, 0 for none or a chunked one.
+        [[nodiscard]] std::size_t getContentLength() const noexcept { return content_length; }
+
+        /// @return Octets the complete request takes from the start of the fed data. A chunked body is not counted.
+        [[nodiscard]] std::size_t getRequestLength() const noexcept { return head_length + content_length; }
+
+        /// @note Valid once the head is done, viewing the octets of the last `feed()` until they move or get released.
+        [[nodiscard]] const RequestView& getView() const noexcept { return view; }
+
+        /// @brief Re-points the view at a copy of the fed octets, such as a head kept aside while its body streams.
+        void relocate(const char* new_base) noexcept;
+
+        /// @return Why parsing failed, as a "ParseErr: ..." message.
+        [[nodiscard]] std::string_view getError() const noexcept { return error_msg; }
+    };
+}
+
+#endif
@@ -2,13 +2,16 @@
 #define READER_HPP
 
 #include <string>
-#include <tuple>
-#include <map>
+#include <string_view>
 #include "netio/buffers.hpp"
+#include "netio/pools.hpp"
 #include "netio/sockets.hpp"
+#include "netio/transport.hpp"
+#include "http1/bodies.hpp"
 #include "http1/helpers.hpp"
 #include "http1/messages.hpp"
-#include "uri/parse.hpp"
+#include "http1/parser.hpp"
+#include "uri/view.hpp"
 #include "uri/url.hpp"
 
 namespace ToyServer::Http1
@@ -16,53 +19,66 @@ namespace ToyServer::Http1
     using NetIO::FixedBuffer;
     using NetIO::ClientSocket;
 
-    constexpr bool matchSpacing(char s)
-    {
-        return s == ' ' || s == '\t';
-    }
-
-    struct RawHeader
-    {
-        std::string name;
-        std::string content;
-    };
-
     /**
      * @brief Helper to read and parse a request including its URL string.
+     * @note A `RequestParser` works in place over the transport's read-ahead buffer and resumes after each refill, so `nextView()` allocates nothing for requests that fit it. Chunked bodies and bodies past the buffer are streamed through the view's `body_reader` instead, with only the head copied aside. Throws std::runtime_error on I/O failures and malformed or oversized requests.
+     * @tparam T Connection type, called directly. Defined in reader.cpp and instantiated there for `NetIO::ClientSocket` and `NetIO::MemoryTransport`.
      */
-    class HttpReader
+    template <NetIO::Transport T>
+    class BasicHttpReader
     {
     private:
-        static constexpr std::size_t header_buf_size = 1024;
-        static constexpr std::size_t body_buf_size = 4096;
-
-        ToyServer::Uri::UrlParser url_parser;
-        FixedBuffer header_buf;
-        FixedBuffer body_buf;
-        ClientSocket* socket;
+        static constexpr std::size_t default_max_body_size = 8 << 20;
 
-        [[nodiscard]] Schema deduceSchema(const std::string& token) const;
-        [[nodiscard]] Method deduceMethod(const std::string& token) const;
-        [[nodiscard]] Uri::Url parseSimpleURL(const std::string& token);
+        RequestParser parser;   // resumes over the read-ahead across refills
+        std::string head_store; // copy of the head of a request whose body is streamed
+        BodyReader body_reader;
+        NetIO::RequestArena arena; // backs the strings and maps of `nextRequest()` results
+        T* transport;
+        std::size_t pending_consume; // octets still held for the previous view
+        std::size_t max_body_size;
+        bool view_out; // the parser still backs the previous view
 
-        [[nodiscard]] std::tuple<Schema, Method, Uri::Url> parseTop();
-        [[nodiscard]] RawHeader parseHeader(const std::string& token) const;
-        [[nodiscard]] std::map<std::string, std::string> parseHeaders();
+        /// @brief Moves the head into `head_store` and leaves the read-ahead to the body stream.
+        void detachHead(std::string_view data);
 
-        /// @note This actually just reads the body based on `Content-Length`!
-        void parseBody(std::size_t content_len = 0);
+        /// @brief Drops the previous view's octets plus any blank lines before the next request.
+        [[nodiscard]] std::string_view releaseConsumed();
 
     public:
-        // : url_parser {}, header_buf {header_buf_size}, body_buf {body_buf_size}, socket {} {}
-        explicit HttpReader() noexcept;
+        explicit BasicHttpReader() noexcept;
 
-        HttpReader(const HttpReader& other) = delete;
-        HttpReader& operator=(const HttpReader& other) = delete;
+        BasicHttpReader(const BasicHttpReader& other) = delete;
+        BasicHttpReader& operator=(const BasicHttpReader& other) = delete;
 
-        void resetState(ClientSocket* socket) noexcept;
+        void resetState(T* transport_) noexcept;
 
+        /// @brief Largest request body accepted, whether sized or chunked.
+        void setBodyLimit(std::size_t max_body_size_) noexcept
+        {
+            max_body_size = max_body_size_;
+            parser.setBodyLimit(max_body_size_);
+        }
+
+        /// @brief Tells whether a pipelined request head is already buffered, so `nextView()` can start without waiting on the peer.
+        /// @note Invalidates the previous view. Always false while the previous body is still arriving.
+        [[nodiscard]] bool hasBufferedHead();
+
+        /// @brief Parses the next request without copying. Releases the previous view's octets first, skipping any body left unread.
+        [[nodiscard]] RequestView nextView();
+
+        /// @brief Owning variant of `nextView()` for handlers that retain request data. Streamed bodies are read in full.
+        /// @note The result lives in the reader's arena, which is reset by the next call, so copy it to keep it longer.
         [[nodiscard]] Request nextRequest();
+
+        /// @brief Per-request scratch memory for handlers, released together with the request.
+        [[nodiscard]] std::pmr::memory_resource* getArena() noexcept { return arena.getResource(); }
     };
+
+    extern template class BasicHttpReader<NetIO::ClientSocket>;
+    extern template class BasicHttpReader<NetIO::MemoryTransport>;
+
+    using HttpReader = BasicHttpReader<NetIO::ClientSocket>;
 }
 
-#endif
\ No newline at end of file
+#endif
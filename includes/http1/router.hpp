@@ -0,0 +1,476 @@
+#ifndef ROUTER_HPP
+#define ROUTER_HPP
+
+#include <cstdint>
+#include <algorithm>
+#include <array>
+#include <memory>
+#include <optional>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include "http1/helpers.hpp"
+#include "http1/messages.hpp"
+
+namespace ToyServer::Http1
+{
+    constexpr std::size_t max_route_params = 8;
+
+    /**
+     * @brief Values captured by a matched route's `:param` and `*wildcard` segments, as views into the request path.
+     */
+    class RouteParams
+    {
+    private:
+        std::array<std::string_view, max_route_params> values;
+        std::span<const std::string_view> names;
+
+    public:
+        constexpr RouteParams() noexcept
+        : values {}, names {} {}
+
+        constexpr RouteParams(std::span<const std::string_view> names_, const std::array<std::string_view, max_route_params>& values_) noexcept
+        : values {values_}, names {names_} {}
+
+        /// @return The value captured under `name`, without its leading `:` or `*`.
+        [[nodiscard]] std::optional<std::string_view> find(std::string_view name) const noexcept;
+
+        [[nodiscard]] constexpr std::size_t size() const noexcept { return names.size(); }
+
+        [[nodiscard]] constexpr std::string_view operator[](std::size_t idx) const noexcept { return values[idx]; }
+    };
+
+    /**
+     * @brief Route callback, a plain function so dispatch is one indirect call through a constant table.
+     */
+    using RouteHandler = Response (*)(const RequestView& req, const RouteParams& params);
+
+    /**
+     * @brief Route declaration. Patterns are absolute paths whose segments are static text, `:name` (one whole segment) or a final `*name` (the rest of the path, possibly empty).
+     */
+    struct Route
+    {
+        Method method;
+        std::string_view pattern;
+        RouteHandler handler;
+    };
+
+    enum class RouteNodeKind : std::uint8_t
+    {
+        node_static,
+        node_param,
+        node_wildcard,
+        last = node_wildcard
+    };
+
+    /**
+     * @brief Node of the compressed radix tree. Static children of a node are laid out next to each other, sorted by their first label octet.
+     */
+    struct RouteNode
+    {
+        std::uint32_t label_start;    // static label within the tree's text
+        std::uint32_t label_length;
+        std::uint32_t child_start;    // first static child
+        std::uint32_t child_count;
+        std::uint32_t param_child;    // zero when absent, as the root is never a child
+        std::uint32_t wildcard_child;
+        std::uint32_t route_start;    // routes ending here, sorted by method
+        std::uint32_t route_count;
+        RouteNodeKind kind;
+    };
+
+    /**
+     * @brief Route ending at a tree node, with the names of its captures in path order.
+     */
+    struct RouteSlot
+    {
+        RouteHandler handler;
+        std::string_view pattern;
+        std::uint32_t param_start;
+        std::uint32_t param_count;
+        Method method;
+    };
+
+    /**
+     * @brief Read-only view of a router's flattened tree, which is all the lookup code needs.
+     */
+    struct RouteTree
+    {
+        std::span<const RouteNode> nodes;
+        std::span<const char> node_keys; // first label octet of each node
+        std::span<const char> text;
+        std::span<const RouteSlot> slots;
+        std::span<const std::string_view> param_names;
+    };
+
+    /**
+     * @brief Lookup result. `params` views the looked up path.
+     */
+    struct RouteMatch
+    {
+        const RouteSlot* route;
+        RouteParams params;
+    };
+
+    /// @brief Walks the tree along `path`, preferring static segments over `:param` ones and those over wildcards, and backtracking only where a preferred branch dead ends.
+    /// @return The match, with a null `route` when nothing fits.
+    [[nodiscard]] RouteMatch matchRoute(const RouteTree& tree, Method method, std::string_view path) noexcept;
+
+    /// @brief Runs the handler of the route matching the request target (sans query), or replies 404.
+    [[nodiscard]] Response dispatchRoute(const RouteTree& tree, const RequestView& req);
+
+    /* Compile-time route planning. */
+
+    constexpr char param_marker = '\x01';    // stands for a `:param` segment in normalized patterns
+    constexpr char wildcard_marker = '\x02'; // stands for a `*wildcard` tail
+
+    /**
+     * @brief Sizes of a planned tree, which become the router's template arguments.
+     */
+    struct RouteSizes
+    {
+        std::size_t node_count;
+        std::size_t text_size;
+        std::size_t param_count;
+    };
+
+    /**
+     * @brief Transient tree built while planning, then copied into a router's fixed arrays. Buffers are sized for the worst case up front.
+     * @note Planning sticks to raw buffers and pointers: in constant evaluation a `std::vector` push or a `std::unique_ptr` subscript costs hundreds of steps, which thousands of routes would multiply past the compiler's limit.
+     */
+    struct RoutePlan
+    {
+        std::unique_ptr<RouteNode[]> nodes;
+        std::unique_ptr<char[]> node_keys;
+        std::unique_ptr<char[]> text;
+        std::unique_ptr<RouteSlot[]> slots;
+        std::unique_ptr<std::string_view[]> param_names;
+        std::size_t node_count = 0;
+        std::size_t text_size = 0;
+        std::size_t param_count = 0;
+    };
+
+    /// @brief Writes `pattern` to `out` with every capture segment replaced by its marker octet, so patterns group and compare as plain text, and appends the capture names to `names`. Invalid patterns fail the build.
+    /// @return Length of the normalized pattern, which is never longer than the original.
+    consteval std::size_t normalizePattern(std::string_view pattern, char* out, std::string_view* names, std::size_t& name_count)
+    {
+        const char* src = pattern.data();
+        const char* src_end = src + pattern.length();
+        char* dst = out;
+        std::size_t capture_count = 0;
+
+        if (src == src_end || *src != '/')
+            throw std::invalid_argument {"Route pattern must start with '/'."};
+
+        while (src != src_end)
+        {
+            char c = *src;
+
+            if (c == param_marker || c == wildcard_marker)
+                throw std::invalid_argument {"Route pattern has a control octet."};
+
+            if ((c != ':' && c != '*') || src[-1] != '/')
+            {
+                *dst++ = c;
+                src++;
+                continue;
+            }
+
+            const char* name_end = src + 1;
+
+            while (name_end != src_end && *name_end != '/')
+                name_end++;
+
+            if (name_end == src + 1)
+                throw std::invalid_argument {"Route capture needs a name."};
+
+            if (c == '*' && name_end != src_end)
+                throw std::invalid_argument {"Route wildcard must be the last segment."};
+
+            if (++capture_count > max_route_params)
+                throw std::invalid_argument {"Route has too many captures."};
+
+            names[name_count++] = {src + 1, static_cast<std::size_t>(name_end - src - 1)};
+            *dst++ = (c == ':') ? param_marker : wildcard_marker;
+            src = name_end;
+        }
+
+        return static_cast<std::size_t>(dst - out);
+    }
+
+    /// @brief Lays out the compressed radix tree breadth first, so every node's static children get consecutive slots. Each node only regroups its own routes by their next octet, which keeps planning close to linear in the pattern text.
+    consteval void planRoutes(std::span<const Route> routes, RoutePlan& plan)
+    {
+        struct PendingNode
+        {
+            std::size_t lo;    // range of `order` below the node
+            std::size_t hi;
+            std::size_t depth; // normalized octets matched before the node
+        };
+
+        const std::size_t route_count = routes.size();
+        std::size_t pattern_total = 0;
+
+        for (const Route& route : routes)
+            pattern_total += route.pattern.length();
+
+        // every node but the root takes at least one octet of each route below it, which bounds the node count
+        const std::size_t max_nodes = pattern_total + 1;
+
+        std::unique_ptr<char[]> key_store {new char[pattern_total]};
+        std::unique_ptr<std::string_view[]> key_store_views {new std::string_view[route_count]};
+        std::unique_ptr<std::size_t[]> param_store_starts {new std::size_t[route_count + 1]};
+        std::unique_ptr<std::uint32_t[]> order_store {new std::uint32_t[route_count]};
+        std::unique_ptr<std::uint32_t[]> scratch_store {new std::uint32_t[route_count]};
+        std::unique_ptr<int[]> next_key_store {new int[route_count]};
+        std::unique_ptr<PendingNode[]> queue_store {new PendingNode[max_nodes]};
+
+        plan.nodes.reset(new RouteNode[max_nodes]);
+        plan.node_keys.reset(new char[max_nodes]);
+        plan.text.reset(new char[pattern_total]);
+        plan.slots.reset(new RouteSlot[route_count]);
+        plan.param_names.reset(new std::string_view[route_count * max_route_params]);
+
+        std::string_view* keys = key_store_views.get();
+        std::size_t* param_starts = param_store_starts.get();
+        std::uint32_t* order = order_store.get();
+        std::uint32_t* scratch = scratch_store.get();
+        int* next_keys = next_key_store.get();
+        PendingNode* queue = queue_store.get();
+        RouteNode* nodes = plan.nodes.get();
+        char* node_keys = plan.node_keys.get();
+        char* text = plan.text.get();
+
+        for (std::size_t route_idx = 0, key_pos = 0; route_idx < route_count; route_idx++)
+        {
+            param_starts[route_idx] = plan.param_count;
+            std::size_t key_len = normalizePattern(routes[route_idx].pattern, key_store.get() + key_pos, plan.param_names.get(), plan.param_count);
+            keys[route_idx] = {key_store.get() + key_pos, key_len};
+            order[route_idx] = static_cast<std::uint32_t>(route_idx);
+            key_pos += key_len;
+        }
+
+        param_starts[route_count] = plan.param_count;
+
+        // grouping state shared by all nodes: one counting slot per possible next octet, plus one for "ends here"
+        int group_keys[257] {};
+        std::size_t group_sizes[257] {};
+        std::size_t group_starts[257] {};
+
+        queue[0] = {0, route_count, 0};
+        node_keys[0] = '\0';
+        plan.node_count = 1;
+
+        for (std::size_t node_idx = 0; node_idx < plan.node_count; node_idx++)
+        {
+            auto [lo, hi, depth] = queue[node_idx];
+            RouteNode node {};
+            node.label_start = static_cast<std::uint32_t>(plan.text_size);
+            node.kind = RouteNodeKind::node_static;
+
+            // capture nodes consume their marker, static ones the longest text shared by their routes up to the next marker
+            if (node_idx != 0 && node_keys[node_idx] == param_marker)
+            {
+                node.kind = RouteNodeKind::node_param;
+                depth++;
+            }
+            else if (node_idx != 0 && node_keys[node_idx] == wildcard_marker)
+            {
+                node.kind = RouteNodeKind::node_wildcard;
+                depth++;
+            }
+            else if (lo < hi)
+            {
+                const char* first = keys[order[lo]].data();
+                std::size_t first_end = keys[order[lo]].length();
+                std::size_t label_end = depth;
+
+                while (label_end < first_end && first[label_end] != param_marker && first[label_end] != wildcard_marker)
+                    label_end++;
+
+                for (std::size_t sorted_idx = lo + 1; sorted_idx < hi && label_end > depth; sorted_idx++)
+                {
+                    const char* other = keys[order[sorted_idx]].data();
+                    std::size_t other_end = std::min(label_end, keys[order[sorted_idx]].length());
+                    std::size_t common_end = depth;
+
+                    while (common_end < other_end && other[common_end] == first[common_end])
+                        common_end++;
+
+                    label_end = common_end;
+                }
+
+                for (std::size_t label_pos = depth; label_pos < label_end; label_pos++)
+                    text[plan.text_size++] = first[label_pos];
+
+                node.label_length = static_cast<std::uint32_t>(label_end - depth);
+                depth = label_end;
+            }
+
+            // a counting pass groups the routes by next octet, in key order: those ending here (-1) first, then markers, then static text
+            std::size_t key_count = 0;
+
+            for (std::size_t sorted_idx = lo; sorted_idx < hi; sorted_idx++)
+            {
+                std::string_view key = keys[order[sorted_idx]];
+                int next_key = (key.length() == depth) ? -1 : static_cast<unsigned char>(key.data()[depth]);
+                std::size_t key_slot = 0;
+
+                while (key_slot < key_count && group_keys[key_slot] < next_key)
+                    key_slot++;
+
+                if (key_slot == key_count || group_keys[key_slot] != next_key)
+                {
+                    for (std::size_t shift_idx = key_count; shift_idx > key_slot; shift_idx--)
+                    {
+                        group_keys[shift_idx] = group_keys[shift_idx - 1];
+                        group_sizes[shift_idx] = group_sizes[shift_idx - 1];
+                    }
+
+                    group_keys[key_slot] = next_key;
+                    group_sizes[key_slot] = 0;
+                    key_count++;
+                }
+
+                next_keys[sorted_idx] = next_key;
+                group_sizes[key_slot]++;
+            }
+
+            for (std::size_t key_slot = 0, group_start = lo; key_slot < key_count; key_slot++)
+            {
+                group_starts[key_slot] = group_start;
+                group_start += group_sizes[key_slot];
+            }
+
+            for (std::size_t sorted_idx = lo; sorted_idx < hi; sorted_idx++)
+            {
+                std::size_t key_slot = 0;
+
+                while (group_keys[key_slot] != next_keys[sorted_idx])
+                    key_slot++;
+
+                scratch[group_starts[key_slot]++] = order[sorted_idx];
+            }
+
+            for (std::size_t sorted_idx = lo; sorted_idx < hi; sorted_idx++)
+                order[sorted_idx] = scratch[sorted_idx];
+
+            // routes ending here differ only in method, which orders them
+            std::size_t ended_hi = (key_count > 0 && group_keys[0] == -1) ? lo + group_sizes[0] : lo;
+
+            for (std::size_t ended_idx = lo + 1; ended_idx < ended_hi; ended_idx++)
+            {
+                for (std::size_t swap_idx = ended_idx; swap_idx > lo && routes[order[swap_idx]].method < routes[order[swap_idx - 1]].method; swap_idx--)
+                    std::swap(order[swap_idx], order[swap_idx - 1]);
+            }
+
+            for (std::size_t ended_idx = lo + 1; ended_idx < ended_hi; ended_idx++)
+            {
+                if (routes[order[ended_idx]].method == routes[order[ended_idx - 1]].method)
+                    throw std::invalid_argument {"Two routes overlap: same method and path shape."};
+            }
+
+            node.route_start = static_cast<std::uint32_t>(lo);
+            node.route_count = static_cast<std::uint32_t>(ended_hi - lo);
+            node.child_start = static_cast<std::uint32_t>(plan.node_count);
+
+            for (std::size_t key_slot = (ended_hi > lo) ? 1 : 0, group_lo = ended_hi; key_slot < key_count; key_slot++)
+            {
+                int group_key = group_keys[key_slot];
+                std::uint32_t child_idx = static_cast<std::uint32_t>(plan.node_count++);
+
+                if (group_key == param_marker)
+                    node.param_child = child_idx;
+                else if (group_key == wildcard_marker)
+                    node.wildcard_child = child_idx;
+                else
+                    node.child_count++;
+
+                node_keys[child_idx] = static_cast<char>(group_key);
+                queue[child_idx] = {group_lo, group_lo + group_sizes[key_slot], depth};
+                group_lo += group_sizes[key_slot];
+            }
+
+            // the marker groups sort first, so the static children start after them
+            node.child_start += static_cast<std::uint32_t>((node.param_child != 0) + (node.wildcard_child != 0));
+            nodes[node_idx] = node;
+        }
+
+        // every node's routes now sit in one run of `order`, which becomes the slot table
+        for (std::size_t sorted_idx = 0; sorted_idx < route_count; sorted_idx++)
+        {
+            std::uint32_t route_idx = order[sorted_idx];
+            const Route& route = routes[route_idx];
+
+            plan.slots[sorted_idx] = {route.handler, route.pattern, static_cast<std::uint32_t>(param_starts[route_idx]), static_cast<std::uint32_t>(param_starts[route_idx + 1] - param_starts[route_idx]), route.method};
+        }
+    }
+
+    consteval RouteSizes measureRoutes(std::span<const Route> routes)
+    {
+        RoutePlan plan;
+        planRoutes(routes, plan);
+
+        return {plan.node_count, plan.text_size, plan.param_count};
+    }
+
+    /**
+     * @brief Path router over a compressed radix tree that is planned at compile time and stored in flat arrays. Lookup walks the path once, so its cost follows the path length rather than the route count.
+     * @note Build one with `makeRouter`. It is usable directly as a session's `RequestHandler`.
+     */
+    template <std::size_t NodeCount, std::size_t TextSize, std::size_t ParamCount, std::size_t RouteCount>
+    class Router
+    {
+    private:
+        std::array<RouteNode, NodeCount> nodes;
+        std::array<char, NodeCount> node_keys;
+        std::array<char, TextSize> text;
+        std::array<RouteSlot, RouteCount> slots;
+        std::array<std::string_view, ParamCount> param_names;
+
+    public:
+        consteval explicit Router(std::span<const Route> routes)
+        : nodes {}, node_keys {}, text {}, slots {}, param_names {}
+        {
+            RoutePlan plan;
+            planRoutes(routes, plan);
+
+            std::copy(plan.nodes.get(), plan.nodes.get() + NodeCount, nodes.begin());
+            std::copy(plan.node_keys.get(), plan.node_keys.get() + NodeCount, node_keys.begin());
+            std::copy(plan.text.get(), plan.text.get() + TextSize, text.begin());
+            std::copy(plan.slots.get(), plan.slots.get() + RouteCount, slots.begin());
+            std::copy(plan.param_names.get(), plan.param_names.get() + ParamCount, param_names.begin());
+        }
+
+        [[nodiscard]] constexpr RouteTree getTree() const noexcept
+        {
+            return {nodes, node_keys, text, slots, param_names};
+        }
+
+        [[nodiscard]] RouteMatch match(Method method, std::string_view path) const noexcept
+        {
+            return matchRoute(getTree(), method, path);
+        }
+
+        [[nodiscard]] Response operator()(const RequestView& req) const
+        {
+            return dispatchRoute(getTree(), req);
+        }
+    };
+
+    /**
+     * @brief Plans a router from a captureless lambda returning a `std::array<Route, N>`, e.g. `constexpr auto router = makeRouter([] { return std::array {Route {...}, ...}; });`
+     * @note Overlapping routes and malformed patterns are compile errors.
+     */
+    template <typename RoutesFn>
+    consteval auto makeRouter(RoutesFn)
+    {
+        constexpr auto routes = RoutesFn {}();
+        constexpr RouteSizes sizes = measureRoutes(routes);
+
+        return Router<sizes.node_count, sizes.text_size, sizes.param_count, routes.size()> {routes};
+    }
+}
+
+#endif
@@ -0,0 +1,62 @@
+#ifndef SCANNER_HPP
+#define SCANNER_HPP
+
+#include <cstddef>
+#include <string_view>
+
+namespace ToyServer::Http1
+{
+    /**
+     * @brief Up to four octets a scan stops at. Repeat an octet to search for fewer.
+     */
+    struct ScanSet
+    {
+        char c0;
+        char c1;
+        char c2;
+        char c3;
+    };
+
+    constexpr ScanSet scan_lf {'\n', '\n', '\n', '\n'};
+    constexpr ScanSet scan_line_end {'\r', '\n', '\n', '\n'};
+    constexpr ScanSet scan_colon {':', ':', ':', ':'};
+    constexpr ScanSet scan_sp {' ', ' ', ' ', ' '};
+
+    /**
+     * @brief Widest octet scanning implementation available, detected through CPUID.
+     */
+    enum class ScanLevel
+    {
+        scan_scalar, // one octet at a time
+        scan_sse2,   // 16 octets per step
+        scan_avx2,   // 32 octets per step
+        last = scan_avx2
+    };
+
+    /**
+     * @brief One implementation of the scanning primitives.
+     */
+    struct ScanKernels
+    {
+        const char* name;
+
+        /// @return Position of the first octet in `set`, or `len` when there is none.
+        std::size_t (*find_any)(const char* data, std::size_t len, ScanSet set) noexcept;
+
+        /// @return Whether every octet is an RFC 9110 tchar.
+        bool (*is_token)(const char* data, std::size_t len) noexcept;
+    };
+
+    [[nodiscard]] ScanLevel detectScanLevel() noexcept;
+
+    /// @note Levels the CPU lacks are clamped down to the best supported one.
+    [[nodiscard]] const ScanKernels& getScanKernels(ScanLevel level) noexcept;
+
+    /// @return Position of the first octet in `set`, or `std::string_view::npos`. Uses the kernels picked at startup.
+    [[nodiscard]] std::size_t findAnyOf(std::string_view text, ScanSet set) noexcept;
+
+    /// @brief Checks header names and methods. Empty text is not a token.
+    [[nodiscard]] bool isToken(std::string_view text) noexcept;
+}
+
+#endif
@@ -0,0 +1,61 @@
+#ifndef SESSION_HPP
+#define SESSION_HPP
+
+#include <functional>
+#include "netio/config.hpp"
+#include "netio/sockets.hpp"
+#include "http1/messages.hpp"
+#include "http1/reader.hpp"
+#include "http1/writer.hpp"
+
+namespace ToyServer::Http1
+{
+    /**
+     * @brief Callback producing the reply for one request. The view is only valid during the call.
+     */
+    using RequestHandler = std::function<Response(const RequestView& req)>;
+
+    /**
+     * @brief Reuse bounds for a persistent connection.
+     */
+    struct SessionLimits
+    {
+        int idle_timeout_ms;      // longest wait for the next request (or the rest of one)
+        std::size_t max_requests; // requests served before the connection is closed anyway
+        std::size_t max_body_size = 8 << 20; // larger request bodies get the connection dropped
+    };
+
+    /**
+     * @brief Serves requests from one blocking client connection until either side stops keep-alive, the peer idles out, or the request limit is hit.
+     * @note Pipelined requests are answered in order, and their replies leave together once no further complete request is buffered. Parse, handler and write times plus every reply's method and status go to the calling thread's `Metrics::ThreadMetrics`.
+     */
+    class HttpSession
+    {
+    private:
+        NetIO::ClientSocket socket;
+        HttpReader reader;
+        HttpWriter writer;
+        RequestHandler handler;
+        SessionLimits limits;
+
+        /// @brief Best effort 400 reply before dropping a malformed request's connection.
+        void rejectRequest() noexcept;
+
+        /// @brief Best effort 500 reply to a request whose handler threw, sent after the replies queued before it, then the connection is dropped.
+        void failRequest(const RequestView& req) noexcept;
+
+        /// @brief Flushes queued replies, if any, timing the flush as a write.
+        void flushTimed();
+
+    public:
+        HttpSession(NetIO::SocketConfig config, RequestHandler handler_, SessionLimits limits_);
+
+        HttpSession(const HttpSession& other) = delete;
+        HttpSession& operator=(const HttpSession& other) = delete;
+
+        /// @return Count of requests answered by the handler.
+        std::size_t serve();
+    };
+}
+
+#endif
@@ -0,0 +1,92 @@
+#ifndef STATICS_HPP
+#define STATICS_HPP
+
+#include <string>
+#include <string_view>
+#include "http1/helpers.hpp"
+#include "http1/messages.hpp"
+
+namespace ToyServer::Http1
+{
+    /**
+     * @brief Content coding of a served file variant, in server preference order.
+     */
+    enum class Coding
+    {
+        coding_br,       // `.br` sidecar
+        coding_gzip,     // `.gz` sidecar
+        coding_identity, // the file itself
+        last = coding_identity
+    };
+
+    /// @brief Guesses a `Content-Type` from the file extension, falling back to `application/octet-stream`.
+    [[nodiscard]] std::string_view guessMimeType(std::string_view path) noexcept;
+
+    /// @brief Tells whether precompressed variants are worth looking for, i.e. the type is text-like.
+    [[nodiscard]] bool isCompressibleType(std::string_view mime_type) noexcept;
+
+    /// @return Bit mask with bit `Coding::x` set for every sidecar coding the client accepts (q > 0).
+    [[nodiscard]] unsigned parseAcceptEncoding(std::string_view accept_encoding) noexcept;
+
+    [[nodiscard]] std::string_view stringifyCoding(Coding coding) noexcept;
+
+    /// @brief Builds the strong validator of one file variant from its size and modification time, e.g. `"1a2-65f0c3d1-gzip"`.
+    [[nodiscard]] std::string makeEntityTag(const NetIO::FileStats& stats, Coding coding);
+
+    /// @brief Weakly compares `etag` against an `If-None-Match` list, where `*` matches any tag.
+    [[nodiscard]] bool matchesEntityTag(std::string_view if_none_match, std::string_view etag) noexcept;
+
+    /**
+     * @brief Static file handler over a document root. GET replies carry the file as a `FileBody`, so the writer streams it with `sendfile` and no octet passes through userspace.
+     * @note Paths are resolved beneath the root's directory descriptor, so symlinks pointing outside the root are refused, and any `..` or hidden segment is refused too. For text-like files, a `.br` or `.gz` sibling at least as new as the file is served instead when `Accept-Encoding` allows it. Every file reply carries an `ETag`, and a matching `If-None-Match` gets 304.
+     */
+    class StaticFiles
+    {
+    private:
+        static constexpr std::size_t large_file_size = 1 << 20; // files past this get sequential read-ahead hints
+        static constexpr std::string_view index_name = "index.html";
+
+        std::string doc_root;
+        int root_fd;
+
+    public:
+        /// @return The path relative to the root, or empty when it is unsafe or malformed.
+        [[nodiscard]] static std::string sanitizePath(std::string_view url_path);
+
+        [[nodiscard]] static Response makeStatusReply(Schema schema, Status status);
+
+        /// @brief Builds a 304 reply repeating the validator and `Vary` line that the full reply would carry.
+        [[nodiscard]] static Response makeNotModified(Schema schema, std::string_view etag, bool varies);
+
+        /// @note Throws std::runtime_error if `doc_root_` is not an openable directory.
+        explicit StaticFiles(std::string doc_root_);
+
+        StaticFiles(const StaticFiles& other) = delete;
+        StaticFiles& operator=(const StaticFiles& other) = delete;
+
+        [[nodiscard]] const std::string& getDocRoot() const noexcept { return doc_root; }
+
+        /// @brief Opens a sanitized path as a regular file, switching to the index page for directories (`relative` is updated then).
+        /// @return A closed handle when there is no such file.
+        [[nodiscard]] NetIO::FileHandle openResolved(std::string& relative, NetIO::FileStats& stats) const;
+
+        /// @brief Looks for the best precompressed sibling of a resolved file among the `accepted` codings.
+        /// @return The sidecar, with `stats` and `coding` updated, or a closed handle.
+        [[nodiscard]] NetIO::FileHandle openSidecar(const std::string& relative, unsigned accepted, NetIO::FileStats& stats, Coding& coding) const;
+
+        /// @brief Builds the reply for a file opened through `openResolved` / `openSidecar`, streaming it by `sendfile` for GET.
+        /// @return A 304 reply instead when `if_none_match` names the variant's `ETag`.
+        [[nodiscard]] Response makeFileReply(Method method, Schema schema, NetIO::FileHandle&& file, const NetIO::FileStats& stats, std::string_view relative, Coding coding = Coding::coding_identity, std::string_view if_none_match = {}) const;
+
+        /// @brief Builds the reply for `url_path`, which may still carry a query string.
+        [[nodiscard]] Response serve(Method method, Schema schema, std::string_view url_path, std::string_view accept_encoding = {}, std::string_view if_none_match = {}) const;
+
+        [[nodiscard]] Response serve(const RequestView& req) const;
+
+        [[nodiscard]] Response serve(const Request& req) const;
+
+        ~StaticFiles() noexcept;
+    };
+}
+
+#endif
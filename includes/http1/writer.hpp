@@ -1,8 +1,14 @@
 #ifndef WRITER_HPP
 #define WRITER_HPP
 
+#include <sys/uio.h>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
 #include "netio/buffers.hpp"
 #include "netio/sockets.hpp"
+#include "netio/transport.hpp"
 #include "http1/helpers.hpp"
 #include "http1/messages.hpp"
 
@@ -15,35 +21,136 @@ namespace ToyServer::Http1
 
     [[nodiscard]] std::string_view stringifyStatus(Status status);
 
+    /// @return Precomputed status line with its CRLF, e.g. `"HTTP/1.1 200 OK\r\n"`, or a 500 line for invalid enums.
+    [[nodiscard]] std::string_view getStatusLine(Schema schema, Status status) noexcept;
+
+    /// @return This thread's `Date` header line with its CRLF, rendered again at most once per second.
+    [[nodiscard]] std::string_view getDateLine() noexcept;
+
+    /**
+     * @brief Output side of a streamed reply body, handed to its `BodyProducer`. Small pieces are batched into one chunk, larger ones become a chunk of their own sent without copying, so memory stays bounded by the batch size.
+     * @note For HTTP/1.0 replies the pieces go out unframed, and the connection close ends the body. Producers do not depend on the writer's transport, so the writer is reached through two plain function pointers.
+     */
+    class ChunkSink
+    {
+    private:
+        void* writer;
+        void (*write_fn)(void* writer, std::string_view piece);
+        void (*flush_fn)(void* writer);
+
+    public:
+        template <typename Writer>
+        explicit ChunkSink(Writer& writer_) noexcept
+        : writer {&writer_},
+          write_fn {[](void* target, std::string_view piece) { static_cast<Writer*>(target)->streamPiece(piece); }},
+          flush_fn {[](void* target) {
+              static_cast<Writer*>(target)->flushChunkBatch();
+              static_cast<Writer*>(target)->flush();
+          }} {}
+
+        ChunkSink(const ChunkSink& other) = delete;
+        ChunkSink& operator=(const ChunkSink& other) = delete;
+
+        /// @note The piece only needs to stay valid during the call.
+        void write(std::string_view piece) { write_fn(writer, piece); }
+
+        /// @brief Sends batched pieces now, e.g. before the producer waits on something slow.
+        void flush() { flush_fn(writer); }
+    };
+
     /**
-     * @brief Helper to write an HTTP/1.x request to a web client.
-     * @note Throws std::runtime_error on socket I/O failures.
+     * @brief Helper to write HTTP/1.x replies to a web client. Replies are queued as segments, where only the status line and headers get serialized and bodies are referenced in place. Queued replies go out in request order with a single gathering write when possible, and file bodies go out through `sendfile`.
+     * @note Throws std::runtime_error on transport I/O failures.
+     * @tparam T Connection type, called directly. Defined in writer.cpp and instantiated there for `NetIO::ClientSocket` and `NetIO::MemoryTransport`.
      */
-    class HttpWriter
+    template <NetIO::Transport T>
+    class BasicHttpWriter
     {
     private:
-        FixedBuffer out_buf;  // reply output buffer
-        ClientSocket* socket; // non-owning pointer for socket shared by reader, writer
-        std::size_t buf_count; // octet count within buffer after pre-load
+        friend class ChunkSink;
+
+        static constexpr std::size_t flush_threshold = 65536;
+        static constexpr std::size_t max_gather_count = 1024; // IOV_MAX on Linux
+        static constexpr int no_file_fd = -1;
+        static constexpr std::size_t chunk_batch_size = 16384; // streamed pieces are batched up to this before a chunk is sent
+
+        /// @brief Output piece: a file range when `file_fd` is set, a referenced body when `body` is set, otherwise a range of `head_buf`.
+        struct OutSegment
+        {
+            const char* body;
+            std::size_t offset;
+            std::size_t length;
+            int file_fd;
+        };
+
+        std::string head_buf;                  // serialized status lines and headers of queued replies
+        std::vector<OutSegment> segments;      // queued output in send order
+        std::vector<NetIO::FixedBuffer> held_bodies; // bodies of replies handed over by value, kept until sent
+        std::vector<NetIO::FileHandle> held_files;   // same for file bodies
+        std::vector<std::shared_ptr<const PrebuiltReply>> held_prebuilts; // same for prebuilt replies
+        std::vector<struct iovec> gather_vecs; // scratch list for the gathering write
+        std::string chunk_buf;                 // batched pieces of the streamed body being sent
+        T* transport; // non-owning pointer for the connection shared by reader, writer
+        std::size_t pending_count; // octets queued across all segments
+        bool chunk_framing;        // whether the streamed body being sent is chunked, false for HTTP/1.0
 
-        void dumpOutBuffer(std::size_t load_count);
+        /// @brief Queues a range of `head_buf`, sharing the previous segment when that one is head text too.
+        void queueHeadRange(std::size_t start, std::size_t length);
 
-        void loadChars(const std::string& content);
+        void writeHeadText(std::string_view text);
 
-        void loadChars(const char* octets_ptr, std::size_t len);
+        void writeLines(const Response& res, bool keep_alive);
 
-        void writeLines(const Response& res);
+        void writePayload(const char* body, std::size_t length);
 
-        void writePayload(const Response& res);
+        void writeFilePayload(const FileBody& file_body);
+
+        void writePrebuilt(const Response& res, bool keep_alive);
+
+        /// @brief Runs the producer of a streamed reply, then queues its last chunk and the terminating one.
+        void writeStreamed(const Response& res, bool keep_alive);
+
+        /// @brief Sends `piece` as one chunk right away, together with everything queued before it.
+        void sendChunk(std::string_view piece);
+
+        void streamPiece(std::string_view piece);
+
+        void flushChunkBatch();
+
+        /// @brief Sends a run of in-memory segments with as few gathering writes as possible.
+        void sendGathered(std::size_t seg_begin, std::size_t seg_end, bool more_follows);
+
+        void sendFileSegment(const OutSegment& segment);
+
+        [[noreturn]] void failFlush(NetIO::IOStatus status);
+
+        void clearQueue() noexcept;
 
     public:
-        explicit HttpWriter(ClientSocket* socket_ptr) noexcept;
+        explicit BasicHttpWriter(T* transport_) noexcept;
+
+        BasicHttpWriter(const BasicHttpWriter& other) = delete;
+        BasicHttpWriter& operator=(const BasicHttpWriter& other) = delete;
+
+        [[nodiscard]] bool hasPendingOutput() const noexcept { return pending_count > 0; }
+
+        /// @brief Serializes a reply's head behind any queued ones. Adds `Content-Length` (or `Transfer-Encoding` for streamed bodies) and `Connection` unless the handler set them, and only sends once enough output piled up.
+        /// @note The body is sent by reference, so `res` must stay alive until `flush()`.
+        void queueReply(const Response& res, bool keep_alive);
 
-        HttpWriter(const HttpWriter& other) = delete;
-        HttpWriter& operator=(const HttpWriter& other) = delete;
+        /// @brief Like the other overload, but the writer keeps the body (or file) itself until sent.
+        void queueReply(Response&& res, bool keep_alive);
 
-        void writeReply(const Response& res);
+        /// @brief Sends every queued reply, resuming after partial writes.
+        void flush();
+
+        void writeReply(const Response& res, bool keep_alive = false);
     };
+
+    extern template class BasicHttpWriter<NetIO::ClientSocket>;
+    extern template class BasicHttpWriter<NetIO::MemoryTransport>;
+
+    using HttpWriter = BasicHttpWriter<NetIO::ClientSocket>;
 }
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,69 @@
+#ifndef DRIVER_HPP
+#define DRIVER_HPP
+
+#include <cstdint>
+#include <chrono>
+#include <string>
+#include "loadgen/histogram.hpp"
+
+namespace ToyServer::LoadGen
+{
+    /**
+     * @brief How requests are paced.
+     */
+    enum class LoadMode
+    {
+        load_closed, // each connection keeps `pipeline_depth` requests in flight, sending the next as soon as a reply lands
+        load_open,   // requests are due at a constant rate whether or not the server keeps up
+        last = load_open
+    };
+
+    /**
+     * @brief Simple aggregate of load run options.
+     */
+    struct LoadConfig
+    {
+        std::string host;
+        std::string port;
+        std::string target;
+        LoadMode mode;
+        double rate;                        // requests per second over all threads, open loop only
+        std::size_t connections;
+        std::size_t threads;
+        std::size_t pipeline_depth;         // requests in flight per connection, 1 disables pipelining
+        std::chrono::milliseconds duration;
+        bool keep_alive;                    // without it every request gets a fresh connection
+    };
+
+    /**
+     * @brief Totals of a load run. Latencies are in nanoseconds.
+     * @note Open loop latencies count from when a request was due rather than when it was sent, so a stalled server is charged for every request it held back (coordinated omission correction).
+     */
+    struct LoadResult
+    {
+        HdrHistogram latency;
+        std::uint64_t completed;  // replies received
+        std::uint64_t non_2xx;    // replies with a status outside 200-299
+        std::uint64_t errors;     // failed connects, resets and malformed replies
+        std::uint64_t unfinished; // requests due or in flight when the run ended
+        std::uint64_t connects;
+        std::uint64_t bytes_read;
+        std::chrono::nanoseconds elapsed;
+
+        void merge(const LoadResult& other);
+    };
+
+    /// @brief Histogram tracking 1 ns to 1 hour at 3 significant digits, the bounds every `LoadResult` uses.
+    [[nodiscard]] HdrHistogram makeLatencyHistogram();
+
+    /// @brief Serializes the GET request sent for every sample.
+    [[nodiscard]] std::string makeRequestText(const LoadConfig& config);
+
+    /**
+     * @brief Runs a load test against `config.host` with one epoll loop per thread over non-blocking connections.
+     * @note Throws std::invalid_argument on bad options and std::runtime_error if the host cannot be resolved or refuses every connection.
+     */
+    [[nodiscard]] LoadResult runLoad(const LoadConfig& config);
+}
+
+#endif
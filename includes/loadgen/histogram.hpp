@@ -0,0 +1,56 @@
+#ifndef HISTOGRAM_HPP
+#define HISTOGRAM_HPP
+
+#include <cstdint>
+#include <vector>
+
+namespace ToyServer::LoadGen
+{
+    /**
+     * @brief HDR histogram of positive integer values: every power of two range is split into the same number of linear sub-buckets, so any recorded value is kept to a fixed number of significant decimal digits with a bounded, preallocated counts array.
+     * @note Values above the trackable maximum are clamped to it. Not thread safe, so each thread records into its own and they get merged afterwards.
+     */
+    class HdrHistogram
+    {
+    private:
+        std::vector<std::uint64_t> counts;
+        std::uint64_t highest_trackable;
+        std::uint64_t total_count;
+        std::uint64_t max_value;
+        std::uint64_t min_value;
+        double value_sum;
+        int sub_bucket_half_count_magnitude;
+        std::int64_t sub_bucket_half_count;
+        std::uint64_t sub_bucket_mask;
+
+        [[nodiscard]] std::size_t indexOf(std::uint64_t value) const noexcept;
+        [[nodiscard]] std::uint64_t valueAt(std::size_t index) const noexcept;
+        [[nodiscard]] std::uint64_t highestEquivalent(std::uint64_t value) const noexcept;
+
+    public:
+        /// @param highest_trackable_ Largest value kept exactly, at least 2.
+        /// @param significant_digits Decimal precision from 1 to 5, 3 keeps every value within 0.1%.
+        /// @note Throws std::invalid_argument on bad bounds.
+        HdrHistogram(std::uint64_t highest_trackable_, int significant_digits);
+
+        void record(std::uint64_t value) noexcept;
+
+        /// @note Both histograms need the same bounds.
+        void merge(const HdrHistogram& other);
+
+        void reset() noexcept;
+
+        /// @return Highest value equivalent to the one at `percentile` (0 to 100) of the recorded samples, 0 when empty.
+        [[nodiscard]] std::uint64_t getValueAtPercentile(double percentile) const noexcept;
+
+        [[nodiscard]] std::uint64_t getTotalCount() const noexcept { return total_count; }
+
+        [[nodiscard]] std::uint64_t getMax() const noexcept { return max_value; }
+
+        [[nodiscard]] std::uint64_t getMin() const noexcept { return (total_count > 0) ? min_value : 0; }
+
+        [[nodiscard]] double getMean() const noexcept { return (total_count > 0) ? value_sum / static_cast<double>(total_count) : 0.0; }
+    };
+}
+
+#endif
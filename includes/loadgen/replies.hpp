@@ -0,0 +1,60 @@
+#ifndef REPLIES_HPP
+#define REPLIES_HPP
+
+#include <string_view>
+#include "http1/bodies.hpp"
+
+namespace ToyServer::LoadGen
+{
+    /**
+     * @brief Incremental framing of HTTP/1.x replies on a client connection: finds where each reply ends without copying any of it, so pipelined replies can be counted straight off the read-ahead buffer.
+     * @note Only the status code, `Content-Length`, `Transfer-Encoding` and `Connection` fields are read. Throws std::runtime_error on malformed framing.
+     */
+    class ReplyParser
+    {
+    private:
+        enum class Step
+        {
+            step_head,
+            step_sized,      // `Content-Length` body
+            step_chunked,
+            step_until_close, // body without framing, ended by the server hanging up
+            step_done,
+            last = step_done
+        };
+
+        Http1::ChunkedDecoder decoder;
+        std::size_t body_left;
+        int status_code;
+        Step step;
+        bool closing;
+
+        /// @return Octets of the head, 0 while its blank line has not arrived.
+        [[nodiscard]] std::size_t parseHead(std::string_view input);
+
+    public:
+        ReplyParser() noexcept;
+
+        /// @brief Readies the parser for the next reply on the connection.
+        void reset() noexcept;
+
+        /// @brief Frames as much of the current reply as `input` holds.
+        /// @return Octets of `input` belonging to the reply, which the caller may drop. Octets past the reply's end are never taken.
+        [[nodiscard]] std::size_t feed(std::string_view input);
+
+        /// @brief Ends a reply whose body runs until the server closes the connection.
+        /// @return `true` if the reply was complete by that rule.
+        [[nodiscard]] bool finishOnClose() noexcept;
+
+        [[nodiscard]] bool isDone() const noexcept { return step == Step::step_done; }
+
+        [[nodiscard]] bool isHeadDone() const noexcept { return step != Step::step_head; }
+
+        [[nodiscard]] int getStatusCode() const noexcept { return status_code; }
+
+        /// @return `true` if the server will hang up after this reply.
+        [[nodiscard]] bool isClosing() const noexcept { return closing; }
+    };
+}
+
+#endif
@@ -0,0 +1,189 @@
+#ifndef METRICS_HPP
+#define METRICS_HPP
+
+#include <cstdint>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <string>
+#include "netio/queues.hpp"
+#include "http1/helpers.hpp"
+
+namespace ToyServer::Metrics
+{
+    /**
+     * @brief Monotonic counters kept per thread.
+     */
+    enum class Counter
+    {
+        c_accepts,
+        c_conns_opened,
+        c_conns_closed,
+        c_bytes_in,
+        c_bytes_out,
+        last = c_bytes_out
+    };
+
+    /**
+     * @brief Latency histograms kept per thread.
+     */
+    enum class Timer
+    {
+        t_parse,   // reading and parsing one request head
+        t_handler, // producing one reply
+        t_write,   // one serialize or flush call of the reply writer
+        last = t_write
+    };
+
+    constexpr std::size_t counter_count = static_cast<std::size_t>(Counter::last) + 1;
+    constexpr std::size_t timer_count = static_cast<std::size_t>(Timer::last) + 1;
+    constexpr std::size_t method_count = static_cast<std::size_t>(Http1::Method::last) + 1;
+    constexpr std::size_t status_count = static_cast<std::size_t>(Http1::Status::last) + 1;
+
+    /// @brief Histogram layout: durations up to 2^10 ns share the first bucket, every power of two after that up to 2^35 ns (about 34 s) is split into 2^sub_bucket_bits linear steps, and anything longer overflows into the last bucket.
+    constexpr int min_exponent = 10;
+    constexpr int max_exponent = 34;
+    constexpr int sub_bucket_bits = 1;
+    constexpr std::size_t bucket_count = 2 + (static_cast<std::size_t>(max_exponent - min_exponent + 1) << sub_bucket_bits);
+
+    /// @brief Histogram bucket of a duration. Buckets cover (lower, upper], matching the inclusive `le` bound of a Prometheus bucket.
+    constexpr std::size_t bucketOf(std::uint64_t nanos) noexcept
+    {
+        std::uint64_t value = (nanos > 0) ? nanos - 1 : 0;
+        int exponent = std::bit_width(value) - 1;
+
+        if (exponent < min_exponent)
+            return 0;
+
+        if (exponent > max_exponent)
+            return bucket_count - 1;
+
+        auto sub_bucket = static_cast<std::size_t>((value >> (exponent - sub_bucket_bits)) & ((1U << sub_bucket_bits) - 1));
+
+        return 1 + (static_cast<std::size_t>(exponent - min_exponent) << sub_bucket_bits) + sub_bucket;
+    }
+
+    /// @brief Inclusive upper bound in nanoseconds of every bucket but the overflow one.
+    constexpr std::uint64_t bucketBound(std::size_t bucket_idx) noexcept
+    {
+        if (bucket_idx == 0)
+            return std::uint64_t {1} << min_exponent;
+
+        std::size_t step = bucket_idx - 1;
+        int exponent = min_exponent + static_cast<int>(step >> sub_bucket_bits);
+        std::uint64_t sub_bucket = step & ((1U << sub_bucket_bits) - 1);
+
+        return (std::uint64_t {1} << exponent) + ((sub_bucket + 1) << (exponent - sub_bucket_bits));
+    }
+
+    static_assert(bucketOf(1024) == 0 && bucketOf(1025) == 1 && bucketOf(1536) == 1 && bucketOf(1537) == 2 && bucketOf(2048) == 2 && bucketOf(2049) == 3);
+    static_assert(bucketBound(1) == 1536 && bucketBound(2) == 2048 && bucketBound(bucket_count - 2) == std::uint64_t {1} << (max_exponent + 1));
+    static_assert(bucketOf(bucketBound(bucket_count - 2) + 1) == bucket_count - 1);
+
+    /**
+     * @brief Totals of one latency histogram over all threads.
+     */
+    struct TimerTotals
+    {
+        std::array<std::uint64_t, bucket_count> buckets; // per bucket, not cumulative
+        std::uint64_t sum_ns;
+        std::uint64_t count;
+    };
+
+    /**
+     * @brief All metrics summed over every thread at one point in time.
+     */
+    struct MetricsSnapshot
+    {
+        std::array<std::uint64_t, counter_count> counters;
+        std::array<std::uint64_t, method_count * status_count> requests; // by method, then status
+        std::array<TimerTotals, timer_count> timers;
+        std::size_t block_count; // per-thread blocks summed, including those of finished threads
+
+        [[nodiscard]] std::uint64_t get(Counter id) const noexcept { return counters[static_cast<std::size_t>(id)]; }
+
+        [[nodiscard]] std::uint64_t getRequests(Http1::Method method, Http1::Status status) const noexcept { return requests[static_cast<std::size_t>(method) * status_count + static_cast<std::size_t>(status)]; }
+
+        [[nodiscard]] const TimerTotals& getTimer(Timer id) const noexcept { return timers[static_cast<std::size_t>(id)]; }
+    };
+
+    /**
+     * @brief One thread's metrics, on cache lines of its own so recording never contends with other threads.
+     * @note Only the owning thread writes, so an update is a relaxed load and store with no locked instruction. Scrapes read concurrently and may see an update a moment late, never a torn one.
+     */
+    class alignas(NetIO::cache_line_size) ThreadMetrics
+    {
+    private:
+        struct TimerCells
+        {
+            std::array<std::atomic<std::uint64_t>, bucket_count> buckets;
+            std::atomic<std::uint64_t> sum_ns;
+        };
+
+        std::array<std::atomic<std::uint64_t>, counter_count> counters;
+        std::array<std::atomic<std::uint64_t>, method_count * status_count> requests;
+        std::array<TimerCells, timer_count> timers;
+        ThreadMetrics* next;         // registry link, fixed before the block is published
+        std::atomic<bool> claimed;   // owned by a live thread
+
+        static void bump(std::atomic<std::uint64_t>& cell, std::uint64_t amount) noexcept
+        {
+            cell.store(cell.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+        }
+
+        friend ThreadMetrics& claimThreadMetrics() noexcept;
+        friend void releaseThreadMetrics(ThreadMetrics& block) noexcept;
+        friend MetricsSnapshot collectMetrics() noexcept;
+
+    public:
+        ThreadMetrics() noexcept;
+
+        ThreadMetrics(const ThreadMetrics& other) = delete;
+        ThreadMetrics& operator=(const ThreadMetrics& other) = delete;
+
+        void add(Counter id, std::uint64_t amount = 1) noexcept
+        {
+            bump(counters[static_cast<std::size_t>(id)], amount);
+        }
+
+        void countRequest(Http1::Method method, Http1::Status status) noexcept
+        {
+            bump(requests[static_cast<std::size_t>(method) * status_count + static_cast<std::size_t>(status)], 1);
+        }
+
+        void observe(Timer id, std::chrono::nanoseconds span) noexcept
+        {
+            auto nanos = static_cast<std::uint64_t>((span.count() > 0) ? span.count() : 0);
+            TimerCells& cells = timers[static_cast<std::size_t>(id)];
+
+            bump(cells.buckets[bucketOf(nanos)], 1);
+            bump(cells.sum_ns, nanos);
+        }
+
+        /// @brief Adds this block's values to `totals`.
+        void sumInto(MetricsSnapshot& totals) const noexcept;
+    };
+
+    /// @brief Block of the calling thread, or `nullptr` before its first recording.
+    inline thread_local ThreadMetrics* local_metrics = nullptr;
+
+    /// @brief Binds a block to the calling thread, reusing one a finished thread gave back so counters stay monotonic. Called once per thread.
+    [[nodiscard]] ThreadMetrics& claimThreadMetrics() noexcept;
+
+    /// @brief Metrics block of the calling thread. Costs a thread-local load after the first call.
+    [[nodiscard]] inline ThreadMetrics& threadMetrics() noexcept
+    {
+        ThreadMetrics* block = local_metrics;
+
+        return (block != nullptr) ? *block : claimThreadMetrics();
+    }
+
+    /// @brief Sums every thread's block. Lock-free, so it never stalls recording threads.
+    [[nodiscard]] MetricsSnapshot collectMetrics() noexcept;
+
+    /// @brief Appends `snapshot` to `out` in the Prometheus text exposition format (version 0.0.4).
+    void writePrometheus(const MetricsSnapshot& snapshot, std::string& out);
+}
+
+#endif
@@ -5,59 +5,60 @@
 #include <string>
 #include <algorithm>
 #include <memory>
+#include <optional>
+#include <span>
+#include "netio/pools.hpp"
 
 namespace ToyServer::NetIO
 {
+    /**
+     * @brief Fixed size octet block with an extra NUL past the end, drawn from `BufferPool`.
+     * @note Copies are deep. Moves keep the block where it is, so pointers into it survive them.
+     */
     class FixedBuffer
     {
     private:
         using octet_ptr_t = char*;
 
-        std::unique_ptr<char> block;
+        PooledBlock block;
         std::size_t capacity;
 
-        constexpr void swapState(FixedBuffer&& other) noexcept
+        void swapState(FixedBuffer&& other) noexcept
         {
-            block = std::move(other.block);
-
-            std::size_t temp_capacity = 0;
-            std::swap(temp_capacity, other.capacity);
-            capacity = temp_capacity;
+            std::swap(block, other.block);
+            std::swap(capacity, other.capacity);
         }
     public:
-        constexpr FixedBuffer(std::size_t capacity_)
-        : block {std::make_unique<char>(capacity_ + 1)} {}
-
-        constexpr FixedBuffer(const FixedBuffer& other)
+        FixedBuffer(std::size_t capacity_)
+        : block {capacity_ + 1}, capacity {capacity_}
         {
-            if (&other == this)
-                return;
-
-            block = std::make_unique<char>(other.capacity);
+            block.get()[capacity] = '\0';
+        }
 
-            std::copy(other.block.get(), other.block.get() + other.capacity, block.get());
-            capacity = other.capacity;
+        FixedBuffer(const FixedBuffer& other)
+        : block {other.capacity + 1}, capacity {other.capacity}
+        {
+            std::copy(other.block.get(), other.block.get() + other.capacity + 1, block.get());
         }
 
-        constexpr FixedBuffer& operator=(const FixedBuffer& other)
+        FixedBuffer& operator=(const FixedBuffer& other)
         {
             if (&other == this)
                 return *this;
 
-            block = std::make_unique<char>(other.capacity);
-
-            std::copy(other.block.get(), other.block.get() + other.capacity, block.get());
-            capacity = other.capacity;
+            FixedBuffer temp {other};
+            swapState(std::move(temp));
 
             return *this;
         }
 
-        constexpr FixedBuffer(FixedBuffer&& other) noexcept
+        FixedBuffer(FixedBuffer&& other) noexcept
+        : block {}, capacity {0}
         {
             swapState(std::forward<FixedBuffer&&>(other));
         }
 
-        constexpr FixedBuffer& operator=(FixedBuffer&& other) noexcept
+        FixedBuffer& operator=(FixedBuffer&& other) noexcept
         {
             swapState(std::forward<FixedBuffer&&>(other));
             return *this;
@@ -79,6 +80,59 @@ namespace ToyServer::NetIO
         [[nodiscard]] bool loadChars(const std::string& content);
         [[nodiscard]] bool loadChars(const char* octet_ptr, std::size_t len);
     };
+
+    /**
+     * @brief Circular read-ahead buffer for socket input. One `recv` can fill all free space (both sides of the wrap), and scans work over buffered octets so leftovers carry over to the next read.
+     * @note Capacity is rounded up to a power of two for index masking. Storage comes from `BufferPool` on the first fill, so idle owners cost nothing and connection churn reuses slabs.
+     */
+    class RingBuffer
+    {
+    private:
+        PooledBlock block;
+        std::size_t capacity;
+        std::size_t head; // total octets consumed, never wraps
+        std::size_t tail; // total octets produced, never wraps
+
+    public:
+        explicit RingBuffer(std::size_t capacity_);
+
+        RingBuffer(const RingBuffer& other) = delete;
+        RingBuffer& operator=(const RingBuffer& other) = delete;
+
+        RingBuffer(RingBuffer&& other) noexcept = default;
+        RingBuffer& operator=(RingBuffer&& other) noexcept = default;
+
+        [[nodiscard]] std::size_t getCapacity() const noexcept { return capacity; }
+
+        [[nodiscard]] std::size_t getSize() const noexcept { return tail - head; }
+
+        [[nodiscard]] std::size_t getSpace() const noexcept { return capacity - getSize(); }
+
+        [[nodiscard]] bool isEmpty() const noexcept { return head == tail; }
+
+        /// @brief Free regions in fill order: the second span is non-empty only when free space wraps.
+        [[nodiscard]] std::pair<std::span<char>, std::span<char>> getFreeSpans();
+
+        /// @brief Makes all buffered octets contiguous, rotating the block in place only if the data currently wraps.
+        [[nodiscard]] std::span<const char> linearize() noexcept;
+
+        /// @brief Buffered regions in read order: the second span is non-empty only when data wraps.
+        [[nodiscard]] std::pair<std::span<const char>, std::span<const char>> getDataSpans() const noexcept;
+
+        /// @brief Marks `count` octets of the free spans as filled.
+        void commitWrite(std::size_t count) noexcept;
+
+        /// @brief Offset from the read position of the first `delim`, if buffered.
+        [[nodiscard]] std::optional<std::size_t> findOctet(char delim) const noexcept;
+
+        /// @brief Moves up to `len` buffered octets into `dst`.
+        /// @return Count of octets moved.
+        std::size_t copyOut(char* dst, std::size_t len) noexcept;
+
+        void discard(std::size_t count) noexcept;
+
+        void clear() noexcept;
+    };
 }
 
 #endif
\ No newline at end of file
@@ -24,9 +24,10 @@ namespace ToyServer::NetIO
         std::string socket_port_str;   // port number as text
         int socket_backlog_num;        // count of pending connections
         int socket_timeout_num;        // seconds
+        bool socket_reuse_port;        // SO_REUSEPORT: let several listeners share the port
 
-        constexpr SocketHints(const char* port_cstr, int backlog, int timeout) noexcept
-        : socket_port_str {port_cstr}, socket_backlog_num {backlog}, socket_timeout_num {timeout} {}
+        constexpr SocketHints(const char* port_cstr, int backlog, int timeout, bool reuse_port = false) noexcept
+        : socket_port_str {port_cstr}, socket_backlog_num {backlog}, socket_timeout_num {timeout}, socket_reuse_port {reuse_port} {}
     };
 
     /**
@@ -36,7 +37,7 @@ namespace ToyServer::NetIO
     {
         int socket_fd; // sockfd : int
         int socket_backlog; // backlog : int
-        int rw_timeout; // SO_LINGER : int
+        int rw_timeout; // SO_LINGER seconds, set by blocking sessions only : int
     };
 
     /**
@@ -49,6 +50,7 @@ namespace ToyServer::NetIO
         struct addrinfo* opt_cursor;
         int so_backlog;
         int so_timeout;
+        bool so_reuse_port;
 
         [[nodiscard]] bool atEnd() const noexcept;
         [[nodiscard]] bool isEmpty() const noexcept;
@@ -0,0 +1,71 @@
+#ifndef FILES_HPP
+#define FILES_HPP
+
+#include <cstddef>
+#include <ctime>
+
+namespace ToyServer::NetIO
+{
+    /**
+     * @brief Simple aggregate of the file metadata replies need.
+     */
+    struct FileStats
+    {
+        std::size_t size;
+        std::time_t modified;
+        bool is_regular;
+        bool is_directory;
+    };
+
+    /**
+     * @brief RAII wrapper for a read-only file descriptor, such as one handed to `sendfile`.
+     */
+    class FileHandle
+    {
+    private:
+        static constexpr int file_fd_placeholder = -1; // invalid file fd, placeholder only!
+
+        int fd;
+
+        void closeFd() noexcept;
+        void swapState(FileHandle&& other) noexcept;
+
+    public:
+        constexpr FileHandle() noexcept
+        : fd {file_fd_placeholder} {}
+
+        explicit FileHandle(int fd_) noexcept
+        : fd {fd_} {}
+
+        FileHandle(const FileHandle& other) = delete;
+        FileHandle& operator=(const FileHandle& other) = delete;
+
+        FileHandle(FileHandle&& other) noexcept;
+        FileHandle& operator=(FileHandle&& other) noexcept;
+
+        [[nodiscard]] int getFd() const noexcept { return fd; }
+
+        [[nodiscard]] bool isOpen() const noexcept { return fd != file_fd_placeholder; }
+
+        /// @return `false` when `fstat` fails.
+        [[nodiscard]] bool getStats(FileStats& stats) const noexcept;
+
+        /// @brief Reads exactly `count` octets from `offset` into `dst` without moving the file position.
+        /// @return `false` on errors or an early end of file.
+        [[nodiscard]] bool readAt(char* dst, std::size_t count, std::size_t offset) const noexcept;
+
+        /// @brief Hints the kernel to read ahead aggressively, for files about to be streamed whole.
+        void adviseSequential() const noexcept;
+
+        ~FileHandle() noexcept;
+    };
+
+    /**
+     * @brief Opens `relative_path` beneath the directory `dir_fd` for reading, with `openat2` and `RESOLVE_BENEATH`.
+     * @note A symlink is followed only when its target stays beneath `dir_fd`. Kernels without `openat2` refuse every symlink instead.
+     * @return A closed handle on failure, including a path that escapes `dir_fd`.
+     */
+    [[nodiscard]] FileHandle openFileAt(int dir_fd, const char* relative_path) noexcept;
+}
+
+#endif
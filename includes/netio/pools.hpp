@@ -0,0 +1,179 @@
+#ifndef POOLS_HPP
+#define POOLS_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <array>
+#include <atomic>
+#include <memory_resource>
+#include <mutex>
+#include <utility>
+#include <vector>
+#include "netio/queues.hpp"
+
+namespace ToyServer::NetIO
+{
+    struct LocalCache;
+
+    /**
+     * @brief Snapshot of the pool counters.
+     */
+    struct PoolStats
+    {
+        std::uint64_t arena_count;  // arenas reserved so far, each `BufferPool::arena_size` octets
+        std::uint64_t carved_count; // slabs ever cut from arenas
+        std::uint64_t large_count;  // oversized blocks that went to the heap
+    };
+
+    /**
+     * @brief Process wide allocator for I/O buffers. Sizes up to `max_slab_size` are rounded to power of two classes, and each slab is cut from a large preallocated arena on cache line boundaries. Freed slabs go to a per-thread free list first, so steady connection churn reuses memory without touching malloc or any lock.
+     * @note Slabs are never handed back to the system. Bigger requests get their own aligned heap block.
+     */
+    class BufferPool
+    {
+    public:
+        static constexpr std::size_t slab_alignment = cache_line_size;
+        static constexpr std::size_t min_slab_size = 64;
+        static constexpr std::size_t max_slab_size = 1 << 20;
+        static constexpr std::size_t class_count = 15; // 64 B up to 1 MiB
+        static constexpr std::size_t arena_size = 1 << 22;
+        static constexpr std::size_t local_cache_limit = 32; // slabs of one class a thread keeps to itself
+
+    private:
+        friend struct LocalCache;
+
+        /// @brief Slabs of one class freed by threads whose own lists were full.
+        struct alignas(cache_line_size) SharedList
+        {
+            std::mutex lock;
+            std::vector<char*> slabs;
+        };
+
+        std::array<SharedList, class_count> shared_lists;
+        std::mutex arena_lock;
+        std::vector<char*> arenas;
+        char* arena_cursor;
+        std::size_t arena_left;
+        std::atomic<std::uint64_t> carved_count;
+        std::atomic<std::uint64_t> large_count;
+
+        BufferPool() noexcept;
+
+        [[nodiscard]] char* carveSlab(std::size_t class_idx);
+
+        /// @brief Takes back a thread's cached slabs of one class, used when a thread's free list fills up or the thread exits.
+        void returnShared(std::size_t class_idx, char* const* slabs, std::size_t count) noexcept;
+
+        /// @brief Refills a thread's free list of one class from the shared one.
+        /// @return Count of slabs moved into `slabs`.
+        std::size_t takeShared(std::size_t class_idx, char** slabs, std::size_t max_count) noexcept;
+
+    public:
+        /// @brief Size class index for a request of `size` octets, which must not exceed `max_slab_size`.
+        [[nodiscard]] static constexpr std::size_t pickClass(std::size_t size) noexcept
+        {
+            std::size_t class_idx = 0;
+
+            while ((min_slab_size << class_idx) < size)
+                class_idx++;
+
+            return class_idx;
+        }
+
+        [[nodiscard]] static constexpr std::size_t getClassSize(std::size_t class_idx) noexcept
+        {
+            return min_slab_size << class_idx;
+        }
+
+        [[nodiscard]] static BufferPool& getInstance();
+
+        BufferPool(const BufferPool& other) = delete;
+        BufferPool& operator=(const BufferPool& other) = delete;
+
+        /// @return Cache line aligned, uninitialized storage for at least `size` octets.
+        [[nodiscard]] char* acquire(std::size_t size);
+
+        /// @note `size` must be the one passed to `acquire`.
+        void release(char* block, std::size_t size) noexcept;
+
+        [[nodiscard]] PoolStats getStats() noexcept;
+
+        ~BufferPool() noexcept;
+    };
+
+    /**
+     * @brief Owning handle to storage from `BufferPool`, given back on destruction.
+     */
+    class PooledBlock
+    {
+    private:
+        char* block;
+        std::size_t size;
+
+    public:
+        constexpr PooledBlock() noexcept
+        : block {nullptr}, size {0} {}
+
+        explicit PooledBlock(std::size_t size_)
+        : block {BufferPool::getInstance().acquire(size_)}, size {size_} {}
+
+        PooledBlock(const PooledBlock& other) = delete;
+        PooledBlock& operator=(const PooledBlock& other) = delete;
+
+        PooledBlock(PooledBlock&& other) noexcept
+        : block {std::exchange(other.block, nullptr)}, size {std::exchange(other.size, 0)} {}
+
+        PooledBlock& operator=(PooledBlock&& other) noexcept
+        {
+            if (&other != this)
+            {
+                reset();
+                block = std::exchange(other.block, nullptr);
+                size = std::exchange(other.size, 0);
+            }
+
+            return *this;
+        }
+
+        [[nodiscard]] constexpr char* get() const noexcept { return block; }
+
+        [[nodiscard]] explicit operator bool() const noexcept { return block != nullptr; }
+
+        void reset() noexcept
+        {
+            if (block != nullptr)
+                BufferPool::getInstance().release(std::exchange(block, nullptr), std::exchange(size, 0));
+        }
+
+        ~PooledBlock() noexcept
+        {
+            reset();
+        }
+    };
+
+    /**
+     * @brief Monotonic `std::pmr` arena for the short lived pieces of one request, released wholesale before the next. It starts out in one pooled slab, so a typical request allocates nothing at all.
+     * @note Requests that outgrow the slab spill to the heap until the next `reset()`.
+     */
+    class RequestArena
+    {
+    private:
+        static constexpr std::size_t initial_size = 8192;
+
+        PooledBlock initial;
+        std::pmr::monotonic_buffer_resource resource;
+
+    public:
+        RequestArena();
+
+        RequestArena(const RequestArena& other) = delete;
+        RequestArena& operator=(const RequestArena& other) = delete;
+
+        [[nodiscard]] std::pmr::memory_resource* getResource() noexcept { return &resource; }
+
+        /// @brief Frees everything allocated so far at once, invalidating it.
+        void reset() noexcept { resource.release(); }
+    };
+}
+
+#endif
@@ -0,0 +1,177 @@
+#ifndef QUEUES_HPP
+#define QUEUES_HPP
+
+#include <cstdint>
+#include <cstddef>
+#include <atomic>
+#include <array>
+#include <optional>
+#include <type_traits>
+
+namespace ToyServer::NetIO
+{
+    /// @brief Destructive interference size assumed for padding hot atomics.
+    constexpr std::size_t cache_line_size = 64;
+
+    /// @brief Helper for queue capacities, which must be powers of two for index masking.
+    constexpr bool isPowerOfTwo(std::size_t n)
+    {
+        return n != 0 && (n & (n - 1)) == 0;
+    }
+
+    /**
+     * @brief Bounded lock-free ring with exactly one producer thread and one consumer thread.
+     */
+    template <typename T, std::size_t Capacity>
+    class SpscRing
+    {
+    private:
+        static_assert(isPowerOfTwo(Capacity), "SpscRing capacity must be a power of two.");
+        static_assert(std::is_trivially_copyable_v<T>, "SpscRing items must be trivially copyable.");
+
+        static constexpr std::size_t index_mask = Capacity - 1;
+
+        alignas(cache_line_size) std::atomic<std::size_t> head; // consumer position
+        alignas(cache_line_size) std::atomic<std::size_t> tail; // producer position
+        alignas(cache_line_size) std::array<T, Capacity> items;
+
+    public:
+        constexpr SpscRing() noexcept
+        : head {0}, tail {0}, items {} {}
+
+        SpscRing(const SpscRing& other) = delete;
+        SpscRing& operator=(const SpscRing& other) = delete;
+
+        /// @note Producer side only.
+        [[nodiscard]] bool tryPush(const T& item) noexcept
+        {
+            std::size_t tail_pos = tail.load(std::memory_order_relaxed);
+
+            if (tail_pos - head.load(std::memory_order_acquire) >= Capacity)
+                return false;
+
+            items[tail_pos & index_mask] = item;
+            tail.store(tail_pos + 1, std::memory_order_release);
+
+            return true;
+        }
+
+        /// @note Consumer side only.
+        [[nodiscard]] std::optional<T> tryPop() noexcept
+        {
+            std::size_t head_pos = head.load(std::memory_order_relaxed);
+
+            if (head_pos == tail.load(std::memory_order_acquire))
+                return {};
+
+            T item = items[head_pos & index_mask];
+            head.store(head_pos + 1, std::memory_order_release);
+
+            return item;
+        }
+
+        [[nodiscard]] std::size_t getSize() const noexcept
+        {
+            return tail.load(std::memory_order_acquire) - head.load(std::memory_order_acquire);
+        }
+    };
+
+    /**
+     * @brief Bounded Chase-Lev work-stealing deque. The owner pushes and pops at the bottom without locks, while any other thread may steal from the top with a single CAS.
+     * @note Items are stored in lock-free atomics so that racing steals never tear a slot.
+     */
+    template <typename T, std::size_t Capacity>
+    class StealDeque
+    {
+    private:
+        static_assert(isPowerOfTwo(Capacity), "StealDeque capacity must be a power of two.");
+        static_assert(std::atomic<T>::is_always_lock_free, "StealDeque items must fit a lock-free atomic.");
+
+        static constexpr std::size_t index_mask = Capacity - 1;
+
+        alignas(cache_line_size) std::atomic<std::int64_t> top;    // thief end
+        alignas(cache_line_size) std::atomic<std::int64_t> bottom; // owner end
+        alignas(cache_line_size) std::array<std::atomic<T>, Capacity> items;
+
+    public:
+        constexpr StealDeque() noexcept
+        : top {0}, bottom {0}, items {} {}
+
+        StealDeque(const StealDeque& other) = delete;
+        StealDeque& operator=(const StealDeque& other) = delete;
+
+        /// @note Owner side only.
+        [[nodiscard]] bool tryPush(const T& item) noexcept
+        {
+            std::int64_t bottom_pos = bottom.load(std::memory_order_relaxed);
+            std::int64_t top_pos = top.load(std::memory_order_acquire);
+
+            if (bottom_pos - top_pos >= static_cast<std::int64_t>(Capacity))
+                return false;
+
+            items[bottom_pos & index_mask].store(item, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+            bottom.store(bottom_pos + 1, std::memory_order_relaxed);
+
+            return true;
+        }
+
+        /// @note Owner side only.
+        [[nodiscard]] std::optional<T> tryPop() noexcept
+        {
+            std::int64_t bottom_pos = bottom.load(std::memory_order_relaxed) - 1;
+            bottom.store(bottom_pos, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            std::int64_t top_pos = top.load(std::memory_order_relaxed);
+
+            if (top_pos > bottom_pos)
+            {
+                bottom.store(bottom_pos + 1, std::memory_order_relaxed);
+                return {};
+            }
+
+            T item = items[bottom_pos & index_mask].load(std::memory_order_relaxed);
+
+            if (top_pos == bottom_pos)
+            {
+                // last item: race any thief for it
+                bool won = top.compare_exchange_strong(top_pos, top_pos + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+                bottom.store(bottom_pos + 1, std::memory_order_relaxed);
+
+                if (!won)
+                    return {};
+            }
+
+            return item;
+        }
+
+        /// @note Safe from any thread.
+        [[nodiscard]] std::optional<T> trySteal() noexcept
+        {
+            std::int64_t top_pos = top.load(std::memory_order_acquire);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            std::int64_t bottom_pos = bottom.load(std::memory_order_acquire);
+
+            if (top_pos >= bottom_pos)
+                return {};
+
+            T item = items[top_pos & index_mask].load(std::memory_order_relaxed);
+
+            if (!top.compare_exchange_strong(top_pos, top_pos + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+                return {};
+
+            return item;
+        }
+
+        [[nodiscard]] std::size_t getSize() const noexcept
+        {
+            std::int64_t depth = bottom.load(std::memory_order_relaxed) - top.load(std::memory_order_relaxed);
+
+            return (depth > 0) ? static_cast<std::size_t>(depth) : 0;
+        }
+
+        [[nodiscard]] constexpr std::size_t getCapacity() const noexcept { return Capacity; }
+    };
+}
+
+#endif
@@ -0,0 +1,129 @@
+#ifndef REACTOR_HPP
+#define REACTOR_HPP
+
+#include <cstdint>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include "netio/config.hpp"
+#include "netio/sockets.hpp"
+
+namespace ToyServer::NetIO
+{
+    /**
+     * @brief Lifecycle stage of a reactor-owned connection.
+     */
+    enum class ConnState
+    {
+        conn_reading, // waiting for more request octets
+        conn_writing, // output is queued but the kernel buffer is full
+        conn_closing  // flush remaining output, then drop
+    };
+
+    /**
+     * @brief Per-connection state machine owned by a `Reactor`. Holds the non-blocking socket plus its pending input and output octets.
+     */
+    class Connection
+    {
+    public:
+        static constexpr std::size_t max_inbox_size = 1 << 20; // unconsumed input past this drops the connection
+
+    private:
+        static constexpr std::size_t read_chunk_size = 4096;
+
+        ClientSocket socket;
+        std::string inbox;      // received octets not yet consumed by the handler
+        std::string outbox;     // queued reply octets
+        std::size_t out_offset; // octets of outbox already sent
+        ConnState state;
+        bool peer_closed;       // the peer sent FIN, so no more input will come
+
+    public:
+        explicit Connection(SocketConfig config);
+
+        Connection(const Connection& other) = delete;
+        Connection& operator=(const Connection& other) = delete;
+
+        [[nodiscard]] ClientSocket& getSocket() noexcept { return socket; }
+
+        /// @note Handlers should erase whatever prefix they consumed.
+        [[nodiscard]] std::string& getInbox() noexcept { return inbox; }
+
+        [[nodiscard]] ConnState getState() const noexcept { return state; }
+
+        void setState(ConnState next) noexcept { state = next; }
+
+        /// @return Whether a read already saw the peer's hang-up. Queued replies may still be flushed to it.
+        [[nodiscard]] bool isPeerClosed() const noexcept { return peer_closed; }
+
+        void queueOutput(std::string_view data);
+
+        [[nodiscard]] bool hasPendingOutput() const noexcept;
+
+        /// @brief Moves all unsent output out, for backends that submit writes asynchronously and need the octets to stay put until completion.
+        [[nodiscard]] std::string takeOutput();
+
+        /// @brief Drains the kernel receive buffer into the inbox, as edge-triggered readiness requires. An `io_closed` result marks the peer as closed.
+        /// @return `io_ok` only when reading stopped at `max_inbox_size` with input possibly left in the kernel.
+        [[nodiscard]] IOStatus fillInbox();
+
+        /// @brief Sends queued output until done or the kernel buffer fills up.
+        [[nodiscard]] IOStatus flushOutbox();
+    };
+
+    /**
+     * @brief Callback run whenever a connection receives new input. It consumes from the inbox, queues output, and returns the next state: `conn_reading` to keep the connection or `conn_closing` to drop it after flushing.
+     * @note A handler may stop after one request: it is called again as long as it consumes input and its output gets flushed. A handler that throws, or leaves `max_inbox_size` octets unconsumed, gets its connection dropped.
+     */
+    using ConnectionHandler = std::function<ConnState(Connection& conn)>;
+
+    /**
+     * @brief Edge-triggered epoll event loop. Owns a non-blocking listener's accepted connections and drives them from a single thread.
+     * @note Only `stop()` may be called from other threads.
+     */
+    class Reactor
+    {
+    private:
+        static constexpr int max_events = 256;
+
+        std::unordered_map<int, std::unique_ptr<Connection>> connections;
+        ConnectionHandler handler;
+        ServerSocket* listener;
+        int epoll_fd;
+        int wake_fd;
+        std::atomic<bool> running;
+
+        void watchFd(int fd, std::uint32_t events);
+        void addConnection(SocketConfig config);
+        void acceptPending();
+        void handleClient(int fd, std::uint32_t events);
+        void dropConnection(int fd);
+
+    public:
+        /// @note `listener_` must be non-blocking and must outlive the reactor.
+        Reactor(ServerSocket& listener_, ConnectionHandler handler_);
+
+        Reactor(const Reactor& other) = delete;
+        Reactor& operator=(const Reactor& other) = delete;
+
+        [[nodiscard]] std::size_t getConnectionCount() const noexcept { return connections.size(); }
+
+        /// @brief Takes over an already connected non-blocking socket, as if the listener had accepted it.
+        void adoptConnection(SocketConfig config);
+
+        /// @brief Waits up to `timeout_ms` for readiness and dispatches every ready event once.
+        void runOnce(int timeout_ms);
+
+        /// @brief Loops on `runOnce` until `stop()` is called.
+        void run();
+
+        void stop() noexcept;
+
+        ~Reactor() noexcept;
+    };
+}
+
+#endif
@@ -0,0 +1,90 @@
+#ifndef SHARDS_HPP
+#define SHARDS_HPP
+
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <latch>
+#include <memory>
+#include <optional>
+#include <thread>
+#include <vector>
+#include "netio/config.hpp"
+#include "netio/queues.hpp"
+#include "netio/reactor.hpp"
+#include "netio/sockets.hpp"
+#include "netio/uring.hpp"
+
+namespace ToyServer::NetIO
+{
+    /**
+     * @brief Pins the calling thread to one CPU.
+     * @return `true` on success.
+     */
+    [[nodiscard]] bool pinThisThread(std::size_t cpu_idx) noexcept;
+
+    /**
+     * @brief Lists the CPUs the calling thread may run on, which a container or `taskset` may restrict to fewer or other ids than `hardware_concurrency()` suggests.
+     * @return Allowed CPU ids in ascending order, or CPUs `0..hardware_concurrency()-1` if the mask cannot be read.
+     */
+    [[nodiscard]] std::vector<std::size_t> getAllowedCpus();
+
+    /**
+     * @brief Builds the connection handler for one shard, called on that shard's own thread so any state it captures is allocated core-locally.
+     */
+    using ShardHandlerFactory = std::function<ConnectionHandler(std::size_t shard_idx)>;
+
+    /**
+     * @brief Thread-per-core server mode. Every shard binds its own `SO_REUSEPORT` listener, is pinned to one CPU, and runs a private `Reactor` or `UringReactor`, so accepted connections never cross cores.
+     */
+    class ShardGroup
+    {
+    private:
+        struct alignas(cache_line_size) Shard
+        {
+            std::unique_ptr<ServerSocket> listener;
+            std::unique_ptr<Reactor> reactor;             // set for IOBackend::io_epoll
+            std::unique_ptr<UringReactor> uring_reactor;  // set for IOBackend::io_uring
+            std::exception_ptr startup_error;
+            std::exception_ptr run_error; // what ended the event loop early, if anything
+            std::thread thread;
+            int pinned_cpu; // -1 when pinning failed
+        };
+
+        std::vector<std::unique_ptr<Shard>> shards;
+        std::vector<std::size_t> allowed_cpus; // shards are spread over these, in order
+        SocketHints hints;
+        ShardHandlerFactory handler_factory;
+        IOBackend backend;
+
+        void shardMain(std::size_t shard_idx, std::latch& ready);
+
+    public:
+        /// @note A `shard_count` of 0 means one shard per CPU the process may run on. An unsupported `backend_` falls back to epoll.
+        ShardGroup(SocketHints hints_, std::size_t shard_count, ShardHandlerFactory handler_factory_, IOBackend backend_ = IOBackend::io_epoll);
+
+        ShardGroup(const ShardGroup& other) = delete;
+        ShardGroup& operator=(const ShardGroup& other) = delete;
+
+        [[nodiscard]] std::size_t getShardCount() const noexcept { return shards.size(); }
+
+        [[nodiscard]] IOBackend getBackend() const noexcept { return backend; }
+
+        /// @return The CPU a started shard is pinned to, or none if pinning it failed and it runs wherever the scheduler puts it.
+        [[nodiscard]] std::optional<std::size_t> getShardCpu(std::size_t shard_idx) const noexcept;
+
+        /// @return The error that ended a shard's event loop early, or null while it runs or after a clean stop.
+        /// @note Only read it after `stop()`, since the shard thread writes it.
+        [[nodiscard]] std::exception_ptr getShardFailure(std::size_t shard_idx) const noexcept;
+
+        /// @brief Spawns all shards and waits until each has its listener bound.
+        /// @note Rethrows the first shard setup failure after stopping the rest.
+        void start();
+
+        void stop() noexcept;
+
+        ~ShardGroup() noexcept;
+    };
+}
+
+#endif
@@ -2,11 +2,39 @@
 #define SOCKETS_HPP
 
 #include <sys/socket.h>
+#include <sys/uio.h>
+#include <span>
+#include <string_view>
 #include "netio/buffers.hpp"
 #include "netio/config.hpp"
 
 namespace ToyServer::NetIO
 {
+    /**
+     * @brief Outcome of a single non-blocking socket operation.
+     */
+    enum class IOStatus
+    {
+        io_ok,     // some octets were transferred
+        io_again,  // kernel buffer empty / full: wait for readiness
+        io_closed  // peer hung up or the socket errored
+    };
+
+    /**
+     * @brief Simple aggregate for a non-blocking transfer result.
+     */
+    struct IOResult
+    {
+        std::size_t count;
+        IOStatus status;
+    };
+
+    /**
+     * @brief Sets or clears O_NONBLOCK on a descriptor.
+     * @return `true` on success.
+     */
+    [[nodiscard]] bool setNonBlocking(int fd, bool enabled = true) noexcept;
+
     /**
      * @brief RAII wrapper for a listening socket's state.
      */
@@ -19,6 +47,7 @@ namespace ToyServer::NetIO
         int backlog;
         int child_sock_timeout;
         bool closed;
+        bool nonblocking;
 
         void closeFd();
         [[nodiscard]] bool isClosed() const;
@@ -26,9 +55,9 @@ namespace ToyServer::NetIO
 
     public:
         constexpr ServerSocket()
-        : fd {socket_fd_placeholder}, backlog {0}, child_sock_timeout {0}, closed {true} {}
+        : fd {socket_fd_placeholder}, backlog {0}, child_sock_timeout {0}, closed {true}, nonblocking {false} {}
 
-        ServerSocket(SocketConfig config);
+        ServerSocket(SocketConfig config, bool nonblocking_ = false);
 
         ServerSocket(const ServerSocket& other) = delete;
         ServerSocket& operator=(const ServerSocket& other) = delete;
@@ -36,6 +65,13 @@ namespace ToyServer::NetIO
         ServerSocket(ServerSocket&& other) noexcept;
         ServerSocket& operator=(ServerSocket&& other) noexcept;
 
+        [[nodiscard]] int getFd() const noexcept { return fd; }
+
+        [[nodiscard]] bool isNonBlocking() const noexcept { return nonblocking; }
+
+        [[nodiscard]] int getChildTimeout() const noexcept { return child_sock_timeout; }
+
+        /// @note For a non-blocking listener, the returned config has `socket_fd == -1` once the pending queue is drained. Accepted sockets inherit the listener's blocking mode.
         [[nodiscard]] SocketConfig acceptConnection() const;
 
         ~ServerSocket() noexcept;
@@ -48,7 +84,9 @@ namespace ToyServer::NetIO
     {
     private:
         static constexpr int socket_fd_placeholder = -1; // invalid socket fd, placeholder only!
+        static constexpr std::size_t read_ahead_size = 16384;
 
+        RingBuffer read_ahead; // octets received but not yet handed out
         int fd;
         int timeout;
         bool closed;
@@ -59,18 +97,10 @@ namespace ToyServer::NetIO
         void swapState(ClientSocket&& other) noexcept;
 
     public:
-        constexpr ClientSocket()
-        : fd {socket_fd_placeholder}, timeout {0}, closed {true}, peer_ok {false} {}
+        ClientSocket()
+        : read_ahead {read_ahead_size}, fd {socket_fd_placeholder}, timeout {0}, closed {true}, peer_ok {false} {}
 
-        constexpr ClientSocket(SocketConfig config)
-        : fd {config.socket_fd}, timeout {config.rw_timeout}, closed {fd != socket_fd_placeholder}, peer_ok {true}
-        {
-            struct linger timeout_opts {};
-            timeout_opts.l_linger = timeout;
-            timeout_opts.l_onoff = 1;
-
-            setsockopt(fd, SOL_SOCKET, SO_LINGER, &timeout_opts, sizeof(timeout_opts));
-        }
+        ClientSocket(SocketConfig config);
 
         ClientSocket(const ClientSocket& other) = delete;
         ClientSocket& operator=(const ClientSocket& other) = delete;
@@ -78,12 +108,54 @@ namespace ToyServer::NetIO
         ClientSocket(ClientSocket&& other) noexcept;
         ClientSocket& operator=(ClientSocket&& other) noexcept;
 
+        [[nodiscard]] int getFd() const noexcept { return fd; }
+
+        [[nodiscard]] bool isPeerOk() const noexcept { return peer_ok; }
+
+        [[nodiscard]] bool hasBufferedInput() const noexcept { return !read_ahead.isEmpty(); }
+
+        [[nodiscard]] std::size_t getReadAheadCapacity() const noexcept { return read_ahead.getCapacity(); }
+
+        /// @brief Bounds how long a blocking read may wait (`SO_RCVTIMEO`). A timed out read reports `io_again`.
+        [[nodiscard]] bool setReceiveTimeout(int timeout_ms) noexcept;
+
+        /// @brief Makes `close` wait up to `timeout_s` seconds for unsent output (`SO_LINGER`).
+        /// @note Only for blocking sockets: a lingering close blocks even on an `O_NONBLOCK` fd, which would stall an event loop.
+        [[nodiscard]] bool setLingerTimeout(int timeout_s) noexcept;
+
+        /// @brief Pulls as many octets as the kernel has (and the ring fits) with one scatter read.
+        [[nodiscard]] IOStatus fillReadAhead();
+
+        /// @brief Contiguous view of all buffered input, valid until the next fill or consume.
+        [[nodiscard]] std::string_view peekReadAhead() noexcept;
+
+        /// @brief Drops `count` buffered octets once a parser is done with them.
+        void consumeReadAhead(std::size_t count) noexcept;
+
         void readInto(std::size_t count, FixedBuffer& buffer);
         void writeFrom(std::size_t count, FixedBuffer& buffer);
+
+        /// @brief Reads one `delim` terminated chunk into `buffer` as a C string, dropping CR octets. Octets past the delimiter stay buffered for the next call.
+        /// @return Chunk length, 0 also when the peer hung up first (see `isPeerOk`).
         [[nodiscard]] std::size_t readUntil(char delim, FixedBuffer& buffer);
 
+        /// @brief Non-blocking read of at most `len` octets. Never loops on `EAGAIN`.
+        /// @note `io_closed` after an orderly hang-up still allows writes, so replies to a half-closed peer can be flushed.
+        [[nodiscard]] IOResult readSome(char* dst, std::size_t len) noexcept;
+
+        /// @brief Non-blocking write of at most `len` octets. Never loops on `EAGAIN`.
+        [[nodiscard]] IOResult writeSome(const char* src, std::size_t len) noexcept;
+
+        /// @brief Gathering variant of `writeSome`: sends from every segment in order with one `sendmsg`. At most `IOV_MAX` segments per call.
+        /// @param more_follows Sets `MSG_MORE` so a short head can share a TCP segment with the body sent next.
+        [[nodiscard]] IOResult writeGather(std::span<const struct iovec> segments, bool more_follows = false) noexcept;
+
+        /// @brief Sends up to `count` octets of a file from `offset` with `sendfile`, never copying them through userspace.
+        /// @note SIGPIPE is blocked on the calling thread during the call, so a reset peer yields `io_closed` instead of killing the process.
+        [[nodiscard]] IOResult sendFile(int file_fd, std::size_t offset, std::size_t count) noexcept;
+
         ~ClientSocket() noexcept;
     };
 }
 
-#endif
\ No newline at end of file
+#endif
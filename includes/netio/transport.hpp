@@ -0,0 +1,92 @@
+#ifndef TRANSPORT_HPP
+#define TRANSPORT_HPP
+
+#include <sys/uio.h>
+#include <concepts>
+#include <span>
+#include <string>
+#include <string_view>
+#include "netio/buffers.hpp"
+#include "netio/sockets.hpp"
+
+namespace ToyServer::NetIO
+{
+    /**
+     * @brief What the HTTP/1 reader and writer need from a connection: a read-ahead buffer refilled on demand, gathering writes, and file sends. Readers and writers are instantiated per transport, so these calls are direct.
+     * @note Statuses follow `ClientSocket`: a fill into a full buffer reports `io_ok`, and `io_again` means the peer has nothing more for now.
+     */
+    template <typename T>
+    concept Transport = requires(T& transport, const T& const_transport, std::size_t count, std::span<const struct iovec> segments, bool more_follows, int file_fd) {
+        { transport.fillReadAhead() } -> std::same_as<IOStatus>;
+        { transport.peekReadAhead() } -> std::same_as<std::string_view>;
+        { transport.consumeReadAhead(count) } -> std::same_as<void>;
+        { const_transport.hasBufferedInput() } -> std::same_as<bool>;
+        { const_transport.getReadAheadCapacity() } -> std::same_as<std::size_t>;
+        { transport.writeGather(segments, more_follows) } -> std::same_as<IOResult>;
+        { transport.sendFile(file_fd, count, count) } -> std::same_as<IOResult>;
+    };
+
+    /**
+     * @brief In-memory stand-in for a client socket: input is pushed by the caller and output is collected in a string, so parsing and serializing can be exercised or measured without the kernel.
+     * @note Transfers may be capped to act out short reads and writes. A fill with no input left reports `io_again`, or `io_closed` once the input was closed.
+     */
+    class MemoryTransport
+    {
+    private:
+        static constexpr std::size_t default_read_ahead_size = 16384;
+        static constexpr std::size_t file_chunk_size = 65536;
+
+        RingBuffer read_ahead; // octets "received" but not yet handed out
+        std::string input;     // octets pushed by the peer side that no fill took yet
+        std::string output;    // octets written to the peer side
+        std::size_t input_offset;
+        std::size_t max_transfer; // octets one fill or write moves at most
+        bool input_closed;
+
+    public:
+        explicit MemoryTransport(std::size_t read_ahead_size = default_read_ahead_size);
+
+        MemoryTransport(const MemoryTransport& other) = delete;
+        MemoryTransport& operator=(const MemoryTransport& other) = delete;
+
+        /// @brief Queues octets for later fills, as if the peer sent them.
+        void pushInput(std::string_view data);
+
+        /// @brief Acts out a peer hang up once the pushed input is drained.
+        void closeInput() noexcept { input_closed = true; }
+
+        void setMaxTransfer(std::size_t max_transfer_) noexcept { max_transfer = max_transfer_; }
+
+        [[nodiscard]] std::string_view getOutput() const noexcept { return output; }
+
+        void clearOutput() noexcept { output.clear(); }
+
+        /// @brief Forgets all input, output and buffered octets, keeping capacities for the next round.
+        void reset() noexcept;
+
+        [[nodiscard]] bool hasBufferedInput() const noexcept { return !read_ahead.isEmpty(); }
+
+        [[nodiscard]] std::size_t getReadAheadCapacity() const noexcept { return read_ahead.getCapacity(); }
+
+        [[nodiscard]] IOStatus fillReadAhead();
+
+        [[nodiscard]] std::string_view peekReadAhead() noexcept
+        {
+            auto flat = read_ahead.linearize();
+
+            return {flat.data(), flat.size()};
+        }
+
+        void consumeReadAhead(std::size_t count) noexcept { read_ahead.discard(count); }
+
+        [[nodiscard]] IOResult writeGather(std::span<const struct iovec> segments, bool more_follows = false);
+
+        /// @brief Copies a file range into the output with `pread`.
+        [[nodiscard]] IOResult sendFile(int file_fd, std::size_t offset, std::size_t count);
+    };
+
+    static_assert(Transport<ClientSocket>);
+    static_assert(Transport<MemoryTransport>);
+}
+
+#endif
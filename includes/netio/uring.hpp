@@ -0,0 +1,148 @@
+#ifndef URING_HPP
+#define URING_HPP
+
+#include <cstdint>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "netio/reactor.hpp"
+#include "netio/sockets.hpp"
+
+struct io_uring_sqe;
+struct io_uring_buf_ring;
+
+namespace ToyServer::NetIO
+{
+    /**
+     * @brief Event loop implementation to run connections on.
+     */
+    enum class IOBackend
+    {
+        io_epoll, // readiness based `Reactor`
+        io_uring  // completion based `UringReactor`
+    };
+
+    /**
+     * @brief Checks that the running kernel has every io_uring feature `UringReactor` relies on (multishot accept / recv, provided buffer rings, cancel by fd).
+     */
+    [[nodiscard]] bool isUringSupported() noexcept;
+
+    /**
+     * @brief Picks `wanted` unless it is unavailable here, then falls back to epoll.
+     */
+    [[nodiscard]] IOBackend pickBackend(IOBackend wanted) noexcept;
+
+    /**
+     * @brief io_uring counterpart of `Reactor`, driving the same `Connection` objects and handlers. One multishot accept feeds connections, each connection keeps one multishot recv that fills kernel-provided buffers, and queued output goes out as linked send chains, so most I/O costs no syscall of its own.
+     * @note Uses raw syscalls, no liburing. Only `stop()` may be called from other threads.
+     */
+    class UringReactor
+    {
+    private:
+        static constexpr unsigned ring_entries = 4096;
+        static constexpr unsigned recv_buf_count = 1024; // must be a power of two
+        static constexpr unsigned recv_buf_size = 4096;
+        static constexpr unsigned send_chunk_size = 65536;
+        static constexpr std::uint16_t recv_buf_group = 0;
+
+        /// @brief Operation kind packed into the top of each SQE's user_data.
+        enum class UringOp : std::uint8_t
+        {
+            op_accept,
+            op_recv,
+            op_send,
+            op_wake,
+            op_cancel
+        };
+
+        /// @brief Connection plus its in-flight submission bookkeeping.
+        struct UringConn
+        {
+            std::unique_ptr<Connection> conn;
+            std::string in_flight;     // octets owned by the kernel until every send of the chain completes
+            std::size_t flight_offset; // start of the next chain within in_flight
+            unsigned sends_in_flight;
+            bool recv_armed;
+            bool closing;
+        };
+
+        struct RingMaps
+        {
+            void* sq_ptr;
+            void* cq_ptr;
+            io_uring_sqe* sqes;
+            std::size_t sq_map_len;
+            std::size_t cq_map_len;
+            std::size_t sqes_map_len;
+        };
+
+        std::unordered_map<int, UringConn> connections;
+        std::vector<char> recv_slab;
+        ConnectionHandler handler;
+        RingMaps maps;
+        ServerSocket* listener;
+
+        // SQ / CQ ring views into the shared mappings, accessed through std::atomic_ref
+        unsigned* sq_head;
+        unsigned* sq_tail;
+        unsigned sq_mask;
+        unsigned sq_capacity;
+        unsigned* cq_head;
+        unsigned* cq_tail;
+        void* cqes;
+        unsigned cq_mask;
+        unsigned sq_local_tail;     // SQEs prepared but not yet published
+        std::size_t ops_in_flight;  // submissions still owed a final completion
+
+        io_uring_buf_ring* buf_ring;
+        std::size_t buf_ring_len;
+        std::uint64_t wake_value;
+        int ring_fd;
+        int wake_fd;
+        std::atomic<bool> running;
+
+        void setupRing();
+        void setupBufRing();
+        void teardown() noexcept;
+        void reapCompletions();
+
+        [[nodiscard]] io_uring_sqe* nextSqe();
+        int submitAndWait(unsigned wait_count);
+
+        void armAccept();
+        void armRecv(int fd);
+        void armWake();
+        void armCancel(int fd);
+        void submitOutput(int fd, UringConn& entry);
+        void recycleBuffer(std::uint16_t buf_id) noexcept;
+
+        void onAccept(int res, std::uint32_t flags);
+        void onRecv(int fd, int res, std::uint32_t flags);
+        void onSend(int fd, int res);
+        void beginClose(int fd, UringConn& entry);
+        void maybeDrop(int fd);
+
+    public:
+        /// @note `listener_` must outlive the reactor. Its blocking mode does not matter.
+        UringReactor(ServerSocket& listener_, ConnectionHandler handler_);
+
+        UringReactor(const UringReactor& other) = delete;
+        UringReactor& operator=(const UringReactor& other) = delete;
+
+        [[nodiscard]] std::size_t getConnectionCount() const noexcept { return connections.size(); }
+
+        /// @brief Submits pending work, waits for at least one completion, and handles every completion ready.
+        void runOnce();
+
+        /// @brief Loops on `runOnce` until `stop()` is called.
+        void run();
+
+        void stop() noexcept;
+
+        ~UringReactor() noexcept;
+    };
+}
+
+#endif
@@ -0,0 +1,108 @@
+#ifndef WORKERS_HPP
+#define WORKERS_HPP
+
+#include <cstdint>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <span>
+#include <thread>
+#include <vector>
+#include "netio/config.hpp"
+#include "netio/queues.hpp"
+#include "netio/sockets.hpp"
+
+namespace ToyServer::NetIO
+{
+    /**
+     * @brief Compact connection task: just what a worker needs to wrap an accepted socket. Fits a lock-free 64-bit atomic.
+     */
+    struct ConnTask
+    {
+        int socket_fd;
+        int rw_timeout;
+    };
+
+    /**
+     * @brief Snapshot of one worker's counters for tuning.
+     */
+    struct WorkerStats
+    {
+        std::size_t task_count;  // tasks run in total
+        std::size_t steal_count; // tasks taken from a peer's deque
+        std::size_t wake_count;  // times the worker slept and was woken
+        std::size_t queue_depth; // tasks waiting in this worker's deque
+    };
+
+    /**
+     * @brief Callback run on a worker thread for each accepted connection. It owns the socket from then on.
+     */
+    using ConnectionTask = std::function<void(SocketConfig config)>;
+
+    /**
+     * @brief Producer-consumer server core: one accept thread spreads connections in batches over per-worker work-stealing deques, and each worker takes from its own deque first and steals from its peers' when that runs dry.
+     * @note Tasks are whole blocking sessions, so every deque stays stealable: connections queued to a busy worker are taken by idle peers instead of waiting behind its session. The handoff is lock-free and idle workers sleep on an atomic epoch instead of a mutex.
+     */
+    class WorkerPool
+    {
+    private:
+        static constexpr std::size_t deque_capacity = 256;
+        static constexpr std::size_t accept_batch_size = 64;
+
+        struct alignas(cache_line_size) Worker
+        {
+            StealDeque<ConnTask, deque_capacity> deque; // the acceptor owns the bottom, this worker and its peers take from the top
+            std::atomic<std::uint32_t> wake_epoch;
+            std::atomic<bool> sleeping;
+            std::atomic<std::size_t> task_count;
+            std::atomic<std::size_t> steal_count;
+            std::atomic<std::size_t> wake_count;
+            std::thread thread;
+
+            Worker() noexcept
+            : deque {}, wake_epoch {0}, sleeping {false}, task_count {0}, steal_count {0}, wake_count {0}, thread {} {}
+        };
+
+        std::vector<std::unique_ptr<Worker>> workers;
+        ConnectionTask task_fn;
+        std::size_t next_worker; // acceptor-side cursor spreading pushes and wake-ups
+        int wake_fd;             // interrupts the accept loop on stop()
+        std::atomic<bool> running;
+
+        void wakeWorker(Worker& worker) noexcept;
+        void wakeIdleWorkers(std::size_t wanted_count) noexcept;
+        void wakeIdlePeer(std::size_t self_idx) noexcept;
+        [[nodiscard]] bool pushTask(ConnTask task) noexcept;
+        [[nodiscard]] std::optional<ConnTask> takeTask(std::size_t self_idx) noexcept;
+        void dropQueued() noexcept;
+        void runTask(ConnTask task);
+        void workerLoop(std::size_t self_idx);
+
+    public:
+        WorkerPool(std::size_t worker_count, ConnectionTask task_fn_);
+
+        WorkerPool(const WorkerPool& other) = delete;
+        WorkerPool& operator=(const WorkerPool& other) = delete;
+
+        void start();
+
+        /// @brief Spreads accepted connections over the worker deques, waking one sleeper per connection. Acceptor thread only.
+        /// @note Connections that cannot be queued because the pool stopped are closed.
+        void submitBatch(std::span<const SocketConfig> batch);
+
+        /// @brief Accept loop for the producer thread: drains ready connections into batches until `stop()`.
+        void serve(const ServerSocket& listener);
+
+        void stop() noexcept;
+
+        /// @return Connections queued in all deques but not yet taken by a worker.
+        [[nodiscard]] std::size_t getQueueDepth() const noexcept;
+
+        [[nodiscard]] std::vector<WorkerStats> getStats() const;
+
+        ~WorkerPool() noexcept;
+    };
+}
+
+#endif
@@ -6,6 +6,8 @@
 #include <utility>
 #include <string>
 #include <string_view>
+#include <memory_resource>
+#include <optional>
 #include <variant>
 #include "uri/url.hpp"
 
@@ -38,7 +40,8 @@ namespace ToyServer::Uri
         TokenTag tag;
     };
 
-    std::string getLexeme(const Token& token, const std::string& source);
+    /// @brief Views a token's text within its source, copying nothing.
+    [[nodiscard]] std::string_view getLexeme(const Token& token, std::string_view source);
 
     /// @brief Lexing helper function.
     constexpr bool isAlphaNum(char c)
@@ -62,7 +65,7 @@ namespace ToyServer::Uri
         Token lexWord();
 
     public:
-        UrlLexer(const std::string& url_str);
+        UrlLexer(std::string_view url_str);
 
         void swapState(UrlLexer&& other) noexcept;
 
@@ -95,33 +98,33 @@ namespace ToyServer::Uri
     template <>
     struct UrlFragChooser<FragmentTag::url_path>
     {
-        using type = std::string;
+        using type = std::string_view;
     };
 
     template <>
     struct UrlFragChooser<FragmentTag::url_param>
     {
-        using type = std::pair<std::string, std::string>;
+        using type = std::pair<std::string_view, std::string_view>;
     };
 
     /// @brief Alias for UrlFragment native type helper.
     template <FragmentTag FragTag>
     using url_frag_choose_t = UrlFragChooser<FragTag>::type;
 
-    /// @brief Aggregate for parsed URL chunk.
+    /// @brief Aggregate for parsed URL chunk, viewing the parser's source.
     struct UrlFragment
     {
-        std::variant<NullChunk, std::string, std::pair<std::string, std::string>> chunk;
+        std::variant<NullChunk, std::string_view, std::pair<std::string_view, std::string_view>> chunk;
         FragmentTag tag;
 
         constexpr UrlFragment()
         : chunk (NullChunk {}), tag {FragmentTag::url_chunkless} {}
 
-        constexpr UrlFragment(std::string text_, FragmentTag tag_)
-        : chunk (std::move(text_)), tag {tag_} {}
+        constexpr UrlFragment(std::string_view text_, FragmentTag tag_)
+        : chunk (text_), tag {tag_} {}
 
-        constexpr UrlFragment(std::pair<std::string, std::string> pair_)
-        : chunk (std::move(pair_)), tag {FragmentTag::url_param} {}
+        constexpr UrlFragment(std::pair<std::string_view, std::string_view> pair_)
+        : chunk (pair_), tag {FragmentTag::url_param} {}
     };
 
     /// @brief Helper to unpack UrlFragment tag.
@@ -152,12 +155,12 @@ namespace ToyServer::Uri
      * file = word "." word;
      * params = param ("&" param)*;
      * param = word "=" word;
-     * @note The parsing grammar is a CFG one, but the simple format of a relative URL keeps it easy- path goes first and then params or file last.
+     * @note The parsing grammar is a CFG one, but the simple format of a relative URL keeps it easy- path goes first and then params or file last. Fragments are views of the source, so only the final `Url` strings get allocated, all from the resource given to `parseAll`.
      */
     class UrlParser
     {
     private:
-        std::string symbols;
+        std::string_view symbols;
         Token previous;
         Token current;
         UrlLexer lexer;
@@ -177,9 +180,10 @@ namespace ToyServer::Uri
         /// @note Partial initialization is desired here, since I don't want to recreate a whopping "big" parser everytime (104B). Just reset it when needed!
         UrlParser();
 
-        void reset(const std::string& url_str);
+        /// @note `url_str` is viewed, not copied, so it must stay alive until `parseAll` returns.
+        void reset(std::string_view url_str);
 
-        [[nodiscard]] Url parseAll();
+        [[nodiscard]] Url parseAll(std::pmr::memory_resource* resource = std::pmr::get_default_resource());
     };
 }
 
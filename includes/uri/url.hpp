@@ -5,7 +5,9 @@
 #include <utility>
 #include <stdexcept>
 #include <string>
+#include <functional>
 #include <map>
+#include <memory_resource>
 #include <variant>
 
 namespace ToyServer::Uri
@@ -24,6 +26,11 @@ namespace ToyServer::Uri
      */
     struct NullUrlItem {};
 
+    /**
+     * @brief Query parameters, allocated from the same memory resource as their URL. Lookups by `std::string_view` allocate nothing.
+     */
+    using url_params_t = std::pmr::map<std::pmr::string, std::pmr::string, std::less<>>;
+
     /**
      * @brief Type selection helper for Url item results.
      */
@@ -42,7 +49,7 @@ namespace ToyServer::Uri
     template <>
     struct UrlItemChooser<UrlItemTag::ur_params>
     {
-        using type = std::map<std::string, std::string>;
+        using type = url_params_t;
     };
 
     /**
@@ -53,18 +60,19 @@ namespace ToyServer::Uri
 
     /**
      * @brief Aggregate for modeling a relative URL.
+     * @note Its strings keep the memory resource they were built with, e.g. a per-request arena. Copies use the default resource, so copy a URL to keep it past its arena.
      */
     struct Url
     {
-        std::string path;
-        std::variant<NullUrlItem, std::map<std::string, std::string>> content;
+        std::pmr::string path;
+        std::variant<NullUrlItem, url_params_t> content;
         UrlItemTag tag;
 
-        constexpr Url(std::string path_)
-        : path {path_}, content (NullUrlItem {}), tag {UrlItemTag::ur_none} {}
+        explicit Url(std::pmr::string path_)
+        : path {std::move(path_)}, content (NullUrlItem {}), tag {UrlItemTag::ur_none} {}
 
-        Url(std::string path_, std::map<std::string, std::string> params_)
-        : path {path_}, content (std::move(params_)), tag {UrlItemTag::ur_params} {}
+        Url(std::pmr::string path_, url_params_t params_)
+        : path {std::move(path_)}, content (std::move(params_)), tag {UrlItemTag::ur_params} {}
     };
 
     template <UrlItemTag UTag>
@@ -0,0 +1,122 @@
+#ifndef VIEW_HPP
+#define VIEW_HPP
+
+#include <cstddef>
+#include <iterator>
+#include <memory_resource>
+#include <optional>
+#include <string>
+#include <string_view>
+#include "uri/url.hpp"
+
+namespace ToyServer::Uri
+{
+    /**
+     * @brief One `key=value` pair of a query, both parts still percent-encoded.
+     */
+    struct QueryParam
+    {
+        std::string_view key;
+        std::string_view value; // empty when the pair has no '='
+    };
+
+    /**
+     * @brief Forward iterator splitting a raw query into pairs as it goes. Empty pairs (`a=1&&b=2`) are skipped.
+     */
+    class QueryIterator
+    {
+    private:
+        std::string_view rest; // query text after the current pair
+        QueryParam current;
+        bool at_end;
+
+        void advance() noexcept;
+
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = QueryParam;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const QueryParam*;
+        using reference = const QueryParam&;
+
+        /// @brief The end iterator.
+        constexpr QueryIterator() noexcept
+        : rest {}, current {}, at_end {true} {}
+
+        explicit QueryIterator(std::string_view query) noexcept;
+
+        [[nodiscard]] reference operator*() const noexcept { return current; }
+
+        [[nodiscard]] pointer operator->() const noexcept { return &current; }
+
+        QueryIterator& operator++() noexcept
+        {
+            advance();
+            return *this;
+        }
+
+        QueryIterator operator++(int) noexcept
+        {
+            QueryIterator old = *this;
+            advance();
+
+            return old;
+        }
+
+        [[nodiscard]] bool operator==(const QueryIterator& other) const noexcept
+        {
+            return (at_end || other.at_end) ? at_end == other.at_end : current.key.data() == other.current.key.data();
+        }
+    };
+
+    /**
+     * @brief Lazily split query parameters, nothing is parsed before iteration.
+     */
+    class QueryParams
+    {
+    private:
+        std::string_view query;
+
+    public:
+        constexpr explicit QueryParams(std::string_view query_) noexcept
+        : query {query_} {}
+
+        [[nodiscard]] QueryIterator begin() const noexcept { return QueryIterator {query}; }
+
+        [[nodiscard]] QueryIterator end() const noexcept { return {}; }
+
+        [[nodiscard]] bool empty() const noexcept { return begin() == end(); }
+
+        /// @return Raw value of the first pair whose raw key equals `key`.
+        [[nodiscard]] std::optional<std::string_view> find(std::string_view key) const noexcept;
+    };
+
+    /**
+     * @brief Non-owning split of an origin-form request target. Every part views the parsed text and stays percent-encoded until decoded on demand.
+     */
+    struct UrlView
+    {
+        std::string_view path;
+        std::string_view query; // without the '?', empty when absent
+
+        [[nodiscard]] QueryParams getParams() const noexcept { return QueryParams {query}; }
+    };
+
+    /// @brief Validates and splits `target` in one pass over its octets, allocating nothing. A `#fragment` is dropped.
+    /// @return The view, or nothing when the target is not an absolute path of RFC 3986 characters with well-formed escapes.
+    [[nodiscard]] std::optional<UrlView> parseUrlView(std::string_view target) noexcept;
+
+    /// @brief Percent-decodes `raw` into `out`, which needs room for `raw.length()` octets and may be `raw`'s own storage.
+    /// @param plus_as_space Decode '+' as a space, as form-encoded query parts want.
+    /// @return Decoded length, or nothing on a malformed escape.
+    [[nodiscard]] std::optional<std::size_t> percentDecode(std::string_view raw, char* out, bool plus_as_space = false) noexcept;
+
+    /// @brief Owning, decoded copy of one URL part, allocated from `resource`.
+    /// @note Throws std::runtime_error on a malformed escape.
+    [[nodiscard]] std::pmr::string decodeComponent(std::string_view raw, bool plus_as_space = false, std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+
+    /// @brief Copies a view into an owning `Url` whose strings come from `resource`. Parts stay encoded, and a repeated key keeps its last value.
+    [[nodiscard]] Url toOwnedUrl(const UrlView& view, std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+}
+
+#endif
@@ -14,6 +14,8 @@ elif [[ "$choice" = "r" ]]; then
     cmake --fresh -S . -B build -DDBG_BUILD:BOOL=0 && cmake --build build -- -j 2 && echo "Release build OK!" && cp ./build/compile_commands.json . || echo "Build failed, see logs!"
 elif [[ "$choice" = "t" ]]; then
     ctest -V --test-dir build
+elif [[ "$choice" = "b" ]]; then
+    cmake --build build --target run_benches && echo "Benchmark results are in build/bench_*.json"
 else
-    echo "Usage: ./build.sh [d | r | t | i]\nOptions:\nd = debug build\nr = release build\nt = run tests\ni = usage info"
+    echo "Usage: ./build.sh [d | r | t | b | i]\nOptions:\nd = debug build\nr = release build\nt = run tests\nb = run benchmarks (use a release build)\ni = usage info"
 fi
@@ -0,0 +1,279 @@
+/**
+ * @file bodies.cpp
+ * @author DrkWithT
+ * @brief Implements the chunked decoder and streamed request bodies.
+ * @date 2024-08-28
+ */
+
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+#include <utility>
+#include "http1/bodies.hpp"
+
+namespace ToyServer::Http1
+{
+    static constexpr int hexValue(char c) noexcept
+    {
+        if (c >= '0' && c <= '9')
+            return c - '0';
+        else if (c >= 'a' && c <= 'f')
+            return c - 'a' + 10;
+        else if (c >= 'A' && c <= 'F')
+            return c - 'A' + 10;
+
+        return -1;
+    }
+
+    void failFill(NetIO::IOStatus status)
+    {
+        switch (status)
+        {
+            case NetIO::IOStatus::io_again:
+                throw std::runtime_error {"IOErr: socket would block."};
+            case NetIO::IOStatus::io_closed:
+            default:
+                throw std::runtime_error {"IOErr: peer closed before request completed."};
+        }
+    }
+
+    /* ChunkedDecoder private impl. */
+
+    void ChunkedDecoder::endSizeLine()
+    {
+        if (digit_count == 0)
+            throw std::runtime_error {"ParseErr: missing chunk size."};
+
+        state = (chunk_left == 0) ? State::st_trailer_start : State::st_data;
+    }
+
+    /* ChunkedDecoder public impl. */
+
+    ChunkedDecoder::ChunkedDecoder() noexcept
+    : chunk_left {0}, line_size {0}, digit_count {0}, state {State::st_size} {}
+
+    void ChunkedDecoder::reset() noexcept
+    {
+        chunk_left = 0;
+        line_size = 0;
+        digit_count = 0;
+        state = State::st_size;
+    }
+
+    DecodeStep ChunkedDecoder::decode(std::string_view input)
+    {
+        std::size_t pos = 0;
+
+        while (pos < input.length() && state != State::st_done)
+        {
+            // chunk data leaves as one slice, everything else is framing looked at octet by octet
+            if (state == State::st_data)
+            {
+                std::size_t slice_len = std::min(chunk_left, input.length() - pos);
+                chunk_left -= slice_len;
+
+                if (chunk_left == 0)
+                    state = State::st_data_end;
+
+                return {pos + slice_len, input.substr(pos, slice_len)};
+            }
+
+            char c = input[pos++];
+
+            switch (state)
+            {
+                case State::st_size:
+                    if (int digit = hexValue(c); digit != -1)
+                    {
+                        if (chunk_left > (std::numeric_limits<std::size_t>::max() >> 4))
+                            throw std::runtime_error {"ParseErr: chunk size overflow."};
+
+                        chunk_left = (chunk_left << 4) | static_cast<std::size_t>(digit);
+                        digit_count++;
+                    }
+                    else if (c == ';' || c == ' ' || c == '\t')
+                    {
+                        line_size = 0;
+                        state = State::st_extension;
+                    }
+                    else if (c == '\r')
+                    {
+                        state = State::st_size_lf;
+                    }
+                    else if (c == '\n')
+                    {
+                        endSizeLine();
+                    }
+                    else
+                    {
+                        throw std::runtime_error {"ParseErr: malformed chunk size."};
+                    }
+                    break;
+                case State::st_extension:
+                    if (c == '\r')
+                        state = State::st_size_lf;
+                    else if (c == '\n')
+                        endSizeLine();
+                    else if (++line_size > max_line_size)
+                        throw std::runtime_error {"ParseErr: chunk extension too long."};
+                    break;
+                case State::st_size_lf:
+                    if (c != '\n')
+                        throw std::runtime_error {"ParseErr: malformed chunk size."};
+
+                    endSizeLine();
+                    break;
+                case State::st_data_end:
+                    if (c == '\r')
+                        state = State::st_data_lf;
+                    else if (c == '\n')
+                        reset();
+                    else
+                        throw std::runtime_error {"ParseErr: missing CRLF after chunk."};
+                    break;
+                case State::st_data_lf:
+                    if (c != '\n')
+                        throw std::runtime_error {"ParseErr: missing CRLF after chunk."};
+
+                    reset();
+                    break;
+                case State::st_trailer_start:
+                    if (c == '\r')
+                    {
+                        state = State::st_final_lf;
+                    }
+                    else if (c == '\n')
+                    {
+                        state = State::st_done;
+                    }
+                    else
+                    {
+                        line_size = 1;
+                        state = State::st_trailer;
+                    }
+                    break;
+                case State::st_trailer:
+                    if (c == '\n')
+                        state = State::st_trailer_start;
+                    else if (++line_size > max_line_size)
+                        throw std::runtime_error {"ParseErr: trailer field too long."};
+                    break;
+                case State::st_final_lf:
+                    if (c != '\n')
+                        throw std::runtime_error {"ParseErr: malformed chunked trailer."};
+
+                    state = State::st_done;
+                    break;
+                default:
+                    break;
+            }
+        }
+
+        return {pos, {}};
+    }
+
+    /* BodyReader private impl. */
+
+    void BodyReader::releaseSlice() noexcept
+    {
+        if (slice_consume > 0)
+        {
+            source.consume(source.transport, slice_consume);
+            slice_consume = 0;
+        }
+    }
+
+    /* BodyReader public impl. */
+
+    BodyReader::BodyReader() noexcept
+    : decoder {}, buffered_body {}, source {}, length_left {0}, read_count {0}, max_body_size {0}, slice_consume {0}, framing {Framing::framing_buffered}, finished {true} {}
+
+    void BodyReader::resetBuffered(std::string_view body) noexcept
+    {
+        buffered_body = body;
+        read_count = 0;
+        slice_consume = 0;
+        framing = Framing::framing_buffered;
+        finished = true;
+    }
+
+    void BodyReader::resetStreamed(ReadAheadSource source_, std::optional<std::size_t> content_len, std::size_t max_body_size_) noexcept
+    {
+        decoder.reset();
+        buffered_body = {};
+        source = source_;
+        length_left = content_len.value_or(0);
+        read_count = 0;
+        max_body_size = max_body_size_;
+        slice_consume = 0;
+        framing = (content_len) ? Framing::framing_length : Framing::framing_chunked;
+        finished = false;
+    }
+
+    std::string_view BodyReader::readSome()
+    {
+        if (framing == Framing::framing_buffered)
+        {
+            read_count += buffered_body.length();
+            return std::exchange(buffered_body, {});
+        }
+
+        releaseSlice();
+
+        while (!finished)
+        {
+            std::string_view data = source.peek(source.transport);
+
+            if (data.empty())
+            {
+                if (NetIO::IOStatus status = source.fill(source.transport); status != NetIO::IOStatus::io_ok)
+                    failFill(status);
+
+                continue;
+            }
+
+            if (framing == Framing::framing_length)
+            {
+                std::string_view slice = data.substr(0, length_left);
+                length_left -= slice.length();
+                read_count += slice.length();
+                slice_consume = slice.length();
+                finished = length_left == 0;
+
+                return slice;
+            }
+
+            auto [consumed, slice] = decoder.decode(data);
+
+            if (!slice.empty())
+            {
+                // the declared size is unknown up front, so the limit is checked as octets arrive
+                if (slice.length() > max_body_size - read_count)
+                    throw std::runtime_error {"ParseErr: request body too large."};
+
+                read_count += slice.length();
+                slice_consume = consumed;
+
+                return slice;
+            }
+
+            source.consume(source.transport, consumed);
+            finished = decoder.isDone();
+        }
+
+        return {};
+    }
+
+    void BodyReader::skipRest()
+    {
+        buffered_body = {};
+
+        while (!finished)
+        {
+            [[maybe_unused]] auto skipped = readSome();
+        }
+
+        if (framing != Framing::framing_buffered)
+            releaseSlice();
+    }
+}
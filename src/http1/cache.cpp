@@ -0,0 +1,198 @@
+/**
+ * @file cache.cpp
+ * @author DrkWithT
+ * @brief Implements the sharded in-memory cache of prebuilt static file replies.
+ * @date 2024-08-28
+ */
+
+#include <functional>
+#include <utility>
+#include "http1/cache.hpp"
+#include "http1/writer.hpp"
+
+namespace ToyServer::Http1
+{
+    /* StaticCache private impl. */
+
+    StaticCache::Shard& StaticCache::pickShard(const std::string& key) noexcept
+    {
+        return shards[std::hash<std::string> {}(key) % shard_count];
+    }
+
+    std::shared_ptr<const StaticCache::CachedReply> StaticCache::lookup(Shard& shard, const std::string& key)
+    {
+        std::lock_guard shard_guard {shard.lock};
+        auto entry_it = shard.entries.find(key);
+
+        if (entry_it == shard.entries.end())
+            return {};
+
+        shard.lru.splice(shard.lru.begin(), shard.lru, entry_it->second.lru_pos);
+
+        return entry_it->second.reply;
+    }
+
+    std::shared_ptr<const StaticCache::CachedReply> StaticCache::insert(Shard& shard, const std::string& key, std::shared_ptr<const CachedReply> reply)
+    {
+        std::size_t shard_budget = limits.memory_budget / shard_count;
+        std::size_t charge = reply->bytes.capacity() + 2 * key.length() + entry_overhead;
+
+        if (charge > shard_budget)
+            return reply;
+
+        std::lock_guard shard_guard {shard.lock};
+
+        if (auto entry_it = shard.entries.find(key); entry_it != shard.entries.end())
+            return entry_it->second.reply;
+
+        while (shard.used_bytes + charge > shard_budget && !shard.lru.empty())
+        {
+            auto victim_it = shard.entries.find(shard.lru.back());
+
+            shard.used_bytes -= victim_it->second.charge;
+            shard.entries.erase(victim_it);
+            shard.lru.pop_back();
+            shard.evictions.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        shard.lru.push_front(key);
+        shard.entries.emplace(key, CacheEntry {reply, shard.lru.begin(), charge});
+        shard.used_bytes += charge;
+
+        return reply;
+    }
+
+    std::shared_ptr<const StaticCache::CachedReply> StaticCache::buildReply(const NetIO::FileHandle& file, const NetIO::FileStats& stats, std::string_view relative, Coding coding)
+    {
+        auto reply = std::make_shared<CachedReply>();
+        std::string& bytes = reply->bytes;
+        std::string_view mime_type = guessMimeType(relative);
+
+        reply->etag = makeEntityTag(stats, coding);
+        reply->varies = isCompressibleType(mime_type);
+
+        // the status line follows the request's version, so the writer supplies it
+        bytes.append("Content-Type: ")
+            .append(mime_type)
+            .append("\r\nContent-Length: ")
+            .append(std::to_string(stats.size));
+
+        if (coding != Coding::coding_identity)
+            bytes.append("\r\nContent-Encoding: ").append(stringifyCoding(coding));
+
+        if (reply->varies)
+            bytes.append("\r\nVary: Accept-Encoding");
+
+        bytes.append("\r\nETag: ").append(reply->etag).append("\r\n");
+
+        reply->head_end = bytes.length();
+        bytes.append("\r\n");
+
+        std::size_t body_start = bytes.length();
+        bytes.resize(body_start + stats.size);
+
+        if (!file.readAt(bytes.data() + body_start, stats.size, 0))
+            return {};
+
+        return reply;
+    }
+
+    Response StaticCache::makeCachedReply(Method method, Schema schema, std::shared_ptr<const CachedReply> reply, std::string_view if_none_match)
+    {
+        if (!if_none_match.empty() && matchesEntityTag(if_none_match, reply->etag))
+            return StaticFiles::makeNotModified(schema, reply->etag, reply->varies);
+
+        Response cached = StaticFiles::makeStatusReply(schema, Status::stat_ok);
+        cached.prebuilt = PrebuiltRef {std::move(reply), method == Method::h1_head};
+
+        return cached;
+    }
+
+    /* StaticCache public impl. */
+
+    StaticCache::StaticCache(const StaticFiles& files_, CacheLimits limits_)
+    : shards {}, files {files_}, limits {limits_} {}
+
+    Response StaticCache::serve(Method method, Schema schema, std::string_view url_path, std::string_view accept_encoding, std::string_view if_none_match)
+    {
+        if (method != Method::h1_get && method != Method::h1_head)
+            return files.serve(method, schema, url_path);
+
+        std::string key = StaticFiles::sanitizePath(url_path);
+
+        if (key.empty())
+            return files.serve(method, schema, url_path);
+
+        // every set of accepted codings may pick a different variant, so each gets its own entry
+        unsigned accepted = parseAcceptEncoding(accept_encoding);
+        std::size_t path_len = key.length();
+        key.append(1, '\0').append(1, static_cast<char>('0' + accepted));
+
+        Shard& shard = pickShard(key);
+
+        if (auto reply = lookup(shard, key); reply)
+        {
+            shard.hits.fetch_add(1, std::memory_order_relaxed);
+            return makeCachedReply(method, schema, std::move(reply), if_none_match);
+        }
+
+        shard.misses.fetch_add(1, std::memory_order_relaxed);
+
+        std::string relative = key.substr(0, path_len);
+        NetIO::FileStats stats {};
+        NetIO::FileHandle file = files.openResolved(relative, stats);
+
+        if (!file.isOpen())
+            return StaticFiles::makeStatusReply(schema, Status::stat_not_found);
+
+        Coding coding = Coding::coding_identity;
+
+        if (NetIO::FileHandle sidecar = files.openSidecar(relative, accepted, stats, coding); sidecar.isOpen())
+            file = std::move(sidecar);
+
+        if (stats.size > limits.max_entry_size)
+            return files.makeFileReply(method, schema, std::move(file), stats, relative, coding, if_none_match);
+
+        auto reply = buildReply(file, stats, relative, coding);
+
+        // the file changed size while being read, so stream it instead of caching a torn copy
+        if (!reply)
+            return files.makeFileReply(method, schema, std::move(file), stats, relative, coding, if_none_match);
+
+        return makeCachedReply(method, schema, insert(shard, key, std::move(reply)), if_none_match);
+    }
+
+    Response StaticCache::serve(const RequestView& req)
+    {
+        return serve(req.method, req.schema, req.target, req.findHeader(FieldId::f_accept_encoding).value_or(""), req.findHeader(FieldId::f_if_none_match).value_or(""));
+    }
+
+    CacheStats StaticCache::getStats() const
+    {
+        CacheStats totals {0, 0, 0, 0, 0};
+
+        for (const auto& shard : shards)
+        {
+            totals.hits += shard.hits.load(std::memory_order_relaxed);
+            totals.misses += shard.misses.load(std::memory_order_relaxed);
+            totals.evictions += shard.evictions.load(std::memory_order_relaxed);
+
+            std::lock_guard shard_guard {shard.lock};
+            totals.entry_count += shard.entries.size();
+            totals.used_bytes += shard.used_bytes;
+        }
+
+        return totals;
+    }
+
+    void StaticCache::clear()
+    {
+        for (auto& shard : shards)
+        {
+            std::lock_guard shard_guard {shard.lock};
+            shard.entries.clear();
+            shard.lru.clear();
+            shard.used_bytes = 0;
+        }
+    }
+}
@@ -0,0 +1,49 @@
+/**
+ * @file exporter.cpp
+ * @author DrkWithT
+ * @brief Implements the Prometheus scrape endpoint.
+ * @date 2024-09-06
+ */
+
+#include <algorithm>
+#include <utility>
+#include "metrics/metrics.hpp"
+#include "http1/exporter.hpp"
+
+namespace ToyServer::Http1
+{
+    static constexpr std::string_view metrics_content_type = "text/plain; version=0.0.4; charset=utf-8";
+
+    Response makeMetricsReply(Method method, Schema schema)
+    {
+        std::string text {};
+        Metrics::writePrometheus(Metrics::collectMetrics(), text);
+
+        Response reply {(schema == Schema::http_unknown) ? Schema::http_1_1 : schema, Status::stat_ok, "", {}, NetIO::FixedBuffer {0}};
+        reply.headers[FieldId::f_content_type] = metrics_content_type;
+        reply.headers[FieldId::f_cache_control] = "no-store";
+
+        if (method == Method::h1_head)
+        {
+            reply.headers[FieldId::f_content_length] = std::to_string(text.length());
+            return reply;
+        }
+
+        reply.body = NetIO::FixedBuffer {text.length()};
+        std::copy(text.begin(), text.end(), reply.body.getBasePtr());
+
+        return reply;
+    }
+
+    RequestHandler withMetricsEndpoint(std::string path, RequestHandler inner)
+    {
+        return [path = std::move(path), inner = std::move(inner)](const RequestView& req) {
+            std::string_view target_path = req.target.substr(0, req.target.find('?'));
+
+            if (target_path == path && (req.method == Method::h1_get || req.method == Method::h1_head))
+                return makeMetricsReply(req.method, req.schema);
+
+            return inner(req);
+        };
+    }
+}
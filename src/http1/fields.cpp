@@ -0,0 +1,68 @@
+/**
+ * @file fields.cpp
+ * @author DrkWithT
+ * @brief Implements the flat reply header store.
+ * @date 2024-08-30
+ */
+
+#include <stdexcept>
+#include "http1/fields.hpp"
+
+namespace ToyServer::Http1
+{
+    /* HeaderFields private impl. */
+
+    std::size_t HeaderFields::findUnknown(std::string_view name) const noexcept
+    {
+        for (std::size_t field_idx = 0; field_idx < fields.size(); field_idx++)
+        {
+            if (fields[field_idx].id == FieldId::f_unknown && equalsNoCase(fields[field_idx].name, name))
+                return field_idx;
+        }
+
+        return fields.size();
+    }
+
+    /* HeaderFields public impl. */
+
+    HeaderFields::HeaderFields() noexcept
+    : fields {}, known_pos {} {}
+
+    bool HeaderFields::contains(std::string_view name) const noexcept
+    {
+        if (FieldId id = lookupField(name); id != FieldId::f_unknown)
+            return contains(id);
+
+        return findUnknown(name) != fields.size();
+    }
+
+    std::string& HeaderFields::operator[](FieldId id)
+    {
+        FieldPos& pos = known_pos[static_cast<std::size_t>(id)];
+
+        if (pos == 0)
+        {
+            // the position would wrap to "absent" past this
+            if (fields.size() >= max_indexed_fields)
+                throw std::runtime_error {"HeaderFields: too many fields for the index."};
+
+            fields.push_back({std::string {field_names[static_cast<std::size_t>(id)]}, {}, id});
+            pos = static_cast<FieldPos>(fields.size());
+        }
+
+        return fields[pos - 1].value;
+    }
+
+    std::string& HeaderFields::operator[](std::string_view name)
+    {
+        if (FieldId id = lookupField(name); id != FieldId::f_unknown)
+            return (*this)[id];
+
+        std::size_t field_idx = findUnknown(name);
+
+        if (field_idx == fields.size())
+            fields.push_back({std::string {name}, {}, FieldId::f_unknown});
+
+        return fields[field_idx].value;
+    }
+}
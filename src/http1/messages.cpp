@@ -0,0 +1,107 @@
+/**
+ * @file messages.cpp
+ * @author DrkWithT
+ * @brief Implements request view helpers and the owning conversion.
+ * @date 2024-08-24
+ */
+
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+#include "http1/messages.hpp"
+
+namespace ToyServer::Http1
+{
+    /* RequestView impl. */
+
+    std::optional<std::string_view> RequestView::findHeader(FieldId id) const noexcept
+    {
+        if (field_index != nullptr)
+        {
+            if (FieldPos pos = (*field_index)[static_cast<std::size_t>(id)]; pos != 0)
+                return headers[pos - 1].value;
+
+            return {};
+        }
+
+        // views put together by hand have no index
+        for (const auto& [field_name, field_value, field_id] : headers)
+        {
+            if (field_id == id || equalsNoCase(field_name, field_names[static_cast<std::size_t>(id)]))
+                return field_value;
+        }
+
+        return {};
+    }
+
+    std::optional<std::string_view> RequestView::findHeader(std::string_view name) const noexcept
+    {
+        if (FieldId id = lookupField(name); id != FieldId::f_unknown)
+            return findHeader(id);
+
+        for (const auto& [field_name, field_value, field_id] : headers)
+        {
+            if (field_id == FieldId::f_unknown && equalsNoCase(field_name, name))
+                return field_value;
+        }
+
+        return {};
+    }
+
+    /// @brief Looks for `option` in a comma separated header value such as `Connection`.
+    static bool hasListOption(std::string_view list, std::string_view option) noexcept
+    {
+        while (!list.empty())
+        {
+            std::size_t comma_pos = list.find(',');
+            std::string_view item = list.substr(0, comma_pos);
+
+            while (!item.empty() && (item.front() == ' ' || item.front() == '\t'))
+                item.remove_prefix(1);
+
+            while (!item.empty() && (item.back() == ' ' || item.back() == '\t'))
+                item.remove_suffix(1);
+
+            if (equalsNoCase(item, option))
+                return true;
+
+            if (comma_pos == std::string_view::npos)
+                break;
+
+            list.remove_prefix(comma_pos + 1);
+        }
+
+        return false;
+    }
+
+    bool wantsKeepAlive(const RequestView& view) noexcept
+    {
+        auto connection_opts = view.findHeader(FieldId::f_connection);
+
+        if (view.schema == Schema::http_1_1)
+            return !connection_opts || !hasListOption(*connection_opts, "close");
+
+        return connection_opts && hasListOption(*connection_opts, "keep-alive");
+    }
+
+    /* conversion impl. */
+
+    Request toOwnedRequest(const RequestView& view, std::pmr::memory_resource* resource)
+    {
+        std::optional<Uri::UrlView> target_view = Uri::parseUrlView(view.target);
+
+        if (!target_view)
+            throw std::runtime_error {"ParseErr: malformed request target."};
+
+        header_map_t header_dict {resource};
+
+        // the first duplicate wins, as with `RequestView::findHeader`
+        for (const auto& [name, value, id] : view.headers)
+            header_dict.try_emplace(std::pmr::string {name, resource}, value);
+
+        NetIO::FixedBuffer body_copy {view.body.length()};
+        std::copy(view.body.begin(), view.body.end(), body_copy.getBasePtr());
+
+        return {view.schema, view.method, Uri::toOwnedUrl(*target_view, resource), std::move(header_dict), std::move(body_copy)};
+    }
+}
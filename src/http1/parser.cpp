@@ -0,0 +1,302 @@
+/**
+ * @file parser.cpp
+ * @author DrkWithT
+ * @brief Implements the resumable HTTP/1.x request parser.
+ * @date 2024-09-02
+ */
+
+#include <charconv>
+#include "http1/helpers.hpp"
+#include "http1/parser.hpp"
+#include "http1/scanner.hpp"
+
+namespace ToyServer::Http1
+{
+    static constexpr std::string_view http_1_0_name = "HTTP/1.0";
+    static constexpr std::string_view http_1_1_name = "HTTP/1.1";
+
+    static constexpr std::string_view http_head_verb = "HEAD";
+    static constexpr std::string_view http_get_verb = "GET";
+
+    static constexpr std::string_view http_chunked_coding = "chunked";
+
+    /* parsing helpers */
+
+    static constexpr std::string_view trimLineEnd(std::string_view line) noexcept
+    {
+        if (!line.empty() && line.back() == '\r')
+            line.remove_suffix(1);
+
+        return line;
+    }
+
+    static constexpr std::string_view trimSpacing(std::string_view text) noexcept
+    {
+        while (!text.empty() && matchSpacing(text.front()))
+            text.remove_prefix(1);
+
+        while (!text.empty() && matchSpacing(text.back()))
+            text.remove_suffix(1);
+
+        return text;
+    }
+
+    static constexpr Schema deduceSchema(std::string_view token) noexcept
+    {
+        if (token == http_1_0_name)
+            return Schema::http_1_0;
+        else if (token == http_1_1_name)
+            return Schema::http_1_1;
+
+        // a later 1.x minor version is answered as the highest one we speak (RFC 9110 section 2.5)
+        if (token.length() == http_1_1_name.length() && token.starts_with(http_1_1_name.substr(0, 7)) && token.back() >= '2' && token.back() <= '9')
+            return Schema::http_1_1;
+
+        return Schema::http_unknown;
+    }
+
+    static constexpr Method deduceMethod(std::string_view token) noexcept
+    {
+        if (token == http_head_verb)
+            return Method::h1_head;
+        else if (token == http_get_verb)
+            return Method::h1_get;
+
+        return Method::h1_unknown;
+    }
+
+    /// @brief Re-points a view after the buffer under it was moved.
+    static std::string_view rebaseView(std::string_view text, const char* old_base, const char* new_base) noexcept
+    {
+        if (text.data() == nullptr)
+            return text;
+
+        return {new_base + (text.data() - old_base), text.length()};
+    }
+
+    /* RequestParser private impl. */
+
+    ParseStatus RequestParser::fail(std::string_view msg) noexcept
+    {
+        error_msg = msg;
+        step = ParseStep::step_failed;
+
+        return ParseStatus::parse_error;
+    }
+
+    bool RequestParser::parseTop(std::string_view line) noexcept
+    {
+        // order of line reading: method, path, schema
+        std::size_t method_end = findAnyOf(line, scan_sp);
+        std::size_t target_end = (method_end != std::string_view::npos) ? findAnyOf(line.substr(method_end + 1), scan_sp) : std::string_view::npos;
+
+        if (target_end == std::string_view::npos || target_end == 0 || !isToken(line.substr(0, method_end)))
+            return false;
+
+        target_end += method_end + 1;
+
+        view.method_txt = line.substr(0, method_end);
+        view.target = line.substr(method_end + 1, target_end - method_end - 1);
+        view.method = deduceMethod(view.method_txt);
+        view.schema = deduceSchema(line.substr(target_end + 1));
+
+        // framing rules differ per version, so an unknown one cannot be parsed safely
+        return view.schema != Schema::http_unknown;
+    }
+
+    bool RequestParser::parseHeader(std::string_view line) noexcept
+    {
+        std::size_t colon_pos = findAnyOf(line, scan_colon);
+
+        // the name must be a bare token, which also rules out whitespace before the colon
+        if (colon_pos == std::string_view::npos || !isToken(line.substr(0, colon_pos)))
+            return false;
+
+        std::size_t header_count = view.headers.size();
+        std::string_view name = line.substr(0, colon_pos);
+        HeaderView& field = header_slots[header_count++] = {name, trimSpacing(line.substr(colon_pos + 1)), lookupField(name)};
+
+        // only the first of repeated fields is indexed, like a linear search would find
+        if (field.id != FieldId::f_unknown && field_index[static_cast<std::size_t>(field.id)] == 0)
+            field_index[static_cast<std::size_t>(field.id)] = static_cast<FieldPos>(header_count);
+
+        view.headers = {header_slots.data(), header_count};
+
+        return true;
+    }
+
+    ParseStatus RequestParser::finishHead() noexcept
+    {
+        auto content_len_txt = view.findHeader(FieldId::f_content_length);
+        auto transfer_enc_txt = view.findHeader(FieldId::f_transfer_encoding);
+
+        bool length_seen = false;
+
+        // every Content-Length line must agree, or hops that frame by different ones would split the stream differently
+        for (const auto& field : view.headers)
+        {
+            if (field.id != FieldId::f_content_length)
+                continue;
+
+            const char* txt_end = field.value.data() + field.value.length();
+            std::size_t field_length = 0;
+            auto [parse_end, parse_err] = std::from_chars(field.value.data(), txt_end, field_length);
+
+            if (parse_err != std::errc {} || parse_end != txt_end)
+                return fail("ParseErr: invalid Content-Length.");
+
+            if (length_seen && field_length != content_length)
+                return fail("ParseErr: conflicting Content-Length.");
+
+            content_length = field_length;
+            length_seen = true;
+        }
+
+        if (transfer_enc_txt)
+        {
+            // both framings at once is the classic smuggling setup, and only plain chunked is decodable here
+            if (content_len_txt || !equalsNoCase(*transfer_enc_txt, http_chunked_coding))
+                return fail("ParseErr: unsupported Transfer-Encoding.");
+
+            chunked = true;
+            step = ParseStep::step_done;
+
+            return ParseStatus::parse_complete;
+        }
+
+        if (content_length > max_body_size)
+            return fail("ParseErr: request body too large.");
+
+        step = ParseStep::step_body;
+
+        return ParseStatus::parse_need_more;
+    }
+
+    /* RequestParser public impl. */
+
+    RequestParser::RequestParser() noexcept
+    : header_slots {}, field_index {}, view {}, error_msg {}, base {}, line_start {0}, scan_offset {0}, head_length {0}, content_length {0}, max_head_size {default_max_head_size}, max_body_size {default_max_body_size}, step {ParseStep::step_blank_lines}, chunked {false}
+    {
+        view.field_index = &field_index;
+    }
+
+    void RequestParser::reset() noexcept
+    {
+        field_index.fill(0);
+        view = RequestView {};
+        view.field_index = &field_index;
+        error_msg = {};
+        base = nullptr;
+        line_start = 0;
+        scan_offset = 0;
+        head_length = 0;
+        content_length = 0;
+        step = ParseStep::step_blank_lines;
+        chunked = false;
+    }
+
+    ParseStatus RequestParser::feed(std::span<const char> buffered) noexcept
+    {
+        std::string_view data {buffered.data(), buffered.size()};
+
+        if (!data.empty())
+            relocate(data.data());
+
+        if (step == ParseStep::step_failed)
+            return ParseStatus::parse_error;
+
+        if (step == ParseStep::step_done)
+            return ParseStatus::parse_complete;
+
+        if (step == ParseStep::step_blank_lines)
+        {
+            // tolerate stray CRLFs between requests
+            while (line_start < data.length() && (data[line_start] == '\r' || data[line_start] == '\n'))
+                line_start++;
+
+            scan_offset = line_start;
+
+            if (line_start == data.length())
+                return ParseStatus::parse_need_more;
+
+            step = ParseStep::step_top_line;
+        }
+
+        // each line is handled once its LF arrives, and the search resumes where the last call stopped
+        while (step == ParseStep::step_top_line || step == ParseStep::step_header_lines)
+        {
+            std::size_t line_end = findAnyOf(data.substr(scan_offset), scan_lf);
+
+            if (line_end == std::string_view::npos)
+            {
+                scan_offset = data.length();
+
+                if (scan_offset > max_head_size)
+                    return fail("ParseErr: request head too large.");
+
+                return ParseStatus::parse_need_more;
+            }
+
+            line_end += scan_offset;
+
+            if (line_end >= max_head_size)
+                return fail("ParseErr: request head too large.");
+
+            std::string_view line = trimLineEnd(data.substr(line_start, line_end - line_start));
+            line_start = scan_offset = line_end + 1;
+
+            if (step == ParseStep::step_top_line)
+            {
+                if (!parseTop(line))
+                    return fail("ParseErr: malformed request line.");
+
+                step = ParseStep::step_header_lines;
+            }
+            else if (line.empty())
+            {
+                head_length = line_start;
+
+                if (ParseStatus status = finishHead(); status != ParseStatus::parse_need_more)
+                    return status;
+            }
+            else if (view.headers.size() >= max_header_count)
+            {
+                return fail("ParseErr: too many headers.");
+            }
+            else if (!parseHeader(line))
+            {
+                return fail("ParseErr: malformed header.");
+            }
+        }
+
+        // a sized body is only waited for, its octets are not looked at here
+        if (data.length() < head_length + content_length)
+            return ParseStatus::parse_need_more;
+
+        view.body = data.substr(head_length, content_length);
+        step = ParseStep::step_done;
+
+        return ParseStatus::parse_complete;
+    }
+
+    void RequestParser::relocate(const char* new_base) noexcept
+    {
+        if (base == nullptr || base == new_base)
+        {
+            base = new_base;
+            return;
+        }
+
+        view.method_txt = rebaseView(view.method_txt, base, new_base);
+        view.target = rebaseView(view.target, base, new_base);
+        view.body = rebaseView(view.body, base, new_base);
+
+        for (std::size_t header_idx = 0; header_idx < view.headers.size(); header_idx++)
+        {
+            header_slots[header_idx].name = rebaseView(header_slots[header_idx].name, base, new_base);
+            header_slots[header_idx].value = rebaseView(header_slots[header_idx].value, base, new_base);
+        }
+
+        base = new_base;
+    }
+}
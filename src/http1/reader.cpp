@@ -5,152 +5,160 @@
  * @date 2024-08-02
  */
 
+#include <algorithm>
 #include <stdexcept>
-#include <sstream>
 #include <string>
-#include "http1/helpers.hpp"
+#include <string_view>
 #include "http1/reader.hpp"
 
 namespace ToyServer::Http1
 {
-    static constexpr const char* http_1_0_name = "HTTP/1.0";
-    static constexpr const char* http_1_1_name = "HTTP/1.1";
+    /* BasicHttpReader private impl. */
 
-    static constexpr const char* http_head_verb = "HEAD";
-    static constexpr const char* http_get_verb = "GET";
-
-    static constexpr char http_sp = ' ';
-    static constexpr char http_line_end = '\n';
-
-    static constexpr const char* http_content_len_prop = "Content-Length:";
-
-    /* HttpReader private impl. */
-    Schema HttpReader::deduceSchema(const std::string& token) const
+    template <NetIO::Transport T>
+    void BasicHttpReader<T>::detachHead(std::string_view data)
     {
-        if (token == http_1_0_name)
-            return Schema::http_1_0;
-        else if (token == http_1_1_name)
-            return Schema::http_1_1;
+        std::size_t head_len = parser.getHeadLength();
 
-        return Schema::http_unknown;
-    }
+        head_store.assign(data.substr(0, head_len));
+        parser.relocate(head_store.data());
 
-    Method HttpReader::deduceMethod(const std::string& token) const
-    {
-        if (token == http_head_verb)
-            return Method::h1_head;
-        else if (token == http_get_verb)
-            return Method::h1_get;
-
-        return Method::h1_unknown;
+        // the body reader owns the read-ahead from here on
+        transport->consumeReadAhead(head_len);
+        pending_consume = 0;
     }
 
-    Uri::Url HttpReader::parseSimpleURL(const std::string& token)
+    template <NetIO::Transport T>
+    std::string_view BasicHttpReader<T>::releaseConsumed()
     {
-        url_parser.reset(token);
+        // a body the handler did not finish still sits between this request and the next
+        body_reader.skipRest();
 
-        return url_parser.parseAll();
-    }
+        // the previous view's octets are released only now, which is what keeps it valid until here
+        if (view_out)
+        {
+            transport->consumeReadAhead(pending_consume);
+            parser.reset();
+            pending_consume = 0;
+            view_out = false;
+        }
 
-    std::tuple<Schema, Method, Uri::Url> HttpReader::parseTop()
-    {
-        std::istringstream str_chop {};
+        std::string_view data = transport->peekReadAhead();
 
-        if (socket->readUntil(http_sp, header_buf) > 0)
-            str_chop.str(std::string {header_buf.getBasePtr()});
-        else
-            throw std::runtime_error {"IOErr: failed to read top request line."};
+        // stray CRLFs between requests are dropped before the parser starts, so a peer idling after them times out quietly
+        if (!parser.isHeadDone())
+        {
+            std::size_t blank_count = data.find_first_not_of("\r\n");
+
+            if (blank_count == std::string_view::npos)
+                blank_count = data.length();
 
-        // order of line reading: method, path, schema
-        std::string token {};
+            if (blank_count > 0)
+            {
+                transport->consumeReadAhead(blank_count);
+                parser.reset();
+                data = transport->peekReadAhead();
+            }
+        }
 
-        str_chop >> token;
-        Method method = deduceMethod(token);
+        return data;
+    }
 
-        token.clear();
-        str_chop >> token;
-        Uri::Url path = parseSimpleURL(token);
+    /* BasicHttpReader public impl. */
 
-        token.clear();
-        str_chop >> token;
-        Schema schema = deduceSchema(token);
+    template <NetIO::Transport T>
+    BasicHttpReader<T>::BasicHttpReader() noexcept
+    : parser {}, head_store {}, body_reader {}, arena {}, transport {}, pending_consume {0}, max_body_size {default_max_body_size}, view_out {false} {}
 
-        header_buf.clearData();
-        return {schema, method, path};
+    template <NetIO::Transport T>
+    void BasicHttpReader<T>::resetState(T* transport_) noexcept
+    {
+        transport = transport_;
+        body_reader.resetBuffered({});
+        parser.reset();
+        pending_consume = 0;
+        view_out = false;
+
+        if (transport)
+            parser.setHeadLimit(transport->getReadAheadCapacity());
     }
 
-    [[nodiscard]] RawHeader HttpReader::parseHeader(const std::string& token) const
+    template <NetIO::Transport T>
+    bool BasicHttpReader<T>::hasBufferedHead()
     {
-        std::istringstream str_chop {token};
-        std::string header_name {};
-        std::string header_content {};
-
-        str_chop >> header_name;
-        str_chop >> header_content;
+        // skipping the rest of a body may block on the peer, so leave that to nextView
+        if (!body_reader.isFinished())
+            return false;
 
-        return {header_name, header_content};
-    };
+        return parser.feed(releaseConsumed()) != ParseStatus::parse_need_more || parser.isHeadDone();
+    }
 
-    std::map<std::string, std::string> HttpReader::parseHeaders()
+    template <NetIO::Transport T>
+    RequestView BasicHttpReader<T>::nextView()
     {
-        std::string temp_line {};
-        std::map<std::string, std::string> header_dict {};
+        std::string_view data = releaseConsumed();
+        ParseStatus status {};
 
-        do
+        while ((status = parser.feed(data)) == ParseStatus::parse_need_more)
         {
-            if (socket->readUntil(http_line_end, header_buf) > 0)
-                temp_line = std::string {header_buf.getBasePtr()};
-            else
-                throw std::runtime_error {"IOErr: failed to read header."};
+            // a body past the read-ahead is streamed behind a copy of the head
+            if (parser.isHeadDone() && parser.getRequestLength() > transport->getReadAheadCapacity())
+                break;
 
-            auto [name, value] = parseHeader(temp_line);
+            if (data.length() >= transport->getReadAheadCapacity())
+                throw std::runtime_error {"ParseErr: request head too large."};
 
-            header_dict[name] = std::move(value);
+            fillOrThrow(*transport);
+            data = releaseConsumed();
         }
-        while (temp_line.length() > 0);
-
-        return header_dict;
-    }
 
-    void HttpReader::parseBody(std::size_t content_len)
-    {
-        if (content_len == 0)
-            return;
+        if (status == ParseStatus::parse_error)
+            throw std::runtime_error {std::string {parser.getError()}};
 
-        socket->readInto(content_len, body_buf);
-    }
+        view_out = true;
 
-    /* HttpReader public impl. */
+        if (parser.isChunked() || status == ParseStatus::parse_need_more)
+        {
+            detachHead(data);
+            body_reader.resetStreamed(ReadAheadSource::of(*transport), parser.isChunked() ? std::optional<std::size_t> {} : parser.getContentLength(), max_body_size);
+        }
+        else
+        {
+            body_reader.resetBuffered(parser.getView().body);
+            pending_consume = parser.getRequestLength();
+        }
 
-    HttpReader::HttpReader() noexcept
-    : url_parser {}, header_buf {header_buf_size}, body_buf {body_buf_size}, socket {} {}
+        RequestView view = parser.getView();
+        view.body_reader = &body_reader;
 
-    void HttpReader::resetState(ClientSocket* socket) noexcept
-    {
-        this->socket = socket;
-        body_buf.clearData();
-        header_buf.clearData();
+        return view;
     }
 
-    Request HttpReader::nextRequest()
+    template <NetIO::Transport T>
+    Request BasicHttpReader<T>::nextRequest()
     {
-        // parse top and its simple URL within
-        auto [schema, method, path] = parseTop();
+        // the previous request's reply is out by now, so its strings go all at once
+        arena.reset();
 
-        // read and "parse" headers until blank line by HTTP spec.
-        std::map<std::string, std::string> headers = parseHeaders();
+        RequestView view = nextView();
+        Request req = toOwnedRequest(view, arena.getResource());
 
-        // obey content-length
-        std::size_t content_len_value = 0;
+        if (body_reader.isFinished())
+            return req;
 
-        if (headers.contains(http_content_len_prop))
-        {
-            content_len_value = std::stoul(headers.at(http_content_len_prop));
-        }
+        std::string body_text;
+
+        for (std::string_view slice = body_reader.readSome(); !slice.empty(); slice = body_reader.readSome())
+            body_text.append(slice);
 
-        // read body at last
-        parseBody(content_len_value);
+        req.body = NetIO::FixedBuffer {body_text.length()};
+        std::copy(body_text.begin(), body_text.end(), req.body.getBasePtr());
 
-        return {schema, method, path, headers, body_buf};
+        return req;
     }
-}
\ No newline at end of file
+
+    /* BasicHttpReader instantiations */
+
+    template class BasicHttpReader<NetIO::ClientSocket>;
+    template class BasicHttpReader<NetIO::MemoryTransport>;
+}
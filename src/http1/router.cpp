@@ -0,0 +1,134 @@
+/**
+ * @file router.cpp
+ * @author DrkWithT
+ * @brief Implements route lookup over a planned radix tree.
+ * @date 2024-08-31
+ */
+
+#include <algorithm>
+#include "http1/router.hpp"
+#include "http1/statics.hpp"
+
+namespace ToyServer::Http1
+{
+    /**
+     * @brief State of one lookup, shared by every level of the walk.
+     */
+    struct RouteWalk
+    {
+        const RouteTree& tree;
+        std::array<std::string_view, max_route_params> captures;
+        const RouteSlot* route;
+        Method method;
+    };
+
+    static const RouteSlot* findMethod(const RouteTree& tree, const RouteNode& node, Method method) noexcept
+    {
+        for (std::uint32_t slot_idx = node.route_start; slot_idx < node.route_start + node.route_count; slot_idx++)
+        {
+            if (tree.slots[slot_idx].method == method)
+                return &tree.slots[slot_idx];
+        }
+
+        return nullptr;
+    }
+
+    static bool walkNode(RouteWalk& walk, std::uint32_t node_idx, std::string_view rest, std::size_t capture_count) noexcept
+    {
+        const RouteNode& node = walk.tree.nodes[node_idx];
+
+        switch (node.kind)
+        {
+            case RouteNodeKind::node_static:
+            {
+                std::string_view label {walk.tree.text.data() + node.label_start, node.label_length};
+
+                if (!rest.starts_with(label))
+                    return false;
+
+                rest.remove_prefix(label.length());
+                break;
+            }
+            case RouteNodeKind::node_param:
+            {
+                std::size_t segment_len = std::min(rest.find('/'), rest.length());
+
+                if (segment_len == 0)
+                    return false;
+
+                walk.captures[capture_count++] = rest.substr(0, segment_len);
+                rest.remove_prefix(segment_len);
+                break;
+            }
+            case RouteNodeKind::node_wildcard:
+            default:
+                walk.captures[capture_count++] = rest;
+                rest = {};
+                break;
+        }
+
+        if (rest.empty())
+        {
+            if (const RouteSlot* route = findMethod(walk.tree, node, walk.method); route)
+            {
+                walk.route = route;
+                return true;
+            }
+
+            // a wildcard tail may also match nothing at all
+            return node.wildcard_child != 0 && walkNode(walk, node.wildcard_child, rest, capture_count);
+        }
+
+        // siblings are sorted by first octet, so the one static candidate is found by binary search
+        if (node.child_count > 0)
+        {
+            auto keys_begin = walk.tree.node_keys.begin() + node.child_start;
+            auto keys_end = keys_begin + node.child_count;
+            auto key_pos = std::lower_bound(keys_begin, keys_end, rest.front());
+
+            if (key_pos != keys_end && *key_pos == rest.front() && walkNode(walk, static_cast<std::uint32_t>(key_pos - walk.tree.node_keys.begin()), rest, capture_count))
+                return true;
+        }
+
+        if (node.param_child != 0 && walkNode(walk, node.param_child, rest, capture_count))
+            return true;
+
+        return node.wildcard_child != 0 && walkNode(walk, node.wildcard_child, rest, capture_count);
+    }
+
+    /* RouteParams impl. */
+
+    std::optional<std::string_view> RouteParams::find(std::string_view name) const noexcept
+    {
+        for (std::size_t param_idx = 0; param_idx < names.size(); param_idx++)
+        {
+            if (names[param_idx] == name)
+                return values[param_idx];
+        }
+
+        return {};
+    }
+
+    /* Router lookup impl. */
+
+    RouteMatch matchRoute(const RouteTree& tree, Method method, std::string_view path) noexcept
+    {
+        RouteWalk walk {tree, {}, nullptr, method};
+
+        if (tree.nodes.empty() || !walkNode(walk, 0, path, 0))
+            return {nullptr, {}};
+
+        return {walk.route, RouteParams {tree.param_names.subspan(walk.route->param_start, walk.route->param_count), walk.captures}};
+    }
+
+    Response dispatchRoute(const RouteTree& tree, const RequestView& req)
+    {
+        std::string_view path = req.target.substr(0, req.target.find_first_of("?#"));
+        RouteMatch match = matchRoute(tree, req.method, path);
+
+        if (!match.route)
+            return StaticFiles::makeStatusReply(req.schema, Status::stat_not_found);
+
+        return match.route->handler(req, match.params);
+    }
+}
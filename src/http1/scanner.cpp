@@ -0,0 +1,286 @@
+/**
+ * @file scanner.cpp
+ * @author DrkWithT
+ * @brief Implements vectorized delimiter scanning and token checks for the request parser.
+ * @date 2024-08-20
+ */
+
+#include <array>
+#include "http1/scanner.hpp"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define TOYSERVER_SCAN_X86 1
+#else
+#define TOYSERVER_SCAN_X86 0
+#endif
+
+namespace ToyServer::Http1
+{
+    /* scalar kernels */
+
+    /// @brief RFC 9110 tchar: ALPHA / DIGIT / "!#$%&'*+-.^_`|~"
+    static constexpr std::array<bool, 256> token_table = [] {
+        std::array<bool, 256> table {};
+
+        for (int c = '0'; c <= '9'; c++)
+            table[c] = true;
+
+        for (int c = 'A'; c <= 'Z'; c++)
+            table[c] = true;
+
+        for (int c = 'a'; c <= 'z'; c++)
+            table[c] = true;
+
+        for (char c : std::string_view {"!#$%&'*+-.^_`|~"})
+            table[static_cast<unsigned char>(c)] = true;
+
+        return table;
+    }();
+
+    static constexpr bool matchScanSet(char c, ScanSet set) noexcept
+    {
+        return c == set.c0 || c == set.c1 || c == set.c2 || c == set.c3;
+    }
+
+    static std::size_t findAnyScalar(const char* data, std::size_t len, ScanSet set) noexcept
+    {
+        for (std::size_t pos = 0; pos < len; pos++)
+        {
+            if (matchScanSet(data[pos], set))
+                return pos;
+        }
+
+        return len;
+    }
+
+    static bool isTokenScalar(const char* data, std::size_t len) noexcept
+    {
+        for (std::size_t pos = 0; pos < len; pos++)
+        {
+            if (!token_table[static_cast<unsigned char>(data[pos])])
+                return false;
+        }
+
+        return true;
+    }
+
+    static constexpr ScanKernels scalar_kernels {"scalar", findAnyScalar, isTokenScalar};
+
+#if TOYSERVER_SCAN_X86
+    /* SSE2 kernels, always present on x86-64 */
+
+    __attribute__((target("sse2")))
+    static inline __m128i inRange128(__m128i octets, char lo, char hi) noexcept
+    {
+        // unsigned (x - lo) <= (hi - lo), done with min since SSE2 lacks unsigned compares
+        __m128i offset = _mm_sub_epi8(octets, _mm_set1_epi8(lo));
+
+        return _mm_cmpeq_epi8(_mm_min_epu8(offset, _mm_set1_epi8(static_cast<char>(hi - lo))), offset);
+    }
+
+    __attribute__((target("sse2")))
+    static inline unsigned matchMask128(const char* at, ScanSet set) noexcept
+    {
+        __m128i octets = _mm_loadu_si128(reinterpret_cast<const __m128i*>(at));
+        __m128i hits = _mm_or_si128(
+            _mm_or_si128(_mm_cmpeq_epi8(octets, _mm_set1_epi8(set.c0)), _mm_cmpeq_epi8(octets, _mm_set1_epi8(set.c1))),
+            _mm_or_si128(_mm_cmpeq_epi8(octets, _mm_set1_epi8(set.c2)), _mm_cmpeq_epi8(octets, _mm_set1_epi8(set.c3)))
+        );
+
+        return static_cast<unsigned>(_mm_movemask_epi8(hits));
+    }
+
+    __attribute__((target("sse2")))
+    static inline unsigned invalidMask128(const char* at) noexcept
+    {
+        __m128i octets = _mm_loadu_si128(reinterpret_cast<const __m128i*>(at));
+
+        // visible ASCII minus the separators: "(),/:;<=>?@[\]{}
+        __m128i bad = _mm_or_si128(
+            _mm_or_si128(inRange128(octets, '(', ')'), inRange128(octets, ':', '@')),
+            _mm_or_si128(inRange128(octets, '[', ']'), _mm_cmpeq_epi8(octets, _mm_set1_epi8('"')))
+        );
+        bad = _mm_or_si128(bad, _mm_or_si128(_mm_cmpeq_epi8(octets, _mm_set1_epi8(',')), _mm_cmpeq_epi8(octets, _mm_set1_epi8('/'))));
+        bad = _mm_or_si128(bad, _mm_or_si128(_mm_cmpeq_epi8(octets, _mm_set1_epi8('{')), _mm_cmpeq_epi8(octets, _mm_set1_epi8('}'))));
+
+        return static_cast<unsigned>(_mm_movemask_epi8(_mm_or_si128(bad, _mm_cmpeq_epi8(inRange128(octets, '!', '~'), _mm_setzero_si128()))));
+    }
+
+    __attribute__((target("sse2")))
+    static std::size_t findAnySse2(const char* data, std::size_t len, ScanSet set) noexcept
+    {
+        if (len < 16)
+            return findAnyScalar(data, len, set);
+
+        std::size_t pos = 0;
+
+        for (; pos + 16 <= len; pos += 16)
+        {
+            if (unsigned mask = matchMask128(data + pos, set); mask != 0)
+                return pos + static_cast<std::size_t>(__builtin_ctz(mask));
+        }
+
+        // the tail block overlaps octets already known not to match, so its first hit is still the first overall
+        if (pos < len)
+        {
+            if (unsigned mask = matchMask128(data + len - 16, set); mask != 0)
+                return len - 16 + static_cast<std::size_t>(__builtin_ctz(mask));
+        }
+
+        return len;
+    }
+
+    __attribute__((target("sse2")))
+    static bool isTokenSse2(const char* data, std::size_t len) noexcept
+    {
+        if (len < 16)
+            return isTokenScalar(data, len);
+
+        for (std::size_t pos = 0; pos + 16 <= len; pos += 16)
+        {
+            if (invalidMask128(data + pos) != 0)
+                return false;
+        }
+
+        return invalidMask128(data + len - 16) == 0;
+    }
+
+    /* AVX2 kernels */
+
+    __attribute__((target("avx2")))
+    static inline __m256i inRange256(__m256i octets, char lo, char hi) noexcept
+    {
+        __m256i offset = _mm256_sub_epi8(octets, _mm256_set1_epi8(lo));
+
+        return _mm256_cmpeq_epi8(_mm256_min_epu8(offset, _mm256_set1_epi8(static_cast<char>(hi - lo))), offset);
+    }
+
+    __attribute__((target("avx2")))
+    static inline unsigned matchMask256(const char* at, ScanSet set) noexcept
+    {
+        __m256i octets = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(at));
+        __m256i hits = _mm256_or_si256(
+            _mm256_or_si256(_mm256_cmpeq_epi8(octets, _mm256_set1_epi8(set.c0)), _mm256_cmpeq_epi8(octets, _mm256_set1_epi8(set.c1))),
+            _mm256_or_si256(_mm256_cmpeq_epi8(octets, _mm256_set1_epi8(set.c2)), _mm256_cmpeq_epi8(octets, _mm256_set1_epi8(set.c3)))
+        );
+
+        return static_cast<unsigned>(_mm256_movemask_epi8(hits));
+    }
+
+    __attribute__((target("avx2")))
+    static inline unsigned invalidMask256(const char* at) noexcept
+    {
+        __m256i octets = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(at));
+
+        __m256i bad = _mm256_or_si256(
+            _mm256_or_si256(inRange256(octets, '(', ')'), inRange256(octets, ':', '@')),
+            _mm256_or_si256(inRange256(octets, '[', ']'), _mm256_cmpeq_epi8(octets, _mm256_set1_epi8('"')))
+        );
+        bad = _mm256_or_si256(bad, _mm256_or_si256(_mm256_cmpeq_epi8(octets, _mm256_set1_epi8(',')), _mm256_cmpeq_epi8(octets, _mm256_set1_epi8('/'))));
+        bad = _mm256_or_si256(bad, _mm256_or_si256(_mm256_cmpeq_epi8(octets, _mm256_set1_epi8('{')), _mm256_cmpeq_epi8(octets, _mm256_set1_epi8('}'))));
+
+        return static_cast<unsigned>(_mm256_movemask_epi8(_mm256_or_si256(bad, _mm256_cmpeq_epi8(inRange256(octets, '!', '~'), _mm256_setzero_si256()))));
+    }
+
+    __attribute__((target("avx2")))
+    static std::size_t findAnyAvx2(const char* data, std::size_t len, ScanSet set) noexcept
+    {
+        // most header fields are short, these go 16 at a time before any ymm register gets dirty
+        if (len < 32)
+            return findAnySse2(data, len, set);
+
+        std::size_t pos = 0;
+
+        for (; pos + 32 <= len; pos += 32)
+        {
+            if (unsigned mask = matchMask256(data + pos, set); mask != 0)
+                return pos + static_cast<std::size_t>(__builtin_ctz(mask));
+        }
+
+        if (pos < len)
+        {
+            if (unsigned mask = matchMask256(data + len - 32, set); mask != 0)
+                return len - 32 + static_cast<std::size_t>(__builtin_ctz(mask));
+        }
+
+        return len;
+    }
+
+    __attribute__((target("avx2")))
+    static bool isTokenAvx2(const char* data, std::size_t len) noexcept
+    {
+        if (len < 32)
+            return isTokenSse2(data, len);
+
+        for (std::size_t pos = 0; pos + 32 <= len; pos += 32)
+        {
+            if (invalidMask256(data + pos) != 0)
+                return false;
+        }
+
+        return invalidMask256(data + len - 32) == 0;
+    }
+
+    static constexpr ScanKernels sse2_kernels {"sse2", findAnySse2, isTokenSse2};
+    static constexpr ScanKernels avx2_kernels {"avx2", findAnyAvx2, isTokenAvx2};
+#endif
+
+    /* dispatch */
+
+    ScanLevel detectScanLevel() noexcept
+    {
+#if TOYSERVER_SCAN_X86
+        // may run during static initialization, before libgcc has read CPUID itself
+        __builtin_cpu_init();
+
+        if (__builtin_cpu_supports("avx2"))
+            return ScanLevel::scan_avx2;
+
+        if (__builtin_cpu_supports("sse2"))
+            return ScanLevel::scan_sse2;
+#endif
+
+        return ScanLevel::scan_scalar;
+    }
+
+    const ScanKernels& getScanKernels(ScanLevel level) noexcept
+    {
+        static const ScanLevel best_level = detectScanLevel();
+
+        if (level > best_level)
+            level = best_level;
+
+        switch (level)
+        {
+#if TOYSERVER_SCAN_X86
+            case ScanLevel::scan_avx2:
+                return avx2_kernels;
+            case ScanLevel::scan_sse2:
+                return sse2_kernels;
+#endif
+            default:
+                return scalar_kernels;
+        }
+    }
+
+    /// @note Function local so that parsing during another unit's static initialization still sees picked kernels.
+    static const ScanKernels& getActiveKernels() noexcept
+    {
+        static const ScanKernels& active_kernels = getScanKernels(ScanLevel::last);
+
+        return active_kernels;
+    }
+
+    std::size_t findAnyOf(std::string_view text, ScanSet set) noexcept
+    {
+        std::size_t pos = getActiveKernels().find_any(text.data(), text.length(), set);
+
+        return (pos < text.length()) ? pos : std::string_view::npos;
+    }
+
+    bool isToken(std::string_view text) noexcept
+    {
+        return !text.empty() && getActiveKernels().is_token(text.data(), text.length());
+    }
+}
@@ -0,0 +1,167 @@
+/**
+ * @file session.cpp
+ * @author DrkWithT
+ * @brief Implements persistent HTTP/1.x connection handling with pipelining.
+ * @date 2024-08-26
+ */
+
+#include <chrono>
+#include <optional>
+#include <stdexcept>
+#include <utility>
+#include "metrics/metrics.hpp"
+#include "http1/session.hpp"
+
+namespace ToyServer::Http1
+{
+    using Clock = std::chrono::steady_clock;
+
+    /* HttpSession private impl. */
+
+    void HttpSession::rejectRequest() noexcept
+    {
+        try
+        {
+            writer.queueReply({Schema::http_1_1, Status::stat_bad_request, "", {}, NetIO::FixedBuffer {0}}, false);
+            writer.flush();
+            Metrics::threadMetrics().countRequest(Method::h1_unknown, Status::stat_bad_request);
+        }
+        catch (const std::exception&)
+        {
+            // the peer is likely gone already
+        }
+    }
+
+    void HttpSession::failRequest(const RequestView& req) noexcept
+    {
+        try
+        {
+            writer.queueReply({(req.schema == Schema::http_unknown) ? Schema::http_1_1 : req.schema, Status::stat_server_err, "", {}, NetIO::FixedBuffer {0}}, false);
+            flushTimed();
+            Metrics::threadMetrics().countRequest(req.method, Status::stat_server_err);
+        }
+        catch (const std::exception&)
+        {
+            // the peer is likely gone already
+        }
+    }
+
+    /* HttpSession public impl. */
+
+    HttpSession::HttpSession(NetIO::SocketConfig config, RequestHandler handler_, SessionLimits limits_)
+    : socket {config}, reader {}, writer {&socket}, handler {std::move(handler_)}, limits {limits_}
+    {
+        if (!socket.setReceiveTimeout(limits.idle_timeout_ms))
+            throw std::runtime_error {"HttpSession::HttpSession: Failed to set idle timeout!"};
+
+        // a zero linger would reset the connection and drop replies still queued in the kernel
+        if (config.rw_timeout > 0 && !socket.setLingerTimeout(config.rw_timeout))
+            throw std::runtime_error {"HttpSession::HttpSession: Failed to set linger timeout!"};
+
+        reader.resetState(&socket);
+        reader.setBodyLimit(limits.max_body_size);
+    }
+
+    void HttpSession::flushTimed()
+    {
+        if (!writer.hasPendingOutput())
+            return;
+
+        Clock::time_point write_start = Clock::now();
+        writer.flush();
+        Metrics::threadMetrics().observe(Metrics::Timer::t_write, Clock::now() - write_start);
+    }
+
+    std::size_t HttpSession::serve()
+    {
+        Metrics::ThreadMetrics& metrics = Metrics::threadMetrics();
+        std::size_t served_count = 0;
+
+        while (served_count < limits.max_requests)
+        {
+            // replies wait while more pipelined requests are on hand, then go out together before blocking on the peer
+            if (!reader.hasBufferedHead())
+            {
+                try
+                {
+                    flushTimed();
+                }
+                catch (const std::runtime_error&)
+                {
+                    return served_count;
+                }
+
+                // a timeout or hang up between requests just ends the session
+                if (!socket.hasBufferedInput() && socket.fillReadAhead() != NetIO::IOStatus::io_ok)
+                    return served_count;
+            }
+
+            RequestView req {};
+            Clock::time_point parse_start = Clock::now();
+
+            try
+            {
+                req = reader.nextView();
+                metrics.observe(Metrics::Timer::t_parse, Clock::now() - parse_start);
+            }
+            catch (const std::runtime_error&)
+            {
+                rejectRequest();
+                return served_count;
+            }
+
+            bool keep_alive = wantsKeepAlive(req) && served_count + 1 < limits.max_requests;
+
+            Clock::time_point handler_start = Clock::now();
+            std::optional<Response> res {};
+
+            try
+            {
+                res.emplace(handler(req));
+            }
+            catch (...)
+            {
+                // earlier pipelined replies still go out, the failed request gets a 500 and ends the connection
+                failRequest(req);
+                return served_count;
+            }
+
+            try
+            {
+                Clock::time_point write_start = Clock::now();
+                Status status = res->status;
+
+                metrics.observe(Metrics::Timer::t_handler, write_start - handler_start);
+
+                // an unframed HTTP/1.0 stream can only end with the connection
+                if (res->body_stream && res->schema != Schema::http_1_1)
+                    keep_alive = false;
+
+                writer.queueReply(std::move(*res), keep_alive);
+                metrics.observe(Metrics::Timer::t_write, Clock::now() - write_start);
+                metrics.countRequest(req.method, status);
+            }
+            catch (const std::exception&)
+            {
+                // a peer gone mid-flush: drop the connection
+                return served_count;
+            }
+
+            served_count++;
+
+            if (!keep_alive)
+                break;
+        }
+
+        try
+        {
+            flushTimed();
+        }
+        catch (const std::runtime_error&)
+        {
+            // nothing left to do for a peer that hung up
+        }
+
+        return served_count;
+    }
+}
@@ -0,0 +1,433 @@
+/**
+ * @file statics.cpp
+ * @author DrkWithT
+ * @brief Implements the static file handler with zero-copy file bodies.
+ * @date 2024-08-27
+ */
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <array>
+#include <charconv>
+#include <cstdint>
+#include <stdexcept>
+#include <utility>
+#include "http1/statics.hpp"
+#include "uri/view.hpp"
+
+namespace ToyServer::Http1
+{
+    struct MimeEntry
+    {
+        std::string_view extension;
+        std::string_view mime_type;
+    };
+
+    static constexpr std::array<MimeEntry, 16> mime_entries {{
+        {".html", "text/html; charset=utf-8"},
+        {".htm", "text/html; charset=utf-8"},
+        {".css", "text/css; charset=utf-8"},
+        {".js", "text/javascript; charset=utf-8"},
+        {".mjs", "text/javascript; charset=utf-8"},
+        {".json", "application/json"},
+        {".txt", "text/plain; charset=utf-8"},
+        {".svg", "image/svg+xml"},
+        {".png", "image/png"},
+        {".jpg", "image/jpeg"},
+        {".jpeg", "image/jpeg"},
+        {".gif", "image/gif"},
+        {".webp", "image/webp"},
+        {".ico", "image/x-icon"},
+        {".woff2", "font/woff2"},
+        {".wasm", "application/wasm"}
+    }};
+
+    static constexpr std::string_view default_mime_type = "application/octet-stream";
+
+    static constexpr std::array<std::string_view, 3> coding_names {"br", "gzip", "identity"};
+    static constexpr std::array<std::string_view, 2> sidecar_suffixes {".br", ".gz"};
+
+    static constexpr unsigned codingBit(Coding coding) noexcept
+    {
+        return 1U << static_cast<unsigned>(coding);
+    }
+
+    static constexpr std::string_view trimSpaces(std::string_view text) noexcept
+    {
+        while (!text.empty() && (text.front() == ' ' || text.front() == '\t'))
+            text.remove_prefix(1);
+
+        while (!text.empty() && (text.back() == ' ' || text.back() == '\t'))
+            text.remove_suffix(1);
+
+        return text;
+    }
+
+    /// @brief Tells whether an `Accept-Encoding` item's parameters carry a zero quality, which means "not acceptable".
+    static constexpr bool hasZeroQuality(std::string_view params) noexcept
+    {
+        while (!params.empty())
+        {
+            std::size_t semi_pos = params.find(';');
+            std::string_view param = trimSpaces(params.substr(0, semi_pos));
+
+            if (param.length() >= 2 && (param[0] == 'q' || param[0] == 'Q') && param[1] == '=')
+            {
+                std::string_view weight = param.substr(2);
+
+                // "0", "0.", "0.0", "0.00" or "0.000"
+                return !weight.empty() && weight[0] == '0' && weight.find_first_not_of("0.", 1) == std::string_view::npos;
+            }
+
+            if (semi_pos == std::string_view::npos)
+                break;
+
+            params.remove_prefix(semi_pos + 1);
+        }
+
+        return false;
+    }
+
+    /// @brief Replies use the request's version, or HTTP/1.1 when it was not recognized.
+    static constexpr Schema replySchema(Schema schema) noexcept
+    {
+        return (schema == Schema::http_unknown) ? Schema::http_1_1 : schema;
+    }
+
+    /// @brief Drops the weak prefix, since `If-None-Match` compares tags weakly.
+    static constexpr std::string_view opaqueTag(std::string_view tag) noexcept
+    {
+        return (tag.starts_with("W/")) ? tag.substr(2) : tag;
+    }
+
+    /// @brief Appends `value` in lowercase hex.
+    static void appendHex(std::string& out, std::uint64_t value)
+    {
+        char digits[16] {};
+        auto [digits_end, conv_err] = std::to_chars(digits, digits + sizeof(digits), value, 16);
+
+        out.append(digits, digits_end);
+    }
+
+    std::string_view guessMimeType(std::string_view path) noexcept
+    {
+        std::size_t dot_pos = path.rfind('.');
+
+        if (dot_pos == std::string_view::npos || path.find('/', dot_pos) != std::string_view::npos)
+            return default_mime_type;
+
+        std::string_view extension = path.substr(dot_pos);
+
+        for (const auto& [entry_extension, mime_type] : mime_entries)
+        {
+            if (equalsNoCase(extension, entry_extension))
+                return mime_type;
+        }
+
+        return default_mime_type;
+    }
+
+    bool isCompressibleType(std::string_view mime_type) noexcept
+    {
+        return mime_type.starts_with("text/")
+            || mime_type == "application/json"
+            || mime_type == "application/wasm"
+            || mime_type == "image/svg+xml";
+    }
+
+    unsigned parseAcceptEncoding(std::string_view accept_encoding) noexcept
+    {
+        unsigned accepted = 0;
+        unsigned refused = 0;
+        bool any_accepted = false;
+
+        while (!accept_encoding.empty())
+        {
+            std::size_t comma_pos = accept_encoding.find(',');
+            std::string_view item = accept_encoding.substr(0, comma_pos);
+            std::size_t semi_pos = item.find(';');
+            std::string_view name = trimSpaces(item.substr(0, semi_pos));
+            bool acceptable = semi_pos == std::string_view::npos || !hasZeroQuality(item.substr(semi_pos + 1));
+            unsigned coding_bits = 0;
+
+            if (equalsNoCase(name, "br"))
+                coding_bits = codingBit(Coding::coding_br);
+            else if (equalsNoCase(name, "gzip") || equalsNoCase(name, "x-gzip"))
+                coding_bits = codingBit(Coding::coding_gzip);
+            else if (name == "*")
+                any_accepted = acceptable;
+
+            if (acceptable)
+                accepted |= coding_bits;
+            else
+                refused |= coding_bits;
+
+            if (comma_pos == std::string_view::npos)
+                break;
+
+            accept_encoding.remove_prefix(comma_pos + 1);
+        }
+
+        // "*" covers every coding not named on its own
+        if (any_accepted)
+            accepted |= (codingBit(Coding::coding_br) | codingBit(Coding::coding_gzip)) & ~refused;
+
+        return accepted & ~refused;
+    }
+
+    std::string_view stringifyCoding(Coding coding) noexcept
+    {
+        return coding_names[static_cast<std::size_t>(coding)];
+    }
+
+    std::string makeEntityTag(const NetIO::FileStats& stats, Coding coding)
+    {
+        std::string etag {"\""};
+
+        appendHex(etag, stats.size);
+        etag.append(1, '-');
+        appendHex(etag, static_cast<std::uint64_t>(stats.modified));
+
+        // each coding is its own representation, so it gets its own validator
+        if (coding != Coding::coding_identity)
+            etag.append(1, '-').append(stringifyCoding(coding));
+
+        etag.append(1, '"');
+
+        return etag;
+    }
+
+    bool matchesEntityTag(std::string_view if_none_match, std::string_view etag) noexcept
+    {
+        std::string_view wanted = opaqueTag(etag);
+
+        // our tags hold no commas, so splitting on them cannot make a foreign tag match
+        while (!if_none_match.empty())
+        {
+            std::size_t comma_pos = if_none_match.find(',');
+            std::string_view item = trimSpaces(if_none_match.substr(0, comma_pos));
+
+            if (item == "*" || opaqueTag(item) == wanted)
+                return true;
+
+            if (comma_pos == std::string_view::npos)
+                break;
+
+            if_none_match.remove_prefix(comma_pos + 1);
+        }
+
+        return false;
+    }
+
+    /* StaticFiles public impl. */
+
+    std::string StaticFiles::sanitizePath(std::string_view url_path)
+    {
+        url_path = url_path.substr(0, url_path.find_first_of("?#"));
+
+        if (url_path.empty() || url_path.front() != '/')
+            return {};
+
+        std::string decoded {url_path};
+        auto decoded_len = Uri::percentDecode(decoded, decoded.data());
+
+        // an escaped NUL would cut the path short at openat
+        if (!decoded_len)
+            return {};
+
+        decoded.resize(*decoded_len);
+
+        if (decoded.find('\0') != std::string::npos)
+            return {};
+
+        // rebuild from the segments so that no "..", hidden name or doubled slash reaches openat
+        std::string relative;
+        std::string_view rest {decoded};
+
+        while (!rest.empty())
+        {
+            std::size_t slash_pos = rest.find('/');
+            std::string_view segment = rest.substr(0, slash_pos);
+
+            if (!segment.empty())
+            {
+                if (segment.front() == '.')
+                    return {};
+
+                if (!relative.empty())
+                    relative += '/';
+
+                relative.append(segment);
+            }
+
+            if (slash_pos == std::string_view::npos)
+                break;
+
+            rest.remove_prefix(slash_pos + 1);
+        }
+
+        if (relative.empty())
+            return std::string {index_name};
+
+        if (decoded.back() == '/')
+            relative.append("/").append(index_name);
+
+        return relative;
+    }
+
+    Response StaticFiles::makeStatusReply(Schema schema, Status status)
+    {
+        return {replySchema(schema), status, "", {}, NetIO::FixedBuffer {0}};
+    }
+
+    Response StaticFiles::makeNotModified(Schema schema, std::string_view etag, bool varies)
+    {
+        Response reply = makeStatusReply(schema, Status::stat_not_modified);
+        reply.headers[FieldId::f_etag] = etag;
+
+        if (varies)
+            reply.headers[FieldId::f_vary] = "Accept-Encoding";
+
+        return reply;
+    }
+
+    StaticFiles::StaticFiles(std::string doc_root_)
+    : doc_root {std::move(doc_root_)}, root_fd {open(doc_root.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC)}
+    {
+        if (root_fd == -1)
+            throw std::runtime_error {"StaticFiles::StaticFiles: Cannot open document root!"};
+    }
+
+    NetIO::FileHandle StaticFiles::openResolved(std::string& relative, NetIO::FileStats& stats) const
+    {
+        NetIO::FileHandle file = NetIO::openFileAt(root_fd, relative.c_str());
+
+        if (!file.isOpen() || !file.getStats(stats))
+            return {};
+
+        // a directory serves its index page
+        if (stats.is_directory)
+        {
+            relative.append("/").append(index_name);
+            file = NetIO::openFileAt(root_fd, relative.c_str());
+
+            if (!file.isOpen() || !file.getStats(stats))
+                return {};
+        }
+
+        if (!stats.is_regular)
+            return {};
+
+        return file;
+    }
+
+    NetIO::FileHandle StaticFiles::openSidecar(const std::string& relative, unsigned accepted, NetIO::FileStats& stats, Coding& coding) const
+    {
+        if (accepted == 0 || !isCompressibleType(guessMimeType(relative)))
+            return {};
+
+        std::string sidecar_path;
+
+        for (Coding candidate : {Coding::coding_br, Coding::coding_gzip})
+        {
+            if ((accepted & codingBit(candidate)) == 0)
+                continue;
+
+            sidecar_path.assign(relative).append(sidecar_suffixes[static_cast<std::size_t>(candidate)]);
+
+            NetIO::FileStats sidecar_stats {};
+            NetIO::FileHandle sidecar = NetIO::openFileAt(root_fd, sidecar_path.c_str());
+
+            // an older sidecar is a leftover from a previous build, never serve it over the fresh file
+            if (!sidecar.isOpen() || !sidecar.getStats(sidecar_stats) || !sidecar_stats.is_regular || sidecar_stats.modified < stats.modified)
+                continue;
+
+            stats = sidecar_stats;
+            coding = candidate;
+
+            return sidecar;
+        }
+
+        return {};
+    }
+
+    Response StaticFiles::makeFileReply(Method method, Schema schema, NetIO::FileHandle&& file, const NetIO::FileStats& stats, std::string_view relative, Coding coding, std::string_view if_none_match) const
+    {
+        std::string etag = makeEntityTag(stats, coding);
+        std::string_view mime_type = guessMimeType(relative);
+        // shared caches must key text-like replies on Accept-Encoding whichever variant this one is
+        bool varies = isCompressibleType(mime_type);
+
+        if (!if_none_match.empty() && matchesEntityTag(if_none_match, etag))
+            return makeNotModified(schema, etag, varies);
+
+        Response reply = makeStatusReply(schema, Status::stat_ok);
+        reply.headers[FieldId::f_content_type] = mime_type;
+
+        if (coding != Coding::coding_identity)
+            reply.headers[FieldId::f_content_encoding] = stringifyCoding(coding);
+
+        if (varies)
+            reply.headers[FieldId::f_vary] = "Accept-Encoding";
+
+        reply.headers[FieldId::f_etag] = std::move(etag);
+
+        if (method == Method::h1_head)
+        {
+            // HEAD reports the GET length but sends no payload
+            reply.headers[FieldId::f_content_length] = std::to_string(stats.size);
+            return reply;
+        }
+
+        if (stats.size >= large_file_size)
+            file.adviseSequential();
+
+        reply.file_body = FileBody {std::move(file), 0, stats.size};
+
+        return reply;
+    }
+
+    Response StaticFiles::serve(Method method, Schema schema, std::string_view url_path, std::string_view accept_encoding, std::string_view if_none_match) const
+    {
+        if (method != Method::h1_get && method != Method::h1_head)
+            return makeStatusReply(schema, Status::stat_not_implemented);
+
+        std::string relative = sanitizePath(url_path);
+
+        if (relative.empty())
+            return makeStatusReply(schema, Status::stat_bad_request);
+
+        NetIO::FileStats stats {};
+        NetIO::FileHandle file = openResolved(relative, stats);
+
+        if (!file.isOpen())
+            return makeStatusReply(schema, Status::stat_not_found);
+
+        Coding coding = Coding::coding_identity;
+
+        if (NetIO::FileHandle sidecar = openSidecar(relative, parseAcceptEncoding(accept_encoding), stats, coding); sidecar.isOpen())
+            file = std::move(sidecar);
+
+        return makeFileReply(method, schema, std::move(file), stats, relative, coding, if_none_match);
+    }
+
+    Response StaticFiles::serve(const RequestView& req) const
+    {
+        return serve(req.method, req.schema, req.target, req.findHeader(FieldId::f_accept_encoding).value_or(""), req.findHeader(FieldId::f_if_none_match).value_or(""));
+    }
+
+    Response StaticFiles::serve(const Request& req) const
+    {
+        auto accept_encoding_it = req.headers.find(std::string_view {"Accept-Encoding"});
+        std::string_view accept_encoding = (accept_encoding_it != req.headers.end()) ? std::string_view {accept_encoding_it->second} : std::string_view {};
+        auto if_none_match_it = req.headers.find(std::string_view {"If-None-Match"});
+        std::string_view if_none_match = (if_none_match_it != req.headers.end()) ? std::string_view {if_none_match_it->second} : std::string_view {};
+
+        return serve(req.method, req.schema, req.route.path, accept_encoding, if_none_match);
+    }
+
+    StaticFiles::~StaticFiles() noexcept
+    {
+        close(root_fd);
+    }
+}
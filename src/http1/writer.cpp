@@ -5,11 +5,13 @@
  * @date 2024-08-03
  */
 
+#include <time.h>
+#include <algorithm>
+#include <charconv>
 #include <stdexcept>
 #include <array>
 #include <string_view>
 #include <string>
-#include <sstream>
 #include "http1/writer.hpp"
 
 namespace ToyServer::Http1
@@ -20,8 +22,6 @@ namespace ToyServer::Http1
 
     /* constants */
 
-    static constexpr std::size_t writer_buf_len = 2048;
-
     static constexpr std::string_view text_foo = ""; // placeholder for invalid enums
 
     static constexpr schemas_t schema_texts = {
@@ -40,6 +40,101 @@ namespace ToyServer::Http1
         "501 Not Implemented"
     };
 
+    static constexpr std::size_t schema_count = static_cast<std::size_t>(Schema::last);
+    static constexpr std::size_t status_count = static_cast<std::size_t>(Status::last);
+    static constexpr std::size_t head_kind_count = schema_count * status_count;
+
+    /**
+     * @brief Compile-time blob of texts stored back to back, one per (schema, status) pair.
+     */
+    struct HeadTable
+    {
+        std::array<char, 2048> bytes {};
+        std::array<std::size_t, head_kind_count + 1> offsets {};
+
+        [[nodiscard]] constexpr std::string_view get(Schema schema, Status status) const noexcept
+        {
+            std::size_t kind_idx = static_cast<std::size_t>(schema) * status_count + static_cast<std::size_t>(status);
+
+            return {bytes.data() + offsets[kind_idx], offsets[kind_idx + 1] - offsets[kind_idx]};
+        }
+    };
+
+    /// @brief Error statuses whose bodiless replies are sent whole from `canned_heads`.
+    static constexpr bool isCannedStatus(Status status) noexcept
+    {
+        return status >= Status::stat_bad_request && status < Status::last;
+    }
+
+    /// @brief Statuses whose replies never have a body, so they must not announce a length either (RFC 9110 sections 8.6, 15.3.5 and 15.4.5).
+    /// @note No 1xx status is ever sent here.
+    static constexpr bool isBodilessStatus(Status status) noexcept
+    {
+        return status == Status::stat_no_content || status == Status::stat_not_modified;
+    }
+
+    /// @param with_length Whether to render the full canned head of an empty error reply instead of the bare status line.
+    static consteval HeadTable buildHeadTable(bool with_length)
+    {
+        HeadTable table {};
+        std::size_t pos = 0;
+
+        auto append = [&table, &pos](std::string_view text) {
+            for (char c : text)
+                table.bytes[pos++] = c;
+        };
+
+        for (std::size_t schema_idx = 0; schema_idx < schema_count; schema_idx++)
+        {
+            for (std::size_t status_idx = 0; status_idx < status_count; status_idx++)
+            {
+                table.offsets[schema_idx * status_count + status_idx] = pos;
+
+                if (with_length && !isCannedStatus(static_cast<Status>(status_idx)))
+                    continue;
+
+                append(schema_texts[schema_idx]);
+                append(" ");
+                append(status_texts[status_idx]);
+                append("\r\n");
+
+                if (with_length)
+                    append("Content-Length: 0\r\n");
+            }
+        }
+
+        table.offsets[head_kind_count] = pos;
+
+        return table;
+    }
+
+    static constexpr HeadTable status_lines = buildHeadTable(false);
+    static constexpr HeadTable canned_heads = buildHeadTable(true); // empty for non error statuses
+
+    static_assert(status_lines.get(Schema::http_1_1, Status::stat_not_found) == "HTTP/1.1 404 Not Found\r\n");
+    static_assert(canned_heads.get(Schema::http_1_0, Status::stat_bad_request) == "HTTP/1.0 400 Bad Request\r\nContent-Length: 0\r\n");
+    static_assert(canned_heads.get(Schema::http_1_1, Status::stat_ok).empty());
+
+    static constexpr std::array<std::string_view, 7> day_names {"Sun", "Mon", "Tue", "Wed", "Thu", "Fri", "Sat"};
+    static constexpr std::array<std::string_view, 12> month_names {"Jan", "Feb", "Mar", "Apr", "May", "Jun", "Jul", "Aug", "Sep", "Oct", "Nov", "Dec"};
+
+    /**
+     * @brief A thread's rendered `Date` line and the second it shows.
+     */
+    struct DateLineCache
+    {
+        std::array<char, 40> line {};
+        std::size_t length = 0;
+        time_t shown_second = -1;
+    };
+
+    static thread_local DateLineCache date_line_cache;
+
+    static constexpr std::string_view conn_keep_alive_line = "Connection: keep-alive\r\n";
+    static constexpr std::string_view conn_close_line = "Connection: close\r\n";
+    static constexpr std::string_view chunked_line = "Transfer-Encoding: chunked\r\n";
+    static constexpr std::string_view last_chunk = "0\r\n\r\n";
+
     /* helpers impl. */
 
     std::string_view stringifySchema(Schema schema)
@@ -58,73 +153,417 @@ namespace ToyServer::Http1
         return status_texts.at(static_cast<int>(status));
     }
 
-    /* HttpWriter private impl. */
+    std::string_view getStatusLine(Schema schema, Status status) noexcept
+    {
+        // a reply built with invalid enums still needs a parsable status line
+        if (schema >= Schema::last || status >= Status::last)
+            return status_lines.get(Schema::http_1_1, Status::stat_server_err);
+
+        return status_lines.get(schema, status);
+    }
+
+    std::string_view getDateLine() noexcept
+    {
+        struct timespec now {};
+        clock_gettime(CLOCK_REALTIME_COARSE, &now);
+
+        DateLineCache& cache = date_line_cache;
+
+        if (now.tv_sec == cache.shown_second)
+            return {cache.line.data(), cache.length};
+
+        struct tm parts {};
+        gmtime_r(&now.tv_sec, &parts);
+
+        // IMF-fixdate, e.g. "Date: Sun, 06 Nov 1994 08:49:37 GMT", rendered by hand to stay clear of locales
+        char* out = cache.line.data();
+
+        auto putText = [&out](std::string_view text) {
+            out = std::copy(text.begin(), text.end(), out);
+        };
+
+        auto putDigits = [&out](int value, int width) {
+            for (int digit_idx = width - 1; digit_idx >= 0; digit_idx--)
+            {
+                out[digit_idx] = static_cast<char>('0' + value % 10);
+                value /= 10;
+            }
+
+            out += width;
+        };
+
+        putText("Date: ");
+        putText(day_names[static_cast<std::size_t>(parts.tm_wday)]);
+        putText(", ");
+        putDigits(parts.tm_mday, 2);
+        putText(" ");
+        putText(month_names[static_cast<std::size_t>(parts.tm_mon)]);
+        putText(" ");
+        putDigits(parts.tm_year + 1900, 4);
+        putText(" ");
+        putDigits(parts.tm_hour, 2);
+        putText(":");
+        putDigits(parts.tm_min, 2);
+        putText(":");
+        putDigits(parts.tm_sec, 2);
+        putText(" GMT\r\n");
+
+        cache.length = static_cast<std::size_t>(out - cache.line.data());
+        cache.shown_second = now.tv_sec;
 
-    void HttpWriter::dumpOutBuffer(std::size_t load_count)
+        return {cache.line.data(), cache.length};
+    }
+
+    /* BasicHttpWriter private impl. */
+
+    template <NetIO::Transport T>
+    void BasicHttpWriter<T>::queueHeadRange(std::size_t start, std::size_t length)
+    {
+        // heads of replies without a body in between share one segment
+        if (!segments.empty() && segments.back().body == nullptr && segments.back().file_fd == no_file_fd)
+            segments.back().length += length;
+        else
+            segments.push_back({nullptr, start, length, no_file_fd});
+
+        pending_count += length;
+    }
+
+    template <NetIO::Transport T>
+    void BasicHttpWriter<T>::writeHeadText(std::string_view text)
     {
-        buf_count = load_count;
-        socket->writeFrom(buf_count, out_buf);
-        buf_count = 0;
+        std::size_t text_start = head_buf.length();
+        head_buf.append(text);
+        queueHeadRange(text_start, text.length());
     }
 
-    void HttpWriter::loadChars(const std::string& content)
+    template <NetIO::Transport T>
+    void BasicHttpWriter<T>::writeLines(const Response& res, bool keep_alive)
     {
-        // attempt loading of content chars (I also say octets.)
-        if (!out_buf.loadChars(content))
+        std::size_t head_start = head_buf.length();
+        std::size_t body_len = (res.file_body) ? res.file_body->length : res.body.getCapacity();
+        std::string_view canned_head = (res.schema < Schema::last && res.status < Status::last) ? canned_heads.get(res.schema, res.status) : text_foo;
+
+        // a bare error reply is one precomputed blob, everything else is put together from the status line on
+        if (!canned_head.empty() && res.headers.empty() && body_len == 0 && !res.body_stream)
         {
-            out_buf.clearData();
-            throw std::runtime_error {"Output buffer load too big."};
+            head_buf.append(canned_head);
         }
+        else
+        {
+            head_buf.append(getStatusLine(res.schema, res.status));
+
+            for (const auto& [name, value, id] : res.headers)
+                head_buf.append(name).append(": ").append(value).append("\r\n");
+
+            // framing by length (or by chunks) is what lets the client find the next reply on a reused connection
+            if (res.body_stream)
+            {
+                if (res.schema == Schema::http_1_1 && !res.headers.contains(FieldId::f_transfer_encoding))
+                    head_buf.append(chunked_line);
+            }
+            else if (!res.headers.contains(FieldId::f_content_length) && !isBodilessStatus(res.status))
+            {
+                std::array<char, 24> len_digits;
+                auto [len_end, len_err] = std::to_chars(len_digits.data(), len_digits.data() + len_digits.size(), body_len);
+
+                head_buf.append("Content-Length: ").append(len_digits.data(), len_end).append("\r\n");
+            }
+        }
+
+        if (!res.headers.contains(FieldId::f_date))
+            head_buf.append(getDateLine());
+
+        if (!res.headers.contains(FieldId::f_connection))
+            head_buf.append((keep_alive) ? conn_keep_alive_line : conn_close_line);
+
+        head_buf.append("\r\n");
+        queueHeadRange(head_start, head_buf.length() - head_start);
+    }
+
+    template <NetIO::Transport T>
+    void BasicHttpWriter<T>::writePayload(const char* body, std::size_t length)
+    {
+        if (length == 0)
+            return;
+
+        segments.push_back({body, 0, length, no_file_fd});
+        pending_count += length;
     }
 
-    void HttpWriter::loadChars(const char* octets_ptr, std::size_t len)
+    template <NetIO::Transport T>
+    void BasicHttpWriter<T>::writeFilePayload(const FileBody& file_body)
     {
-        if (!out_buf.loadChars(octets_ptr, len))
+        if (file_body.length == 0)
+            return;
+
+        segments.push_back({nullptr, file_body.offset, file_body.length, file_body.file.getFd()});
+        pending_count += file_body.length;
+    }
+
+    template <NetIO::Transport T>
+    void BasicHttpWriter<T>::writePrebuilt(const Response& res, bool keep_alive)
+    {
+        const PrebuiltRef& prebuilt = *res.prebuilt;
+        const auto& [bytes, head_end] = *prebuilt.reply;
+        std::string_view status_line = getStatusLine(res.schema, res.status);
+        std::string_view conn_line = (keep_alive) ? conn_keep_alive_line : conn_close_line;
+
+        // status line, head lines, then the Date and Connection lines, then the blank line and body, all sent in place but the date
+        writePayload(status_line.data(), status_line.length());
+        writePayload(bytes.data(), head_end);
+        writeHeadText(getDateLine());
+        writePayload(conn_line.data(), conn_line.length());
+        writePayload(bytes.data() + head_end, (prebuilt.head_only) ? 2 : bytes.length() - head_end);
+    }
+
+    template <NetIO::Transport T>
+    void BasicHttpWriter<T>::writeStreamed(const Response& res, bool keep_alive)
+    {
+        writeLines(res, keep_alive);
+
+        // HTTP/1.0 has no chunked coding, so its body just runs until the close
+        chunk_framing = res.schema == Schema::http_1_1;
+        chunk_buf.clear();
+
+        ChunkSink sink {*this};
+        res.body_stream(sink);
+
+        flushChunkBatch();
+
+        if (chunk_framing)
+            writeHeadText(last_chunk);
+    }
+
+    template <NetIO::Transport T>
+    void BasicHttpWriter<T>::sendChunk(std::string_view piece)
+    {
+        if (chunk_framing)
+        {
+            std::array<char, 2 * sizeof(std::size_t) + 2> size_line;
+            auto [size_end, size_err] = std::to_chars(size_line.data(), size_line.data() + size_line.size() - 2, piece.length(), 16);
+
+            *size_end++ = '\r';
+            *size_end++ = '\n';
+
+            writeHeadText({size_line.data(), size_end});
+            writePayload(piece.data(), piece.length());
+            writeHeadText("\r\n");
+        }
+        else
         {
-            out_buf.clearData();
-            throw std::runtime_error {"Output buffer load too big."};
+            writePayload(piece.data(), piece.length());
         }
+
+        // the piece may not outlive this call, so it leaves now
+        flush();
     }
 
-    void HttpWriter::writeLines(const Response& res)
+    template <NetIO::Transport T>
+    void BasicHttpWriter<T>::streamPiece(std::string_view piece)
     {
-        std::ostringstream sout {};
+        if (piece.empty())
+            return;
 
-        sout << stringifySchema(res.schema)
-            << ' ' << stringifyStatus(res.status)
-            << "\r\n";
+        if (chunk_buf.length() + piece.length() <= chunk_batch_size)
+        {
+            chunk_buf.append(piece);
 
-        sout.str("");
+            if (chunk_buf.length() == chunk_batch_size)
+                flushChunkBatch();
 
-        for (const auto& [name, value] : res.headers)
-            sout << name << ": " << value << "\r\n";
+            return;
+        }
 
-        sout << "\r\n";
+        flushChunkBatch();
 
-        auto data = sout.str();
-        loadChars(data);
-        dumpOutBuffer(data.length());
+        // big pieces skip the copy into the batch
+        if (piece.length() >= chunk_batch_size)
+            sendChunk(piece);
+        else
+            chunk_buf.append(piece);
     }
 
-    void HttpWriter::writePayload(const Response& res)
+    template <NetIO::Transport T>
+    void BasicHttpWriter<T>::flushChunkBatch()
     {
-        std::size_t res_body_len = res.body.getCapacity();
-        loadChars(res.body.getBasePtr(), res_body_len);
-        dumpOutBuffer(res_body_len);
+        if (chunk_buf.empty())
+            return;
+
+        sendChunk(chunk_buf);
+        chunk_buf.clear();
     }
 
-    /* HttpWriter public impl. */
+    template <NetIO::Transport T>
+    void BasicHttpWriter<T>::sendGathered(std::size_t seg_begin, std::size_t seg_end, bool more_follows)
+    {
+        // head_buf is final now, so its ranges can become raw pointers
+        gather_vecs.clear();
+
+        for (std::size_t seg_idx = seg_begin; seg_idx < seg_end; seg_idx++)
+        {
+            const auto& [body, offset, length, file_fd] = segments[seg_idx];
+            const char* base = (body != nullptr) ? body : head_buf.data() + offset;
 
-    HttpWriter::HttpWriter(ClientSocket* socket_ptr) noexcept
-    : out_buf {writer_buf_len}, socket {socket_ptr}, buf_count {0} {}
+            gather_vecs.push_back({const_cast<char*>(base), length});
+        }
 
-    void HttpWriter::writeReply(const Response& res)
+        std::size_t vec_idx = 0;
+
+        while (vec_idx < gather_vecs.size())
+        {
+            std::size_t vec_count = std::min(gather_vecs.size() - vec_idx, max_gather_count);
+            auto [count, status] = transport->writeGather({gather_vecs.data() + vec_idx, vec_count}, more_follows);
+
+            if (status != NetIO::IOStatus::io_ok)
+                failFlush(status);
+
+            // skip past fully sent segments, then trim a partially sent one
+            while (vec_idx < gather_vecs.size() && count >= gather_vecs[vec_idx].iov_len)
+                count -= gather_vecs[vec_idx++].iov_len;
+
+            if (count > 0)
+            {
+                gather_vecs[vec_idx].iov_base = static_cast<char*>(gather_vecs[vec_idx].iov_base) + count;
+                gather_vecs[vec_idx].iov_len -= count;
+            }
+        }
+    }
+
+    template <NetIO::Transport T>
+    void BasicHttpWriter<T>::sendFileSegment(const OutSegment& segment)
     {
-        /// @note I do a quick and dirty pre-feeding reset for now. If this gets copied more, I'll pull out a method.
-        out_buf.clearData();
-        buf_count = 0;
+        std::size_t sent_count = 0;
+
+        while (sent_count < segment.length)
+        {
+            auto [count, status] = transport->sendFile(segment.file_fd, segment.offset + sent_count, segment.length - sent_count);
 
-        writeLines(res);
-        writePayload(res);
+            if (status != NetIO::IOStatus::io_ok)
+                failFlush(status);
+
+            sent_count += count;
+        }
     }
-}
\ No newline at end of file
+
+    template <NetIO::Transport T>
+    void BasicHttpWriter<T>::failFlush(NetIO::IOStatus status)
+    {
+        clearQueue();
+
+        throw std::runtime_error {(status == NetIO::IOStatus::io_again)
+            ? "IOErr: socket would block."
+            : "IOErr: peer closed before reply was sent."};
+    }
+
+    template <NetIO::Transport T>
+    void BasicHttpWriter<T>::clearQueue() noexcept
+    {
+        // keep the capacities around for the next batch of replies
+        head_buf.clear();
+        segments.clear();
+        held_bodies.clear();
+        held_files.clear();
+        held_prebuilts.clear();
+        pending_count = 0;
+    }
+
+    /* BasicHttpWriter public impl. */
+
+    template <NetIO::Transport T>
+    BasicHttpWriter<T>::BasicHttpWriter(T* transport_) noexcept
+    : head_buf {}, segments {}, held_bodies {}, held_files {}, held_prebuilts {}, gather_vecs {}, chunk_buf {}, transport {transport_}, pending_count {0}, chunk_framing {true} {}
+
+    template <NetIO::Transport T>
+    void BasicHttpWriter<T>::queueReply(const Response& res, bool keep_alive)
+    {
+        if (res.prebuilt)
+        {
+            writePrebuilt(res, keep_alive);
+        }
+        else if (res.body_stream)
+        {
+            writeStreamed(res, keep_alive);
+        }
+        else
+        {
+            writeLines(res, keep_alive);
+
+            if (res.file_body)
+                writeFilePayload(*res.file_body);
+            else
+                writePayload(res.body.getBasePtr(), res.body.getCapacity());
+        }
+
+        if (pending_count >= flush_threshold)
+            flush();
+    }
+
+    template <NetIO::Transport T>
+    void BasicHttpWriter<T>::queueReply(Response&& res, bool keep_alive)
+    {
+        // moving a FixedBuffer keeps its block where it is, and moving a FileHandle keeps its fd, so the segments stay valid
+        if (res.prebuilt)
+        {
+            writePrebuilt(res, keep_alive);
+            held_prebuilts.push_back(std::move(res.prebuilt->reply));
+        }
+        else if (res.body_stream)
+        {
+            // the producer's output is sent or copied by the time it returns
+            writeStreamed(res, keep_alive);
+        }
+        else if (res.file_body)
+        {
+            writeLines(res, keep_alive);
+            writeFilePayload(*res.file_body);
+            held_files.push_back(std::move(res.file_body->file));
+        }
+        else
+        {
+            writeLines(res, keep_alive);
+            held_bodies.push_back(std::move(res.body));
+            writePayload(held_bodies.back().getBasePtr(), held_bodies.back().getCapacity());
+        }
+
+        if (pending_count >= flush_threshold)
+            flush();
+    }
+
+    template <NetIO::Transport T>
+    void BasicHttpWriter<T>::flush()
+    {
+        std::size_t seg_idx = 0;
+
+        // in-memory runs go out gathered, file bodies go out by sendfile in between
+        while (seg_idx < segments.size())
+        {
+            if (segments[seg_idx].file_fd != no_file_fd)
+            {
+                sendFileSegment(segments[seg_idx++]);
+                continue;
+            }
+
+            std::size_t run_end = seg_idx;
+
+            while (run_end < segments.size() && segments[run_end].file_fd == no_file_fd)
+                run_end++;
+
+            sendGathered(seg_idx, run_end, run_end < segments.size());
+            seg_idx = run_end;
+        }
+
+        clearQueue();
+    }
+
+    template <NetIO::Transport T>
+    void BasicHttpWriter<T>::writeReply(const Response& res, bool keep_alive)
+    {
+        queueReply(res, keep_alive);
+        flush();
+    }
+
+    /* BasicHttpWriter instantiations */
+
+    template class BasicHttpWriter<NetIO::ClientSocket>;
+    template class BasicHttpWriter<NetIO::MemoryTransport>;
+}
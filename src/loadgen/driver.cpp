@@ -0,0 +1,559 @@
+/**
+ * @file driver.cpp
+ * @author DrkWithT
+ * @brief Implements the open and closed loop load drivers.
+ * @date 2024-09-05
+ */
+
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <netdb.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#include <ctime>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <stdexcept>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "netio/sockets.hpp"
+#include "loadgen/driver.hpp"
+#include "loadgen/replies.hpp"
+
+namespace ToyServer::LoadGen
+{
+    using Clock = std::chrono::steady_clock;
+
+    static constexpr std::uint64_t max_latency_ns = 3'600'000'000'000;
+    static constexpr int latency_digits = 3;
+    static constexpr int max_events = 256;
+
+    /**
+     * @brief Resolved server address, shared read-only by every worker.
+     */
+    struct PeerAddress
+    {
+        struct sockaddr_storage addr;
+        socklen_t addr_len;
+        int family;
+    };
+
+    static PeerAddress resolvePeer(const LoadConfig& config)
+    {
+        struct addrinfo hints {};
+        hints.ai_family = AF_UNSPEC;
+        hints.ai_socktype = SOCK_STREAM;
+
+        struct addrinfo* results = nullptr;
+
+        if (getaddrinfo(config.host.c_str(), config.port.c_str(), &hints, &results) != 0 || results == nullptr)
+            throw std::runtime_error {"IOErr: cannot resolve host."};
+
+        PeerAddress peer {};
+        std::memcpy(&peer.addr, results->ai_addr, results->ai_addrlen);
+        peer.addr_len = results->ai_addrlen;
+        peer.family = results->ai_family;
+
+        freeaddrinfo(results);
+
+        return peer;
+    }
+
+    /// @brief Waits with a nanosecond timeout where the kernel has `epoll_pwait2`, so open loop sends are not rounded to whole milliseconds.
+    static int waitEvents(int epoll_fd, struct epoll_event* events, Clock::duration timeout) noexcept
+    {
+        std::int64_t timeout_ns = std::max<std::int64_t>(0, std::chrono::duration_cast<std::chrono::nanoseconds>(timeout).count());
+        struct timespec wait_span {static_cast<time_t>(timeout_ns / 1'000'000'000), static_cast<long>(timeout_ns % 1'000'000'000)};
+
+        int ready_count = epoll_pwait2(epoll_fd, events, max_events, &wait_span, nullptr);
+
+        if (ready_count == -1 && errno == ENOSYS)
+            ready_count = epoll_wait(epoll_fd, events, max_events, static_cast<int>((timeout_ns + 999'999) / 1'000'000));
+
+        return std::max(ready_count, 0);
+    }
+
+    /**
+     * @brief One client connection of a worker.
+     */
+    struct PeerConnection
+    {
+        NetIO::ClientSocket socket;
+        ReplyParser parser;
+        std::deque<Clock::time_point> stamps; // per request in flight: when it was due (open loop) or sent (closed loop)
+        std::string outbox;                   // queued request octets
+        std::size_t out_offset;               // octets of outbox already sent
+        std::uint32_t generation;             // bumped per reconnect so events of a closed fd are ignored
+        bool connecting;
+    };
+
+    /**
+     * @brief Drives a share of the connections from one thread with an edge-triggered epoll loop.
+     */
+    class LoadWorker
+    {
+    private:
+        std::vector<PeerConnection> conns;
+        std::deque<Clock::time_point> backlog; // open loop requests due but not sent yet
+        LoadResult result;
+        std::string_view request_text;
+        const LoadConfig* config;
+        const PeerAddress* peer;
+        std::size_t depth;
+        std::size_t dispatch_cursor;
+        int epoll_fd;
+
+        [[nodiscard]] bool isOpenLoop() const noexcept { return config->mode == LoadMode::load_open; }
+
+        [[nodiscard]] bool canSend(const PeerConnection& conn) const noexcept { return !conn.connecting && conn.stamps.size() < depth; }
+
+        void openConnection(std::size_t conn_idx);
+        void retireConnection(std::size_t conn_idx);
+        void failConnection(std::size_t conn_idx);
+        [[nodiscard]] bool flushOutbox(PeerConnection& conn);
+        void topUp(std::size_t conn_idx);
+        void dispatchBacklog();
+        [[nodiscard]] bool completeReply(PeerConnection& conn);
+        [[nodiscard]] bool drainReplies(std::size_t conn_idx);
+        void readReplies(std::size_t conn_idx);
+        void handleEvent(std::size_t conn_idx, std::uint32_t events);
+
+    public:
+        LoadWorker(const LoadConfig& config_, const PeerAddress& peer_, std::string_view request_text_, std::size_t conn_count);
+
+        LoadWorker(const LoadWorker& other) = delete;
+        LoadWorker& operator=(const LoadWorker& other) = delete;
+
+        /// @param rate This worker's share of the open loop rate.
+        /// @param phase Fraction of a send interval to delay the first request by, so workers interleave instead of sending in step.
+        void run(Clock::time_point start, double rate, double phase);
+
+        [[nodiscard]] const LoadResult& getResult() const noexcept { return result; }
+
+        ~LoadWorker() noexcept;
+    };
+
+    /* LoadWorker private impl. */
+
+    void LoadWorker::openConnection(std::size_t conn_idx)
+    {
+        PeerConnection& conn = conns[conn_idx];
+
+        // closing the old descriptor also drops it from the epoll set
+        conn.socket = NetIO::ClientSocket {};
+        conn.parser.reset();
+        conn.stamps.clear();
+        conn.outbox.clear();
+        conn.out_offset = 0;
+        conn.generation++;
+        conn.connecting = true;
+
+        int fd = socket(peer->family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+
+        if (fd == -1)
+            throw std::runtime_error {"IOErr: cannot create socket."};
+
+        // a zero linger timeout resets on close, so runs without keep-alive do not pile up TIME_WAIT sockets
+        conn.socket = NetIO::ClientSocket {NetIO::SocketConfig {fd, 0, 0}};
+
+        int no_delay = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &no_delay, sizeof(no_delay));
+
+        if (connect(fd, reinterpret_cast<const struct sockaddr*>(&peer->addr), peer->addr_len) == -1 && errno != EINPROGRESS)
+            throw std::runtime_error {"IOErr: connect failed."};
+
+        struct epoll_event event {};
+        event.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+        event.data.u64 = (static_cast<std::uint64_t>(conn.generation) << 32) | conn_idx;
+
+        if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &event) == -1)
+            throw std::runtime_error {"IOErr: epoll_ctl failed to add fd."};
+    }
+
+    void LoadWorker::retireConnection(std::size_t conn_idx)
+    {
+        PeerConnection& conn = conns[conn_idx];
+
+        // unanswered open loop requests stay due from their original time, while a closed loop just sends anew
+        if (isOpenLoop())
+            backlog.insert(backlog.begin(), conn.stamps.begin(), conn.stamps.end());
+
+        openConnection(conn_idx);
+    }
+
+    void LoadWorker::failConnection(std::size_t conn_idx)
+    {
+        result.errors++;
+        retireConnection(conn_idx);
+    }
+
+    bool LoadWorker::flushOutbox(PeerConnection& conn)
+    {
+        while (conn.out_offset < conn.outbox.length())
+        {
+            auto [sent_count, send_status] = conn.socket.writeSome(conn.outbox.data() + conn.out_offset, conn.outbox.length() - conn.out_offset);
+
+            if (send_status == NetIO::IOStatus::io_again)
+                return true;
+
+            if (send_status == NetIO::IOStatus::io_closed)
+                return false;
+
+            conn.out_offset += sent_count;
+        }
+
+        conn.outbox.clear();
+        conn.out_offset = 0;
+
+        return true;
+    }
+
+    void LoadWorker::topUp(std::size_t conn_idx)
+    {
+        PeerConnection& conn = conns[conn_idx];
+        Clock::time_point now = Clock::now();
+
+        while (canSend(conn))
+        {
+            conn.outbox.append(request_text);
+            conn.stamps.push_back(now);
+        }
+
+        if (!flushOutbox(conn))
+            failConnection(conn_idx);
+    }
+
+    void LoadWorker::dispatchBacklog()
+    {
+        // round robin over connections with room, stopping once a whole lap finds none
+        for (std::size_t full_count = 0; !backlog.empty() && full_count < conns.size();)
+        {
+            PeerConnection& conn = conns[dispatch_cursor];
+            dispatch_cursor = (dispatch_cursor + 1) % conns.size();
+
+            if (!canSend(conn))
+            {
+                full_count++;
+                continue;
+            }
+
+            conn.outbox.append(request_text);
+            conn.stamps.push_back(backlog.front());
+            backlog.pop_front();
+            full_count = 0;
+        }
+
+        for (std::size_t conn_idx = 0; conn_idx < conns.size(); conn_idx++)
+        {
+            if (conns[conn_idx].out_offset < conns[conn_idx].outbox.length() && !flushOutbox(conns[conn_idx]))
+                failConnection(conn_idx);
+        }
+    }
+
+    bool LoadWorker::completeReply(PeerConnection& conn)
+    {
+        if (conn.stamps.empty())
+            throw std::runtime_error {"ParseErr: reply without a request."};
+
+        auto latency = Clock::now() - conn.stamps.front();
+        conn.stamps.pop_front();
+
+        result.latency.record(static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(latency).count()));
+        result.completed++;
+
+        if (int status_code = conn.parser.getStatusCode(); status_code < 200 || status_code > 299)
+            result.non_2xx++;
+
+        bool closing = conn.parser.isClosing() || !config->keep_alive;
+        conn.parser.reset();
+
+        return closing;
+    }
+
+    bool LoadWorker::drainReplies(std::size_t conn_idx)
+    {
+        PeerConnection& conn = conns[conn_idx];
+
+        while (true)
+        {
+            std::string_view pending = conn.socket.peekReadAhead();
+
+            if (pending.empty())
+                return true;
+
+            std::size_t used_count = conn.parser.feed(pending);
+            conn.socket.consumeReadAhead(used_count);
+            result.bytes_read += used_count;
+
+            if (conn.parser.isDone())
+            {
+                if (completeReply(conn))
+                {
+                    retireConnection(conn_idx);
+                    return false;
+                }
+
+                continue;
+            }
+
+            // only an unfinished head is left buffered, and it must fit the read-ahead ring
+            if (used_count < pending.length() && pending.length() >= conn.socket.getReadAheadCapacity())
+                throw std::runtime_error {"ParseErr: reply head too large."};
+
+            return true;
+        }
+    }
+
+    void LoadWorker::readReplies(std::size_t conn_idx)
+    {
+        PeerConnection& conn = conns[conn_idx];
+
+        while (true)
+        {
+            NetIO::IOStatus fill_status = conn.socket.fillReadAhead();
+
+            if (!drainReplies(conn_idx))
+                return;
+
+            if (fill_status == NetIO::IOStatus::io_again)
+                break;
+
+            if (fill_status == NetIO::IOStatus::io_closed)
+            {
+                if (conn.parser.finishOnClose())
+                {
+                    [[maybe_unused]] bool closing = completeReply(conn);
+                    retireConnection(conn_idx);
+                }
+                else if (conn.stamps.empty() && !conn.parser.isHeadDone())
+                    retireConnection(conn_idx); // idle keep-alive connection timed out by the server
+                else
+                    failConnection(conn_idx);
+
+                return;
+            }
+        }
+
+        if (!isOpenLoop())
+            topUp(conn_idx);
+    }
+
+    void LoadWorker::handleEvent(std::size_t conn_idx, std::uint32_t events)
+    {
+        PeerConnection& conn = conns[conn_idx];
+        std::uint32_t generation = conn.generation;
+
+        try
+        {
+            if (conn.connecting)
+            {
+                int connect_err = 0;
+                socklen_t err_len = sizeof(connect_err);
+
+                if ((events & (EPOLLOUT | EPOLLERR | EPOLLHUP)) == 0)
+                    return;
+
+                if (getsockopt(conn.socket.getFd(), SOL_SOCKET, SO_ERROR, &connect_err, &err_len) == -1 || connect_err != 0 || (events & (EPOLLERR | EPOLLHUP)) != 0)
+                {
+                    failConnection(conn_idx);
+                    return;
+                }
+
+                conn.connecting = false;
+                result.connects++;
+
+                if (!isOpenLoop())
+                    topUp(conn_idx);
+
+                return;
+            }
+
+            if ((events & EPOLLOUT) != 0 && !flushOutbox(conn))
+            {
+                failConnection(conn_idx);
+                return;
+            }
+
+            if ((events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR)) != 0)
+                readReplies(conn_idx);
+        }
+        catch (const std::runtime_error&)
+        {
+            // bad replies only cost their connection, but failing to reconnect ends the run
+            if (conn.generation != generation)
+                throw;
+
+            failConnection(conn_idx);
+        }
+    }
+
+    /* LoadWorker public impl. */
+
+    LoadWorker::LoadWorker(const LoadConfig& config_, const PeerAddress& peer_, std::string_view request_text_, std::size_t conn_count)
+    : conns {}, backlog {}, result {makeLatencyHistogram(), 0, 0, 0, 0, 0, 0, {}}, request_text {request_text_}, config {&config_}, peer {&peer_}, depth {(config_.keep_alive) ? config_.pipeline_depth : 1}, dispatch_cursor {0}, epoll_fd {epoll_create1(EPOLL_CLOEXEC)}
+    {
+        if (epoll_fd == -1)
+            throw std::runtime_error {"IOErr: epoll_create1 failed."};
+
+        conns.resize(conn_count);
+    }
+
+    void LoadWorker::run(Clock::time_point start, double rate, double phase)
+    {
+        Clock::time_point deadline = start + config->duration;
+        double interval_ns = (isOpenLoop()) ? 1e9 / rate : 0.0;
+        double due_count = phase; // requests scheduled so far
+        auto dueAt = [start, interval_ns, &due_count] { return start + std::chrono::nanoseconds {std::llround(due_count * interval_ns)}; };
+        std::array<struct epoll_event, max_events> events;
+
+        for (std::size_t conn_idx = 0; conn_idx < conns.size(); conn_idx++)
+            openConnection(conn_idx);
+
+        for (Clock::time_point now = Clock::now(); now < deadline; now = Clock::now())
+        {
+            Clock::time_point wake_at = deadline;
+
+            if (isOpenLoop())
+            {
+                for (Clock::time_point due = dueAt(); due <= now; due = dueAt())
+                {
+                    backlog.push_back(due);
+                    due_count += 1.0;
+                }
+
+                dispatchBacklog();
+                wake_at = std::min(dueAt(), deadline);
+            }
+
+            int ready_count = waitEvents(epoll_fd, events.data(), wake_at - now);
+
+            for (int event_idx = 0; event_idx < ready_count; event_idx++)
+            {
+                std::size_t conn_idx = static_cast<std::size_t>(events[event_idx].data.u64 & 0xffffffff);
+
+                if (conns[conn_idx].generation == static_cast<std::uint32_t>(events[event_idx].data.u64 >> 32))
+                    handleEvent(conn_idx, events[event_idx].events);
+            }
+
+            if (result.connects == 0 && result.errors >= conns.size())
+                throw std::runtime_error {"IOErr: server refused every connection."};
+        }
+
+        result.elapsed = Clock::now() - start;
+        result.unfinished = backlog.size();
+
+        for (const auto& conn : conns)
+            result.unfinished += conn.stamps.size();
+    }
+
+    LoadWorker::~LoadWorker() noexcept
+    {
+        close(epoll_fd);
+    }
+
+    /* LoadResult impl. */
+
+    void LoadResult::merge(const LoadResult& other)
+    {
+        latency.merge(other.latency);
+        completed += other.completed;
+        non_2xx += other.non_2xx;
+        errors += other.errors;
+        unfinished += other.unfinished;
+        connects += other.connects;
+        bytes_read += other.bytes_read;
+        elapsed = std::max(elapsed, other.elapsed);
+    }
+
+    /* Driver impl. */
+
+    HdrHistogram makeLatencyHistogram()
+    {
+        return HdrHistogram {max_latency_ns, latency_digits};
+    }
+
+    std::string makeRequestText(const LoadConfig& config)
+    {
+        std::string text {"GET "};
+
+        text.append(config.target).append(" HTTP/1.1\r\nHost: ").append(config.host);
+
+        if (config.port != "80")
+            text.append(":").append(config.port);
+
+        text.append("\r\nUser-Agent: toyload\r\n");
+
+        if (!config.keep_alive)
+            text.append("Connection: close\r\n");
+
+        text.append("\r\n");
+
+        return text;
+    }
+
+    LoadResult runLoad(const LoadConfig& config)
+    {
+        if (config.connections == 0 || config.threads == 0 || config.pipeline_depth == 0 || config.duration.count() <= 0)
+            throw std::invalid_argument {"runLoad: connections, threads, pipeline depth and duration must be positive."};
+
+        if (config.mode == LoadMode::load_open && !(config.rate > 0.0))
+            throw std::invalid_argument {"runLoad: open loop needs a positive rate."};
+
+        PeerAddress peer = resolvePeer(config);
+        std::string request_text = makeRequestText(config);
+        std::size_t thread_count = std::min(config.threads, config.connections);
+
+        std::vector<std::unique_ptr<LoadWorker>> workers;
+        std::vector<std::exception_ptr> failures(thread_count);
+        std::vector<std::thread> threads;
+
+        for (std::size_t worker_idx = 0; worker_idx < thread_count; worker_idx++)
+        {
+            std::size_t conn_count = config.connections / thread_count + ((worker_idx < config.connections % thread_count) ? 1 : 0);
+            workers.push_back(std::make_unique<LoadWorker>(config, peer, request_text, conn_count));
+        }
+
+        Clock::time_point start = Clock::now();
+        double worker_rate = config.rate / static_cast<double>(thread_count);
+
+        for (std::size_t worker_idx = 0; worker_idx < thread_count; worker_idx++)
+        {
+            threads.emplace_back([&workers, &failures, start, worker_rate, worker_idx, thread_count] {
+                try
+                {
+                    workers[worker_idx]->run(start, worker_rate, static_cast<double>(worker_idx) / static_cast<double>(thread_count));
+                }
+                catch (...)
+                {
+                    failures[worker_idx] = std::current_exception();
+                }
+            });
+        }
+
+        for (auto& thread : threads)
+            thread.join();
+
+        for (const auto& failure : failures)
+        {
+            if (failure)
+                std::rethrow_exception(failure);
+        }
+
+        LoadResult total {makeLatencyHistogram(), 0, 0, 0, 0, 0, 0, {}};
+
+        for (const auto& worker : workers)
+            total.merge(worker->getResult());
+
+        return total;
+    }
+}
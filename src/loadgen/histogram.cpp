@@ -0,0 +1,133 @@
+/**
+ * @file histogram.cpp
+ * @author DrkWithT
+ * @brief Implements the HDR latency histogram.
+ * @date 2024-09-05
+ */
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+#include "loadgen/histogram.hpp"
+
+namespace ToyServer::LoadGen
+{
+    /* HdrHistogram private impl. */
+
+    std::size_t HdrHistogram::indexOf(std::uint64_t value) const noexcept
+    {
+        // the power of two range holding `value`, where the first two ranges share the lowest bucket
+        int bucket_idx = 64 - std::countl_zero(value | sub_bucket_mask) - (sub_bucket_half_count_magnitude + 1);
+        std::int64_t sub_bucket_idx = static_cast<std::int64_t>(value >> bucket_idx);
+        std::int64_t bucket_base = static_cast<std::int64_t>(bucket_idx + 1) << sub_bucket_half_count_magnitude;
+
+        return static_cast<std::size_t>(bucket_base + sub_bucket_idx - sub_bucket_half_count);
+    }
+
+    std::uint64_t HdrHistogram::valueAt(std::size_t index) const noexcept
+    {
+        int bucket_idx = static_cast<int>(index >> sub_bucket_half_count_magnitude) - 1;
+        std::int64_t sub_bucket_idx = static_cast<std::int64_t>(index & static_cast<std::size_t>(sub_bucket_half_count - 1)) + sub_bucket_half_count;
+
+        if (bucket_idx < 0)
+        {
+            sub_bucket_idx -= sub_bucket_half_count;
+            bucket_idx = 0;
+        }
+
+        return static_cast<std::uint64_t>(sub_bucket_idx) << bucket_idx;
+    }
+
+    std::uint64_t HdrHistogram::highestEquivalent(std::uint64_t value) const noexcept
+    {
+        int bucket_idx = 64 - std::countl_zero(value | sub_bucket_mask) - (sub_bucket_half_count_magnitude + 1);
+        std::uint64_t lowest = (value >> bucket_idx) << bucket_idx;
+
+        return lowest + (std::uint64_t {1} << bucket_idx) - 1;
+    }
+
+    /* HdrHistogram public impl. */
+
+    HdrHistogram::HdrHistogram(std::uint64_t highest_trackable_, int significant_digits)
+    : counts {}, highest_trackable {highest_trackable_}, total_count {0}, max_value {0}, min_value {std::numeric_limits<std::uint64_t>::max()}, value_sum {0.0}, sub_bucket_half_count_magnitude {0}, sub_bucket_half_count {0}, sub_bucket_mask {0}
+    {
+        if (significant_digits < 1 || significant_digits > 5 || highest_trackable < 2)
+            throw std::invalid_argument {"HdrHistogram: bad precision or range."};
+
+        // the sub-buckets of one range must tell apart values 10^digits apart in their top digits
+        std::uint64_t largest_single_unit = 2 * static_cast<std::uint64_t>(std::pow(10, significant_digits));
+        int sub_bucket_count_magnitude = std::bit_width(largest_single_unit - 1);
+
+        sub_bucket_half_count_magnitude = sub_bucket_count_magnitude - 1;
+        sub_bucket_half_count = std::int64_t {1} << sub_bucket_half_count_magnitude;
+        sub_bucket_mask = (std::uint64_t {1} << sub_bucket_count_magnitude) - 1;
+
+        std::uint64_t smallest_untrackable = std::uint64_t {1} << sub_bucket_count_magnitude;
+        std::size_t bucket_count = 1;
+
+        while (smallest_untrackable <= highest_trackable && smallest_untrackable <= std::numeric_limits<std::uint64_t>::max() / 2)
+        {
+            smallest_untrackable <<= 1;
+            bucket_count++;
+        }
+
+        counts.resize((bucket_count + 1) * static_cast<std::size_t>(sub_bucket_half_count));
+    }
+
+    void HdrHistogram::record(std::uint64_t value) noexcept
+    {
+        value = std::min(value, highest_trackable);
+
+        counts[indexOf(value)]++;
+        total_count++;
+        max_value = std::max(max_value, value);
+        min_value = std::min(min_value, value);
+        value_sum += static_cast<double>(value);
+    }
+
+    void HdrHistogram::merge(const HdrHistogram& other)
+    {
+        if (other.counts.size() != counts.size() || other.sub_bucket_half_count != sub_bucket_half_count)
+            throw std::invalid_argument {"HdrHistogram::merge: bounds differ."};
+
+        for (std::size_t count_idx = 0; count_idx < counts.size(); count_idx++)
+            counts[count_idx] += other.counts[count_idx];
+
+        total_count += other.total_count;
+        max_value = std::max(max_value, other.max_value);
+        min_value = std::min(min_value, other.min_value);
+        value_sum += other.value_sum;
+    }
+
+    void HdrHistogram::reset() noexcept
+    {
+        std::fill(counts.begin(), counts.end(), 0);
+        total_count = 0;
+        max_value = 0;
+        min_value = std::numeric_limits<std::uint64_t>::max();
+        value_sum = 0.0;
+    }
+
+    std::uint64_t HdrHistogram::getValueAtPercentile(double percentile) const noexcept
+    {
+        if (total_count == 0)
+            return 0;
+
+        double wanted = std::clamp(percentile, 0.0, 100.0) / 100.0 * static_cast<double>(total_count);
+        std::uint64_t target_count = std::max<std::uint64_t>(1, static_cast<std::uint64_t>(std::ceil(wanted)));
+        std::uint64_t running_count = 0;
+
+        for (std::size_t count_idx = 0; count_idx < counts.size(); count_idx++)
+        {
+            running_count += counts[count_idx];
+
+            // a bucket's upper edge may pass the exact maximum, which is known
+            if (running_count >= target_count)
+                return std::min(highestEquivalent(valueAt(count_idx)), max_value);
+        }
+
+        return max_value;
+    }
+}
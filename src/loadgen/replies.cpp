@@ -0,0 +1,188 @@
+/**
+ * @file replies.cpp
+ * @author DrkWithT
+ * @brief Implements reply framing for the load generator.
+ * @date 2024-09-05
+ */
+
+#include <algorithm>
+#include <charconv>
+#include <stdexcept>
+#include "http1/fields.hpp"
+#include "http1/messages.hpp"
+#include "http1/parser.hpp"
+#include "loadgen/replies.hpp"
+
+namespace ToyServer::LoadGen
+{
+    static constexpr std::string_view head_end_mark = "\r\n\r\n";
+    static constexpr std::string_view http_1_0_name = "HTTP/1.0";
+    static constexpr std::string_view http_version_prefix = "HTTP/1.";
+    static constexpr std::string_view http_chunked_coding = "chunked";
+    static constexpr std::string_view http_close_token = "close";
+    static constexpr std::string_view http_keep_alive_token = "keep-alive";
+
+    static constexpr std::string_view trimSpacing(std::string_view text) noexcept
+    {
+        while (!text.empty() && Http1::matchSpacing(text.front()))
+            text.remove_prefix(1);
+
+        while (!text.empty() && Http1::matchSpacing(text.back()))
+            text.remove_suffix(1);
+
+        return text;
+    }
+
+    /* ReplyParser private impl. */
+
+    std::size_t ReplyParser::parseHead(std::string_view input)
+    {
+        std::size_t end_pos = input.find(head_end_mark);
+
+        if (end_pos == std::string_view::npos)
+            return 0;
+
+        std::string_view head = input.substr(0, end_pos + 2);
+        std::size_t line_end = head.find("\r\n");
+        std::string_view status_line = head.substr(0, line_end);
+
+        // "HTTP/1.x SSS reason"
+        if (status_line.length() < 12 || !status_line.starts_with(http_version_prefix) || status_line[8] != ' ')
+            throw std::runtime_error {"ParseErr: bad status line."};
+
+        auto [code_end, code_err] = std::from_chars(status_line.data() + 9, status_line.data() + 12, status_code);
+
+        if (code_err != std::errc {} || code_end != status_line.data() + 12 || status_code < 100)
+            throw std::runtime_error {"ParseErr: bad status code."};
+
+        bool has_length = false;
+        bool chunked = false;
+        closing = status_line.starts_with(http_1_0_name);
+
+        for (std::size_t line_start = line_end + 2; line_start < head.length(); line_start = line_end + 2)
+        {
+            line_end = head.find("\r\n", line_start);
+
+            std::string_view line = head.substr(line_start, line_end - line_start);
+            std::size_t colon_pos = line.find(':');
+
+            if (colon_pos == std::string_view::npos)
+                throw std::runtime_error {"ParseErr: bad header line."};
+
+            std::string_view value = trimSpacing(line.substr(colon_pos + 1));
+
+            switch (Http1::lookupField(line.substr(0, colon_pos)))
+            {
+            case Http1::FieldId::f_content_length:
+            {
+                auto [len_end, len_err] = std::from_chars(value.data(), value.data() + value.length(), body_left);
+
+                if (len_err != std::errc {} || len_end != value.data() + value.length())
+                    throw std::runtime_error {"ParseErr: invalid Content-Length."};
+
+                has_length = true;
+                break;
+            }
+            case Http1::FieldId::f_transfer_encoding:
+                chunked = Http1::equalsNoCase(value, http_chunked_coding);
+                break;
+            case Http1::FieldId::f_connection:
+                if (Http1::equalsNoCase(value, http_close_token))
+                    closing = true;
+                else if (Http1::equalsNoCase(value, http_keep_alive_token))
+                    closing = false;
+                break;
+            default:
+                break;
+            }
+        }
+
+        // informational, 204 and 304 replies never carry a body
+        if (status_code < 200 || status_code == 204 || status_code == 304)
+            step = Step::step_done;
+        else if (chunked)
+            step = Step::step_chunked;
+        else if (has_length)
+            step = (body_left > 0) ? Step::step_sized : Step::step_done;
+        else
+        {
+            step = Step::step_until_close;
+            closing = true;
+        }
+
+        return end_pos + head_end_mark.length();
+    }
+
+    /* ReplyParser public impl. */
+
+    ReplyParser::ReplyParser() noexcept
+    : decoder {}, body_left {0}, status_code {0}, step {Step::step_head}, closing {false} {}
+
+    void ReplyParser::reset() noexcept
+    {
+        decoder.reset();
+        body_left = 0;
+        status_code = 0;
+        step = Step::step_head;
+        closing = false;
+    }
+
+    std::size_t ReplyParser::feed(std::string_view input)
+    {
+        std::size_t used_count = 0;
+
+        if (step == Step::step_head)
+        {
+            used_count = parseHead(input);
+
+            if (used_count == 0)
+                return 0;
+
+            input.remove_prefix(used_count);
+        }
+
+        switch (step)
+        {
+        case Step::step_sized:
+        {
+            std::size_t take_count = std::min(body_left, input.length());
+            body_left -= take_count;
+            used_count += take_count;
+
+            if (body_left == 0)
+                step = Step::step_done;
+
+            break;
+        }
+        case Step::step_chunked:
+            while (!input.empty() && !decoder.isDone())
+            {
+                std::size_t step_count = decoder.decode(input).consumed;
+                input.remove_prefix(step_count);
+                used_count += step_count;
+            }
+
+            if (decoder.isDone())
+                step = Step::step_done;
+
+            break;
+        case Step::step_until_close:
+            used_count += input.length();
+            break;
+        default:
+            break;
+        }
+
+        return used_count;
+    }
+
+    bool ReplyParser::finishOnClose() noexcept
+    {
+        if (step != Step::step_until_close)
+            return false;
+
+        step = Step::step_done;
+
+        return true;
+    }
+}
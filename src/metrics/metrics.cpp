@@ -0,0 +1,126 @@
+/**
+ * @file metrics.cpp
+ * @author DrkWithT
+ * @brief Implements the per-thread metrics registry and scrape-time aggregation.
+ * @date 2024-09-06
+ */
+
+#include <new>
+#include "metrics/metrics.hpp"
+
+namespace ToyServer::Metrics
+{
+    /// @brief Every block ever handed out, newest first. Blocks are never freed, so a scrape can walk the list while threads come and go.
+    static std::atomic<ThreadMetrics*> registry_head {nullptr};
+
+    /// @brief Shared by threads that could not get a block of their own. Concurrent writers may lose updates there, but never corrupt one.
+    static ThreadMetrics spare_block {};
+
+    void releaseThreadMetrics(ThreadMetrics& block) noexcept
+    {
+        block.claimed.store(false, std::memory_order_release);
+    }
+
+    /**
+     * @brief Gives the calling thread's block back once the thread exits.
+     */
+    class ThreadMetricsGuard
+    {
+    private:
+        ThreadMetrics* block;
+
+    public:
+        explicit ThreadMetricsGuard(ThreadMetrics* block_) noexcept
+        : block {block_} {}
+
+        ThreadMetricsGuard(const ThreadMetricsGuard& other) = delete;
+        ThreadMetricsGuard& operator=(const ThreadMetricsGuard& other) = delete;
+
+        ~ThreadMetricsGuard() noexcept
+        {
+            local_metrics = nullptr;
+
+            if (block != &spare_block)
+                releaseThreadMetrics(*block);
+        }
+    };
+
+    /* ThreadMetrics impl. */
+
+    ThreadMetrics::ThreadMetrics() noexcept
+    : counters {}, requests {}, timers {}, next {nullptr}, claimed {false} {}
+
+    void ThreadMetrics::sumInto(MetricsSnapshot& totals) const noexcept
+    {
+        for (std::size_t counter_idx = 0; counter_idx < counter_count; counter_idx++)
+            totals.counters[counter_idx] += counters[counter_idx].load(std::memory_order_relaxed);
+
+        for (std::size_t request_idx = 0; request_idx < requests.size(); request_idx++)
+            totals.requests[request_idx] += requests[request_idx].load(std::memory_order_relaxed);
+
+        for (std::size_t timer_idx = 0; timer_idx < timer_count; timer_idx++)
+        {
+            TimerTotals& timer_totals = totals.timers[timer_idx];
+
+            for (std::size_t bucket_idx = 0; bucket_idx < bucket_count; bucket_idx++)
+            {
+                std::uint64_t bucket_value = timers[timer_idx].buckets[bucket_idx].load(std::memory_order_relaxed);
+                timer_totals.buckets[bucket_idx] += bucket_value;
+                timer_totals.count += bucket_value;
+            }
+
+            timer_totals.sum_ns += timers[timer_idx].sum_ns.load(std::memory_order_relaxed);
+        }
+    }
+
+    /* Registry impl. */
+
+    ThreadMetrics& claimThreadMetrics() noexcept
+    {
+        ThreadMetrics* block = nullptr;
+
+        // reuse a block of a finished thread first, keeping its counts so totals never go backwards
+        for (ThreadMetrics* candidate = registry_head.load(std::memory_order_acquire); candidate != nullptr && block == nullptr; candidate = candidate->next)
+        {
+            bool expected = false;
+
+            if (candidate->claimed.compare_exchange_strong(expected, true, std::memory_order_acquire))
+                block = candidate;
+        }
+
+        if (block == nullptr)
+        {
+            block = new (std::nothrow) ThreadMetrics {};
+
+            if (block == nullptr)
+                block = &spare_block;
+            else
+            {
+                block->claimed.store(true, std::memory_order_relaxed);
+                block->next = registry_head.load(std::memory_order_relaxed);
+
+                while (!registry_head.compare_exchange_weak(block->next, block, std::memory_order_release, std::memory_order_relaxed)) {}
+            }
+        }
+
+        thread_local ThreadMetricsGuard guard {block};
+        local_metrics = block;
+
+        return *block;
+    }
+
+    MetricsSnapshot collectMetrics() noexcept
+    {
+        MetricsSnapshot totals {};
+
+        spare_block.sumInto(totals);
+
+        for (const ThreadMetrics* block = registry_head.load(std::memory_order_acquire); block != nullptr; block = block->next)
+        {
+            block->sumInto(totals);
+            totals.block_count++;
+        }
+
+        return totals;
+    }
+}
@@ -0,0 +1,137 @@
+/**
+ * @file prometheus.cpp
+ * @author DrkWithT
+ * @brief Implements the Prometheus text exposition of metric snapshots.
+ * @date 2024-09-06
+ */
+
+#include <charconv>
+#include <string_view>
+#include "metrics/metrics.hpp"
+
+namespace ToyServer::Metrics
+{
+    static constexpr std::array<std::string_view, method_count> method_labels {
+        "HEAD",
+        "GET",
+        "unknown"
+    };
+
+    static constexpr std::array<std::string_view, status_count> status_labels {
+        "200",
+        "204",
+        "304",
+        "400",
+        "404",
+        "415",
+        "500",
+        "501",
+        "unknown"
+    };
+
+    /**
+     * @brief Name and help text of a latency histogram, in the order of `Timer`.
+     */
+    struct TimerInfo
+    {
+        std::string_view name;
+        std::string_view help;
+    };
+
+    static constexpr std::array<TimerInfo, timer_count> timer_infos {{
+        {"toyserver_request_parse_seconds", "Time to read and parse one request head."},
+        {"toyserver_handler_seconds", "Time the request handler took to produce one reply."},
+        {"toyserver_write_seconds", "Time of one reply serialize or flush call."}
+    }};
+
+    static void appendNumber(std::string& out, std::uint64_t value)
+    {
+        std::array<char, 24> digits;
+        auto [digits_end, digits_err] = std::to_chars(digits.data(), digits.data() + digits.size(), value);
+
+        out.append(digits.data(), digits_end);
+    }
+
+    /// @brief Appends nanoseconds as seconds, in the shortest form that reads back exactly.
+    static void appendSeconds(std::string& out, double nanos)
+    {
+        std::array<char, 32> digits;
+        auto [digits_end, digits_err] = std::to_chars(digits.data(), digits.data() + digits.size(), nanos / 1e9);
+
+        out.append(digits.data(), digits_end);
+    }
+
+    static void appendHeader(std::string& out, std::string_view name, std::string_view type, std::string_view help)
+    {
+        out.append("# HELP ").append(name).append(" ").append(help).append("\n");
+        out.append("# TYPE ").append(name).append(" ").append(type).append("\n");
+    }
+
+    static void appendScalar(std::string& out, std::string_view name, std::string_view type, std::string_view help, std::uint64_t value)
+    {
+        appendHeader(out, name, type, help);
+        out.append(name).append(" ");
+        appendNumber(out, value);
+        out.append("\n");
+    }
+
+    static void appendHistogram(std::string& out, const TimerInfo& info, const TimerTotals& totals)
+    {
+        std::uint64_t running_count = 0;
+
+        appendHeader(out, info.name, "histogram", info.help);
+
+        for (std::size_t bucket_idx = 0; bucket_idx + 1 < bucket_count; bucket_idx++)
+        {
+            running_count += totals.buckets[bucket_idx];
+
+            out.append(info.name).append("_bucket{le=\"");
+            appendSeconds(out, static_cast<double>(bucketBound(bucket_idx)));
+            out.append("\"} ");
+            appendNumber(out, running_count);
+            out.append("\n");
+        }
+
+        out.append(info.name).append("_bucket{le=\"+Inf\"} ");
+        appendNumber(out, totals.count);
+        out.append("\n").append(info.name).append("_sum ");
+        appendSeconds(out, static_cast<double>(totals.sum_ns));
+        out.append("\n").append(info.name).append("_count ");
+        appendNumber(out, totals.count);
+        out.append("\n");
+    }
+
+    void writePrometheus(const MetricsSnapshot& snapshot, std::string& out)
+    {
+        // opens and closes of one connection may land on different threads, so only their difference is meaningful
+        std::uint64_t opened_count = snapshot.get(Counter::c_conns_opened);
+        std::uint64_t closed_count = snapshot.get(Counter::c_conns_closed);
+
+        appendScalar(out, "toyserver_accepts_total", "counter", "Connections accepted.", snapshot.get(Counter::c_accepts));
+        appendScalar(out, "toyserver_connections_active", "gauge", "Client connections currently open.", (opened_count > closed_count) ? opened_count - closed_count : 0);
+
+        // series appear once they have a count, as label sets usually do
+        appendHeader(out, "toyserver_requests_total", "counter", "Replies sent, by request method and reply status.");
+
+        for (std::size_t method_idx = 0; method_idx < method_count; method_idx++)
+        {
+            for (std::size_t status_idx = 0; status_idx < status_count; status_idx++)
+            {
+                std::uint64_t request_count = snapshot.requests[method_idx * status_count + status_idx];
+
+                if (request_count == 0)
+                    continue;
+
+                out.append("toyserver_requests_total{method=\"").append(method_labels[method_idx]).append("\",status=\"").append(status_labels[status_idx]).append("\"} ");
+                appendNumber(out, request_count);
+                out.append("\n");
+            }
+        }
+
+        appendScalar(out, "toyserver_received_bytes_total", "counter", "Octets read from client connections.", snapshot.get(Counter::c_bytes_in));
+        appendScalar(out, "toyserver_sent_bytes_total", "counter", "Octets written to client connections.", snapshot.get(Counter::c_bytes_out));
+
+        for (std::size_t timer_idx = 0; timer_idx < timer_count; timer_idx++)
+            appendHistogram(out, timer_infos[timer_idx], snapshot.timers[timer_idx]);
+    }
+}
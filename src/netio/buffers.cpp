@@ -9,6 +9,7 @@
  * 
  */
 
+#include <cstring>
 #include <stdexcept>
 #include "netio/buffers.hpp"
 
@@ -16,7 +17,7 @@ namespace ToyServer::NetIO
 {
     char& FixedBuffer::getAt(std::size_t pos)
     {
-        if (pos < 0 || pos >= getCapacity())
+        if (pos >= getCapacity())
             throw std::invalid_argument {"FixedBuffer: Invalid index OOB."};
 
         return getBasePtr()[pos];
@@ -61,4 +62,110 @@ namespace ToyServer::NetIO
 
         return true;
     }
+
+    // RingBuffer impl.
+
+    static std::size_t roundUpPowerOfTwo(std::size_t n) noexcept
+    {
+        std::size_t result = 1;
+
+        while (result < n)
+            result <<= 1;
+
+        return result;
+    }
+
+    RingBuffer::RingBuffer(std::size_t capacity_)
+    : block {}, capacity {roundUpPowerOfTwo(capacity_)}, head {0}, tail {0} {}
+
+    std::pair<std::span<char>, std::span<char>> RingBuffer::getFreeSpans()
+    {
+        if (!block)
+            block = PooledBlock {capacity};
+        std::size_t space = getSpace();
+        std::size_t write_pos = tail & (capacity - 1);
+        std::size_t first_len = std::min(space, capacity - write_pos);
+
+        return {
+            std::span<char> {block.get() + write_pos, first_len},
+            std::span<char> {block.get(), space - first_len}
+        };
+    }
+
+    std::pair<std::span<const char>, std::span<const char>> RingBuffer::getDataSpans() const noexcept
+    {
+        std::size_t size = getSize();
+        std::size_t read_pos = head & (capacity - 1);
+        std::size_t first_len = std::min(size, capacity - read_pos);
+
+        return {
+            std::span<const char> {block.get() + read_pos, first_len},
+            std::span<const char> {block.get(), size - first_len}
+        };
+    }
+
+    std::span<const char> RingBuffer::linearize() noexcept
+    {
+        auto [first, second] = getDataSpans();
+
+        if (second.empty())
+            return first;
+
+        std::size_t size = getSize();
+        std::size_t read_pos = head & (capacity - 1);
+
+        std::rotate(block.get(), block.get() + read_pos, block.get() + capacity);
+        head = 0;
+        tail = size;
+
+        return {block.get(), size};
+    }
+
+    void RingBuffer::commitWrite(std::size_t count) noexcept
+    {
+        tail += std::min(count, getSpace());
+    }
+
+    std::optional<std::size_t> RingBuffer::findOctet(char delim) const noexcept
+    {
+        auto [first, second] = getDataSpans();
+
+        // memchr is vectorized by libc, much faster than a plain loop here
+        if (const void* found = std::memchr(first.data(), delim, first.size()); found != nullptr)
+            return static_cast<std::size_t>(static_cast<const char*>(found) - first.data());
+
+        if (const void* found = std::memchr(second.data(), delim, second.size()); found != nullptr)
+            return first.size() + static_cast<std::size_t>(static_cast<const char*>(found) - second.data());
+
+        return {};
+    }
+
+    std::size_t RingBuffer::copyOut(char* dst, std::size_t len) noexcept
+    {
+        auto [first, second] = getDataSpans();
+        std::size_t first_count = std::min(len, first.size());
+        std::size_t second_count = std::min(len - first_count, second.size());
+
+        std::copy(first.begin(), first.begin() + first_count, dst);
+        std::copy(second.begin(), second.begin() + second_count, dst + first_count);
+
+        discard(first_count + second_count);
+
+        return first_count + second_count;
+    }
+
+    void RingBuffer::discard(std::size_t count) noexcept
+    {
+        head += std::min(count, getSize());
+
+        // rewinding an empty ring keeps the next fill contiguous
+        if (head == tail)
+            clear();
+    }
+
+    void RingBuffer::clear() noexcept
+    {
+        head = 0;
+        tail = 0;
+    }
 }
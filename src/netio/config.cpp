@@ -36,7 +36,7 @@ namespace ToyServer::NetIO
 
     AddrInfo::AddrInfo(const SocketHints& hints)
     {
-        auto [port_sv, backlog, timeout] = hints;
+        auto [port_sv, backlog, timeout, reuse_port] = hints;
 
         struct addrinfo pre_hints;
         std::memset(&pre_hints, 0, sizeof(pre_hints));
@@ -51,6 +51,7 @@ namespace ToyServer::NetIO
 
         so_backlog = backlog;
         so_timeout = timeout;
+        so_reuse_port = reuse_port;
         this->opt_cursor = opt_head;
     }
 
@@ -66,8 +67,18 @@ namespace ToyServer::NetIO
         int protocol = temp->ai_protocol;
         int sockfd = socket(family, socktype, protocol);
         int timeout = so_timeout;
+        int reuse_flag = 1;
 
-        if (bind(sockfd, temp->ai_addr, temp->ai_addrlen) == -1)
+        // allow quick restarts while old connections sit in TIME_WAIT
+        setsockopt(sockfd, SOL_SOCKET, SO_REUSEADDR, &reuse_flag, sizeof(reuse_flag));
+
+        if (so_reuse_port && setsockopt(sockfd, SOL_SOCKET, SO_REUSEPORT, &reuse_flag, sizeof(reuse_flag)) == -1)
+        {
+            close(sockfd);
+            sockfd = -1;
+        }
+
+        if (sockfd != -1 && bind(sockfd, temp->ai_addr, temp->ai_addrlen) == -1)
         {
             close(sockfd);
             sockfd = -1;
@@ -75,7 +86,7 @@ namespace ToyServer::NetIO
 
         advanceCursor();
 
-        return std::optional {SocketConfig {sockfd, .socket_backlog=so_backlog, timeout}};
+        return std::optional {SocketConfig {sockfd, so_backlog, timeout}};
     }
 
     AddrInfo::~AddrInfo() noexcept
@@ -0,0 +1,178 @@
+/**
+ * @file files.cpp
+ * @author DrkWithT
+ * @brief Implements read-only file handles for zero-copy file replies.
+ * @date 2024-08-27
+ */
+
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <linux/openat2.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <climits>
+#include <cerrno>
+#include <cstring>
+#include <array>
+#include <atomic>
+#include <utility>
+#include "netio/files.hpp"
+
+namespace ToyServer::NetIO
+{
+    // FileHandle private impl.
+
+    void FileHandle::closeFd() noexcept
+    {
+        if (fd == file_fd_placeholder)
+            return;
+
+        close(fd);
+        fd = file_fd_placeholder;
+    }
+
+    void FileHandle::swapState(FileHandle&& other) noexcept
+    {
+        int temp_fd = file_fd_placeholder;
+        std::swap(temp_fd, other.fd);
+        fd = temp_fd;
+    }
+
+    // FileHandle public impl.
+
+    FileHandle::FileHandle(FileHandle&& other) noexcept
+    : fd {file_fd_placeholder}
+    {
+        swapState(std::move(other));
+    }
+
+    FileHandle& FileHandle::operator=(FileHandle&& other) noexcept
+    {
+        if (&other == this)
+            return *this;
+
+        closeFd();
+        swapState(std::move(other));
+
+        return *this;
+    }
+
+    bool FileHandle::getStats(FileStats& stats) const noexcept
+    {
+        struct stat file_info {};
+
+        if (fstat(fd, &file_info) != 0)
+            return false;
+
+        stats.size = static_cast<std::size_t>(file_info.st_size);
+        stats.modified = file_info.st_mtime;
+        stats.is_regular = S_ISREG(file_info.st_mode);
+        stats.is_directory = S_ISDIR(file_info.st_mode);
+
+        return true;
+    }
+
+    bool FileHandle::readAt(char* dst, std::size_t count, std::size_t offset) const noexcept
+    {
+        std::size_t read_total = 0;
+
+        while (read_total < count)
+        {
+            ssize_t read_count = pread(fd, dst + read_total, count - read_total, static_cast<off_t>(offset + read_total));
+
+            if (read_count == -1 && errno == EINTR)
+                continue;
+
+            if (read_count <= 0)
+                return false;
+
+            read_total += static_cast<std::size_t>(read_count);
+        }
+
+        return true;
+    }
+
+    void FileHandle::adviseSequential() const noexcept
+    {
+        [[maybe_unused]] int advise_rc = posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+    }
+
+    FileHandle::~FileHandle() noexcept
+    {
+        closeFd();
+    }
+
+    // Utility impl.
+
+    static std::atomic<bool> openat2_missing {false};
+
+    /// @brief Fallback for kernels before 5.6: walks the path one directory at a time, refusing symlinks at every step.
+    static int openNoFollow(int dir_fd, const char* relative_path) noexcept
+    {
+        std::array<char, PATH_MAX> segments;
+        std::size_t path_len = std::strlen(relative_path);
+
+        if (path_len >= segments.size())
+        {
+            errno = ENAMETOOLONG;
+            return -1;
+        }
+
+        std::memcpy(segments.data(), relative_path, path_len + 1);
+
+        char* segment = segments.data();
+        int parent_fd = dir_fd;
+        int file_fd = -1;
+
+        while (true)
+        {
+            char* slash = std::strchr(segment, '/');
+            bool is_last = slash == nullptr;
+            int flags = O_CLOEXEC | O_NOFOLLOW | ((is_last) ? (O_RDONLY | O_NOCTTY) : (O_PATH | O_DIRECTORY));
+
+            if (!is_last)
+                *slash = '\0';
+
+            do
+            {
+                file_fd = openat(parent_fd, segment, flags);
+            }
+            while (file_fd == -1 && errno == EINTR);
+
+            if (parent_fd != dir_fd)
+                close(parent_fd);
+
+            if (file_fd == -1 || is_last)
+                return file_fd;
+
+            parent_fd = file_fd;
+            segment = slash + 1;
+        }
+    }
+
+    FileHandle openFileAt(int dir_fd, const char* relative_path) noexcept
+    {
+        int file_fd = -1;
+
+        if (!openat2_missing.load(std::memory_order_relaxed))
+        {
+            // symlinks are followed only while they stay beneath dir_fd, and /proc magic links never are
+            struct open_how how {};
+            how.flags = O_RDONLY | O_CLOEXEC | O_NOCTTY;
+            how.resolve = RESOLVE_BENEATH | RESOLVE_NO_MAGICLINKS;
+
+            do
+            {
+                file_fd = static_cast<int>(syscall(SYS_openat2, dir_fd, relative_path, &how, sizeof(how)));
+            }
+            while (file_fd == -1 && (errno == EINTR || errno == EAGAIN));
+
+            if (file_fd != -1 || errno != ENOSYS)
+                return FileHandle {file_fd};
+
+            openat2_missing.store(true, std::memory_order_relaxed);
+        }
+
+        return FileHandle {openNoFollow(dir_fd, relative_path)};
+    }
+}
@@ -0,0 +1,158 @@
+/**
+ * @file pools.cpp
+ * @author DrkWithT
+ * @brief Implements the size classed buffer pool.
+ * @date 2024-08-29
+ */
+
+#include <algorithm>
+#include <new>
+#include "netio/pools.hpp"
+
+namespace ToyServer::NetIO
+{
+    /**
+     * @brief A thread's own free slabs per class, handed back to the pool when the thread exits.
+     */
+    struct LocalCache
+    {
+        std::array<std::array<char*, BufferPool::local_cache_limit>, BufferPool::class_count> slabs;
+        std::array<std::size_t, BufferPool::class_count> counts {};
+
+        ~LocalCache() noexcept
+        {
+            BufferPool& pool = BufferPool::getInstance();
+
+            for (std::size_t class_idx = 0; class_idx < BufferPool::class_count; class_idx++)
+                pool.returnShared(class_idx, slabs[class_idx].data(), counts[class_idx]);
+        }
+    };
+
+    static thread_local LocalCache local_cache;
+
+    /* BufferPool private impl. */
+
+    BufferPool::BufferPool() noexcept
+    : shared_lists {}, arena_lock {}, arenas {}, arena_cursor {nullptr}, arena_left {0}, carved_count {0}, large_count {0} {}
+
+    char* BufferPool::carveSlab(std::size_t class_idx)
+    {
+        std::size_t class_size = getClassSize(class_idx);
+        std::lock_guard guard {arena_lock};
+
+        // the rest of a used up arena is simply left behind, at most one slab's worth
+        if (arena_left < class_size)
+        {
+            arenas.reserve(arenas.size() + 1);
+            arena_cursor = static_cast<char*>(::operator new(arena_size, std::align_val_t {slab_alignment}));
+            arena_left = arena_size;
+            arenas.push_back(arena_cursor);
+        }
+
+        char* slab = arena_cursor;
+        arena_cursor += class_size;
+        arena_left -= class_size;
+        carved_count.fetch_add(1, std::memory_order_relaxed);
+
+        return slab;
+    }
+
+    /* BufferPool public impl. */
+
+    BufferPool& BufferPool::getInstance()
+    {
+        static BufferPool pool;
+
+        return pool;
+    }
+
+    char* BufferPool::acquire(std::size_t size)
+    {
+        if (size > max_slab_size)
+        {
+            large_count.fetch_add(1, std::memory_order_relaxed);
+            return static_cast<char*>(::operator new(size, std::align_val_t {slab_alignment}));
+        }
+
+        std::size_t class_idx = pickClass(size);
+        std::size_t& count = local_cache.counts[class_idx];
+
+        if (count == 0)
+            count = takeShared(class_idx, local_cache.slabs[class_idx].data(), local_cache_limit / 2);
+
+        if (count > 0)
+            return local_cache.slabs[class_idx][--count];
+
+        return carveSlab(class_idx);
+    }
+
+    void BufferPool::release(char* block, std::size_t size) noexcept
+    {
+        if (size > max_slab_size)
+        {
+            ::operator delete(block, std::align_val_t {slab_alignment});
+            return;
+        }
+
+        std::size_t class_idx = pickClass(size);
+        std::size_t& count = local_cache.counts[class_idx];
+
+        // a full list spills its older half, so a thread that only frees (e.g. a writer fed by others) cannot hoard slabs
+        if (count == local_cache_limit)
+        {
+            returnShared(class_idx, local_cache.slabs[class_idx].data(), local_cache_limit / 2);
+            std::copy(local_cache.slabs[class_idx].begin() + local_cache_limit / 2, local_cache.slabs[class_idx].end(), local_cache.slabs[class_idx].begin());
+            count -= local_cache_limit / 2;
+        }
+
+        local_cache.slabs[class_idx][count++] = block;
+    }
+
+    void BufferPool::returnShared(std::size_t class_idx, char* const* slabs, std::size_t count) noexcept
+    {
+        if (count == 0)
+            return;
+
+        SharedList& list = shared_lists[class_idx];
+        std::lock_guard guard {list.lock};
+
+        try
+        {
+            list.slabs.insert(list.slabs.end(), slabs, slabs + count);
+        }
+        catch (const std::bad_alloc&)
+        {
+            // out of memory for the list itself: these slabs are lost, which beats failing a free
+        }
+    }
+
+    std::size_t BufferPool::takeShared(std::size_t class_idx, char** slabs, std::size_t max_count) noexcept
+    {
+        SharedList& list = shared_lists[class_idx];
+        std::lock_guard guard {list.lock};
+        std::size_t take_count = std::min(max_count, list.slabs.size());
+
+        std::copy(list.slabs.end() - take_count, list.slabs.end(), slabs);
+        list.slabs.resize(list.slabs.size() - take_count);
+
+        return take_count;
+    }
+
+    PoolStats BufferPool::getStats() noexcept
+    {
+        std::lock_guard guard {arena_lock};
+
+        return {arenas.size(), carved_count.load(std::memory_order_relaxed), large_count.load(std::memory_order_relaxed)};
+    }
+
+    BufferPool::~BufferPool() noexcept
+    {
+        for (char* arena : arenas)
+            ::operator delete(arena, std::align_val_t {slab_alignment});
+    }
+
+    /* RequestArena impl. */
+
+    RequestArena::RequestArena()
+    : initial {initial_size}, resource {initial.get(), initial_size, std::pmr::new_delete_resource()} {}
+}
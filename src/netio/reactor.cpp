@@ -0,0 +1,294 @@
+/**
+ * @file reactor.cpp
+ * @author DrkWithT
+ * @brief Implements the epoll event loop and its per-connection state.
+ * @date 2024-08-10
+ */
+
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <array>
+#include <utility>
+#include <stdexcept>
+#include "netio/reactor.hpp"
+
+namespace ToyServer::NetIO
+{
+    // Connection public impl.
+
+    Connection::Connection(SocketConfig config)
+    : socket {config}, inbox {}, outbox {}, out_offset {0}, state {ConnState::conn_reading}, peer_closed {false} {}
+
+    void Connection::queueOutput(std::string_view data)
+    {
+        outbox.append(data);
+    }
+
+    bool Connection::hasPendingOutput() const noexcept
+    {
+        return out_offset < outbox.length();
+    }
+
+    std::string Connection::takeOutput()
+    {
+        std::string pending {};
+
+        if (out_offset == 0)
+            pending.swap(outbox);
+        else
+            pending.assign(outbox, out_offset);
+
+        outbox.clear();
+        out_offset = 0;
+
+        return pending;
+    }
+
+    IOStatus Connection::fillInbox()
+    {
+        std::array<char, read_chunk_size> chunk;
+
+        while (inbox.length() < max_inbox_size)
+        {
+            std::size_t room = std::min(chunk.size(), max_inbox_size - inbox.length());
+            auto [count, status] = socket.readSome(chunk.data(), room);
+
+            if (status == IOStatus::io_closed)
+                peer_closed = true;
+
+            if (status != IOStatus::io_ok)
+                return status;
+
+            inbox.append(chunk.data(), count);
+        }
+
+        return IOStatus::io_ok;
+    }
+
+    IOStatus Connection::flushOutbox()
+    {
+        while (hasPendingOutput())
+        {
+            auto [count, status] = socket.writeSome(outbox.data() + out_offset, outbox.length() - out_offset);
+
+            if (status != IOStatus::io_ok)
+                return status;
+
+            out_offset += count;
+        }
+
+        outbox.clear();
+        out_offset = 0;
+
+        return IOStatus::io_ok;
+    }
+
+    // Reactor private impl.
+
+    void Reactor::watchFd(int fd, std::uint32_t events)
+    {
+        struct epoll_event event {};
+        event.events = events;
+        event.data.fd = fd;
+
+        if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &event) == -1)
+            throw std::runtime_error {"Reactor: epoll_ctl failed to add fd."};
+    }
+
+    void Reactor::addConnection(SocketConfig config)
+    {
+        int child_fd = config.socket_fd;
+        connections[child_fd] = std::make_unique<Connection>(config);
+
+        // clients stay registered for both directions, so no EPOLL_CTL_MOD is needed when output backs up
+        watchFd(child_fd, EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET);
+    }
+
+    void Reactor::acceptPending()
+    {
+        // edge-triggered: the whole pending queue must be drained before the next wait
+        while (true)
+        {
+            SocketConfig child_config = listener->acceptConnection();
+
+            if (child_config.socket_fd == -1)
+                break;
+
+            addConnection(child_config);
+        }
+    }
+
+    void Reactor::handleClient(int fd, std::uint32_t events)
+    {
+        auto conn_it = connections.find(fd);
+
+        if (conn_it == connections.end())
+            return;
+
+        Connection& conn = *conn_it->second;
+
+        if ((events & (EPOLLERR | EPOLLHUP)) != 0)
+        {
+            dropConnection(fd);
+            return;
+        }
+
+        bool input_ready = (events & (EPOLLIN | EPOLLRDHUP)) != 0;
+
+        while (true)
+        {
+            bool consumed_input = false;
+
+            // input stays in the kernel while output is backed up, so a slow reader cannot grow the inbox without bound
+            if (conn.getState() == ConnState::conn_reading)
+            {
+                // reading stops at the inbox cap, and no new edge comes for what is left in the kernel
+                input_ready = input_ready && !conn.isPeerClosed() && conn.fillInbox() == IOStatus::io_ok;
+
+                if (std::size_t inbox_size = conn.getInbox().length(); inbox_size > 0)
+                {
+                    try
+                    {
+                        conn.setState(handler(conn));
+                    }
+                    catch (...)
+                    {
+                        dropConnection(fd);
+                        return;
+                    }
+
+                    consumed_input = conn.getInbox().length() < inbox_size;
+                }
+
+                // a full inbox the handler cannot make progress on would never shrink
+                if (conn.getInbox().length() >= Connection::max_inbox_size)
+                {
+                    dropConnection(fd);
+                    return;
+                }
+            }
+
+            IOStatus write_status = conn.flushOutbox();
+
+            if (write_status == IOStatus::io_closed)
+            {
+                dropConnection(fd);
+                return;
+            }
+
+            if (write_status == IOStatus::io_again)
+            {
+                if (conn.getState() == ConnState::conn_reading)
+                    conn.setState(ConnState::conn_writing);
+
+                return;
+            }
+
+            if (conn.getState() == ConnState::conn_closing)
+            {
+                dropConnection(fd);
+                return;
+            }
+
+            // no new edge comes for input that arrived while writing, so drain the socket and dispatch again
+            if (conn.getState() == ConnState::conn_writing)
+            {
+                conn.setState(ConnState::conn_reading);
+                input_ready = true;
+                continue;
+            }
+
+            if (input_ready || (consumed_input && !conn.getInbox().empty()))
+                continue;
+
+            // a hang-up is only acted on once every reply to the peer's last requests went out
+            if (conn.isPeerClosed())
+                dropConnection(fd);
+
+            return;
+        }
+    }
+
+    void Reactor::dropConnection(int fd)
+    {
+        // the ClientSocket destructor closes the fd, which also removes it from the epoll set
+        epoll_ctl(epoll_fd, EPOLL_CTL_DEL, fd, nullptr);
+        connections.erase(fd);
+    }
+
+    // Reactor public impl.
+
+    Reactor::Reactor(ServerSocket& listener_, ConnectionHandler handler_)
+    : connections {}, handler {std::move(handler_)}, listener {&listener_}, epoll_fd {epoll_create1(EPOLL_CLOEXEC)}, wake_fd {eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)}, running {true}
+    {
+        if (epoll_fd == -1 || wake_fd == -1 || !listener->isNonBlocking())
+        {
+            if (epoll_fd != -1)
+                close(epoll_fd);
+
+            if (wake_fd != -1)
+                close(wake_fd);
+
+            throw std::runtime_error {"Reactor: bad epoll / eventfd descriptors or blocking listener."};
+        }
+
+        watchFd(listener->getFd(), EPOLLIN | EPOLLET);
+        watchFd(wake_fd, EPOLLIN);
+    }
+
+    void Reactor::adoptConnection(SocketConfig config)
+    {
+        if (!setNonBlocking(config.socket_fd))
+            throw std::runtime_error {"Reactor: failed to set O_NONBLOCK on adopted fd."};
+
+        addConnection(config);
+    }
+
+    void Reactor::runOnce(int timeout_ms)
+    {
+        std::array<struct epoll_event, max_events> events;
+
+        int ready_count = epoll_wait(epoll_fd, events.data(), max_events, timeout_ms);
+
+        for (int event_idx = 0; event_idx < ready_count; event_idx++)
+        {
+            int ready_fd = events[event_idx].data.fd;
+            std::uint32_t ready_flags = events[event_idx].events;
+
+            if (ready_fd == listener->getFd())
+                acceptPending();
+            else if (ready_fd == wake_fd)
+            {
+                std::uint64_t wake_count = 0;
+                [[maybe_unused]] auto read_rc = read(wake_fd, &wake_count, sizeof(wake_count));
+            }
+            else
+                handleClient(ready_fd, ready_flags);
+        }
+    }
+
+    void Reactor::run()
+    {
+        // a stop() issued before run() starts must still be honored
+        while (running.load(std::memory_order_acquire))
+            runOnce(-1);
+    }
+
+    void Reactor::stop() noexcept
+    {
+        running.store(false, std::memory_order_release);
+
+        std::uint64_t wake_count = 1;
+        [[maybe_unused]] auto write_rc = write(wake_fd, &wake_count, sizeof(wake_count));
+    }
+
+    Reactor::~Reactor() noexcept
+    {
+        connections.clear();
+        close(wake_fd);
+        close(epoll_fd);
+    }
+}
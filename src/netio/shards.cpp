@@ -0,0 +1,199 @@
+/**
+ * @file shards.cpp
+ * @author DrkWithT
+ * @brief Implements thread-per-core SO_REUSEPORT shards.
+ * @date 2024-08-17
+ */
+
+#include <pthread.h>
+#include <sched.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <utility>
+#include <stdexcept>
+#include "netio/shards.hpp"
+
+namespace ToyServer::NetIO
+{
+    // Utility impl.
+
+    bool pinThisThread(std::size_t cpu_idx) noexcept
+    {
+        cpu_set_t cpu_mask;
+        CPU_ZERO(&cpu_mask);
+        CPU_SET(cpu_idx, &cpu_mask);
+
+        return pthread_setaffinity_np(pthread_self(), sizeof(cpu_mask), &cpu_mask) == 0;
+    }
+
+    std::vector<std::size_t> getAllowedCpus()
+    {
+        std::vector<std::size_t> cpu_ids {};
+        cpu_set_t cpu_mask;
+        CPU_ZERO(&cpu_mask);
+
+        if (sched_getaffinity(0, sizeof(cpu_mask), &cpu_mask) == 0)
+        {
+            for (std::size_t cpu_idx = 0; cpu_idx < CPU_SETSIZE; cpu_idx++)
+            {
+                if (CPU_ISSET(cpu_idx, &cpu_mask))
+                    cpu_ids.push_back(cpu_idx);
+            }
+        }
+
+        if (cpu_ids.empty())
+        {
+            for (std::size_t cpu_idx = 0; cpu_idx < std::max(std::thread::hardware_concurrency(), 1U); cpu_idx++)
+                cpu_ids.push_back(cpu_idx);
+        }
+
+        return cpu_ids;
+    }
+
+    // ShardGroup private impl.
+
+    void ShardGroup::shardMain(std::size_t shard_idx, std::latch& ready)
+    {
+        Shard& self = *shards[shard_idx];
+        std::size_t cpu_idx = allowed_cpus[shard_idx % allowed_cpus.size()];
+
+        try
+        {
+            // pin before allocating so first-touch places the shard's memory on its own node, an unpinnable shard still serves but is reported
+            if (pinThisThread(cpu_idx))
+                self.pinned_cpu = static_cast<int>(cpu_idx);
+
+            AddrInfo addr_info {hints};
+            std::optional<SocketConfig> bound_config {};
+
+            while (auto option = addr_info.getNextOption())
+            {
+                if (option->socket_fd != -1)
+                {
+                    bound_config = option;
+                    break;
+                }
+            }
+
+            if (!bound_config)
+                throw std::runtime_error {"ShardGroup: no bindable SO_REUSEPORT address."};
+
+            // hint the kernel to prefer this listener for flows whose packets arrive on our CPU
+            if (self.pinned_cpu != -1)
+                setsockopt(bound_config->socket_fd, SOL_SOCKET, SO_INCOMING_CPU, &self.pinned_cpu, sizeof(self.pinned_cpu));
+
+            if (backend == IOBackend::io_uring)
+            {
+                self.listener = std::make_unique<ServerSocket>(*bound_config);
+                self.uring_reactor = std::make_unique<UringReactor>(*self.listener, handler_factory(shard_idx));
+            }
+            else
+            {
+                self.listener = std::make_unique<ServerSocket>(*bound_config, true);
+                self.reactor = std::make_unique<Reactor>(*self.listener, handler_factory(shard_idx));
+            }
+        }
+        catch (...)
+        {
+            self.startup_error = std::current_exception();
+        }
+
+        ready.count_down();
+
+        // handler failures only drop their connection, so whatever escapes here ends this shard alone and not the process
+        try
+        {
+            if (self.reactor)
+                self.reactor->run();
+            else if (self.uring_reactor)
+                self.uring_reactor->run();
+        }
+        catch (...)
+        {
+            self.run_error = std::current_exception();
+        }
+    }
+
+    // ShardGroup public impl.
+
+    ShardGroup::ShardGroup(SocketHints hints_, std::size_t shard_count, ShardHandlerFactory handler_factory_, IOBackend backend_)
+    : shards {}, allowed_cpus {getAllowedCpus()}, hints {std::move(hints_)}, handler_factory {std::move(handler_factory_)}, backend {pickBackend(backend_)}
+    {
+        hints.socket_reuse_port = true;
+
+        if (shard_count == 0)
+            shard_count = allowed_cpus.size();
+
+        shards.reserve(shard_count);
+
+        for (std::size_t shard_idx = 0; shard_idx < shard_count; shard_idx++)
+        {
+            shards.emplace_back(std::make_unique<Shard>());
+            shards.back()->pinned_cpu = -1;
+        }
+    }
+
+    std::optional<std::size_t> ShardGroup::getShardCpu(std::size_t shard_idx) const noexcept
+    {
+        if (shard_idx >= shards.size() || shards[shard_idx]->pinned_cpu == -1)
+            return {};
+
+        return static_cast<std::size_t>(shards[shard_idx]->pinned_cpu);
+    }
+
+    std::exception_ptr ShardGroup::getShardFailure(std::size_t shard_idx) const noexcept
+    {
+        if (shard_idx >= shards.size())
+            return {};
+
+        return shards[shard_idx]->run_error;
+    }
+
+    void ShardGroup::start()
+    {
+        std::latch ready {static_cast<std::ptrdiff_t>(shards.size())};
+
+        for (std::size_t shard_idx = 0; shard_idx < shards.size(); shard_idx++)
+            shards[shard_idx]->thread = std::thread {&ShardGroup::shardMain, this, shard_idx, std::ref(ready)};
+
+        ready.wait();
+
+        for (auto& shard : shards)
+        {
+            if (shard->startup_error)
+            {
+                std::exception_ptr first_error = shard->startup_error;
+                stop();
+                std::rethrow_exception(first_error);
+            }
+        }
+    }
+
+    void ShardGroup::stop() noexcept
+    {
+        for (auto& shard : shards)
+        {
+            if (shard->reactor)
+                shard->reactor->stop();
+            else if (shard->uring_reactor)
+                shard->uring_reactor->stop();
+        }
+
+        for (auto& shard : shards)
+        {
+            if (shard->thread.joinable())
+                shard->thread.join();
+
+            shard->reactor.reset();
+            shard->uring_reactor.reset();
+            shard->listener.reset();
+        }
+    }
+
+    ShardGroup::~ShardGroup() noexcept
+    {
+        stop();
+    }
+}
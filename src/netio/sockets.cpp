@@ -9,17 +9,39 @@
  */
 
 #include <sys/types.h>
+#include <sys/sendfile.h>
 #include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/uio.h>
 #include <netdb.h>
+#include <fcntl.h>
 #include <unistd.h>
+#include <csignal>
+#include <cerrno>
 
 #include <algorithm>
+#include <array>
 #include <utility>
 #include <stdexcept>
+#include "metrics/metrics.hpp"
 #include "netio/sockets.hpp"
 
 namespace ToyServer::NetIO
 {
+    // Utility impl.
+
+    bool setNonBlocking(int fd, bool enabled) noexcept
+    {
+        int flags = fcntl(fd, F_GETFL, 0);
+
+        if (flags == -1)
+            return false;
+
+        flags = (enabled) ? (flags | O_NONBLOCK) : (flags & ~O_NONBLOCK);
+
+        return fcntl(fd, F_SETFL, flags) != -1;
+    }
+
     // ServerSocket private impl.
 
     void ServerSocket::closeFd()
@@ -48,24 +70,34 @@ namespace ToyServer::NetIO
         int temp_child_timeout = 0;
         std::swap(temp_child_timeout, other.child_sock_timeout);
 
-        bool temp_closed_flag = false;
+        bool temp_closed_flag = true;
         std::swap(temp_closed_flag, other.closed);
 
+        bool temp_nonblocking = false;
+        std::swap(temp_nonblocking, other.nonblocking);
+
         fd = temp_sockfd;
         backlog = temp_backlog;
         child_sock_timeout = temp_child_timeout;
         closed = temp_closed_flag;
+        nonblocking = temp_nonblocking;
     }
 
     // ServerSocket public impl.
 
-    ServerSocket::ServerSocket(SocketConfig config)
-    : fd {config.socket_fd}, backlog {config.socket_backlog}, child_sock_timeout {config.rw_timeout}, closed {fd != socket_fd_placeholder}
+    ServerSocket::ServerSocket(SocketConfig config, bool nonblocking_)
+    : fd {config.socket_fd}, backlog {config.socket_backlog}, child_sock_timeout {config.rw_timeout}, closed {fd == socket_fd_placeholder}, nonblocking {nonblocking_}
     {
+        if (nonblocking && !setNonBlocking(fd))
+        {
+            closeFd();
+            throw std::runtime_error {"ServerSocket: failed to set O_NONBLOCK."};
+        }
+
         if (listen(fd, backlog) == -1)
         {
             closeFd();
-            throw std::runtime_error {""};
+            throw std::runtime_error {"ServerSocket: failed to listen."};
         }
     }
 
@@ -76,6 +108,10 @@ namespace ToyServer::NetIO
 
     ServerSocket& ServerSocket::operator=(ServerSocket&& other) noexcept
     {
+        if (&other == this)
+            return *this;
+
+        closeFd();
         swapState(std::move(other));
 
         return *this;
@@ -83,7 +119,16 @@ namespace ToyServer::NetIO
 
     SocketConfig ServerSocket::acceptConnection() const
     {
-        int temp_client_fd = accept(fd, nullptr, nullptr);
+        int temp_client_fd = socket_fd_placeholder;
+
+        do
+        {
+            temp_client_fd = accept4(fd, nullptr, nullptr, (nonblocking) ? SOCK_NONBLOCK : 0);
+        }
+        while (temp_client_fd == -1 && errno == EINTR);
+
+        if (temp_client_fd != socket_fd_placeholder)
+            Metrics::threadMetrics().add(Metrics::Counter::c_accepts);
 
         return {temp_client_fd, backlog, child_sock_timeout};
     }
@@ -97,11 +142,12 @@ namespace ToyServer::NetIO
 
     void ClientSocket::closeFd()
     {
-        if (closed || fd != socket_fd_placeholder)
+        if (closed || fd == socket_fd_placeholder)
             return;
 
         close(fd);
         closed = true;
+        Metrics::threadMetrics().add(Metrics::Counter::c_conns_closed);
     }
 
     bool ClientSocket::isClosed() const
@@ -127,34 +173,73 @@ namespace ToyServer::NetIO
         timeout = temp_timeout;
         closed = temp_closed;
         peer_ok = temp_peer_flag;
+
+        // both sides keep a valid ring, the moved-from one is just emptied
+        std::swap(read_ahead, other.read_ahead);
+        other.read_ahead.clear();
+    }
+
+    // ClientSocket public impl.
+
+    ClientSocket::ClientSocket(SocketConfig config)
+    : read_ahead {read_ahead_size}, fd {config.socket_fd}, timeout {config.rw_timeout}, closed {fd == socket_fd_placeholder}, peer_ok {!closed}
+    {
+        if (closed)
+            return;
+
+        Metrics::threadMetrics().add(Metrics::Counter::c_conns_opened);
     }
 
     ClientSocket::ClientSocket(ClientSocket&& other) noexcept
+    : read_ahead {read_ahead_size}, fd {socket_fd_placeholder}, timeout {0}, closed {true}, peer_ok {false}
     {
         swapState(std::move(other));
     }
 
     ClientSocket& ClientSocket::operator=(ClientSocket&& other) noexcept
     {
+        if (&other == this)
+            return *this;
+
+        closeFd();
         swapState(std::move(other));
 
         return *this;
     }
 
+    bool ClientSocket::setReceiveTimeout(int timeout_ms) noexcept
+    {
+        struct timeval recv_timeout {};
+        recv_timeout.tv_sec = timeout_ms / 1000;
+        recv_timeout.tv_usec = (timeout_ms % 1000) * 1000;
+
+        return setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &recv_timeout, sizeof(recv_timeout)) == 0;
+    }
+
+    bool ClientSocket::setLingerTimeout(int timeout_s) noexcept
+    {
+        struct linger timeout_opts {};
+        timeout_opts.l_linger = timeout_s;
+        timeout_opts.l_onoff = 1;
+
+        return setsockopt(fd, SOL_SOCKET, SO_LINGER, &timeout_opts, sizeof(timeout_opts)) == 0;
+    }
+
     void ClientSocket::readInto(std::size_t count, FixedBuffer& buffer)
     {
-        if (closed || !peer_ok)
+        if (closed || (!peer_ok && read_ahead.isEmpty()))
             throw std::runtime_error {"ClientSocket::readInto: Pipe already broken!"};
 
-        ssize_t pending_rc = static_cast<ssize_t>(count);
-
         if (count >= buffer.getCapacity())
             throw std::invalid_argument {"ClientSocket.readInto: Invalid read count!"};
 
-        ssize_t temp_rc = 0;
-        ssize_t buffer_offset = 0;
         char* buf_ptr = buffer.getBasePtr();
 
+        // serve read-ahead leftovers first, then let the kernel copy the rest straight into the target
+        std::size_t buffer_offset = read_ahead.copyOut(buf_ptr, count);
+        ssize_t pending_rc = static_cast<ssize_t>(count - buffer_offset);
+        ssize_t temp_rc = 0;
+
         while (pending_rc > 0 && peer_ok)
         {
             temp_rc = recv(fd, buf_ptr + buffer_offset, pending_rc, 0);
@@ -167,6 +252,7 @@ namespace ToyServer::NetIO
 
             buffer_offset += temp_rc;
             pending_rc -= temp_rc;
+            Metrics::threadMetrics().add(Metrics::Counter::c_bytes_in, static_cast<std::size_t>(temp_rc));
         }
     }
 
@@ -186,7 +272,7 @@ namespace ToyServer::NetIO
 
         while (pending_wc > 0 && peer_ok)
         {
-            temp_wc = send(fd, buf_ptr + buffer_offset, pending_wc, 0);
+            temp_wc = send(fd, buf_ptr + buffer_offset, pending_wc, MSG_NOSIGNAL);
 
             if (temp_wc <= 0)
             {
@@ -196,51 +282,239 @@ namespace ToyServer::NetIO
 
             buffer_offset += temp_wc;
             pending_wc -= temp_wc;
+            Metrics::threadMetrics().add(Metrics::Counter::c_bytes_out, static_cast<std::size_t>(temp_wc));
         }
     }
 
     std::size_t ClientSocket::readUntil(char delim, FixedBuffer& buffer)
     {
-        if (closed || !peer_ok)
-            throw std::runtime_error {"ClientSocket::readInto: Pipe already broken!"};
+        if (closed || (!peer_ok && read_ahead.isEmpty()))
+            throw std::runtime_error {"ClientSocket::readUntil: Pipe already broken!"};
 
-        ssize_t temp_rc = 0;
-        ssize_t total_rc = 0;
+        std::size_t buffer_limit = buffer.getCapacity();
         char* buffer_ptr = buffer.getBasePtr();
-        char octet = '\0';
 
-        while (peer_ok)
+        while (true)
         {
-            temp_rc = recv(fd, &octet, 1, 0);
-
-            if (temp_rc <= 0)
+            if (auto delim_pos = read_ahead.findOctet(delim); delim_pos)
             {
-                peer_ok = false;
-                break;
+                std::size_t chunk_len = *delim_pos;
+
+                if (chunk_len >= buffer_limit)
+                    throw std::runtime_error {"ClientSocket::readUntil: Reading count underflowed / overflowed!"};
+
+                read_ahead.copyOut(buffer_ptr, chunk_len);
+                read_ahead.discard(1);
+
+                // discard CR octets
+                char* chunk_end = std::remove(buffer_ptr, buffer_ptr + chunk_len, '\r');
+                *chunk_end = '\0';
+
+                return static_cast<std::size_t>(chunk_end - buffer_ptr);
             }
 
-            // check for invalid quantity of read octets
-            if (static_cast<std::size_t>(total_rc) >= buffer.getCapacity())
+            // no delimiter in a full window means the chunk can never fit
+            if (read_ahead.getSize() >= buffer_limit || read_ahead.getSpace() == 0)
                 throw std::runtime_error {"ClientSocket::readUntil: Reading count underflowed / overflowed!"};
 
-            // discard CR octets
-            if (octet == '\r')
-            {
-                continue;
-            }
-            else if (octet == delim)
-            {
-                buffer_ptr[total_rc] = '\0';
-                break;
-            }
-            else
-            {
-                buffer_ptr[total_rc] = octet;
-                total_rc += temp_rc;
-            }
+            IOStatus fill_status = fillReadAhead();
+
+            if (fill_status == IOStatus::io_closed)
+                return 0;
+
+            if (fill_status == IOStatus::io_again)
+                throw std::runtime_error {"ClientSocket::readUntil: Socket would block!"};
+        }
+    }
+
+    IOStatus ClientSocket::fillReadAhead()
+    {
+        auto [first, second] = read_ahead.getFreeSpans();
+
+        if (first.empty())
+            return IOStatus::io_ok;
+
+        std::array<struct iovec, 2> free_vecs {{
+            {first.data(), first.size()},
+            {second.data(), second.size()}
+        }};
+        int vec_count = (second.empty()) ? 1 : 2;
+        ssize_t temp_rc = 0;
+
+        do
+        {
+            temp_rc = readv(fd, free_vecs.data(), vec_count);
         }
+        while (temp_rc == -1 && errno == EINTR);
+
+        if (temp_rc > 0)
+        {
+            read_ahead.commitWrite(static_cast<std::size_t>(temp_rc));
+            Metrics::threadMetrics().add(Metrics::Counter::c_bytes_in, static_cast<std::size_t>(temp_rc));
+            return IOStatus::io_ok;
+        }
+
+        if (temp_rc == -1 && (errno == EAGAIN || errno == EWOULDBLOCK))
+            return IOStatus::io_again;
+
+        peer_ok = false;
+        return IOStatus::io_closed;
+    }
+
+    std::string_view ClientSocket::peekReadAhead() noexcept
+    {
+        auto flat = read_ahead.linearize();
+
+        return {flat.data(), flat.size()};
+    }
+
+    void ClientSocket::consumeReadAhead(std::size_t count) noexcept
+    {
+        read_ahead.discard(count);
+    }
+
+    IOResult ClientSocket::readSome(char* dst, std::size_t len) noexcept
+    {
+        if (!closed && !read_ahead.isEmpty())
+            return {read_ahead.copyOut(dst, len), IOStatus::io_ok};
+
+        if (closed || !peer_ok)
+            return {0, IOStatus::io_closed};
+
+        ssize_t temp_rc = 0;
+
+        do
+        {
+            temp_rc = recv(fd, dst, len, 0);
+        }
+        while (temp_rc == -1 && errno == EINTR);
+
+        if (temp_rc > 0)
+        {
+            Metrics::threadMetrics().add(Metrics::Counter::c_bytes_in, static_cast<std::size_t>(temp_rc));
+            return {static_cast<std::size_t>(temp_rc), IOStatus::io_ok};
+        }
+
+        if (temp_rc == -1 && (errno == EAGAIN || errno == EWOULDBLOCK))
+            return {0, IOStatus::io_again};
+
+        // an orderly FIN only ends the input, replies to what was already received may still go out
+        if (temp_rc == -1)
+            peer_ok = false;
+
+        return {0, IOStatus::io_closed};
+    }
+
+    IOResult ClientSocket::writeSome(const char* src, std::size_t len) noexcept
+    {
+        if (closed || !peer_ok)
+            return {0, IOStatus::io_closed};
+
+        ssize_t temp_wc = 0;
+
+        do
+        {
+            temp_wc = send(fd, src, len, MSG_NOSIGNAL);
+        }
+        while (temp_wc == -1 && errno == EINTR);
+
+        if (temp_wc >= 0)
+        {
+            Metrics::threadMetrics().add(Metrics::Counter::c_bytes_out, static_cast<std::size_t>(temp_wc));
+            return {static_cast<std::size_t>(temp_wc), IOStatus::io_ok};
+        }
+
+        if (errno == EAGAIN || errno == EWOULDBLOCK)
+            return {0, IOStatus::io_again};
+
+        peer_ok = false;
+        return {0, IOStatus::io_closed};
+    }
+
+    IOResult ClientSocket::writeGather(std::span<const struct iovec> segments, bool more_follows) noexcept
+    {
+        if (closed || !peer_ok)
+            return {0, IOStatus::io_closed};
+
+        // sendmsg instead of writev only for MSG_NOSIGNAL, a hung up peer must not raise SIGPIPE
+        struct msghdr gather_msg {};
+        gather_msg.msg_iov = const_cast<struct iovec*>(segments.data());
+        gather_msg.msg_iovlen = segments.size();
+
+        ssize_t temp_wc = 0;
+
+        do
+        {
+            temp_wc = sendmsg(fd, &gather_msg, MSG_NOSIGNAL | ((more_follows) ? MSG_MORE : 0));
+        }
+        while (temp_wc == -1 && errno == EINTR);
+
+        if (temp_wc >= 0)
+        {
+            Metrics::threadMetrics().add(Metrics::Counter::c_bytes_out, static_cast<std::size_t>(temp_wc));
+            return {static_cast<std::size_t>(temp_wc), IOStatus::io_ok};
+        }
+
+        if (errno == EAGAIN || errno == EWOULDBLOCK)
+            return {0, IOStatus::io_again};
+
+        peer_ok = false;
+        return {0, IOStatus::io_closed};
+    }
+
+    IOResult ClientSocket::sendFile(int file_fd, std::size_t offset, std::size_t count) noexcept
+    {
+        if (closed || !peer_ok)
+            return {0, IOStatus::io_closed};
+
+        off_t file_offset = static_cast<off_t>(offset);
+        ssize_t temp_wc = 0;
+        int send_errno = 0;
+
+        // sendfile has no MSG_NOSIGNAL: block SIGPIPE on this thread for the call, then discard any it raised
+        sigset_t pipe_mask;
+        sigset_t old_mask;
+        sigset_t pending_mask;
+        sigemptyset(&pipe_mask);
+        sigaddset(&pipe_mask, SIGPIPE);
+        sigpending(&pending_mask);
+
+        bool pipe_was_pending = sigismember(&pending_mask, SIGPIPE) == 1;
+        pthread_sigmask(SIG_BLOCK, &pipe_mask, &old_mask);
+
+        do
+        {
+            temp_wc = sendfile(fd, file_fd, &file_offset, count);
+        }
+        while (temp_wc == -1 && errno == EINTR);
+
+        send_errno = errno;
+
+        // a short count can come with the signal too, when the peer went away partway through
+        if (!pipe_was_pending)
+        {
+            struct timespec no_wait {};
+            sigtimedwait(&pipe_mask, nullptr, &no_wait);
+        }
+
+        pthread_sigmask(SIG_SETMASK, &old_mask, nullptr);
+        errno = send_errno;
+
+        if (temp_wc > 0)
+        {
+            Metrics::threadMetrics().add(Metrics::Counter::c_bytes_out, static_cast<std::size_t>(temp_wc));
+            return {static_cast<std::size_t>(temp_wc), IOStatus::io_ok};
+        }
+
+        if (temp_wc == -1 && (errno == EAGAIN || errno == EWOULDBLOCK))
+            return {0, IOStatus::io_again};
+
+        // 0 here means the file shrank under us, which the reply's Content-Length cannot recover from either
+        // EPIPE or ECONNRESET mean the peer is gone like any other send error
+        if (temp_wc == -1)
+            peer_ok = false;
 
-        return total_rc;
+        return {0, IOStatus::io_closed};
     }
 
     ClientSocket::~ClientSocket() noexcept
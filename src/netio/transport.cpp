@@ -0,0 +1,100 @@
+/**
+ * @file transport.cpp
+ * @author DrkWithT
+ * @brief Implements the in-memory transport.
+ * @date 2024-09-03
+ */
+
+#include <unistd.h>
+#include <algorithm>
+#include <limits>
+#include "netio/transport.hpp"
+
+namespace ToyServer::NetIO
+{
+    MemoryTransport::MemoryTransport(std::size_t read_ahead_size)
+    : read_ahead {read_ahead_size}, input {}, output {}, input_offset {0}, max_transfer {std::numeric_limits<std::size_t>::max()}, input_closed {false} {}
+
+    void MemoryTransport::pushInput(std::string_view data)
+    {
+        // drop what fills already took before growing the backlog
+        if (input_offset == input.length())
+        {
+            input.clear();
+            input_offset = 0;
+        }
+
+        input.append(data);
+    }
+
+    void MemoryTransport::reset() noexcept
+    {
+        read_ahead.clear();
+        input.clear();
+        output.clear();
+        input_offset = 0;
+        input_closed = false;
+    }
+
+    IOStatus MemoryTransport::fillReadAhead()
+    {
+        auto [first, second] = read_ahead.getFreeSpans();
+
+        if (first.empty())
+            return IOStatus::io_ok;
+
+        if (input_offset == input.length())
+            return (input_closed) ? IOStatus::io_closed : IOStatus::io_again;
+
+        std::size_t count = std::min({input.length() - input_offset, first.size() + second.size(), max_transfer});
+        std::size_t first_count = std::min(count, first.size());
+        const char* src = input.data() + input_offset;
+
+        std::copy(src, src + first_count, first.begin());
+        std::copy(src + first_count, src + count, second.begin());
+
+        read_ahead.commitWrite(count);
+        input_offset += count;
+
+        return IOStatus::io_ok;
+    }
+
+    IOResult MemoryTransport::writeGather(std::span<const struct iovec> segments, [[maybe_unused]] bool more_follows)
+    {
+        std::size_t count = 0;
+
+        for (const auto& [base, length] : segments)
+        {
+            std::size_t part = std::min(length, max_transfer - count);
+
+            output.append(static_cast<const char*>(base), part);
+            count += part;
+
+            if (count == max_transfer)
+                break;
+        }
+
+        return {count, IOStatus::io_ok};
+    }
+
+    IOResult MemoryTransport::sendFile(int file_fd, std::size_t offset, std::size_t count)
+    {
+        std::size_t old_length = output.length();
+        std::size_t want = std::min({count, max_transfer, file_chunk_size});
+
+        output.resize(old_length + want);
+
+        ssize_t temp_rc = pread(file_fd, output.data() + old_length, want, static_cast<off_t>(offset));
+
+        // like sendfile, a file that shrank under the reply cannot be recovered from
+        if (temp_rc <= 0)
+        {
+            output.resize(old_length);
+            return {0, IOStatus::io_closed};
+        }
+
+        output.resize(old_length + static_cast<std::size_t>(temp_rc));
+
+        return {static_cast<std::size_t>(temp_rc), IOStatus::io_ok};
+    }
+}
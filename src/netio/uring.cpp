@@ -0,0 +1,591 @@
+/**
+ * @file uring.cpp
+ * @author DrkWithT
+ * @brief Implements the io_uring event loop with raw syscalls.
+ * @date 2024-08-20
+ */
+
+#include <linux/io_uring.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/utsname.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#include <cstdlib>
+#include <algorithm>
+#include <utility>
+#include <stdexcept>
+#include "metrics/metrics.hpp"
+#include "netio/uring.hpp"
+
+namespace ToyServer::NetIO
+{
+    static constexpr int uring_min_major = 6; // multishot recv landed in 6.0
+    static constexpr unsigned max_chain_length = 16;
+    static constexpr unsigned probe_op_count = 256;
+
+    /* raw syscall wrappers */
+
+    static int uringSetup(unsigned entries, io_uring_params* params) noexcept
+    {
+        return static_cast<int>(syscall(__NR_io_uring_setup, entries, params));
+    }
+
+    static int uringEnter(int ring_fd, unsigned to_submit, unsigned min_complete, unsigned flags) noexcept
+    {
+        return static_cast<int>(syscall(__NR_io_uring_enter, ring_fd, to_submit, min_complete, flags, nullptr, 0));
+    }
+
+    static int uringRegister(int ring_fd, unsigned opcode, void* arg, unsigned nr_args) noexcept
+    {
+        return static_cast<int>(syscall(__NR_io_uring_register, ring_fd, opcode, arg, nr_args));
+    }
+
+    static constexpr std::uint64_t packUserData(std::uint8_t op, int fd) noexcept
+    {
+        return (static_cast<std::uint64_t>(op) << 56) | static_cast<std::uint32_t>(fd);
+    }
+
+    /* helpers impl. */
+
+    bool isUringSupported() noexcept
+    {
+        struct utsname kernel_info {};
+
+        if (uname(&kernel_info) != 0 || std::atoi(kernel_info.release) < uring_min_major)
+            return false;
+
+        io_uring_params params {};
+        int probe_ring_fd = uringSetup(8, &params);
+
+        if (probe_ring_fd < 0)
+            return false;
+
+        std::vector<char> probe_storage(sizeof(io_uring_probe) + probe_op_count * sizeof(io_uring_probe_op), '\0');
+        auto* probe = reinterpret_cast<io_uring_probe*>(probe_storage.data());
+        bool supported = uringRegister(probe_ring_fd, IORING_REGISTER_PROBE, probe, probe_op_count) == 0;
+
+        for (unsigned op : {IORING_OP_ACCEPT, IORING_OP_RECV, IORING_OP_SEND, IORING_OP_READ, IORING_OP_ASYNC_CANCEL})
+        {
+            if (!supported)
+                break;
+
+            supported = op <= probe->last_op && (probe->ops[op].flags & IO_URING_OP_SUPPORTED) != 0;
+        }
+
+        close(probe_ring_fd);
+
+        return supported;
+    }
+
+    IOBackend pickBackend(IOBackend wanted) noexcept
+    {
+        if (wanted == IOBackend::io_uring && !isUringSupported())
+            return IOBackend::io_epoll;
+
+        return wanted;
+    }
+
+    /* UringReactor private impl. */
+
+    void UringReactor::setupRing()
+    {
+        io_uring_params params {};
+        params.flags = IORING_SETUP_CQSIZE;
+        params.cq_entries = ring_entries * 4; // every connection keeps multishot CQEs coming
+
+        ring_fd = uringSetup(ring_entries, &params);
+
+        if (ring_fd < 0)
+            throw std::runtime_error {"UringReactor: io_uring_setup failed."};
+
+        maps.sq_map_len = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        maps.cq_map_len = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        maps.sqes_map_len = params.sq_entries * sizeof(io_uring_sqe);
+
+        bool single_map = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+
+        if (single_map)
+            maps.sq_map_len = maps.cq_map_len = std::max(maps.sq_map_len, maps.cq_map_len);
+
+        maps.sq_ptr = mmap(nullptr, maps.sq_map_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_SQ_RING);
+
+        if (maps.sq_ptr == MAP_FAILED)
+        {
+            maps.sq_ptr = nullptr;
+            throw std::runtime_error {"UringReactor: failed to map SQ ring."};
+        }
+
+        maps.cq_ptr = (single_map) ? maps.sq_ptr : mmap(nullptr, maps.cq_map_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_CQ_RING);
+
+        if (maps.cq_ptr == MAP_FAILED)
+        {
+            maps.cq_ptr = nullptr;
+            throw std::runtime_error {"UringReactor: failed to map CQ ring."};
+        }
+
+        void* sqes_ptr = mmap(nullptr, maps.sqes_map_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_SQES);
+
+        if (sqes_ptr == MAP_FAILED)
+            throw std::runtime_error {"UringReactor: failed to map SQE array."};
+
+        maps.sqes = static_cast<io_uring_sqe*>(sqes_ptr);
+
+        char* sq_base = static_cast<char*>(maps.sq_ptr);
+        char* cq_base = static_cast<char*>(maps.cq_ptr);
+
+        sq_head = reinterpret_cast<unsigned*>(sq_base + params.sq_off.head);
+        sq_tail = reinterpret_cast<unsigned*>(sq_base + params.sq_off.tail);
+        sq_mask = *reinterpret_cast<unsigned*>(sq_base + params.sq_off.ring_mask);
+        sq_capacity = params.sq_entries;
+        cq_head = reinterpret_cast<unsigned*>(cq_base + params.cq_off.head);
+        cq_tail = reinterpret_cast<unsigned*>(cq_base + params.cq_off.tail);
+        cq_mask = *reinterpret_cast<unsigned*>(cq_base + params.cq_off.ring_mask);
+        cqes = cq_base + params.cq_off.cqes;
+
+        // identity map SQ slots to SQEs once, so only the tail moves afterwards
+        unsigned* sq_array = reinterpret_cast<unsigned*>(sq_base + params.sq_off.array);
+
+        for (unsigned slot = 0; slot < sq_capacity; slot++)
+            sq_array[slot] = slot;
+
+        sq_local_tail = *sq_tail;
+    }
+
+    void UringReactor::setupBufRing()
+    {
+        buf_ring_len = recv_buf_count * sizeof(io_uring_buf);
+        void* ring_mem = mmap(nullptr, buf_ring_len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_POPULATE, -1, 0);
+
+        if (ring_mem == MAP_FAILED)
+            throw std::runtime_error {"UringReactor: failed to map buffer ring."};
+
+        buf_ring = static_cast<io_uring_buf_ring*>(ring_mem);
+
+        io_uring_buf_reg ring_reg {};
+        ring_reg.ring_addr = reinterpret_cast<std::uint64_t>(ring_mem);
+        ring_reg.ring_entries = recv_buf_count;
+        ring_reg.bgid = recv_buf_group;
+
+        if (uringRegister(ring_fd, IORING_REGISTER_PBUF_RING, &ring_reg, 1) != 0)
+            throw std::runtime_error {"UringReactor: failed to register provided buffer ring."};
+
+        recv_slab.resize(static_cast<std::size_t>(recv_buf_count) * recv_buf_size);
+
+        for (unsigned buf_id = 0; buf_id < recv_buf_count; buf_id++)
+            recycleBuffer(static_cast<std::uint16_t>(buf_id));
+    }
+
+    void UringReactor::teardown() noexcept
+    {
+        if (maps.sqes != nullptr)
+            munmap(maps.sqes, maps.sqes_map_len);
+
+        if (maps.cq_ptr != nullptr && maps.cq_ptr != maps.sq_ptr)
+            munmap(maps.cq_ptr, maps.cq_map_len);
+
+        if (maps.sq_ptr != nullptr)
+            munmap(maps.sq_ptr, maps.sq_map_len);
+
+        if (ring_fd >= 0)
+            close(ring_fd);
+
+        if (buf_ring != nullptr)
+            munmap(buf_ring, buf_ring_len);
+
+        if (wake_fd >= 0)
+            close(wake_fd);
+    }
+
+    void UringReactor::reapCompletions()
+    {
+        std::atomic_ref<unsigned> cq_head_ref {*cq_head};
+        std::atomic_ref<unsigned> cq_tail_ref {*cq_tail};
+        auto* cqe_array = static_cast<io_uring_cqe*>(cqes);
+
+        unsigned head_pos = cq_head_ref.load(std::memory_order_relaxed);
+
+        while (head_pos != cq_tail_ref.load(std::memory_order_acquire))
+        {
+            const io_uring_cqe& cqe = cqe_array[head_pos & cq_mask];
+            std::uint64_t user_data = cqe.user_data;
+            int res = cqe.res;
+            std::uint32_t flags = cqe.flags;
+
+            // release the slot before dispatch, handlers may submit more work
+            cq_head_ref.store(++head_pos, std::memory_order_release);
+
+            if ((flags & IORING_CQE_F_MORE) == 0)
+                ops_in_flight--;
+
+            auto op = static_cast<UringOp>(user_data >> 56);
+            int fd = static_cast<int>(static_cast<std::uint32_t>(user_data));
+
+            switch (op)
+            {
+                case UringOp::op_accept:
+                    onAccept(res, flags);
+                    break;
+                case UringOp::op_recv:
+                    onRecv(fd, res, flags);
+                    break;
+                case UringOp::op_send:
+                    onSend(fd, res);
+                    break;
+                case UringOp::op_wake:
+                    if (running.load(std::memory_order_acquire))
+                        armWake();
+                    break;
+                case UringOp::op_cancel:
+                default:
+                    break;
+            }
+        }
+    }
+
+    io_uring_sqe* UringReactor::nextSqe()
+    {
+        std::atomic_ref<unsigned> sq_head_ref {*sq_head};
+
+        if (sq_local_tail - sq_head_ref.load(std::memory_order_acquire) >= sq_capacity)
+            submitAndWait(0);
+
+        io_uring_sqe* sqe = &maps.sqes[sq_local_tail & sq_mask];
+        std::memset(sqe, 0, sizeof(io_uring_sqe));
+        sq_local_tail++;
+        ops_in_flight++;
+
+        return sqe;
+    }
+
+    int UringReactor::submitAndWait(unsigned wait_count)
+    {
+        std::atomic_ref<unsigned> sq_tail_ref {*sq_tail};
+        std::atomic_ref<unsigned> sq_head_ref {*sq_head};
+
+        sq_tail_ref.store(sq_local_tail, std::memory_order_release);
+
+        unsigned to_submit = sq_local_tail - sq_head_ref.load(std::memory_order_acquire);
+        unsigned enter_flags = (wait_count > 0) ? IORING_ENTER_GETEVENTS : 0;
+        int enter_rc = 0;
+
+        do
+        {
+            enter_rc = uringEnter(ring_fd, to_submit, wait_count, enter_flags);
+        }
+        while (enter_rc < 0 && errno == EINTR && wait_count == 0);
+
+        return enter_rc;
+    }
+
+    void UringReactor::armAccept()
+    {
+        io_uring_sqe* sqe = nextSqe();
+        sqe->opcode = IORING_OP_ACCEPT;
+        sqe->fd = listener->getFd();
+        sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+        sqe->accept_flags = SOCK_CLOEXEC;
+        sqe->user_data = packUserData(static_cast<std::uint8_t>(UringOp::op_accept), listener->getFd());
+    }
+
+    void UringReactor::armRecv(int fd)
+    {
+        io_uring_sqe* sqe = nextSqe();
+        sqe->opcode = IORING_OP_RECV;
+        sqe->fd = fd;
+        sqe->ioprio = IORING_RECV_MULTISHOT;
+        sqe->flags = IOSQE_BUFFER_SELECT;
+        sqe->buf_group = recv_buf_group;
+        sqe->user_data = packUserData(static_cast<std::uint8_t>(UringOp::op_recv), fd);
+    }
+
+    void UringReactor::armWake()
+    {
+        io_uring_sqe* sqe = nextSqe();
+        sqe->opcode = IORING_OP_READ;
+        sqe->fd = wake_fd;
+        sqe->addr = reinterpret_cast<std::uint64_t>(&wake_value);
+        sqe->len = sizeof(wake_value);
+        sqe->user_data = packUserData(static_cast<std::uint8_t>(UringOp::op_wake), wake_fd);
+    }
+
+    void UringReactor::armCancel(int fd)
+    {
+        io_uring_sqe* sqe = nextSqe();
+        sqe->opcode = IORING_OP_ASYNC_CANCEL;
+        sqe->fd = fd;
+        sqe->cancel_flags = IORING_ASYNC_CANCEL_FD | IORING_ASYNC_CANCEL_ALL;
+        sqe->user_data = packUserData(static_cast<std::uint8_t>(UringOp::op_cancel), fd);
+    }
+
+    void UringReactor::submitOutput(int fd, UringConn& entry)
+    {
+        if (entry.sends_in_flight > 0)
+            return;
+
+        if (entry.flight_offset >= entry.in_flight.length())
+        {
+            entry.in_flight = entry.conn->takeOutput();
+            entry.flight_offset = 0;
+        }
+
+        std::size_t pending_len = entry.in_flight.length() - entry.flight_offset;
+
+        if (pending_len == 0)
+            return;
+
+        unsigned chain_length = static_cast<unsigned>(std::min<std::size_t>((pending_len + send_chunk_size - 1) / send_chunk_size, max_chain_length));
+
+        // a link chain must not straddle two submissions
+        if (sq_local_tail - std::atomic_ref<unsigned> {*sq_head}.load(std::memory_order_acquire) + chain_length > sq_capacity)
+            submitAndWait(0);
+
+        for (unsigned chain_idx = 0; chain_idx < chain_length; chain_idx++)
+        {
+            std::size_t chunk_len = std::min<std::size_t>(entry.in_flight.length() - entry.flight_offset, send_chunk_size);
+
+            io_uring_sqe* sqe = nextSqe();
+            sqe->opcode = IORING_OP_SEND;
+            sqe->fd = fd;
+            sqe->addr = reinterpret_cast<std::uint64_t>(entry.in_flight.data() + entry.flight_offset);
+            sqe->len = static_cast<std::uint32_t>(chunk_len);
+            sqe->msg_flags = MSG_NOSIGNAL | MSG_WAITALL;
+            sqe->flags = (chain_idx + 1 < chain_length) ? IOSQE_IO_LINK : 0;
+            sqe->user_data = packUserData(static_cast<std::uint8_t>(UringOp::op_send), fd);
+
+            entry.flight_offset += chunk_len;
+        }
+
+        entry.sends_in_flight = chain_length;
+    }
+
+    void UringReactor::recycleBuffer(std::uint16_t buf_id) noexcept
+    {
+        std::atomic_ref<std::uint16_t> tail_ref {buf_ring->tail};
+        std::uint16_t tail_pos = tail_ref.load(std::memory_order_relaxed);
+
+        // index from the ring base: in C++ the header's flex array macro shifts `bufs` by the empty struct's size
+        auto* ring_slots = reinterpret_cast<io_uring_buf*>(static_cast<void*>(buf_ring));
+        io_uring_buf& slot = ring_slots[tail_pos & (recv_buf_count - 1)];
+        slot.addr = reinterpret_cast<std::uint64_t>(recv_slab.data() + static_cast<std::size_t>(buf_id) * recv_buf_size);
+        slot.len = recv_buf_size;
+        slot.bid = buf_id;
+
+        tail_ref.store(static_cast<std::uint16_t>(tail_pos + 1), std::memory_order_release);
+    }
+
+    void UringReactor::onAccept(int res, std::uint32_t flags)
+    {
+        if (res >= 0)
+        {
+            Metrics::threadMetrics().add(Metrics::Counter::c_accepts);
+
+            if (running.load(std::memory_order_acquire))
+            {
+                connections.emplace(res, UringConn {std::make_unique<Connection>(SocketConfig {res, 0, listener->getChildTimeout()}), {}, 0, 0, true, false});
+                armRecv(res);
+            }
+            else
+                close(res);
+        }
+
+        if ((flags & IORING_CQE_F_MORE) == 0 && running.load(std::memory_order_acquire))
+            armAccept();
+    }
+
+    void UringReactor::onRecv(int fd, int res, std::uint32_t flags)
+    {
+        auto conn_it = connections.find(fd);
+
+        if (conn_it == connections.end())
+            return;
+
+        UringConn& entry = conn_it->second;
+        bool more_coming = (flags & IORING_CQE_F_MORE) != 0;
+
+        if (!more_coming)
+            entry.recv_armed = false;
+
+        if (res > 0)
+        {
+            Metrics::threadMetrics().add(Metrics::Counter::c_bytes_in, static_cast<std::size_t>(res));
+
+            auto buf_id = static_cast<std::uint16_t>(flags >> IORING_CQE_BUFFER_SHIFT);
+            entry.conn->getInbox().append(recv_slab.data() + static_cast<std::size_t>(buf_id) * recv_buf_size, static_cast<std::size_t>(res));
+            recycleBuffer(buf_id);
+
+            if (!entry.closing && running.load(std::memory_order_acquire))
+            {
+                try
+                {
+                    entry.conn->setState(handler(*entry.conn));
+                }
+                catch (...)
+                {
+                    beginClose(fd, entry);
+                    return;
+                }
+
+                // a full inbox the handler cannot make progress on would never shrink
+                if (entry.conn->getInbox().length() >= Connection::max_inbox_size)
+                {
+                    beginClose(fd, entry);
+                    return;
+                }
+
+                submitOutput(fd, entry);
+
+                if (entry.conn->getState() == ConnState::conn_closing)
+                {
+                    beginClose(fd, entry);
+                    return;
+                }
+            }
+        }
+        else if (res != -ENOBUFS)
+        {
+            // EOF, reset or cancellation
+            beginClose(fd, entry);
+            return;
+        }
+
+        // the kernel ends a multishot recv when buffers run dry, just re-arm
+        if (!entry.recv_armed && !entry.closing)
+        {
+            entry.recv_armed = true;
+            armRecv(fd);
+        }
+
+        maybeDrop(fd);
+    }
+
+    void UringReactor::onSend(int fd, int res)
+    {
+        auto conn_it = connections.find(fd);
+
+        if (conn_it == connections.end())
+            return;
+
+        UringConn& entry = conn_it->second;
+        entry.sends_in_flight--;
+
+        if (res < 0)
+        {
+            // later links of a failed chain complete with -ECANCELED
+            entry.flight_offset = entry.in_flight.length();
+            beginClose(fd, entry);
+            return;
+        }
+
+        Metrics::threadMetrics().add(Metrics::Counter::c_bytes_out, static_cast<std::size_t>(res));
+
+        if (entry.sends_in_flight == 0)
+            submitOutput(fd, entry);
+
+        maybeDrop(fd);
+    }
+
+    void UringReactor::beginClose(int fd, UringConn& entry)
+    {
+        if (!entry.closing)
+        {
+            entry.closing = true;
+
+            if (entry.recv_armed)
+                armCancel(fd);
+        }
+
+        maybeDrop(fd);
+    }
+
+    void UringReactor::maybeDrop(int fd)
+    {
+        auto conn_it = connections.find(fd);
+
+        if (conn_it == connections.end())
+            return;
+
+        const UringConn& entry = conn_it->second;
+
+        // the fd may only be closed once the kernel holds no request against it
+        if (entry.closing && !entry.recv_armed && entry.sends_in_flight == 0)
+            connections.erase(conn_it);
+    }
+
+    /* UringReactor public impl. */
+
+    UringReactor::UringReactor(ServerSocket& listener_, ConnectionHandler handler_)
+    : connections {}, recv_slab {}, handler {std::move(handler_)}, maps {nullptr, nullptr, nullptr, 0, 0, 0}, listener {&listener_},
+    sq_head {nullptr}, sq_tail {nullptr}, sq_mask {0}, sq_capacity {0}, cq_head {nullptr}, cq_tail {nullptr}, cqes {nullptr}, cq_mask {0}, sq_local_tail {0}, ops_in_flight {0},
+    buf_ring {nullptr}, buf_ring_len {0}, wake_value {0}, ring_fd {-1}, wake_fd {eventfd(0, EFD_CLOEXEC)}, running {true}
+    {
+        try
+        {
+            if (wake_fd == -1)
+                throw std::runtime_error {"UringReactor: failed to create eventfd."};
+
+            setupRing();
+            setupBufRing();
+        }
+        catch (...)
+        {
+            teardown();
+            throw;
+        }
+
+        armAccept();
+        armWake();
+    }
+
+    void UringReactor::runOnce()
+    {
+        submitAndWait(1);
+        reapCompletions();
+    }
+
+    void UringReactor::run()
+    {
+        while (running.load(std::memory_order_acquire))
+            runOnce();
+    }
+
+    void UringReactor::stop() noexcept
+    {
+        running.store(false, std::memory_order_release);
+
+        std::uint64_t wake_count = 1;
+        [[maybe_unused]] auto write_rc = write(wake_fd, &wake_count, sizeof(wake_count));
+    }
+
+    UringReactor::~UringReactor() noexcept
+    {
+        running.store(false, std::memory_order_release);
+
+        // cancel everything and wait, the kernel may still read send buffers or fill recv buffers until then
+        try
+        {
+            io_uring_sqe* sqe = nextSqe();
+            sqe->opcode = IORING_OP_ASYNC_CANCEL;
+            sqe->cancel_flags = IORING_ASYNC_CANCEL_ANY;
+            sqe->user_data = packUserData(static_cast<std::uint8_t>(UringOp::op_cancel), -1);
+
+            for (auto& [fd, entry] : connections)
+                entry.closing = true;
+
+            while (ops_in_flight > 0)
+            {
+                if (submitAndWait(1) < 0 && errno != EINTR)
+                    break;
+
+                reapCompletions();
+            }
+        }
+        catch (...) {}
+
+        connections.clear();
+        teardown();
+    }
+}
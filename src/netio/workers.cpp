@@ -0,0 +1,313 @@
+/**
+ * @file workers.cpp
+ * @author DrkWithT
+ * @brief Implements the work-stealing connection worker pool.
+ * @date 2024-08-14
+ */
+
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include <array>
+#include <utility>
+#include <stdexcept>
+#include "netio/workers.hpp"
+
+namespace ToyServer::NetIO
+{
+    // WorkerPool private impl.
+
+    void WorkerPool::wakeWorker(Worker& worker) noexcept
+    {
+        worker.wake_epoch.fetch_add(1, std::memory_order_seq_cst);
+
+        // skip the futex syscall for busy workers: they re-check the deques before sleeping
+        if (worker.sleeping.load(std::memory_order_seq_cst))
+            worker.wake_epoch.notify_one();
+    }
+
+    void WorkerPool::wakeIdleWorkers(std::size_t wanted_count) noexcept
+    {
+        std::size_t worker_count = workers.size();
+
+        // pairs with the fence in workerLoop: either the sleeper sees the new tasks or this sees it sleeping
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+
+        for (std::size_t offset = 0; offset < worker_count && wanted_count > 0; offset++)
+        {
+            Worker& worker = *workers[(next_worker + offset) % worker_count];
+
+            if (worker.sleeping.load(std::memory_order_seq_cst))
+            {
+                wakeWorker(worker);
+                wanted_count--;
+            }
+        }
+
+        next_worker = (next_worker + 1) % worker_count;
+    }
+
+    void WorkerPool::wakeIdlePeer(std::size_t self_idx) noexcept
+    {
+        std::size_t worker_count = workers.size();
+
+        for (std::size_t offset = 1; offset < worker_count; offset++)
+        {
+            Worker& peer = *workers[(self_idx + offset) % worker_count];
+
+            if (peer.sleeping.load(std::memory_order_seq_cst))
+            {
+                wakeWorker(peer);
+                return;
+            }
+        }
+    }
+
+    bool WorkerPool::pushTask(ConnTask task) noexcept
+    {
+        std::size_t worker_count = workers.size();
+
+        // round-robin over the deques, skipping full ones
+        for (std::size_t offset = 0; offset < worker_count; offset++)
+        {
+            Worker& target = *workers[next_worker];
+            next_worker = (next_worker + 1) % worker_count;
+
+            if (target.deque.tryPush(task))
+                return true;
+        }
+
+        return false;
+    }
+
+    std::optional<ConnTask> WorkerPool::takeTask(std::size_t self_idx) noexcept
+    {
+        Worker& self = *workers[self_idx];
+        std::size_t worker_count = workers.size();
+
+        if (auto task = self.deque.trySteal(); task)
+            return task;
+
+        for (std::size_t offset = 1; offset < worker_count; offset++)
+        {
+            if (auto task = workers[(self_idx + offset) % worker_count]->deque.trySteal(); task)
+            {
+                self.steal_count.fetch_add(1, std::memory_order_relaxed);
+                return task;
+            }
+        }
+
+        return {};
+    }
+
+    void WorkerPool::dropQueued() noexcept
+    {
+        // every taker steals, so this is safe to race with stop() or a late submitBatch()
+        for (auto& worker : workers)
+        {
+            while (auto task = worker->deque.trySteal())
+                close(task->socket_fd);
+        }
+    }
+
+    void WorkerPool::runTask(ConnTask task)
+    {
+        try
+        {
+            task_fn(SocketConfig {task.socket_fd, 0, task.rw_timeout});
+        }
+        catch (...)
+        {
+            // a failing connection must not take its worker thread down with it
+        }
+    }
+
+    void WorkerPool::workerLoop(std::size_t self_idx)
+    {
+        Worker& self = *workers[self_idx];
+
+        while (running.load(std::memory_order_acquire))
+        {
+            // read the epoch first so a submit racing with the checks below still wakes us
+            std::uint32_t epoch = self.wake_epoch.load(std::memory_order_acquire);
+
+            if (auto task = takeTask(self_idx); task)
+            {
+                // this session may block for long, so leftovers go to a sleeping peer now
+                if (getQueueDepth() > 0)
+                    wakeIdlePeer(self_idx);
+
+                self.task_count.fetch_add(1, std::memory_order_relaxed);
+                runTask(*task);
+                continue;
+            }
+
+            self.sleeping.store(true, std::memory_order_seq_cst);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+
+            // a steal lost to another taker also lands here, so only sleep when nothing is left
+            if (getQueueDepth() == 0 && running.load(std::memory_order_acquire))
+            {
+                self.wake_epoch.wait(epoch, std::memory_order_acquire);
+                self.wake_count.fetch_add(1, std::memory_order_relaxed);
+            }
+
+            self.sleeping.store(false, std::memory_order_relaxed);
+        }
+    }
+
+    // WorkerPool public impl.
+
+    WorkerPool::WorkerPool(std::size_t worker_count, ConnectionTask task_fn_)
+    : workers {}, task_fn {std::move(task_fn_)}, next_worker {0}, wake_fd {eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)}, running {false}
+    {
+        if (wake_fd == -1)
+            throw std::runtime_error {"WorkerPool: failed to create eventfd."};
+
+        if (worker_count == 0)
+            worker_count = 1;
+
+        workers.reserve(worker_count);
+
+        for (std::size_t worker_idx = 0; worker_idx < worker_count; worker_idx++)
+            workers.emplace_back(std::make_unique<Worker>());
+    }
+
+    void WorkerPool::start()
+    {
+        if (running.exchange(true))
+            return;
+
+        for (std::size_t worker_idx = 0; worker_idx < workers.size(); worker_idx++)
+            workers[worker_idx]->thread = std::thread {&WorkerPool::workerLoop, this, worker_idx};
+    }
+
+    void WorkerPool::submitBatch(std::span<const SocketConfig> batch)
+    {
+        for (const auto& config : batch)
+        {
+            ConnTask task {config.socket_fd, config.rw_timeout};
+            bool queued = pushTask(task);
+
+            // back-pressure: let workers catch up rather than block on a lock, unless they are gone
+            while (!queued && running.load(std::memory_order_acquire))
+            {
+                wakeIdleWorkers(workers.size());
+                std::this_thread::yield();
+                queued = pushTask(task);
+            }
+
+            if (!queued)
+                close(task.socket_fd);
+        }
+
+        // pairs with the exchange in stop(): either it drains these pushes or this sees it stopped and drains them
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+
+        if (!running.load(std::memory_order_acquire))
+        {
+            dropQueued();
+            return;
+        }
+
+        // one wake per connection at most, and none for workers that are busy anyway
+        wakeIdleWorkers(batch.size());
+    }
+
+    void WorkerPool::serve(const ServerSocket& listener)
+    {
+        std::array<SocketConfig, accept_batch_size> batch;
+        std::array<struct pollfd, 2> watched {{
+            {listener.getFd(), POLLIN, 0},
+            {wake_fd, POLLIN, 0}
+        }};
+
+        while (running.load(std::memory_order_acquire))
+        {
+            if (poll(watched.data(), watched.size(), -1) <= 0)
+                continue;
+
+            if ((watched[1].revents & POLLIN) != 0)
+                break;
+
+            std::size_t batch_count = 0;
+
+            // a blocking listener can only promise one pending connection per readiness
+            do
+            {
+                SocketConfig child_config = listener.acceptConnection();
+
+                if (child_config.socket_fd == -1)
+                    break;
+
+                // workers run blocking handlers
+                if (listener.isNonBlocking() && !setNonBlocking(child_config.socket_fd, false))
+                {
+                    close(child_config.socket_fd);
+                    continue;
+                }
+
+                batch[batch_count++] = child_config;
+            }
+            while (listener.isNonBlocking() && batch_count < batch.size());
+
+            submitBatch(std::span<const SocketConfig> {batch.data(), batch_count});
+        }
+    }
+
+    void WorkerPool::stop() noexcept
+    {
+        if (!running.exchange(false))
+            return;
+
+        std::uint64_t wake_count = 1;
+        [[maybe_unused]] auto write_rc = write(wake_fd, &wake_count, sizeof(wake_count));
+
+        for (auto& worker : workers)
+            wakeWorker(*worker);
+
+        for (auto& worker : workers)
+        {
+            if (worker->thread.joinable())
+                worker->thread.join();
+        }
+
+        // connections nobody got to are simply dropped
+        dropQueued();
+    }
+
+    std::size_t WorkerPool::getQueueDepth() const noexcept
+    {
+        std::size_t depth = 0;
+
+        for (const auto& worker : workers)
+            depth += worker->deque.getSize();
+
+        return depth;
+    }
+
+    std::vector<WorkerStats> WorkerPool::getStats() const
+    {
+        std::vector<WorkerStats> stats {};
+        stats.reserve(workers.size());
+
+        for (const auto& worker : workers)
+        {
+            stats.emplace_back(WorkerStats {
+                worker->task_count.load(std::memory_order_relaxed),
+                worker->steal_count.load(std::memory_order_relaxed),
+                worker->wake_count.load(std::memory_order_relaxed),
+                worker->deque.getSize()
+            });
+        }
+
+        return stats;
+    }
+
+    WorkerPool::~WorkerPool() noexcept
+    {
+        stop();
+        close(wake_fd);
+    }
+}
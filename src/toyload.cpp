@@ -0,0 +1,149 @@
+/**
+ * @file toyload.cpp
+ * @author DrkWithT
+ * @brief HTTP/1.1 load generator reporting throughput and HDR latency percentiles.
+ * @date 2024-09-05
+ */
+
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <exception>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include "loadgen/driver.hpp"
+
+using namespace ToyServer::LoadGen;
+
+static constexpr const char* usage_text =
+    "usage: toyload [options]\n"
+    "  --host=<name>        server host (127.0.0.1)\n"
+    "  --port=<port>        server port (8080)\n"
+    "  --path=<target>      request target (/)\n"
+    "  --connections=<n>    open connections (16)\n"
+    "  --threads=<n>        driver threads (1)\n"
+    "  --duration=<secs>    run length (10)\n"
+    "  --rate=<req/s>       open loop at this total rate, default is closed loop\n"
+    "  --pipeline=<n>       requests in flight per connection (1)\n"
+    "  --no-keepalive       one request per connection\n";
+
+template <typename Num>
+static bool parseNumber(std::string_view text, Num& result)
+{
+    auto [parse_end, parse_err] = std::from_chars(text.data(), text.data() + text.length(), result);
+
+    return parse_err == std::errc {} && parse_end == text.data() + text.length();
+}
+
+static bool parseArgs(int argc, char* argv[], LoadConfig& config)
+{
+    for (int arg_idx = 1; arg_idx < argc; arg_idx++)
+    {
+        std::string_view arg {argv[arg_idx]};
+        std::string_view value = arg.substr(std::min(arg.find('=') + 1, arg.length()));
+        bool arg_ok = true;
+
+        if (arg.starts_with("--host="))
+            config.host = value;
+        else if (arg.starts_with("--port="))
+            config.port = value;
+        else if (arg.starts_with("--path="))
+            config.target = value;
+        else if (arg.starts_with("--connections="))
+            arg_ok = parseNumber(value, config.connections);
+        else if (arg.starts_with("--threads="))
+            arg_ok = parseNumber(value, config.threads);
+        else if (arg.starts_with("--pipeline="))
+            arg_ok = parseNumber(value, config.pipeline_depth);
+        else if (arg.starts_with("--duration="))
+        {
+            double seconds = 0.0;
+            arg_ok = parseNumber(value, seconds);
+            config.duration = std::chrono::milliseconds {static_cast<long long>(seconds * 1000.0)};
+        }
+        else if (arg.starts_with("--rate="))
+        {
+            arg_ok = parseNumber(value, config.rate);
+            config.mode = LoadMode::load_open;
+        }
+        else if (arg == "--no-keepalive")
+            config.keep_alive = false;
+        else
+            arg_ok = false;
+
+        if (!arg_ok)
+        {
+            std::cerr << "toyload: bad option '" << arg << "'\n" << usage_text;
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/// @brief Prints a nanosecond count in the largest unit keeping it at or above 1.
+static void printNanos(std::ostream& out, double nanos)
+{
+    if (nanos < 1e3)
+        out << nanos << " ns";
+    else if (nanos < 1e6)
+        out << nanos / 1e3 << " us";
+    else if (nanos < 1e9)
+        out << nanos / 1e6 << " ms";
+    else
+        out << nanos / 1e9 << " s";
+}
+
+static void printReport(const LoadConfig& config, const LoadResult& result)
+{
+    double seconds = std::chrono::duration<double>(result.elapsed).count();
+    const HdrHistogram& latency = result.latency;
+
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << "toyload: GET http://" << config.host << ':' << config.port << config.target << '\n';
+    std::cout << "  " << ((config.mode == LoadMode::load_open) ? "open loop" : "closed loop") << ", " << config.connections << " connections, " << config.threads << " threads, pipeline " << config.pipeline_depth << ((config.keep_alive) ? ", keep-alive\n" : ", no keep-alive\n");
+
+    if (config.mode == LoadMode::load_open)
+        std::cout << "  target rate  " << config.rate << " req/s, latency counted from each request's due time\n";
+
+    std::cout << "  requests     " << result.completed << " in " << seconds << " s, " << static_cast<double>(result.completed) / seconds << " req/s, " << static_cast<double>(result.bytes_read) / seconds / 1e6 << " MB/s read\n";
+    std::cout << "  errors       " << result.errors << " (failed connects, resets, malformed replies)\n";
+    std::cout << "  non-2xx      " << result.non_2xx << '\n';
+    std::cout << "  unfinished   " << result.unfinished << '\n';
+    std::cout << "  connects     " << result.connects << '\n';
+
+    std::cout << "  latency      p50 ";
+    printNanos(std::cout, static_cast<double>(latency.getValueAtPercentile(50.0)));
+    std::cout << ", p99 ";
+    printNanos(std::cout, static_cast<double>(latency.getValueAtPercentile(99.0)));
+    std::cout << ", p99.9 ";
+    printNanos(std::cout, static_cast<double>(latency.getValueAtPercentile(99.9)));
+    std::cout << ", max ";
+    printNanos(std::cout, static_cast<double>(latency.getMax()));
+    std::cout << ", mean ";
+    printNanos(std::cout, latency.getMean());
+    std::cout << '\n';
+}
+
+int main(int argc, char* argv[])
+{
+    LoadConfig config {"127.0.0.1", "8080", "/", LoadMode::load_closed, 0.0, 16, 1, 1, std::chrono::seconds {10}, true};
+
+    if (!parseArgs(argc, argv, config))
+        return 1;
+
+    try
+    {
+        LoadResult result = runLoad(config);
+        printReport(config, result);
+    }
+    catch (const std::exception& err)
+    {
+        std::cerr << "toyload: " << err.what() << '\n';
+        return 1;
+    }
+
+    return 0;
+}
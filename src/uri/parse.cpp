@@ -21,7 +21,7 @@ namespace ToyServer::Uri
 
     /// Token helper impl.
 
-    std::string getLexeme(const Token& token, const std::string& source)
+    std::string_view getLexeme(const Token& token, std::string_view source)
     {
         return source.substr(token.start, token.length);
     }
@@ -62,7 +62,7 @@ namespace ToyServer::Uri
 
     /// Lexer public impl.
 
-    UrlLexer::UrlLexer(const std::string& url_str)
+    UrlLexer::UrlLexer(std::string_view url_str)
     : symbols {url_str}, pos {0}, limit {url_str.length()} {}
 
     void UrlLexer::swapState(UrlLexer&& other) noexcept
@@ -172,18 +172,20 @@ namespace ToyServer::Uri
 
     UrlFragment UrlParser::parsePath()
     {
-        std::string temp {};
+        // path tokens are adjacent in the source, so the whole path is one view of it
+        std::size_t path_start = peekCurrent().start;
+        std::size_t path_end = path_start;
 
         while (!atEOF())
         {
             if (!matchToken(TokenTag::url_slash) && !matchToken(TokenTag::url_word) && !matchToken(TokenTag::url_dot))
                 break;
 
-            temp += getLexeme(peekCurrent(), symbols);
+            path_end = peekCurrent().start + peekCurrent().length;
             consume(TokenTag::url_any);
         }
 
-        return {temp, FragmentTag::url_path};
+        return {symbols.substr(path_start, path_end - path_start), FragmentTag::url_path};
     }
 
     UrlFragment UrlParser::parseParamPair()
@@ -191,30 +193,25 @@ namespace ToyServer::Uri
         if (atEOF())
             return {};
 
-        std::string key {};
-        std::string value {};
-
         consume(TokenTag::url_word);
-        key = getLexeme(peekBack(), symbols);
+        std::string_view key = getLexeme(peekBack(), symbols);
 
         consume(TokenTag::url_equals);
         consume(TokenTag::url_word);
-        value = getLexeme(peekBack(), symbols);
-
-        std::pair<std::string, std::string> temp {std::move(key), std::move(value)};
+        std::string_view value = getLexeme(peekBack(), symbols);
 
-        return {temp};
+        return {std::pair {key, value}};
     }
 
     /// Parser public impl.
 
     UrlParser::UrlParser()
-    : symbols {}, previous {}, current {}, lexer {std::string {}}
+    : symbols {}, previous {}, current {}, lexer {placeholder_src}
     {
         current.tag = TokenTag::url_eos;
     }
 
-    void UrlParser::reset(const std::string& url_str)
+    void UrlParser::reset(std::string_view url_str)
     {
         symbols = url_str;
         previous = {0, 0, TokenTag::url_unknown};
@@ -225,17 +222,17 @@ namespace ToyServer::Uri
         consume(TokenTag::url_any);
     }
 
-    Url UrlParser::parseAll()
+    Url UrlParser::parseAll(std::pmr::memory_resource* resource)
     {
         // 1. parse first thing- the path!
         UrlFragment path_frag = parsePath();
-        auto path_str = unpackFragment<FragmentTag::url_path>(path_frag);
+        std::pmr::string path_str {unpackFragment<FragmentTag::url_path>(path_frag), resource};
         
         // 2. handle optional query if needed...
         if (matchToken(TokenTag::url_question))
         {
             consume(TokenTag::url_question);
-            std::map<std::string, std::string> params {};
+            url_params_t params {resource};
 
             while (true)
             {
@@ -251,12 +248,13 @@ namespace ToyServer::Uri
 
                 auto [key, value] = unpackFragment<FragmentTag::url_param>(frag);
 
-                params[key] = std::move(value);
+                // a repeated key keeps its last value
+                params.insert_or_assign(std::pmr::string {key, resource}, value);
             }
 
-            return {path_str, params};
+            return {std::move(path_str), std::move(params)};
         }
 
-        return {path_str};
+        return Url {std::move(path_str)};
     }
 }
@@ -0,0 +1,205 @@
+/**
+ * @file view.cpp
+ * @author DrkWithT
+ * @brief Implements the single pass URL splitter and on-demand percent decoding.
+ * @date 2024-09-01
+ */
+
+#include <array>
+#include <cstdint>
+#include <stdexcept>
+#include "uri/view.hpp"
+
+namespace ToyServer::Uri
+{
+    /// @brief Octets a path or query may hold as is: RFC 3986 unreserved, sub-delims, ':', '@' and '/'. The '%', '?' and '#' delimiters are handled by the parser itself.
+    static constexpr std::array<bool, 256> url_octets = [] {
+        std::array<bool, 256> table {};
+
+        for (char c = 'a'; c <= 'z'; c++)
+            table[static_cast<unsigned char>(c)] = true;
+
+        for (char c = 'A'; c <= 'Z'; c++)
+            table[static_cast<unsigned char>(c)] = true;
+
+        for (char c = '0'; c <= '9'; c++)
+            table[static_cast<unsigned char>(c)] = true;
+
+        for (char c : std::string_view {"-._~!$&'()*+,;=:@/"})
+            table[static_cast<unsigned char>(c)] = true;
+
+        return table;
+    }();
+
+    static constexpr int hexDigitValue(char c) noexcept
+    {
+        if (c >= '0' && c <= '9')
+            return c - '0';
+        else if (c >= 'a' && c <= 'f')
+            return c - 'a' + 10;
+        else if (c >= 'A' && c <= 'F')
+            return c - 'A' + 10;
+
+        return -1;
+    }
+
+    /* QueryIterator private impl. */
+
+    void QueryIterator::advance() noexcept
+    {
+        while (!rest.empty())
+        {
+            std::size_t pair_end = rest.find('&');
+            std::string_view pair = rest.substr(0, pair_end);
+
+            rest.remove_prefix((pair_end == std::string_view::npos) ? rest.length() : pair_end + 1);
+
+            if (pair.empty())
+                continue;
+
+            std::size_t equals_pos = pair.find('=');
+
+            if (equals_pos == std::string_view::npos)
+                current = {pair, pair.substr(pair.length())};
+            else
+                current = {pair.substr(0, equals_pos), pair.substr(equals_pos + 1)};
+
+            return;
+        }
+
+        current = {};
+        at_end = true;
+    }
+
+    /* QueryIterator public impl. */
+
+    QueryIterator::QueryIterator(std::string_view query) noexcept
+    : rest {query}, current {}, at_end {false}
+    {
+        advance();
+    }
+
+    /* QueryParams impl. */
+
+    std::optional<std::string_view> QueryParams::find(std::string_view key) const noexcept
+    {
+        for (const auto& [param_key, param_value] : *this)
+        {
+            if (param_key == key)
+                return param_value;
+        }
+
+        return {};
+    }
+
+    /* UrlView helpers impl. */
+
+    std::optional<UrlView> parseUrlView(std::string_view target) noexcept
+    {
+        if (target.empty() || target.front() != '/')
+            return {};
+
+        const char* text = target.data();
+        std::size_t length = target.length();
+        std::size_t query_start = std::string_view::npos;
+        std::size_t pos = 0;
+
+        // one sweep validates every octet and notes the delimiters, so nothing is looked at twice
+        while (pos < length)
+        {
+            char c = text[pos];
+
+            if (url_octets[static_cast<unsigned char>(c)])
+            {
+                pos++;
+            }
+            else if (c == '%')
+            {
+                if (pos + 2 >= length || hexDigitValue(text[pos + 1]) == -1 || hexDigitValue(text[pos + 2]) == -1)
+                    return {};
+
+                pos += 3;
+            }
+            else if (c == '?')
+            {
+                // a later '?' is just query text
+                if (query_start == std::string_view::npos)
+                    query_start = pos + 1;
+
+                pos++;
+            }
+            else if (c == '#')
+            {
+                length = pos;
+            }
+            else
+            {
+                return {};
+            }
+        }
+
+        if (query_start == std::string_view::npos)
+            return UrlView {target.substr(0, length), {}};
+
+        return UrlView {target.substr(0, query_start - 1), target.substr(query_start, length - query_start)};
+    }
+
+    std::optional<std::size_t> percentDecode(std::string_view raw, char* out, bool plus_as_space) noexcept
+    {
+        std::size_t out_len = 0;
+
+        for (std::size_t pos = 0; pos < raw.length(); pos++)
+        {
+            char c = raw[pos];
+
+            if (c == '%')
+            {
+                int high = (pos + 2 < raw.length()) ? hexDigitValue(raw[pos + 1]) : -1;
+                int low = (high != -1) ? hexDigitValue(raw[pos + 2]) : -1;
+
+                if (low == -1)
+                    return {};
+
+                c = static_cast<char>(high * 16 + low);
+                pos += 2;
+            }
+            else if (c == '+' && plus_as_space)
+            {
+                c = ' ';
+            }
+
+            out[out_len++] = c;
+        }
+
+        return out_len;
+    }
+
+    std::pmr::string decodeComponent(std::string_view raw, bool plus_as_space, std::pmr::memory_resource* resource)
+    {
+        std::pmr::string decoded {raw, resource};
+
+        auto decoded_len = percentDecode(decoded, decoded.data(), plus_as_space);
+
+        if (!decoded_len)
+            throw std::runtime_error {"ParseErr: malformed percent escape."};
+
+        decoded.resize(*decoded_len);
+
+        return decoded;
+    }
+
+    Url toOwnedUrl(const UrlView& view, std::pmr::memory_resource* resource)
+    {
+        std::pmr::string path {view.path, resource};
+
+        if (view.query.empty())
+            return Url {std::move(path)};
+
+        url_params_t params {resource};
+
+        for (const auto& [key, value] : view.getParams())
+            params.insert_or_assign(std::pmr::string {key, resource}, value);
+
+        return {std::move(path), std::move(params)};
+    }
+}
@@ -0,0 +1,950 @@
+/**
+ * @file test_http1.cpp
+ * @author DrkWithT
+ * @brief Implements unit test for HTTP/1.x parsing helpers and sessions.
+ * @date 2024-08-20
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include "http1/cache.hpp"
+#include "http1/parser.hpp"
+#include "http1/router.hpp"
+#include "http1/scanner.hpp"
+#include "http1/session.hpp"
+#include "http1/statics.hpp"
+
+using namespace ToyServer::Http1;
+using ToyServer::NetIO::FixedBuffer;
+using ToyServer::NetIO::MemoryTransport;
+using ToyServer::NetIO::SocketConfig;
+
+static constexpr ScanLevel all_levels[] {ScanLevel::scan_scalar, ScanLevel::scan_sse2, ScanLevel::scan_avx2};
+
+/// @brief Checks every kernel level against the scalar one for each suffix of `text`, so all block / tail splits get covered.
+static bool kernelsAgree(std::string_view text, ScanSet set)
+{
+    const ScanKernels& scalar = getScanKernels(ScanLevel::scan_scalar);
+
+    for (std::size_t start = 0; start <= text.length(); start++)
+    {
+        std::string_view part = text.substr(start);
+
+        for (ScanLevel level : all_levels)
+        {
+            const ScanKernels& kernels = getScanKernels(level);
+
+            if (kernels.find_any(part.data(), part.length(), set) != scalar.find_any(part.data(), part.length(), set)
+                || kernels.is_token(part.data(), part.length()) != scalar.is_token(part.data(), part.length()))
+            {
+                std::cerr << "Kernel " << kernels.name << " disagrees on: \"" << part << "\"\n";
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+/// @brief Builds the `ETag` a file reply should carry, straight from `stat`.
+static std::string tagOfFile(const std::string& path, Coding coding = Coding::coding_identity)
+{
+    struct stat file_stat {};
+
+    if (stat(path.c_str(), &file_stat) != 0)
+        return {};
+
+    return makeEntityTag(ToyServer::NetIO::FileStats {static_cast<std::size_t>(file_stat.st_size), file_stat.st_mtime, true, false}, coding);
+}
+
+static Response replyWithRoute(const RequestView& req, const RouteParams& params)
+{
+    Response reply = StaticFiles::makeStatusReply(req.schema, Status::stat_ok);
+
+    for (std::size_t param_idx = 0; param_idx < params.size(); param_idx++)
+        reply.headers["X-Param"].append(params[param_idx]).append(";");
+
+    return reply;
+}
+
+static constexpr auto test_router = makeRouter([] {
+    return std::array {
+        Route {Method::h1_get, "/", replyWithRoute},
+        Route {Method::h1_get, "/users", replyWithRoute},
+        Route {Method::h1_get, "/users/me", replyWithRoute},
+        Route {Method::h1_head, "/users/me", replyWithRoute},
+        Route {Method::h1_get, "/users/:id", replyWithRoute},
+        Route {Method::h1_get, "/users/:id/posts/:post", replyWithRoute},
+        Route {Method::h1_get, "/files/*path", replyWithRoute},
+        Route {Method::h1_get, "/api/v1/items/:item", replyWithRoute},
+        Route {Method::h1_get, "/api/v2/items", replyWithRoute}
+    };
+});
+
+/// @brief Drops the `Date` lines of serialized replies, so they compare equal at any time. Each one must be a well-formed IMF-fixdate line.
+static bool stripDateLines(std::string& replies)
+{
+    constexpr std::string_view date_prefix {"Date: "};
+    constexpr std::size_t date_line_size = 37; // "Date: Sun, 06 Nov 1994 08:49:37 GMT\r\n"
+
+    for (std::size_t date_pos = 0; (date_pos = replies.find(date_prefix, date_pos)) != std::string::npos;)
+    {
+        std::string_view date_line = std::string_view {replies}.substr(date_pos, date_line_size);
+
+        if (date_line.length() != date_line_size || date_line[9] != ',' || date_line[13] != ' ' || date_line[25] != ':' || date_line[28] != ':' || !date_line.ends_with(" GMT\r\n"))
+            return false;
+
+        replies.erase(date_pos, date_line_size);
+    }
+
+    return true;
+}
+
+int main()
+{
+    std::cout << "S1...\n";
+    if (findAnyOf("Host: example.com\r\n", scan_colon) != 4 || findAnyOf("Accept-Language: en-US,en;q=0.9\r\n", scan_line_end) != 31 || findAnyOf("no delimiters", scan_lf) != std::string_view::npos)
+    {
+        std::cerr << "Invalid findAnyOf results.\n";
+        return 1;
+    }
+
+    std::cout << "S2...\n";
+    if (!isToken("Sec-Fetch-Mode") || !isToken("X-Custom_Header.v2!#$%&'*+^`|~") || isToken("") || isToken("Bad Name") || isToken("Bad:Name") || isToken("Bad(Name)"))
+    {
+        std::cerr << "Invalid isToken results.\n";
+        return 1;
+    }
+
+    std::cout << "S3...\n";
+    std::string every_octet;
+
+    for (int c = 0; c < 256; c++)
+        every_octet += static_cast<char>(c);
+
+    if (!kernelsAgree(every_octet, scan_line_end) || !kernelsAgree("User-Agent-With-A-Really-Long-Token-Name-To-Span-Blocks:\r\n", scan_colon) || !kernelsAgree("GET /some/long/path/for/blocks?x=1 HTTP/1.1\r\n", scan_sp))
+        return 1;
+
+    // a separator placed at every offset of a long valid token
+    for (std::size_t bad_pos = 0; bad_pos < 70; bad_pos++)
+    {
+        std::string token (70, 'a');
+        token[bad_pos] = '"';
+
+        if (!kernelsAgree(token, scan_lf))
+            return 1;
+    }
+
+    std::cout << "H1...\n";
+    // every known name must find itself whatever its case, and near misses must not
+    for (std::size_t name_idx = 0; name_idx < known_field_count; name_idx++)
+    {
+        std::string upper_name {field_names[name_idx]};
+
+        for (char& c : upper_name)
+            c = static_cast<char>((c >= 'a' && c <= 'z') ? c - 'a' + 'A' : c);
+
+        if (lookupField(field_names[name_idx]) != static_cast<FieldId>(name_idx) || lookupField(upper_name) != static_cast<FieldId>(name_idx)
+            || lookupField(upper_name + "x") != FieldId::f_unknown || lookupField(upper_name.substr(1)) != FieldId::f_unknown)
+        {
+            std::cerr << "Invalid field lookup for " << field_names[name_idx] << '\n';
+            return 1;
+        }
+    }
+
+    HeaderFields reply_fields {};
+    reply_fields["content-type"] = "text/plain";
+    reply_fields["X-Trace"] = "1";
+    reply_fields[FieldId::f_content_type] += "; charset=utf-8";
+
+    if (reply_fields.size() != 2 || !reply_fields.contains(FieldId::f_content_type) || !reply_fields.contains("x-trace")
+        || reply_fields.contains(FieldId::f_vary) || reply_fields.begin()->name != "Content-Type" || reply_fields.begin()->value != "text/plain; charset=utf-8")
+    {
+        std::cerr << "Invalid reply header store.\n";
+        return 1;
+    }
+
+    // a known field added past the 255th must still get its own position
+    for (int field_idx = 0; field_idx < 300; field_idx++)
+        reply_fields["X-Extra-" + std::to_string(field_idx)] = "1";
+
+    reply_fields[FieldId::f_vary] = "Accept-Encoding";
+
+    if (reply_fields.size() != 303 || reply_fields[FieldId::f_vary] != "Accept-Encoding" || reply_fields[FieldId::f_content_type] != "text/plain; charset=utf-8")
+    {
+        std::cerr << "Invalid reply header store past 255 fields.\n";
+        return 1;
+    }
+
+    std::cout << "P1...\n";
+    // a request arriving one octet at a time, into a buffer that moves on every call, completes only with its last body octet
+    {
+        std::string_view wire {"\r\nPOST /form?x=1 HTTP/1.1\r\nHost: a.test\r\nContent-Length: 5\r\nX-Note:  spaced \r\n\r\nhello"};
+        RequestParser parser {};
+        ParseStatus status = ParseStatus::parse_need_more;
+        std::string moving;
+
+        for (std::size_t fed = 1; fed <= wire.length(); fed++)
+        {
+            moving = std::string {wire.substr(0, fed)};
+            moving.shrink_to_fit();
+            status = parser.feed(moving);
+
+            if ((status == ParseStatus::parse_complete) != (fed == wire.length()))
+            {
+                std::cerr << "Parser finished early or late at octet " << fed << '\n';
+                return 1;
+            }
+        }
+
+        const RequestView& fed_view = parser.getView();
+
+        if (fed_view.method_txt != "POST" || fed_view.target != "/form?x=1" || fed_view.schema != Schema::http_1_1 || fed_view.headers.size() != 3
+            || fed_view.findHeader(FieldId::f_host) != "a.test" || fed_view.findHeader("x-note") != "spaced" || fed_view.body != "hello"
+            || parser.getRequestLength() != wire.length())
+        {
+            std::cerr << "Invalid incrementally parsed request.\n";
+            return 1;
+        }
+
+        auto feedWhole = [&parser](std::string_view text) {
+            parser.reset();
+            return parser.feed(text);
+        };
+
+        if (feedWhole("GET / HTTP/1.1\r\nBad Name: x\r\n\r\n") != ParseStatus::parse_error || parser.getError() != "ParseErr: malformed header."
+            || feedWhole("GET / HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n5\r\n") != ParseStatus::parse_complete || !parser.isChunked()
+            || parser.getRequestLength() != 46 || feedWhole("GET / HTTP/1.1\r\nContent-Length: 9\r\n\r\nabc") != ParseStatus::parse_need_more
+            || !parser.isHeadDone() || feedWhole("GET /\r\n") != ParseStatus::parse_error)
+        {
+            std::cerr << "Invalid parser status or framing.\n";
+            return 1;
+        }
+
+        // conflicting lengths are a smuggling vector, repeated equal ones are harmless
+        if (feedWhole("POST / HTTP/1.1\r\nContent-Length: 3\r\nX-A: 1\r\ncontent-length: 30\r\n\r\nabc") != ParseStatus::parse_error || parser.getError() != "ParseErr: conflicting Content-Length."
+            || feedWhole("POST / HTTP/1.1\r\nContent-Length: 3\r\nContent-Length: 3\r\n\r\nabc") != ParseStatus::parse_complete || parser.getContentLength() != 3
+            || feedWhole("POST / HTTP/1.1\r\nContent-Length: 3\r\nContent-Length: x\r\n\r\nabc") != ParseStatus::parse_error)
+        {
+            std::cerr << "Repeated Content-Length not checked.\n";
+            return 1;
+        }
+
+        // unknown versions are refused, later 1.x minors are served as 1.1
+        if (feedWhole("GET / HTTP/2.0\r\n\r\n") != ParseStatus::parse_error || parser.getError() != "ParseErr: malformed request line."
+            || feedWhole("GET / FOO\r\n\r\n") != ParseStatus::parse_error || feedWhole("GET / HTTP/1.x\r\n\r\n") != ParseStatus::parse_error
+            || feedWhole("GET / HTTP/1.2\r\n\r\n") != ParseStatus::parse_complete || parser.getView().schema != Schema::http_1_1)
+        {
+            std::cerr << "Invalid handling of request versions.\n";
+            return 1;
+        }
+
+        parser.setHeadLimit(16);
+
+        if (feedWhole("GET /a/long/path HTTP/1.1\r\n") != ParseStatus::parse_error || parser.getError() != "ParseErr: request head too large.")
+        {
+            std::cerr << "Parser head limit not enforced.\n";
+            return 1;
+        }
+    }
+
+    std::cout << "R1...\n";
+    // static segments win over captures, and a dead end under "me" falls back to the capture
+    {
+        auto matchedPattern = [](Method method, std::string_view path) -> std::string_view {
+            RouteMatch match = test_router.match(method, path);
+            return (match.route) ? match.route->pattern : "none";
+        };
+
+        RouteMatch post_match = test_router.match(Method::h1_get, "/users/me/posts/7");
+        RouteMatch file_match = test_router.match(Method::h1_get, "/files/css/site.css");
+        RouteMatch empty_tail = test_router.match(Method::h1_get, "/files/");
+
+        if (matchedPattern(Method::h1_get, "/") != "/" || matchedPattern(Method::h1_get, "/users") != "/users"
+            || matchedPattern(Method::h1_head, "/users/me") != "/users/me" || matchedPattern(Method::h1_get, "/users/42") != "/users/:id"
+            || matchedPattern(Method::h1_head, "/users/42") != "none" || matchedPattern(Method::h1_get, "/users/") != "none"
+            || matchedPattern(Method::h1_get, "/api/v1/items") != "none" || matchedPattern(Method::h1_get, "/api/v2/items") != "/api/v2/items"
+            || !post_match.route || post_match.params.find("id") != "me" || post_match.params.find("post") != "7"
+            || !file_match.route || file_match.params.find("path") != "css/site.css" || !empty_tail.route || empty_tail.params.find("path") != ""
+            || test_router.match(Method::h1_get, "/api/v1/items/9").params.find("nope"))
+        {
+            std::cerr << "Invalid route matches.\n";
+            return 1;
+        }
+
+        RequestView routed_req {Schema::http_1_1, Method::h1_get, "GET", "/users/5/posts/6?full=1", {}, {}, {}};
+        RequestView missing_req {Schema::http_1_1, Method::h1_get, "GET", "/nowhere", {}, {}, {}};
+        Response routed = test_router(routed_req);
+
+        if (routed.status != Status::stat_ok || routed.headers["X-Param"] != "5;6;" || test_router(missing_req).status != Status::stat_not_found)
+        {
+            std::cerr << "Invalid routed replies.\n";
+            return 1;
+        }
+    }
+
+    std::cout << "E1...\n";
+    // one date line per second per thread, and bare error replies come whole from the canned heads
+    {
+        std::string date_line {getDateLine()};
+
+        if (!stripDateLines(date_line) || !date_line.empty() || getStatusLine(Schema::http_1_0, Status::stat_not_implemented) != "HTTP/1.0 501 Not Implemented\r\n"
+            || getStatusLine(Schema::http_unknown, Status::stat_ok) != "HTTP/1.1 500 Internal Server Error\r\n")
+        {
+            std::cerr << "Invalid date or status line.\n";
+            return 1;
+        }
+    }
+
+    std::cout << "D1...\n";
+    std::string_view chunked_body {"5;name=value\r\nhello\r\n6\r\n world\r\n0\r\nX-Trailer: yes\r\n\r\n"};
+
+    // every split point of the input must decode to the same body
+    for (std::size_t split_pos = 0; split_pos <= chunked_body.length(); split_pos++)
+    {
+        ChunkedDecoder decoder {};
+        std::string decoded;
+
+        for (std::string_view part : {chunked_body.substr(0, split_pos), chunked_body.substr(split_pos)})
+        {
+            while (!part.empty() && !decoder.isDone())
+            {
+                auto [consumed, data] = decoder.decode(part);
+                decoded.append(data);
+                part.remove_prefix(consumed);
+            }
+        }
+
+        if (!decoder.isDone() || decoded != "hello world")
+        {
+            std::cerr << "Invalid chunked decoding with split at " << split_pos << ": \"" << decoded << "\"\n";
+            return 1;
+        }
+    }
+
+    bool bad_size_caught = false;
+
+    try
+    {
+        ChunkedDecoder decoder {};
+        [[maybe_unused]] auto step = decoder.decode("5x\r\nhello\r\n");
+    }
+    catch (const std::runtime_error&)
+    {
+        bad_size_caught = true;
+    }
+
+    if (!bad_size_caught)
+    {
+        std::cerr << "Malformed chunk size was accepted.\n";
+        return 1;
+    }
+
+    std::cout << "K1...\n";
+    int pipe_fds[2] {};
+
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, pipe_fds) != 0)
+    {
+        std::cerr << "Failed to create socket pair.\n";
+        return 1;
+    }
+
+    // three pipelined requests in one write, the last one ends the connection
+    std::string_view pipelined {
+        "GET /a HTTP/1.1\r\nHost: x\r\n\r\n"
+        "GET /b HTTP/1.1\r\nHost: x\r\n\r\n"
+        "GET /c HTTP/1.1\r\nHost: x\r\nConnection: close\r\n\r\n"
+    };
+
+    [[maybe_unused]] auto write_rc = write(pipe_fds[1], pipelined.data(), pipelined.length());
+    std::size_t served_count = 0;
+
+    {
+        HttpSession session {SocketConfig {pipe_fds[0], 0, 0}, [](const RequestView& req) {
+            FixedBuffer body {req.target.length()};
+            std::copy(req.target.begin(), req.target.end(), body.getBasePtr());
+
+            return Response {req.schema, Status::stat_ok, "", {}, std::move(body)};
+        }, SessionLimits {1000, 100}};
+
+        served_count = session.serve();
+    }
+
+    std::string replies;
+    char read_buf[512];
+
+    for (ssize_t read_count = 0; (read_count = read(pipe_fds[1], read_buf, sizeof(read_buf))) > 0;)
+        replies.append(read_buf, static_cast<std::size_t>(read_count));
+
+    close(pipe_fds[1]);
+
+    std::string_view expected_replies {
+        "HTTP/1.1 200 OK\r\nContent-Length: 2\r\nConnection: keep-alive\r\n\r\n/a"
+        "HTTP/1.1 200 OK\r\nContent-Length: 2\r\nConnection: keep-alive\r\n\r\n/b"
+        "HTTP/1.1 200 OK\r\nContent-Length: 2\r\nConnection: close\r\n\r\n/c"
+    };
+
+    if (served_count != 3 || !stripDateLines(replies) || replies != expected_replies)
+    {
+        std::cerr << "Invalid pipelined replies (" << served_count << "):\n" << replies << '\n';
+        return 1;
+    }
+
+    std::cout << "K2...\n";
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, pipe_fds) != 0)
+    {
+        std::cerr << "Failed to create socket pair.\n";
+        return 1;
+    }
+
+    // the second handler throws: the first reply still goes out, then a 500 ends the connection
+    std::string_view failing_pipeline {
+        "GET /a HTTP/1.1\r\nHost: x\r\n\r\n"
+        "GET /boom HTTP/1.1\r\nHost: x\r\n\r\n"
+        "GET /c HTTP/1.1\r\nHost: x\r\n\r\n"
+    };
+
+    write_rc = write(pipe_fds[1], failing_pipeline.data(), failing_pipeline.length());
+
+    {
+        HttpSession session {SocketConfig {pipe_fds[0], 0, 0}, [](const RequestView& req) {
+            if (req.target == "/boom")
+                throw std::runtime_error {"handler failed"};
+
+            FixedBuffer body {req.target.length()};
+            std::copy(req.target.begin(), req.target.end(), body.getBasePtr());
+
+            return Response {req.schema, Status::stat_ok, "", {}, std::move(body)};
+        }, SessionLimits {1000, 100}};
+
+        served_count = session.serve();
+    }
+
+    replies.clear();
+
+    for (ssize_t read_count = 0; (read_count = read(pipe_fds[1], read_buf, sizeof(read_buf))) > 0;)
+        replies.append(read_buf, static_cast<std::size_t>(read_count));
+
+    close(pipe_fds[1]);
+
+    std::string_view expected_failure {
+        "HTTP/1.1 200 OK\r\nContent-Length: 2\r\nConnection: keep-alive\r\n\r\n/a"
+        "HTTP/1.1 500 Internal Server Error\r\nContent-Length: 0\r\nConnection: close\r\n\r\n"
+    };
+
+    if (served_count != 1 || !stripDateLines(replies) || replies != expected_failure)
+    {
+        std::cerr << "Invalid replies around a failing handler (" << served_count << "):\n" << replies << '\n';
+        return 1;
+    }
+
+    std::cout << "B1...\n";
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, pipe_fds) != 0)
+    {
+        std::cerr << "Failed to create socket pair.\n";
+        return 1;
+    }
+
+    // a chunked upload, then two bodies past the read-ahead: one left unread by the handler, one counted
+    std::string upload_requests {"POST /echo HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n5;name=value\r\nhello\r\n6\r\n world\r\n0\r\n\r\n"};
+    upload_requests.append("POST /skip HTTP/1.1\r\nContent-Length: 20000\r\n\r\n").append(20000, 'q');
+    upload_requests.append("POST /count HTTP/1.1\r\nContent-Length: 20000\r\n\r\n").append(20000, 'q');
+    upload_requests.append("GET /count HTTP/1.1\r\nConnection: close\r\n\r\n");
+
+    write_rc = write(pipe_fds[1], upload_requests.data(), upload_requests.length());
+
+    {
+        HttpSession session {SocketConfig {pipe_fds[0], 0, 0}, [](const RequestView& req) {
+            std::string reply_text;
+
+            if (req.target == "/echo")
+            {
+                for (std::string_view slice = req.body_reader->readSome(); !slice.empty(); slice = req.body_reader->readSome())
+                    reply_text.append(slice);
+            }
+            else if (req.target == "/count")
+            {
+                while (!req.body_reader->readSome().empty()) {}
+
+                reply_text = std::to_string(req.body_reader->getReadCount());
+            }
+
+            FixedBuffer body {reply_text.length()};
+            std::copy(reply_text.begin(), reply_text.end(), body.getBasePtr());
+
+            return Response {req.schema, Status::stat_ok, "", {}, std::move(body)};
+        }, SessionLimits {1000, 100}};
+
+        served_count = session.serve();
+    }
+
+    replies.clear();
+
+    for (ssize_t read_count = 0; (read_count = read(pipe_fds[1], read_buf, sizeof(read_buf))) > 0;)
+        replies.append(read_buf, static_cast<std::size_t>(read_count));
+
+    close(pipe_fds[1]);
+
+    std::string_view expected_uploads {
+        "HTTP/1.1 200 OK\r\nContent-Length: 11\r\nConnection: keep-alive\r\n\r\nhello world"
+        "HTTP/1.1 200 OK\r\nContent-Length: 0\r\nConnection: keep-alive\r\n\r\n"
+        "HTTP/1.1 200 OK\r\nContent-Length: 5\r\nConnection: keep-alive\r\n\r\n20000"
+        "HTTP/1.1 200 OK\r\nContent-Length: 1\r\nConnection: close\r\n\r\n0"
+    };
+
+    if (served_count != 4 || !stripDateLines(replies) || replies != expected_uploads)
+    {
+        std::cerr << "Invalid upload replies (" << served_count << "):\n" << replies << '\n';
+        return 1;
+    }
+
+    std::cout << "M1...\n";
+    // the same reader and writer over an in-memory transport that moves at most 7 octets per read or write
+    {
+        MemoryTransport memory_pipe {};
+        BasicHttpReader<MemoryTransport> memory_reader {};
+        BasicHttpWriter<MemoryTransport> memory_writer {&memory_pipe};
+
+        memory_pipe.setMaxTransfer(7);
+        memory_pipe.pushInput("GET /a HTTP/1.1\r\nHost: x\r\n\r\nPOST /b HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n3\r\nabc\r\n0\r\n\r\n");
+        memory_pipe.pushInput("\r\nPOST /c HTTP/1.1\r\nContent-Length: 2\r\n\r\nde");
+        memory_pipe.closeInput();
+        memory_reader.resetState(&memory_pipe);
+
+        for (int request_idx = 0; request_idx < 3; request_idx++)
+        {
+            RequestView req = memory_reader.nextView();
+            std::string reply_text {req.target};
+
+            for (std::string_view slice = req.body_reader->readSome(); !slice.empty(); slice = req.body_reader->readSome())
+                reply_text.append(slice);
+
+            FixedBuffer body {reply_text.length()};
+            std::copy(reply_text.begin(), reply_text.end(), body.getBasePtr());
+
+            memory_writer.queueReply(Response {req.schema, Status::stat_ok, "", {}, std::move(body)}, request_idx < 2);
+        }
+
+        memory_writer.flush();
+
+        bool closed_caught = false;
+
+        try
+        {
+            [[maybe_unused]] RequestView extra = memory_reader.nextView();
+        }
+        catch (const std::runtime_error&)
+        {
+            closed_caught = true;
+        }
+
+        std::string memory_replies {memory_pipe.getOutput()};
+        std::string_view expected_memory_replies {
+            "HTTP/1.1 200 OK\r\nContent-Length: 2\r\nConnection: keep-alive\r\n\r\n/a"
+            "HTTP/1.1 200 OK\r\nContent-Length: 5\r\nConnection: keep-alive\r\n\r\n/babc"
+            "HTTP/1.1 200 OK\r\nContent-Length: 4\r\nConnection: close\r\n\r\n/cde"
+        };
+
+        if (!closed_caught || !stripDateLines(memory_replies) || memory_replies != expected_memory_replies)
+        {
+            std::cerr << "Invalid in-memory replies:\n" << memory_replies << '\n';
+            return 1;
+        }
+
+        // 204 and 304 replies must not announce a length
+        MemoryTransport bodiless_pipe {};
+        BasicHttpWriter<MemoryTransport> bodiless_writer {&bodiless_pipe};
+
+        bodiless_writer.queueReply(Response {Schema::http_1_1, Status::stat_no_content, "", {}, FixedBuffer {0}}, true);
+        bodiless_writer.queueReply(Response {Schema::http_1_1, Status::stat_not_modified, "", {}, FixedBuffer {0}}, false);
+        bodiless_writer.flush();
+
+        std::string bodiless_replies {bodiless_pipe.getOutput()};
+
+        if (!stripDateLines(bodiless_replies) || bodiless_replies != "HTTP/1.1 204 No Content\r\nConnection: keep-alive\r\n\r\nHTTP/1.1 304 Not Modified\r\nConnection: close\r\n\r\n")
+        {
+            std::cerr << "Invalid bodiless replies:\n" << bodiless_replies << '\n';
+            return 1;
+        }
+    }
+
+    std::cout << "W1...\n";
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, pipe_fds) != 0)
+    {
+        std::cerr << "Failed to create socket pair.\n";
+        return 1;
+    }
+
+    // far beyond one socket buffer, so the gathering write must resume after partial sends
+    constexpr std::size_t big_body_len = 1 << 20;
+    std::string big_reply;
+
+    std::thread drain_thread {[&big_reply, peer_fd = pipe_fds[1]]() {
+        char drain_buf[4096];
+
+        for (ssize_t read_count = 0; (read_count = read(peer_fd, drain_buf, sizeof(drain_buf))) > 0;)
+            big_reply.append(drain_buf, static_cast<std::size_t>(read_count));
+    }};
+
+    {
+        ToyServer::NetIO::ClientSocket big_socket {SocketConfig {pipe_fds[0], 0, 0}};
+        HttpWriter writer {&big_socket};
+        FixedBuffer big_body {big_body_len};
+
+        for (std::size_t body_pos = 0; body_pos < big_body_len; body_pos++)
+            big_body[body_pos] = static_cast<char>('a' + body_pos % 26);
+
+        writer.writeReply({Schema::http_1_1, Status::stat_ok, "", {}, std::move(big_body)});
+    }
+
+    drain_thread.join();
+    close(pipe_fds[1]);
+
+    std::string_view big_head {"HTTP/1.1 200 OK\r\nContent-Length: 1048576\r\nConnection: close\r\n\r\n"};
+
+    if (!stripDateLines(big_reply) || big_reply.length() != big_head.length() + big_body_len || !big_reply.starts_with(big_head) || big_reply.back() != static_cast<char>('a' + (big_body_len - 1) % 26))
+    {
+        std::cerr << "Invalid large reply of " << big_reply.length() << " octets.\n";
+        return 1;
+    }
+
+    std::cout << "T1...\n";
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, pipe_fds) != 0)
+    {
+        std::cerr << "Failed to create socket pair.\n";
+        return 1;
+    }
+
+    // the HTTP/1.0 request cannot be chunked, so its body ends with the connection
+    std::string_view stream_requests {
+        "GET /stream HTTP/1.1\r\n\r\n"
+        "GET /stream HTTP/1.0\r\nConnection: keep-alive\r\n\r\n"
+    };
+
+    write_rc = write(pipe_fds[1], stream_requests.data(), stream_requests.length());
+    std::string big_piece (20000, 'z');
+    std::string streamed_replies;
+
+    std::thread stream_drain {[&streamed_replies, peer_fd = pipe_fds[1]]() {
+        char drain_buf[4096];
+
+        for (ssize_t read_count = 0; (read_count = read(peer_fd, drain_buf, sizeof(drain_buf))) > 0;)
+            streamed_replies.append(drain_buf, static_cast<std::size_t>(read_count));
+    }};
+
+    {
+        HttpSession session {SocketConfig {pipe_fds[0], 0, 0}, [&big_piece](const RequestView& req) {
+            Response res {req.schema, Status::stat_ok, "", {}, FixedBuffer {0}};
+            res.body_stream = [&big_piece](ChunkSink& sink) {
+                sink.write("ab");
+                sink.write("cd");
+                sink.write(big_piece);
+                sink.write("ef");
+            };
+
+            return res;
+        }, SessionLimits {1000, 100}};
+
+        served_count = session.serve();
+    }
+
+    stream_drain.join();
+    close(pipe_fds[1]);
+
+    std::string expected_streams {"HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\nConnection: keep-alive\r\n\r\n4\r\nabcd\r\n4e20\r\n"};
+    expected_streams.append(big_piece).append("\r\n2\r\nef\r\n0\r\n\r\n");
+    expected_streams.append("HTTP/1.0 200 OK\r\nConnection: close\r\n\r\nabcd").append(big_piece).append("ef");
+
+    if (served_count != 2 || !stripDateLines(streamed_replies) || streamed_replies != expected_streams)
+    {
+        std::cerr << "Invalid streamed replies (" << served_count << "):\n" << streamed_replies.substr(0, 200) << '\n';
+        return 1;
+    }
+
+    std::cout << "F1...\n";
+    char doc_root[] = "/tmp/toyserver_docs_XXXXXX";
+
+    if (mkdtemp(doc_root) == nullptr || mkdir((std::string {doc_root} + "/docs").c_str(), 0700) != 0)
+    {
+        std::cerr << "Failed to create document root.\n";
+        return 1;
+    }
+
+    std::ofstream {std::string {doc_root} + "/hello.txt"} << "hello file";
+    std::ofstream {std::string {doc_root} + "/docs/index.html"} << "<p>docs</p>";
+
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, pipe_fds) != 0)
+    {
+        std::cerr << "Failed to create socket pair.\n";
+        return 1;
+    }
+
+    std::string_view file_requests {
+        "GET /hello.txt HTTP/1.1\r\n\r\n"
+        "HEAD /hello.txt?v=2 HTTP/1.1\r\n\r\n"
+        "GET /docs/../../etc/passwd HTTP/1.1\r\n\r\n"
+        "GET /missing.css HTTP/1.1\r\n\r\n"
+        "GET /docs HTTP/1.1\r\nConnection: close\r\n\r\n"
+    };
+
+    write_rc = write(pipe_fds[1], file_requests.data(), file_requests.length());
+
+    {
+        StaticFiles statics {doc_root};
+        HttpSession session {SocketConfig {pipe_fds[0], 0, 0}, [&statics](const RequestView& req) {
+            return statics.serve(req);
+        }, SessionLimits {1000, 100}};
+
+        served_count = session.serve();
+    }
+
+    replies.clear();
+
+    for (ssize_t read_count = 0; (read_count = read(pipe_fds[1], read_buf, sizeof(read_buf))) > 0;)
+        replies.append(read_buf, static_cast<std::size_t>(read_count));
+
+    close(pipe_fds[1]);
+
+    std::string hello_tag = tagOfFile(std::string {doc_root} + "/hello.txt");
+    std::string docs_tag = tagOfFile(std::string {doc_root} + "/docs/index.html");
+    std::string expected_files = "HTTP/1.1 200 OK\r\nContent-Type: text/plain; charset=utf-8\r\nVary: Accept-Encoding\r\nETag: " + hello_tag + "\r\nContent-Length: 10\r\nConnection: keep-alive\r\n\r\nhello file"
+        + "HTTP/1.1 200 OK\r\nContent-Type: text/plain; charset=utf-8\r\nVary: Accept-Encoding\r\nETag: " + hello_tag + "\r\nContent-Length: 10\r\nConnection: keep-alive\r\n\r\n"
+        + "HTTP/1.1 400 Bad Request\r\nContent-Length: 0\r\nConnection: keep-alive\r\n\r\n"
+        + "HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\nConnection: keep-alive\r\n\r\n"
+        + "HTTP/1.1 200 OK\r\nContent-Type: text/html; charset=utf-8\r\nVary: Accept-Encoding\r\nETag: " + docs_tag + "\r\nContent-Length: 11\r\nConnection: close\r\n\r\n<p>docs</p>";
+
+    if (served_count != 5 || !stripDateLines(replies) || replies != expected_files)
+    {
+        std::cerr << "Invalid file replies (" << served_count << "):\n" << replies << '\n';
+        return 1;
+    }
+
+    std::cout << "F2...\n";
+    // the peer resets midway through a file body: sendfile must not raise SIGPIPE, the session just ends
+    std::ofstream {std::string {doc_root} + "/big.bin"} << std::string(4 << 20, 'b');
+
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, pipe_fds) != 0)
+    {
+        std::cerr << "Failed to create socket pair.\n";
+        return 1;
+    }
+
+    std::string_view big_request {"GET /big.bin HTTP/1.1\r\n\r\n"};
+    write_rc = write(pipe_fds[1], big_request.data(), big_request.length());
+    std::size_t partial_count = 0;
+
+    {
+        std::thread resetter {[&partial_count, peer_fd = pipe_fds[1]] {
+            char partial_buf[4096];
+
+            for (ssize_t read_count = 0; partial_count < 65536 && (read_count = read(peer_fd, partial_buf, sizeof(partial_buf))) > 0;)
+                partial_count += static_cast<std::size_t>(read_count);
+
+            close(peer_fd);
+        }};
+
+        StaticFiles statics {doc_root};
+        HttpSession session {SocketConfig {pipe_fds[0], 0, 0}, [&statics](const RequestView& req) {
+            return statics.serve(req);
+        }, SessionLimits {1000, 100}};
+
+        served_count = session.serve();
+        resetter.join();
+    }
+
+    if (served_count > 1 || partial_count < 65536)
+    {
+        std::cerr << "Invalid reset during file body (" << served_count << " served, " << partial_count << " octets read).\n";
+        return 1;
+    }
+
+    std::cout << "F3...\n";
+    // a symlink is served only while its target stays beneath the document root
+    char outside_dir[] = "/tmp/toyserver_outside_XXXXXX";
+
+    if (mkdtemp(outside_dir) == nullptr)
+    {
+        std::cerr << "Failed to create outside directory.\n";
+        return 1;
+    }
+
+    std::ofstream {std::string {outside_dir} + "/secret.txt"} << "secret";
+
+    if (symlink((std::string {outside_dir} + "/secret.txt").c_str(), (std::string {doc_root} + "/escape.txt").c_str()) != 0
+        || symlink("hello.txt", (std::string {doc_root} + "/alias.txt").c_str()) != 0)
+    {
+        std::cerr << "Failed to create symlinks.\n";
+        return 1;
+    }
+
+    {
+        StaticFiles statics {doc_root};
+        Response escape_reply = statics.serve(Method::h1_get, Schema::http_1_1, "/escape.txt");
+        Response alias_reply = statics.serve(Method::h1_get, Schema::http_1_1, "/alias.txt");
+
+        if (escape_reply.status != Status::stat_not_found || escape_reply.file_body || alias_reply.status != Status::stat_ok || !alias_reply.file_body || alias_reply.file_body->length != 10)
+        {
+            std::cerr << "Invalid symlink replies.\n";
+            return 1;
+        }
+    }
+
+    std::remove((std::string {doc_root} + "/escape.txt").c_str());
+    std::remove((std::string {doc_root} + "/alias.txt").c_str());
+    std::remove((std::string {outside_dir} + "/secret.txt").c_str());
+    std::remove(outside_dir);
+
+    std::cout << "C1...\n";
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, pipe_fds) != 0)
+    {
+        std::cerr << "Failed to create socket pair.\n";
+        return 1;
+    }
+
+    std::string_view cached_requests {
+        "GET /hello.txt HTTP/1.1\r\n\r\n"
+        "GET /hello.txt HTTP/1.1\r\n\r\n"
+        "HEAD /hello.txt HTTP/1.1\r\nConnection: close\r\n\r\n"
+    };
+
+    write_rc = write(pipe_fds[1], cached_requests.data(), cached_requests.length());
+    std::string cached_replies;
+    CacheStats cache_stats {};
+
+    {
+        StaticFiles statics {doc_root};
+        StaticCache cache {statics, CacheLimits {1 << 20, 4096}};
+        HttpSession session {SocketConfig {pipe_fds[0], 0, 0}, [&cache](const RequestView& req) {
+            return cache.serve(req);
+        }, SessionLimits {1000, 100}};
+
+        served_count = session.serve();
+        cache_stats = cache.getStats();
+    }
+
+    for (ssize_t read_count = 0; (read_count = read(pipe_fds[1], read_buf, sizeof(read_buf))) > 0;)
+        cached_replies.append(read_buf, static_cast<std::size_t>(read_count));
+
+    close(pipe_fds[1]);
+
+    std::string cached_head = "HTTP/1.1 200 OK\r\nContent-Type: text/plain; charset=utf-8\r\nContent-Length: 10\r\nVary: Accept-Encoding\r\nETag: " + hello_tag + "\r\n";
+    std::size_t second_pos = cached_replies.find("HTTP/1.1", 1);
+    std::size_t third_pos = cached_replies.find("HTTP/1.1", second_pos + 1);
+
+    if (served_count != 3 || cache_stats.hits != 2 || cache_stats.misses != 1 || cache_stats.entry_count != 1
+        || !cached_replies.starts_with(cached_head) || third_pos == std::string::npos
+        || cached_replies.substr(0, second_pos).find(" GMT\r\nConnection: keep-alive\r\n\r\nhello file") == std::string::npos
+        || !stripDateLines(cached_replies) || !cached_replies.ends_with("Connection: close\r\n\r\n"))
+    {
+        std::cerr << "Invalid cached replies (" << cache_stats.hits << " hits, " << cache_stats.misses << " misses):\n" << cached_replies << '\n';
+        return 1;
+    }
+
+    std::cout << "V1...\n";
+    {
+        // every path carries the same validator for the same variant, and a match gets 304 on each of them
+        StaticFiles statics {doc_root};
+        StaticCache cache {statics, CacheLimits {1 << 20, 4096}};
+        StaticCache tiny_cache {statics, CacheLimits {1 << 20, 4}};
+        std::string weak_list = "\"other\", W/" + hello_tag;
+
+        Response plain_reply = statics.serve(Method::h1_get, Schema::http_1_1, "/hello.txt");
+        Response large_reply = tiny_cache.serve(Method::h1_get, Schema::http_1_1, "/hello.txt");
+        Response fresh_reply = statics.serve(Method::h1_get, Schema::http_1_1, "/hello.txt", "", "\"other\"");
+        Response plain_304 = statics.serve(Method::h1_get, Schema::http_1_1, "/hello.txt", "", hello_tag);
+        Response large_304 = tiny_cache.serve(Method::h1_head, Schema::http_1_1, "/hello.txt", "", "*");
+        Response miss_304 = cache.serve(Method::h1_get, Schema::http_1_1, "/hello.txt", "", weak_list);
+        Response hit_304 = cache.serve(Method::h1_get, Schema::http_1_1, "/hello.txt", "", hello_tag);
+        Response hit_reply = cache.serve(Method::h1_get, Schema::http_1_0, "/hello.txt");
+
+        if (plain_reply.headers["ETag"] != hello_tag || large_reply.headers["ETag"] != hello_tag || fresh_reply.status != Status::stat_ok
+            || !hit_reply.prebuilt || hit_reply.prebuilt->reply->bytes.find("ETag: " + hello_tag + "\r\n") == std::string::npos)
+        {
+            std::cerr << "Invalid file validators.\n";
+            return 1;
+        }
+
+        for (Response* not_modified : {&plain_304, &large_304, &miss_304, &hit_304})
+        {
+            if (not_modified->status != Status::stat_not_modified || not_modified->file_body || not_modified->prebuilt
+                || not_modified->headers["ETag"] != hello_tag || not_modified->headers["Vary"] != "Accept-Encoding")
+            {
+                std::cerr << "Invalid 304 reply.\n";
+                return 1;
+            }
+        }
+
+        // the shared entry was built by HTTP/1.1 requests, yet an HTTP/1.0 client must see its own version
+        MemoryTransport cached_pipe {};
+        BasicHttpWriter<MemoryTransport> cached_writer {&cached_pipe};
+
+        cached_writer.queueReply(std::move(hit_reply), false);
+        cached_writer.flush();
+
+        std::string cached_text {cached_pipe.getOutput()};
+
+        if (cache.getStats().hits != 2 || !stripDateLines(cached_text) || cached_text != "HTTP/1.0 200 OK\r\n" + cached_head.substr(17) + "Connection: close\r\n\r\nhello file")
+        {
+            std::cerr << "Invalid HTTP/1.0 cached reply:\n" << cached_text << '\n';
+            return 1;
+        }
+    }
+
+    std::cout << "Z1...\n";
+    constexpr unsigned gzip_bit = 1U << static_cast<unsigned>(Coding::coding_gzip);
+    constexpr unsigned br_bit = 1U << static_cast<unsigned>(Coding::coding_br);
+
+    if (parseAcceptEncoding("gzip, deflate, br;q=0") != gzip_bit || parseAcceptEncoding("*, gzip;q=0.0") != br_bit
+        || parseAcceptEncoding("BR;q=0.5, x-gzip") != (br_bit | gzip_bit) || parseAcceptEncoding("identity") != 0 || parseAcceptEncoding("br;q=0.001") != br_bit)
+    {
+        std::cerr << "Invalid parseAcceptEncoding results.\n";
+        return 1;
+    }
+
+    // only a gzip sidecar exists, so br clients get the plain file
+    std::ofstream {std::string {doc_root} + "/hello.txt.gz"} << "gzipped";
+
+    {
+        StaticFiles statics {doc_root};
+        StaticCache cache {statics, CacheLimits {1 << 20, 4096}};
+        Response gzip_reply = statics.serve(Method::h1_get, Schema::http_1_1, "/hello.txt", "br;q=0, gzip");
+        Response plain_reply = statics.serve(Method::h1_get, Schema::http_1_1, "/hello.txt", "br");
+        Response cached_gzip = cache.serve(Method::h1_get, Schema::http_1_1, "/hello.txt", "gzip");
+        Response cached_plain = cache.serve(Method::h1_get, Schema::http_1_1, "/hello.txt");
+
+        // owned requests keep header names as sent, so the lookup must ignore their case, and a repeated name keeps its first value
+        HeaderView lower_fields[] {{"accept-encoding", "gzip"}, {"host", "localhost"}, {"Accept-Encoding", "br"}};
+        Request owned_gzip = toOwnedRequest(RequestView {Schema::http_1_1, Method::h1_get, "GET", "/hello.txt", lower_fields, nullptr, {}, nullptr});
+        Response owned_reply = statics.serve(owned_gzip);
+
+        if (gzip_reply.headers["Content-Encoding"] != "gzip" || !gzip_reply.file_body || gzip_reply.file_body->length != 7
+            || plain_reply.headers.contains("Content-Encoding") || !plain_reply.file_body || plain_reply.file_body->length != 10
+            || !cached_gzip.prebuilt || cached_gzip.prebuilt->reply->bytes.find("Content-Encoding: gzip\r\n") == std::string::npos || !cached_gzip.prebuilt->reply->bytes.ends_with("gzipped")
+            || !cached_plain.prebuilt || !cached_plain.prebuilt->reply->bytes.ends_with("hello file") || cache.getStats().entry_count != 2
+            || owned_gzip.headers.find(std::string_view {"Host"}) == owned_gzip.headers.end() || owned_gzip.headers.size() != 2
+            || owned_gzip.headers.find(std::string_view {"Accept-Encoding"})->second != "gzip"
+            || owned_reply.headers["Content-Encoding"] != "gzip" || !owned_reply.file_body || owned_reply.file_body->length != 7)
+        {
+            std::cerr << "Invalid precompressed replies.\n";
+            return 1;
+        }
+    }
+
+    std::remove((std::string {doc_root} + "/hello.txt.gz").c_str());
+    std::remove((std::string {doc_root} + "/big.bin").c_str());
+    std::remove((std::string {doc_root} + "/docs/index.html").c_str());
+    std::remove((std::string {doc_root} + "/docs").c_str());
+    std::remove((std::string {doc_root} + "/hello.txt").c_str());
+    std::remove(doc_root);
+}
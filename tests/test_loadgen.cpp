@@ -0,0 +1,144 @@
+/**
+ * @file test_loadgen.cpp
+ * @author DrkWithT
+ * @brief Implements unit test for the load generator's histogram and reply framing.
+ * @date 2024-09-05
+ */
+
+#include <cstdint>
+#include <algorithm>
+#include <iostream>
+#include <stdexcept>
+#include <string_view>
+#include "loadgen/driver.hpp"
+#include "loadgen/histogram.hpp"
+#include "loadgen/replies.hpp"
+
+using namespace ToyServer::LoadGen;
+
+/// @brief Frames every reply in `wire`, handing the parser at most `step_size` octets past what it already took.
+/// @return Count of complete replies, or -1 on a framing mismatch.
+static int countReplies(std::string_view wire, std::size_t step_size, int& last_status)
+{
+    ReplyParser parser {};
+    std::size_t used_total = 0;
+    std::size_t visible = 0;
+    int reply_count = 0;
+
+    while (used_total < wire.length())
+    {
+        visible = std::min(wire.length(), std::max(visible, used_total) + step_size);
+        used_total += parser.feed(wire.substr(used_total, visible - used_total));
+
+        if (parser.isDone())
+        {
+            last_status = parser.getStatusCode();
+            reply_count++;
+            parser.reset();
+        }
+        else if (visible == wire.length() && used_total < wire.length())
+            return -1;
+    }
+
+    return reply_count;
+}
+
+int main()
+{
+    std::cout << "H1...\n";
+    HdrHistogram latency = makeLatencyHistogram();
+
+    for (std::uint64_t value = 1; value <= 10000; value++)
+        latency.record(value * 1000);
+
+    // 3 significant digits: each percentile lands within 0.1% of the exact value
+    auto p50 = latency.getValueAtPercentile(50.0);
+    auto p99 = latency.getValueAtPercentile(99.0);
+    auto p999 = latency.getValueAtPercentile(99.9);
+
+    if (p50 < 5'000'000 || p50 > 5'005'000 || p99 < 9'900'000 || p99 > 9'910'000 || p999 < 9'990'000 || p999 > 10'000'000 || latency.getMax() != 10'000'000)
+    {
+        std::cerr << "Invalid percentiles: " << p50 << ' ' << p99 << ' ' << p999 << ' ' << latency.getMax() << '\n';
+        return 1;
+    }
+
+    std::cout << "H2...\n";
+    HdrHistogram small_values {1000, 3};
+
+    for (std::uint64_t value = 0; value < 2048; value++)
+        small_values.record(value);
+
+    // values under the first bucket's sub-bucket count are exact, larger ones clamp to the trackable maximum
+    if (small_values.getValueAtPercentile(0.0) != 0 || small_values.getValueAtPercentile(25.0) != 511 || small_values.getMax() != 1000)
+    {
+        std::cerr << "Invalid small value percentiles: " << small_values.getValueAtPercentile(25.0) << ' ' << small_values.getMax() << '\n';
+        return 1;
+    }
+
+    std::cout << "H3...\n";
+    HdrHistogram fast_half = makeLatencyHistogram();
+    HdrHistogram slow_half = makeLatencyHistogram();
+
+    for (int sample_idx = 0; sample_idx < 100; sample_idx++)
+    {
+        fast_half.record(1000);
+        slow_half.record(1'000'000);
+    }
+
+    fast_half.merge(slow_half);
+
+    if (fast_half.getTotalCount() != 200 || fast_half.getValueAtPercentile(50.0) != 1000 || fast_half.getValueAtPercentile(50.5) < 1'000'000 || fast_half.getMin() != 1000)
+    {
+        std::cerr << "Invalid merged histogram.\n";
+        return 1;
+    }
+
+    std::cout << "P1...\n";
+    constexpr std::string_view pipelined_replies =
+        "HTTP/1.1 200 OK\r\nContent-Length: 5\r\nContent-Type: text/plain\r\n\r\nhello"
+        "HTTP/1.1 204 No Content\r\n\r\n"
+        "HTTP/1.1 200 OK\r\ntransfer-encoding: chunked\r\n\r\n4;ext=1\r\nWiki\r\n5\r\npedia\r\n0\r\nX-Trailer: 1\r\n\r\n"
+        "HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\n\r\n";
+
+    for (std::size_t step_size : {std::size_t {1}, std::size_t {7}, pipelined_replies.length()})
+    {
+        int last_status = 0;
+        int reply_count = countReplies(pipelined_replies, step_size, last_status);
+
+        if (reply_count != 4 || last_status != 404)
+        {
+            std::cerr << "Invalid reply framing at step " << step_size << ": " << reply_count << " replies, last status " << last_status << '\n';
+            return 1;
+        }
+    }
+
+    std::cout << "P2...\n";
+    ReplyParser closing_parser {};
+    std::string_view unframed_reply = "HTTP/1.0 200 OK\r\nServer: old\r\n\r\nuntil the end";
+
+    if (closing_parser.feed(unframed_reply) != unframed_reply.length() || closing_parser.isDone() || !closing_parser.isClosing() || !closing_parser.finishOnClose() || !closing_parser.isDone())
+    {
+        std::cerr << "Invalid close-delimited reply.\n";
+        return 1;
+    }
+
+    std::cout << "P3...\n";
+    ReplyParser bad_parser {};
+
+    try
+    {
+        [[maybe_unused]] auto used_count = bad_parser.feed("SPDY/3 200 OK\r\n\r\n");
+        std::cerr << "Invalid acceptance of a bad status line.\n";
+        return 1;
+    }
+    catch (const std::runtime_error&) {}
+
+    std::cout << "Q1...\n";
+    LoadConfig config {"localhost", "8080", "/index.html", LoadMode::load_closed, 0.0, 1, 1, 1, std::chrono::seconds {1}, false};
+
+    if (makeRequestText(config) != "GET /index.html HTTP/1.1\r\nHost: localhost:8080\r\nUser-Agent: toyload\r\nConnection: close\r\n\r\n")
+    {
+        std::cerr << "Invalid request text: " << makeRequestText(config) << '\n';
+        return 1;
+    }
+}
@@ -0,0 +1,176 @@
+/**
+ * @file test_metrics.cpp
+ * @author DrkWithT
+ * @brief Implements unit test for per-thread metrics, their Prometheus exposition and the scrape endpoint.
+ * @date 2024-09-06
+ */
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <array>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+#include "metrics/metrics.hpp"
+#include "http1/exporter.hpp"
+#include "http1/session.hpp"
+
+using namespace ToyServer;
+using namespace ToyServer::Metrics;
+
+static constexpr std::size_t thread_count = 4;
+static constexpr std::uint64_t rounds_per_thread = 1000;
+
+static void recordRounds()
+{
+    ThreadMetrics& metrics = threadMetrics();
+
+    for (std::uint64_t round = 0; round < rounds_per_thread; round++)
+    {
+        metrics.add(Counter::c_accepts);
+        metrics.add(Counter::c_bytes_in, 3);
+        metrics.countRequest(Http1::Method::h1_get, Http1::Status::stat_not_found);
+        metrics.observe(Timer::t_handler, std::chrono::nanoseconds {1500});
+    }
+}
+
+static void runRecorders()
+{
+    std::vector<std::thread> recorders;
+
+    for (std::size_t thread_idx = 0; thread_idx < thread_count; thread_idx++)
+        recorders.emplace_back(recordRounds);
+
+    for (auto& recorder : recorders)
+        recorder.join();
+}
+
+int main()
+{
+    std::cout << "B1...\n";
+    for (std::size_t bucket_idx = 0; bucket_idx + 1 < bucket_count; bucket_idx++)
+    {
+        std::uint64_t bound = bucketBound(bucket_idx);
+
+        if (bucketOf(bound) != bucket_idx || bucketOf(bound + 1) != bucket_idx + 1 || (bucket_idx > 0 && bound <= bucketBound(bucket_idx - 1)))
+        {
+            std::cerr << "Invalid bucket bound " << bound << " at " << bucket_idx << '\n';
+            return 1;
+        }
+    }
+
+    std::cout << "T1...\n";
+    MetricsSnapshot before = collectMetrics();
+    runRecorders();
+    MetricsSnapshot after = collectMetrics();
+
+    const TimerTotals& handler_times = after.getTimer(Timer::t_handler);
+    std::uint64_t recorded_rounds = thread_count * rounds_per_thread;
+
+    if (after.get(Counter::c_accepts) - before.get(Counter::c_accepts) != recorded_rounds || after.get(Counter::c_bytes_in) - before.get(Counter::c_bytes_in) != 3 * recorded_rounds || after.getRequests(Http1::Method::h1_get, Http1::Status::stat_not_found) != recorded_rounds || handler_times.count != recorded_rounds || handler_times.buckets[bucketOf(1500)] != recorded_rounds || handler_times.sum_ns != 1500 * recorded_rounds)
+    {
+        std::cerr << "Invalid totals after concurrent recording: " << after.get(Counter::c_accepts) << ' ' << handler_times.count << '\n';
+        return 1;
+    }
+
+    std::cout << "T2...\n";
+    // blocks of finished threads are reused, and their counts are kept
+    runRecorders();
+    MetricsSnapshot reused = collectMetrics();
+
+    if (reused.block_count != after.block_count || reused.get(Counter::c_accepts) - after.get(Counter::c_accepts) != recorded_rounds)
+    {
+        std::cerr << "Invalid block reuse: " << after.block_count << " then " << reused.block_count << '\n';
+        return 1;
+    }
+
+    std::cout << "X1...\n";
+    std::string text {};
+    writePrometheus(reused, text);
+
+    for (std::string_view expected : {
+        "# TYPE toyserver_accepts_total counter\ntoyserver_accepts_total 8000\n",
+        "toyserver_requests_total{method=\"GET\",status=\"404\"} 8000\n",
+        "toyserver_received_bytes_total 24000\n",
+        "# TYPE toyserver_handler_seconds histogram\n",
+        "toyserver_handler_seconds_bucket{le=\"1.024e-06\"} 0\n",
+        "toyserver_handler_seconds_bucket{le=\"1.536e-06\"} 8000\n",
+        "toyserver_handler_seconds_bucket{le=\"+Inf\"} 8000\ntoyserver_handler_seconds_sum 0.012\ntoyserver_handler_seconds_count 8000\n"
+    })
+    {
+        if (text.find(expected) == std::string::npos)
+        {
+            std::cerr << "Missing exposition text: " << expected << "\nin:\n" << text;
+            return 1;
+        }
+    }
+
+    std::cout << "E1...\n";
+    int inner_calls = 0;
+    Http1::RequestHandler endpoint = Http1::withMetricsEndpoint("/stats", [&inner_calls](const Http1::RequestView&) {
+        inner_calls++;
+        return Http1::Response {Http1::Schema::http_1_1, Http1::Status::stat_not_found, "", {}, NetIO::FixedBuffer {0}};
+    });
+
+    Http1::Response scrape = endpoint({Http1::Schema::http_1_1, Http1::Method::h1_get, "GET", "/stats?debug=1", {}, nullptr, {}, nullptr});
+    Http1::Response head_scrape = endpoint({Http1::Schema::http_1_0, Http1::Method::h1_head, "HEAD", "/stats", {}, nullptr, {}, nullptr});
+    Http1::Response passed = endpoint({Http1::Schema::http_1_1, Http1::Method::h1_get, "GET", "/metrics", {}, nullptr, {}, nullptr});
+
+    std::string_view scrape_text {scrape.body.getBasePtr(), scrape.body.getCapacity()};
+
+    if (scrape.status != Http1::Status::stat_ok || !scrape_text.starts_with("# HELP toyserver_accepts_total") || !scrape.headers.contains(Http1::FieldId::f_content_type) || head_scrape.body.getCapacity() != 0 || !head_scrape.headers.contains(Http1::FieldId::f_content_length) || head_scrape.schema != Http1::Schema::http_1_0 || passed.status != Http1::Status::stat_not_found || inner_calls != 1)
+    {
+        std::cerr << "Invalid metrics endpoint routing.\n";
+        return 1;
+    }
+
+    std::cout << "S1...\n";
+    int pair_fds[2] {-1, -1};
+
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, pair_fds) == -1)
+    {
+        std::cerr << "Cannot create socket pair.\n";
+        return 1;
+    }
+
+    constexpr std::string_view request_text = "GET /metrics HTTP/1.1\r\nHost: localhost\r\nConnection: close\r\n\r\n";
+
+    if (write(pair_fds[1], request_text.data(), request_text.length()) != static_cast<ssize_t>(request_text.length()))
+    {
+        std::cerr << "Cannot write request.\n";
+        return 1;
+    }
+
+    MetricsSnapshot before_session = collectMetrics();
+    std::size_t served_count = 0;
+
+    {
+        Http1::HttpSession session {{pair_fds[0], 0, 1}, Http1::withMetricsEndpoint(std::string {Http1::default_metrics_path}, [](const Http1::RequestView&) {
+            return Http1::Response {Http1::Schema::http_1_1, Http1::Status::stat_not_found, "", {}, NetIO::FixedBuffer {0}};
+        }), {200, 4}};
+
+        served_count = session.serve();
+    }
+
+    MetricsSnapshot after_session = collectMetrics();
+    std::string reply_text {};
+    std::array<char, 4096> reply_chunk;
+    ssize_t reply_size = 0;
+
+    for (ssize_t chunk_size = 0; (chunk_size = read(pair_fds[1], reply_chunk.data(), reply_chunk.size())) > 0; reply_size += chunk_size)
+        reply_text.append(reply_chunk.data(), chunk_size);
+
+    close(pair_fds[1]);
+
+    auto grew = [&before_session, &after_session](Counter id) { return after_session.get(id) - before_session.get(id); };
+    auto grewTimer = [&before_session, &after_session](Timer id) { return after_session.getTimer(id).count - before_session.getTimer(id).count; };
+
+    if (served_count != 1 || reply_size <= 0 || !reply_text.starts_with("HTTP/1.1 200 OK\r\n") || grew(Counter::c_conns_opened) != 1 || grew(Counter::c_conns_closed) != 1 || grew(Counter::c_bytes_in) != request_text.length() || grew(Counter::c_bytes_out) != static_cast<std::uint64_t>(reply_size) || after_session.getRequests(Http1::Method::h1_get, Http1::Status::stat_ok) != 1 || grewTimer(Timer::t_parse) != 1 || grewTimer(Timer::t_handler) != 1 || grewTimer(Timer::t_write) != 2)
+    {
+        std::cerr << "Invalid session metrics: served " << served_count << ", in " << grew(Counter::c_bytes_in) << ", out " << grew(Counter::c_bytes_out) << " of " << reply_size << ", writes " << grewTimer(Timer::t_write) << '\n';
+        return 1;
+    }
+}
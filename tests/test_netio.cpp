@@ -0,0 +1,156 @@
+/**
+ * @file test_netio.cpp
+ * @author DrkWithT
+ * @brief Implements unit test for NetIO buffers.
+ * @date 2024-08-22
+ * 
+ * @copyright Copyright (c) 2024
+ * 
+ */
+
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+#include "netio/buffers.hpp"
+#include "netio/pools.hpp"
+
+using namespace ToyServer::NetIO;
+
+static void fillRing(RingBuffer& ring, std::string_view text)
+{
+    auto [first, second] = ring.getFreeSpans();
+    std::size_t first_count = std::min(text.length(), first.size());
+
+    std::copy(text.begin(), text.begin() + first_count, first.begin());
+    std::copy(text.begin() + first_count, text.end(), second.begin());
+
+    ring.commitWrite(text.length());
+}
+
+int main()
+{
+    RingBuffer ring {12};
+
+    std::cout << "R1...\n";
+    if (ring.getCapacity() != 16 || !ring.isEmpty())
+    {
+        std::cerr << "Invalid ring capacity: " << ring.getCapacity() << '\n';
+        return 1;
+    }
+
+    std::cout << "R2...\n";
+    fillRing(ring, "GET / HTTP/1.1\r\n");
+
+    auto line_end = ring.findOctet('\n');
+
+    if (!line_end || *line_end != 15)
+    {
+        std::cerr << "Invalid delimiter offset in full ring.\n";
+        return 1;
+    }
+
+    std::string line (*line_end, '\0');
+    ring.copyOut(line.data(), line.length());
+    ring.discard(1);
+
+    if (line != "GET / HTTP/1.1\r" || !ring.isEmpty())
+    {
+        std::cerr << "Invalid copied line: " << line << '\n';
+        return 1;
+    }
+
+    std::cout << "R3...\n";
+    // leave one octet buffered at offset 9, so the next fill wraps around the block end
+    fillRing(ring, "0123456789");
+    ring.discard(9);
+    fillRing(ring, "abcdefghi\nkl");
+
+    auto wrapped_end = ring.findOctet('\n');
+
+    if (!wrapped_end || *wrapped_end != 10)
+    {
+        std::cerr << "Invalid delimiter offset across wrap.\n";
+        return 1;
+    }
+
+    auto flat = ring.linearize();
+
+    if (std::string_view {flat.data(), flat.size()} != "9abcdefghi\nkl")
+    {
+        std::cerr << "Invalid linearized contents.\n";
+        return 1;
+    }
+
+    std::string wrapped (ring.getSize(), '\0');
+    ring.copyOut(wrapped.data(), wrapped.length());
+
+    if (wrapped != "9abcdefghi\nkl" || !ring.isEmpty())
+    {
+        std::cerr << "Invalid wrapped contents: " << wrapped << '\n';
+        return 1;
+    }
+
+    std::cout << "R4...\n";
+    fillRing(ring, std::string(16, 'x'));
+
+    if (ring.getSpace() != 0 || ring.findOctet('\n'))
+    {
+        std::cerr << "Invalid state for full ring without delimiter.\n";
+        return 1;
+    }
+
+    std::cout << "P1...\n";
+    FixedBuffer small_buf {10};
+    FixedBuffer copied_buf {small_buf};
+    small_buf[0] = 'a';
+
+    if (reinterpret_cast<std::uintptr_t>(small_buf.getBasePtr()) % BufferPool::slab_alignment != 0
+        || reinterpret_cast<std::uintptr_t>(copied_buf.getBasePtr()) % BufferPool::slab_alignment != 0
+        || small_buf.getBasePtr()[10] != '\0' || copied_buf.getBasePtr() == small_buf.getBasePtr())
+    {
+        std::cerr << "Invalid pooled buffer placement.\n";
+        return 1;
+    }
+
+    std::cout << "P2...\n";
+    BufferPool& pool = BufferPool::getInstance();
+
+    // after one warm up round, churn of the same sizes must only recycle slabs
+    auto churnBuffers = []() {
+        std::vector<FixedBuffer> buffers;
+
+        for (std::size_t round = 0; round < 16; round++)
+        {
+            buffers.emplace_back(100);
+            buffers.emplace_back(4096);
+            buffers.emplace_back(16384);
+        }
+    };
+
+    churnBuffers();
+    PoolStats warm_stats = pool.getStats();
+
+    for (int round = 0; round < 100; round++)
+        churnBuffers();
+
+    if (pool.getStats().carved_count != warm_stats.carved_count)
+    {
+        std::cerr << "Steady state churn carved new slabs.\n";
+        return 1;
+    }
+
+    std::cout << "P3...\n";
+    // slabs cached by an exited thread go back to the shared lists for others
+    std::thread {churnBuffers}.join();
+    PoolStats thread_stats = pool.getStats();
+    std::thread {churnBuffers}.join();
+
+    if (pool.getStats().carved_count != thread_stats.carved_count)
+    {
+        std::cerr << "Exited thread's slabs were not reused.\n";
+        return 1;
+    }
+}
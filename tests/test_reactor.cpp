@@ -0,0 +1,246 @@
+/**
+ * @file test_reactor.cpp
+ * @author DrkWithT
+ * @brief Implements unit test for the epoll reactor's pipelining, back-pressure and hang-up handling.
+ * @date 2024-08-10
+ */
+
+#include <sys/socket.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <array>
+#include <iostream>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include "netio/reactor.hpp"
+
+using namespace ToyServer::NetIO;
+
+static constexpr std::size_t big_reply_size = 1 << 20;
+static constexpr int max_rounds = 2000;
+
+/// @brief Replies to one line per call, like handlers that stop after a request: "big" gets 1 MiB, "quit" closes, "boom" throws, others are echoed.
+static ConnState replyOneLine(Connection& conn)
+{
+    std::string& inbox = conn.getInbox();
+    std::size_t line_end = inbox.find('\n');
+
+    if (line_end == std::string::npos)
+        return ConnState::conn_reading;
+
+    std::string line = inbox.substr(0, line_end);
+    inbox.erase(0, line_end + 1);
+
+    if (line == "boom")
+        throw std::runtime_error {"handler failure"};
+
+    if (line == "big")
+        conn.queueOutput(std::string(big_reply_size, 'x'));
+    else
+        conn.queueOutput(line + "!\n");
+
+    return (line == "quit") ? ConnState::conn_closing : ConnState::conn_reading;
+}
+
+/// @brief Creates a connected pair: the first end goes to the reactor, the second stays a blocking test client.
+static std::optional<std::array<int, 2>> makePeers()
+{
+    std::array<int, 2> fds {-1, -1};
+
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds.data()) == -1)
+        return {};
+
+    return fds;
+}
+
+static void sendText(int fd, std::string_view text)
+{
+    [[maybe_unused]] auto write_rc = write(fd, text.data(), text.length());
+}
+
+/// @brief Runs the reactor while collecting the client's replies, until `expected_size` octets or EOF arrived.
+static std::string pumpReplies(Reactor& reactor, int client_fd, std::size_t expected_size, bool& saw_eof)
+{
+    std::string replies {};
+    std::array<char, 65536> chunk;
+
+    saw_eof = false;
+    fcntl(client_fd, F_SETFL, fcntl(client_fd, F_GETFL, 0) | O_NONBLOCK);
+
+    for (int round = 0; round < max_rounds && replies.length() < expected_size && !saw_eof; round++)
+    {
+        reactor.runOnce(5);
+
+        for (ssize_t chunk_size = 0; (chunk_size = read(client_fd, chunk.data(), chunk.size())) != -1;)
+        {
+            if (chunk_size == 0)
+            {
+                saw_eof = true;
+                break;
+            }
+
+            replies.append(chunk.data(), chunk_size);
+        }
+    }
+
+    return replies;
+}
+
+int main()
+{
+    ServerSocket listener {};
+
+    {
+        AddrInfo resolver {{"0", 16, 1}};
+
+        // any free port will do, the tests hand connections to the reactor directly
+        while (auto option = resolver.getNextOption())
+        {
+            if (option->socket_fd != -1)
+            {
+                listener = ServerSocket {*option, true};
+                break;
+            }
+        }
+    }
+
+    Reactor reactor {listener, replyOneLine};
+    bool saw_eof = false;
+
+    std::cout << "E1...\n";
+    // three requests in one segment must all be answered, even by a one-request handler
+    auto pipelined = makePeers();
+
+    if (!pipelined)
+    {
+        std::cerr << "Cannot create socket pair.\n";
+        return 1;
+    }
+
+    reactor.adoptConnection({(*pipelined)[0], 0, 1});
+    sendText((*pipelined)[1], "a\nb\nc\n");
+
+    if (std::string replies = pumpReplies(reactor, (*pipelined)[1], 6, saw_eof); replies != "a!\nb!\nc!\n")
+    {
+        std::cerr << "Invalid pipelined replies: " << replies << '\n';
+        return 1;
+    }
+
+    close((*pipelined)[1]);
+    reactor.runOnce(5);
+
+    if (reactor.getConnectionCount() != 0)
+    {
+        std::cerr << "Closed peer was not dropped.\n";
+        return 1;
+    }
+
+    std::cout << "E2...\n";
+    // requests queued behind a back-pressured reply, and ones sent while it was stuck, still get answered
+    auto pressured = makePeers();
+
+    if (!pressured)
+    {
+        std::cerr << "Cannot create socket pair.\n";
+        return 1;
+    }
+
+    reactor.adoptConnection({(*pressured)[0], 0, 1});
+    sendText((*pressured)[1], "big\nb\n");
+    reactor.runOnce(5);
+    sendText((*pressured)[1], "late\n");
+    reactor.runOnce(5);
+
+    std::string pressured_replies = pumpReplies(reactor, (*pressured)[1], big_reply_size + 9, saw_eof);
+
+    if (pressured_replies.length() != big_reply_size + 9 || !pressured_replies.ends_with("xb!\nlate!\n"))
+    {
+        std::cerr << "Invalid replies after back-pressure: " << pressured_replies.length() << " octets\n";
+        return 1;
+    }
+
+    std::cout << "E3...\n";
+    // a hang-up seen while output is backed up drops the connection only after the flush
+    sendText((*pressured)[1], "big\nb\n");
+    shutdown((*pressured)[1], SHUT_WR);
+
+    std::string flushed_replies = pumpReplies(reactor, (*pressured)[1], big_reply_size + 4 + 1, saw_eof);
+
+    if (flushed_replies.length() != big_reply_size + 3 || !flushed_replies.ends_with("xb!\n") || !saw_eof || reactor.getConnectionCount() != 0)
+    {
+        std::cerr << "Invalid flush before hang-up: " << flushed_replies.length() << " octets, eof " << saw_eof << '\n';
+        return 1;
+    }
+
+    close((*pressured)[1]);
+
+    std::cout << "E4...\n";
+    // a closing reply is flushed before the drop, and input after it is ignored
+    auto closing = makePeers();
+
+    if (!closing)
+    {
+        std::cerr << "Cannot create socket pair.\n";
+        return 1;
+    }
+
+    reactor.adoptConnection({(*closing)[0], 0, 1});
+    sendText((*closing)[1], "quit\nb\n");
+
+    if (std::string replies = pumpReplies(reactor, (*closing)[1], 64, saw_eof); replies != "quit!\n" || !saw_eof || reactor.getConnectionCount() != 0)
+    {
+        std::cerr << "Invalid closing reply: " << replies << '\n';
+        return 1;
+    }
+
+    close((*closing)[1]);
+
+    std::cout << "E5...\n";
+    // a throwing handler drops only its own connection
+    auto healthy = makePeers();
+    auto failing = makePeers();
+
+    if (!healthy || !failing)
+    {
+        std::cerr << "Cannot create socket pair.\n";
+        return 1;
+    }
+
+    reactor.adoptConnection({(*healthy)[0], 0, 1});
+    reactor.adoptConnection({(*failing)[0], 0, 1});
+    sendText((*failing)[1], "boom\n");
+    sendText((*healthy)[1], "ok\n");
+
+    if (std::string replies = pumpReplies(reactor, (*healthy)[1], 4, saw_eof); replies != "ok!\n" || reactor.getConnectionCount() != 1
+        || !pumpReplies(reactor, (*failing)[1], 1, saw_eof).empty() || !saw_eof)
+    {
+        std::cerr << "Invalid handling of a throwing handler: " << reactor.getConnectionCount() << " connections\n";
+        return 1;
+    }
+
+    close((*failing)[1]);
+
+    std::cout << "E6...\n";
+    // a peer that never finishes a line cannot grow the inbox past its cap
+    std::string endless(65536, 'y');
+    std::size_t endless_sent = 0;
+
+    for (int round = 0; round < max_rounds && reactor.getConnectionCount() == 1; round++)
+    {
+        if (ssize_t sent_count = send((*healthy)[1], endless.data(), endless.length(), MSG_NOSIGNAL | MSG_DONTWAIT); sent_count > 0)
+            endless_sent += static_cast<std::size_t>(sent_count);
+
+        reactor.runOnce(5);
+    }
+
+    if (reactor.getConnectionCount() != 0 || endless_sent < Connection::max_inbox_size)
+    {
+        std::cerr << "Oversized input was not dropped: " << endless_sent << " octets sent\n";
+        return 1;
+    }
+
+    close((*healthy)[1]);
+}
@@ -0,0 +1,150 @@
+/**
+ * @file test_shards.cpp
+ * @author DrkWithT
+ * @brief Implements unit test for SO_REUSEPORT shards pinned within the allowed cpuset.
+ * @date 2024-08-17
+ */
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sched.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <cstdint>
+#include <array>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "netio/shards.hpp"
+
+using namespace ToyServer::NetIO;
+
+static constexpr std::size_t shard_count = 3;
+
+/// @brief Finds a free port by binding port 0 once, since every shard must bind the same one.
+static std::string pickFreePort()
+{
+    int probe_fd = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in probe_addr {};
+    socklen_t addr_len = sizeof(probe_addr);
+
+    probe_addr.sin_family = AF_INET;
+    probe_addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    if (probe_fd == -1 || bind(probe_fd, reinterpret_cast<struct sockaddr*>(&probe_addr), sizeof(probe_addr)) == -1 || getsockname(probe_fd, reinterpret_cast<struct sockaddr*>(&probe_addr), &addr_len) == -1)
+    {
+        close(probe_fd);
+        return {};
+    }
+
+    close(probe_fd);
+
+    return std::to_string(ntohs(probe_addr.sin_port));
+}
+
+/// @brief Connects to the shards, sends one line and returns the reply, empty on failure.
+static std::string askShards(const std::string& port)
+{
+    int client_fd = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in server_addr {};
+
+    server_addr.sin_family = AF_INET;
+    server_addr.sin_port = htons(static_cast<std::uint16_t>(std::stoi(port)));
+    server_addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    if (client_fd == -1 || connect(client_fd, reinterpret_cast<struct sockaddr*>(&server_addr), sizeof(server_addr)) == -1)
+    {
+        close(client_fd);
+        return {};
+    }
+
+    std::string reply {};
+    std::array<char, 64> chunk;
+
+    [[maybe_unused]] auto write_rc = write(client_fd, "ping\n", 5);
+
+    for (ssize_t chunk_size = 0; (chunk_size = read(client_fd, chunk.data(), chunk.size())) > 0;)
+        reply.append(chunk.data(), chunk_size);
+
+    close(client_fd);
+
+    return reply;
+}
+
+int main()
+{
+    std::vector<std::size_t> process_cpus = getAllowedCpus();
+
+    std::cout << "S1...\n";
+    // restrict the process to its last allowed CPU, as taskset would, so every shard must land there
+    std::size_t only_cpu = process_cpus.back();
+    cpu_set_t narrow_mask;
+    CPU_ZERO(&narrow_mask);
+    CPU_SET(only_cpu, &narrow_mask);
+
+    if (sched_setaffinity(0, sizeof(narrow_mask), &narrow_mask) != 0 || getAllowedCpus() != std::vector<std::size_t> {only_cpu})
+    {
+        std::cerr << "Cannot narrow the test's cpuset.\n";
+        return 1;
+    }
+
+    std::string port = pickFreePort();
+
+    if (port.empty())
+    {
+        std::cerr << "No free port.\n";
+        return 1;
+    }
+
+    ShardGroup group {{port.c_str(), 16, 1}, shard_count, [](std::size_t shard_idx) {
+        return [shard_idx](Connection& conn) {
+            std::string& inbox = conn.getInbox();
+
+            if (inbox.find('\n') == std::string::npos)
+                return ConnState::conn_reading;
+
+            inbox.clear();
+            conn.queueOutput("shard " + std::to_string(shard_idx) + "\n");
+
+            return ConnState::conn_closing;
+        };
+    }};
+
+    group.start();
+
+    for (std::size_t shard_idx = 0; shard_idx < group.getShardCount(); shard_idx++)
+    {
+        if (group.getShardCpu(shard_idx) != only_cpu)
+        {
+            std::cerr << "Shard " << shard_idx << " not pinned within the cpuset.\n";
+            return 1;
+        }
+    }
+
+    std::cout << "S2...\n";
+    for (int client_idx = 0; client_idx < 16; client_idx++)
+    {
+        std::string reply = askShards(port);
+
+        if (!reply.starts_with("shard ") || !reply.ends_with("\n") || std::stoul(reply.substr(6)) >= shard_count)
+        {
+            std::cerr << "Invalid shard reply: '" << reply << "'\n";
+            return 1;
+        }
+    }
+
+    group.stop();
+
+    std::cout << "S3...\n";
+    // without an explicit count there is one shard per allowed CPU, not per online CPU
+    ShardGroup default_group {{port.c_str(), 16, 1}, 0, [](std::size_t) {
+        return [](Connection&) { return ConnState::conn_closing; };
+    }};
+
+    if (default_group.getShardCount() != 1 || default_group.getShardCpu(0))
+    {
+        std::cerr << "Invalid default shard count: " << default_group.getShardCount() << '\n';
+        return 1;
+    }
+}
@@ -8,9 +8,12 @@
  * 
  */
 
+#include <array>
 #include <iostream>
+#include <memory_resource>
 #include "uri/parse.hpp"
 #include "uri/url.hpp"
+#include "uri/view.hpp"
 
 using namespace ToyServer::Uri;
 
@@ -54,8 +57,8 @@ int main()
 
     auto query_args = unpackItem<UrlItemTag::ur_params>(query_res);
 
-    std::string param1_copy = query_args.at("msg");
-    std::string param2_copy = query_args.at("count");
+    std::string param1_copy {query_args.at("msg")};
+    std::string param2_copy {query_args.at("count")};
 
     if (param1_copy != "test")
     {
@@ -68,4 +71,68 @@ int main()
         std::cout << "Invalid value for query param 'count': " << param2_copy << '\n';
         return 1;
     }
+
+    std::cout << "P4\n";
+    // everything must come from the arena: its upstream and the default resource both refuse to allocate
+    std::array<char, 2048> arena_block;
+    std::pmr::monotonic_buffer_resource arena {arena_block.data(), arena_block.size(), std::pmr::null_memory_resource()};
+    std::pmr::memory_resource* old_default = std::pmr::set_default_resource(std::pmr::null_memory_resource());
+    std::string_view long_query {"/some/rather/long/resource/path/index.html?first_parameter=first_value_here&second_parameter=2"};
+    bool arena_ok = true;
+
+    try
+    {
+        parser.reset(long_query);
+        auto arena_res = parser.parseAll(&arena);
+        const auto& arena_args = std::get<url_params_t>(arena_res.content);
+
+        auto first_it = arena_args.find(std::string_view {"first_parameter"});
+        auto second_it = arena_args.find(std::string_view {"second_parameter"});
+
+        arena_ok = arena_res.path == "/some/rather/long/resource/path/index.html"
+            && first_it != arena_args.end() && first_it->second == "first_value_here"
+            && second_it != arena_args.end() && second_it->second == "2";
+    }
+    catch (const std::bad_alloc&)
+    {
+        arena_ok = false;
+    }
+
+    std::pmr::set_default_resource(old_default);
+
+    if (!arena_ok)
+    {
+        std::cout << "Arena parse allocated outside the arena or gave wrong results.\n";
+        return 1;
+    }
+
+    std::cout << "P5\n";
+    // one pass split into views, then pairs and escapes only as they are asked for
+    auto full_view = parseUrlView("/files/a%20b.txt?name=J%C3%B6rg+M&&flag&x=1=2#top");
+    std::string decoded_path {full_view ? decodeComponent(full_view->path) : ""};
+    std::string decoded_name {full_view ? decodeComponent(full_view->getParams().find("name").value_or(""), true) : ""};
+    std::string joined_params;
+
+    if (full_view)
+    {
+        for (const auto& [key, value] : full_view->getParams())
+            joined_params.append(key).append(":").append(value).append(";");
+    }
+
+    if (!full_view || full_view->path != "/files/a%20b.txt" || full_view->query != "name=J%C3%B6rg+M&&flag&x=1=2"
+        || decoded_path != "/files/a b.txt" || decoded_name != "J\xC3\xB6rg M" || joined_params != "name:J%C3%B6rg+M;flag:;x:1=2;"
+        || !parseUrlView("/")->getParams().empty() || parseUrlView("/a?")->query != "" || parseUrlView("/a?b?c")->query != "b?c")
+    {
+        std::cout << "Invalid URL view: " << decoded_path << ' ' << joined_params << '\n';
+        return 1;
+    }
+
+    for (std::string_view bad_target : {"", "api", "/a b", "/a%2", "/a%zz", "/a\"b", "/a?b=<c>"})
+    {
+        if (parseUrlView(bad_target))
+        {
+            std::cout << "Invalid URL view accepted: " << bad_target << '\n';
+            return 1;
+        }
+    }
 }
@@ -0,0 +1,296 @@
+/**
+ * @file test_uring.cpp
+ * @author DrkWithT
+ * @brief Implements unit test for the io_uring reactor: multishot accept / recv, provided buffers, send chains and cancellation.
+ * @date 2024-08-20
+ */
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdint>
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+#include "netio/uring.hpp"
+
+using namespace ToyServer::NetIO;
+
+static constexpr std::size_t chain_reply_size = (1 << 20) + 3; // one full 16 link chain of 64 KiB sends, plus a second chain
+static constexpr std::size_t echo_size = 100000;              // spans many 4 KiB provided buffers
+
+/// @brief Echoes input, except "big\n" which gets a long patterned reply, "quit\n" which closes without one, "boom\n" which throws and "hold" which is kept unconsumed.
+static ConnState echoOrCommand(Connection& conn)
+{
+    std::string& inbox = conn.getInbox();
+
+    if (inbox == "quit\n")
+    {
+        inbox.clear();
+        return ConnState::conn_closing;
+    }
+
+    if (inbox == "boom\n")
+        throw std::runtime_error {"handler failure"};
+
+    // never consumed, like a request head that does not end
+    if (inbox.starts_with("hold"))
+        return ConnState::conn_reading;
+
+    if (inbox == "big\n")
+    {
+        std::string reply(chain_reply_size, '\0');
+
+        for (std::size_t reply_idx = 0; reply_idx < reply.length(); reply_idx++)
+            reply[reply_idx] = static_cast<char>('a' + reply_idx % 26);
+
+        inbox.clear();
+        conn.queueOutput(reply);
+
+        return ConnState::conn_reading;
+    }
+
+    conn.queueOutput(inbox);
+    inbox.clear();
+
+    return ConnState::conn_reading;
+}
+
+/// @brief Binds a loopback listener on a free port.
+static std::optional<std::uint16_t> makeListener(ServerSocket& listener)
+{
+    int listen_fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    struct sockaddr_in listen_addr {};
+    socklen_t addr_len = sizeof(listen_addr);
+
+    listen_addr.sin_family = AF_INET;
+    listen_addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    if (listen_fd == -1 || bind(listen_fd, reinterpret_cast<struct sockaddr*>(&listen_addr), sizeof(listen_addr)) == -1 || getsockname(listen_fd, reinterpret_cast<struct sockaddr*>(&listen_addr), &addr_len) == -1)
+    {
+        close(listen_fd);
+        return {};
+    }
+
+    listener = ServerSocket {{listen_fd, 16, 1}};
+
+    return ntohs(listen_addr.sin_port);
+}
+
+/// @brief Opens a blocking client whose reads give up after a few seconds instead of hanging the test.
+static int connectClient(std::uint16_t port)
+{
+    int client_fd = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in server_addr {};
+    struct timeval read_timeout {5, 0};
+
+    server_addr.sin_family = AF_INET;
+    server_addr.sin_port = htons(port);
+    server_addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    if (client_fd == -1 || connect(client_fd, reinterpret_cast<struct sockaddr*>(&server_addr), sizeof(server_addr)) == -1)
+    {
+        close(client_fd);
+        return -1;
+    }
+
+    setsockopt(client_fd, SOL_SOCKET, SO_RCVTIMEO, &read_timeout, sizeof(read_timeout));
+
+    return client_fd;
+}
+
+static bool sendAll(int fd, std::string_view text)
+{
+    while (!text.empty())
+    {
+        ssize_t sent_count = send(fd, text.data(), text.length(), MSG_NOSIGNAL);
+
+        if (sent_count == -1 && errno == EINTR)
+            continue;
+
+        if (sent_count <= 0)
+            return false;
+
+        text.remove_prefix(static_cast<std::size_t>(sent_count));
+    }
+
+    return true;
+}
+
+/// @brief Reads until `count` octets arrived, EOF or a timeout.
+static std::string readUpTo(int fd, std::size_t count)
+{
+    std::string received(count, '\0');
+    std::size_t received_count = 0;
+
+    while (received_count < count)
+    {
+        ssize_t chunk_size = recv(fd, received.data() + received_count, count - received_count, 0);
+
+        // io_uring task work can interrupt a socket call with a timeout set
+        if (chunk_size == -1 && errno == EINTR)
+            continue;
+
+        if (chunk_size <= 0)
+            break;
+
+        received_count += static_cast<std::size_t>(chunk_size);
+    }
+
+    received.resize(received_count);
+
+    return received;
+}
+
+int main()
+{
+    if (!isUringSupported())
+    {
+        std::cout << "io_uring unsupported here, skipped.\n";
+        return 0;
+    }
+
+    ServerSocket listener {};
+    auto port = makeListener(listener);
+
+    if (!port)
+    {
+        std::cerr << "Cannot bind a loopback listener.\n";
+        return 1;
+    }
+
+    auto reactor = std::make_unique<UringReactor>(listener, echoOrCommand);
+    std::thread loop_thread {[&reactor] { reactor->run(); }};
+    std::vector<int> idle_fds {};
+    int failures = 0;
+
+    std::cout << "U1...\n";
+    // multishot accept keeps serving after the first connection
+    for (int client_idx = 0; client_idx < 3; client_idx++)
+    {
+        int client_fd = connectClient(*port);
+
+        if (client_fd == -1 || !sendAll(client_fd, "hello") || readUpTo(client_fd, 5) != "hello")
+        {
+            std::cerr << "Invalid echo on connection " << client_idx << '\n';
+            failures++;
+        }
+
+        idle_fds.push_back(client_fd);
+    }
+
+    std::cout << "U2...\n";
+    int echo_fd = connectClient(*port);
+    std::string echo_text(echo_size, '\0');
+
+    for (std::size_t text_idx = 0; text_idx < echo_text.length(); text_idx++)
+        echo_text[text_idx] = static_cast<char>('0' + text_idx % 10);
+
+    if (echo_fd == -1 || !sendAll(echo_fd, echo_text) || readUpTo(echo_fd, echo_size) != echo_text)
+    {
+        std::cerr << "Invalid echo across provided buffers.\n";
+        failures++;
+    }
+
+    idle_fds.push_back(echo_fd);
+
+    std::cout << "U3...\n";
+    int chain_fd = connectClient(*port);
+    std::string chain_reply = (chain_fd != -1 && sendAll(chain_fd, "big\n")) ? readUpTo(chain_fd, chain_reply_size) : "";
+    bool chain_ok = chain_reply.length() == chain_reply_size;
+
+    for (std::size_t reply_idx = 0; chain_ok && reply_idx < chain_reply.length(); reply_idx++)
+        chain_ok = chain_reply[reply_idx] == static_cast<char>('a' + reply_idx % 26);
+
+    // output still flows after the chains, in order
+    if (!chain_ok || !sendAll(chain_fd, "after") || readUpTo(chain_fd, 5) != "after")
+    {
+        std::cerr << "Invalid send chain reply of " << chain_reply.length() << " octets.\n";
+        failures++;
+    }
+
+    idle_fds.push_back(chain_fd);
+
+    std::cout << "U4...\n";
+    // closing cancels the armed multishot recv before the fd goes, then the peer sees EOF
+    int quit_fd = connectClient(*port);
+
+    if (quit_fd == -1 || !sendAll(quit_fd, "quit\n") || !readUpTo(quit_fd, 1).empty())
+    {
+        std::cerr << "Closing connection did not end with EOF.\n";
+        failures++;
+    }
+
+    close(quit_fd);
+
+    // a peer hang-up ends the recv too
+    int hangup_fd = connectClient(*port);
+    sendAll(hangup_fd, "bye");
+    readUpTo(hangup_fd, 3);
+    close(hangup_fd);
+
+    std::cout << "U5...\n";
+    // a throwing handler ends only its own connection
+    int boom_fd = connectClient(*port);
+
+    if (boom_fd == -1 || !sendAll(boom_fd, "boom\n") || !readUpTo(boom_fd, 1).empty())
+    {
+        std::cerr << "Throwing handler did not end with EOF.\n";
+        failures++;
+    }
+
+    close(boom_fd);
+
+    std::cout << "U6...\n";
+    // input the handler never consumes cannot grow past the inbox cap
+    int hold_fd = connectClient(*port);
+    std::string hold_text = "hold" + std::string(Connection::max_inbox_size, 'y');
+
+    // the send may fail once the reactor hangs up, what matters is the EOF
+    sendAll(hold_fd, hold_text);
+
+    if (hold_fd == -1 || !readUpTo(hold_fd, 1).empty())
+    {
+        std::cerr << "Oversized input did not end with EOF.\n";
+        failures++;
+    }
+
+    close(hold_fd);
+
+    std::cout << "U7...\n";
+    // stop, then tear down while every idle connection still has a recv armed
+    std::this_thread::sleep_for(std::chrono::milliseconds {50});
+    reactor->stop();
+    loop_thread.join();
+
+    if (reactor->getConnectionCount() != idle_fds.size())
+    {
+        std::cerr << "Invalid live connections: " << reactor->getConnectionCount() << ", expected " << idle_fds.size() << '\n';
+        failures++;
+    }
+
+    reactor.reset();
+
+    for (int idle_fd : idle_fds)
+    {
+        if (!readUpTo(idle_fd, 1).empty())
+        {
+            std::cerr << "Idle connection not closed by teardown.\n";
+            failures++;
+        }
+
+        close(idle_fd);
+    }
+
+    return (failures == 0) ? 0 : 1;
+}
@@ -0,0 +1,304 @@
+/**
+ * @file test_workers.cpp
+ * @author DrkWithT
+ * @brief Implements unit test for the lock-free queues and the work-stealing worker pool.
+ * @date 2024-08-14
+ */
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cstdint>
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <thread>
+#include <vector>
+#include "netio/queues.hpp"
+#include "netio/workers.hpp"
+
+using namespace ToyServer::NetIO;
+
+static constexpr std::uint64_t stress_item_count = 200000;
+static constexpr std::size_t thief_count = 3;
+
+/// @brief Spins until `done` holds or about 5 seconds pass.
+template <typename Pred>
+static bool waitFor(Pred done)
+{
+    for (int round = 0; round < 5000; round++)
+    {
+        if (done())
+            return true;
+
+        std::this_thread::sleep_for(std::chrono::milliseconds {1});
+    }
+
+    return done();
+}
+
+int main()
+{
+    std::cout << "Q1...\n";
+    {
+        SpscRing<std::uint64_t, 4> small_ring {};
+        StealDeque<std::uint64_t, 4> small_deque {};
+
+        for (std::uint64_t item = 1; item <= 4; item++)
+        {
+            if (!small_ring.tryPush(item) || !small_deque.tryPush(item))
+            {
+                std::cerr << "Push failed below capacity.\n";
+                return 1;
+            }
+        }
+
+        // the ring is FIFO, the owner pops the deque's newest item and thieves take the oldest
+        if (small_ring.tryPush(5) || small_deque.tryPush(5) || small_ring.tryPop() != 1 || small_deque.tryPop() != 4 || small_deque.trySteal() != 1 || small_deque.getSize() != 2)
+        {
+            std::cerr << "Invalid queue ordering or bounds.\n";
+            return 1;
+        }
+    }
+
+    std::cout << "Q2...\n";
+    {
+        // every item crosses the ring exactly once and in order, even while it is full most of the time
+        auto ring = std::make_unique<SpscRing<std::uint64_t, 64>>();
+        std::thread producer {[&ring] {
+            for (std::uint64_t item = 0; item < stress_item_count; item++)
+            {
+                while (!ring->tryPush(item))
+                    std::this_thread::yield();
+            }
+        }};
+
+        std::uint64_t expected = 0;
+
+        while (expected < stress_item_count)
+        {
+            auto item = ring->tryPop();
+
+            if (!item)
+            {
+                std::this_thread::yield();
+                continue;
+            }
+
+            if (*item != expected)
+            {
+                std::cerr << "SpscRing reordered item " << *item << ", expected " << expected << '\n';
+                producer.join();
+                return 1;
+            }
+
+            expected++;
+        }
+
+        producer.join();
+    }
+
+    std::cout << "Q3...\n";
+    {
+        // the owner pushes and pops while thieves steal, and no item is lost or taken twice
+        auto deque = std::make_unique<StealDeque<std::uint64_t, 256>>();
+        std::vector<std::atomic<std::uint8_t>> taken_counts(stress_item_count);
+        std::atomic<bool> pushing_done {false};
+        std::vector<std::thread> thieves;
+
+        for (std::size_t thief_idx = 0; thief_idx < thief_count; thief_idx++)
+        {
+            thieves.emplace_back([&deque, &taken_counts, &pushing_done] {
+                while (!pushing_done.load(std::memory_order_acquire) || deque->getSize() > 0)
+                {
+                    if (auto item = deque->trySteal(); item)
+                        taken_counts[*item].fetch_add(1, std::memory_order_relaxed);
+                    else
+                        std::this_thread::yield();
+                }
+            });
+        }
+
+        for (std::uint64_t item = 0; item < stress_item_count; item++)
+        {
+            while (!deque->tryPush(item))
+            {
+                if (auto popped = deque->tryPop(); popped)
+                    taken_counts[*popped].fetch_add(1, std::memory_order_relaxed);
+            }
+
+            // keep the deque near empty now and then, where owner and thieves race for the last item
+            if (item % 3 == 0)
+            {
+                if (auto popped = deque->tryPop(); popped)
+                    taken_counts[*popped].fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+
+        pushing_done.store(true, std::memory_order_release);
+
+        for (auto& thief : thieves)
+            thief.join();
+
+        for (std::uint64_t item = 0; item < stress_item_count; item++)
+        {
+            if (taken_counts[item].load(std::memory_order_relaxed) != 1)
+            {
+                std::cerr << "StealDeque item " << item << " taken " << static_cast<int>(taken_counts[item].load()) << " times.\n";
+                return 1;
+            }
+        }
+    }
+
+    std::cout << "W1...\n";
+    {
+        // connections queued while one worker is stuck in a long session must go to the idle ones
+        std::atomic<bool> release_blocker {false};
+        std::atomic<std::size_t> quick_done_count {0};
+        WorkerPool pool {4, [&release_blocker, &quick_done_count](SocketConfig config) {
+            if (config.socket_fd == 0)
+            {
+                while (!release_blocker.load(std::memory_order_acquire))
+                    std::this_thread::sleep_for(std::chrono::milliseconds {1});
+
+                return;
+            }
+
+            quick_done_count.fetch_add(1, std::memory_order_relaxed);
+        }};
+
+        pool.start();
+
+        std::vector<SocketConfig> blocker_batch {{0, 0, 1}};
+        pool.submitBatch(blocker_batch);
+
+        if (!waitFor([&pool] { return pool.getQueueDepth() == 0; }))
+        {
+            std::cerr << "Blocking task was never taken.\n";
+            return 1;
+        }
+
+        std::vector<SocketConfig> quick_batch {};
+
+        for (int task_idx = 1; task_idx <= 8; task_idx++)
+            quick_batch.push_back({task_idx, 0, 1});
+
+        pool.submitBatch(quick_batch);
+
+        if (!waitFor([&quick_done_count] { return quick_done_count.load() == 8; }))
+        {
+            std::cerr << "Idle workers left queued tasks waiting: " << quick_done_count.load() << " of 8 done.\n";
+            release_blocker.store(true);
+            return 1;
+        }
+
+        release_blocker.store(true, std::memory_order_release);
+        std::size_t task_total = 0;
+        std::size_t steal_total = 0;
+        std::size_t busy_count = 0;
+
+        waitFor([&pool, &task_total] {
+            task_total = 0;
+
+            for (const auto& stats : pool.getStats())
+                task_total += stats.task_count;
+
+            return task_total == 9;
+        });
+
+        for (const auto& stats : pool.getStats())
+        {
+            busy_count += (stats.task_count > 0) ? 1 : 0;
+            steal_total += stats.steal_count;
+        }
+
+        // the blocked worker's deque got two of the quick tasks, which only peers could have taken
+        if (task_total != 9 || busy_count < 2 || steal_total < 2 || pool.getQueueDepth() != 0)
+        {
+            std::cerr << "Invalid worker stats: " << task_total << " tasks on " << busy_count << " workers, " << steal_total << " stolen.\n";
+            return 1;
+        }
+    }
+
+    std::cout << "W2...\n";
+    {
+        // more connections than the deques hold: the acceptor waits for room and nothing is lost
+        constexpr int burst_size = 5000;
+        std::vector<std::atomic<std::uint8_t>> run_counts(burst_size);
+        WorkerPool pool {3, [&run_counts](SocketConfig config) {
+            run_counts[config.socket_fd].fetch_add(1, std::memory_order_relaxed);
+        }};
+
+        pool.start();
+
+        for (int first_fd = 0; first_fd < burst_size; first_fd += 64)
+        {
+            std::vector<SocketConfig> batch {};
+
+            for (int task_fd = first_fd; task_fd < first_fd + 64 && task_fd < burst_size; task_fd++)
+                batch.push_back({task_fd, 0, 1});
+
+            pool.submitBatch(batch);
+        }
+
+        auto countRuns = [&run_counts] {
+            std::size_t done_count = 0;
+
+            for (const auto& run_count : run_counts)
+                done_count += run_count.load(std::memory_order_relaxed);
+
+            return done_count;
+        };
+
+        if (!waitFor([&countRuns] { return countRuns() == burst_size; }))
+        {
+            std::cerr << "Burst tasks lost: " << countRuns() << " of " << burst_size << '\n';
+            return 1;
+        }
+
+        for (const auto& run_count : run_counts)
+        {
+            if (run_count.load() != 1)
+            {
+                std::cerr << "Burst task ran twice.\n";
+                return 1;
+            }
+        }
+    }
+
+    std::cout << "W3...\n";
+    {
+        // connections submitted after stop() are closed rather than leaked, even more than the deques hold
+        WorkerPool pool {2, [](SocketConfig) {}};
+        std::vector<SocketConfig> late_batch {};
+
+        pool.start();
+        pool.stop();
+
+        for (int pipe_idx = 0; pipe_idx < 600; pipe_idx++)
+        {
+            int pipe_fds[2];
+
+            if (pipe(pipe_fds) != 0)
+            {
+                std::cerr << "Cannot create pipe.\n";
+                return 1;
+            }
+
+            close(pipe_fds[1]);
+            late_batch.push_back({pipe_fds[0], 0, 1});
+        }
+
+        pool.submitBatch(late_batch);
+
+        for (const auto& config : late_batch)
+        {
+            if (fcntl(config.socket_fd, F_GETFD) != -1)
+            {
+                std::cerr << "Late connection fd " << config.socket_fd << " leaked.\n";
+                return 1;
+            }
+        }
+    }
+}